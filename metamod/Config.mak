@@ -4,20 +4,24 @@ MODNAME = metamod
 EXTRA_CFLAGS += -D__METAMOD_BUILD__ 
 #-DMETA_PERFMON
 
-SRCFILES = api_hook.cpp api_info.cpp commands_meta.cpp conf_meta.cpp \
-	dllapi.cpp engine_api.cpp engineinfo.cpp game_support.cpp \
+SRCFILES = api_hook.cpp api_info.cpp api_prof.cpp api_record.cpp \
+	api_trace.cpp commands_meta.cpp conf_meta.cpp \
+	cvar_watch.cpp dllapi.cpp engine_api.cpp engineinfo.cpp ent_class.cpp \
+	ent_filter.cpp ent_grid.cpp ent_index.cpp game_support.cpp \
 	game_autodetect.cpp h_export.cpp linkgame.cpp linkplug.cpp \
-	log_meta.cpp meta_eiface.cpp metamod.cpp mlist.cpp mplayer.cpp \
-	mplugin.cpp mqueue.cpp mreg.cpp mutil.cpp osdep.cpp \
-	osdep_p.cpp reg_support.cpp sdk_util.cpp studioapi.cpp \
-	support_meta.cpp thread_logparse.cpp vdate.cpp
+	log_meta.cpp log_queue.cpp meta_eiface.cpp metamod.cpp mlist.cpp mplayer.cpp \
+	mjobs.cpp mplugin.cpp mqueue.cpp mreg.cpp mutil.cpp osdep.cpp \
+	osdep_p.cpp reg_support.cpp sdk_util.cpp startup_timeline.cpp \
+	string_cache.cpp studioapi.cpp support_meta.cpp thread_logparse.cpp \
+	usermsg.cpp vdate.cpp
 
 INFOFILES = info_name.h vers_meta.h
 RESFILE = res_meta.rc
 
 ifeq "$(OS)" "linux"
-	SRCFILES+=osdep_linkent_linux.cpp osdep_detect_gamedll_linux.cpp
-	EXTRA_LINK+=
+	SRCFILES+=osdep_linkent_linux.cpp osdep_detect_gamedll_linux.cpp \
+		osdep_modmap_linux.cpp
+	EXTRA_LINK+=-lpthread
 else
 	SRCFILES+=osdep_linkent_win32.cpp osdep_detect_gamedll_win32.cpp
 	EXTRA_LINK+=-Xlinker --script -Xlinker i386pe.merge
@@ -39,652 +39,341 @@
 #include "mplugin.h"
 #include "metamod.h"
 #include "osdep.h"			//unlikely
+#include "engine_api.h"		// meta_engfuncs
+#include "log_meta.h"		// META_DEBUG, etc
+#include "api_prof.h"		// api_prof_record, meta_prof_value
+#include "api_trace.h"		// api_trace_record, meta_trace_value
+#include "api_record.h"		// api_record_active
+#include "ent_filter.h"		// ent_filter_bit, etc
 
 // getting pointer with table index is faster than with if-else
-static const void ** api_tables[3] = {
+const void ** const api_tables[3] = {
 	(const void**)&Engine.funcs,
 	(const void**)&GameDLL.funcs.dllapi_table,
 	(const void**)&GameDLL.funcs.newapi_table
 };
 
-static const void ** api_info_tables[3] = {
-	(const void**)&engine_info,
-	(const void**)&dllapi_info,
-	(const void**)&newapi_info
+unsigned int api_hook_call_count = 0;
+
+const unsigned int api_msg_funcs[NUM_API_MSG_FUNCS] = {
+	offsetof(enginefuncs_t, pfnMessageBegin),
+	offsetof(enginefuncs_t, pfnMessageEnd),
+	offsetof(enginefuncs_t, pfnWriteByte),
+	offsetof(enginefuncs_t, pfnWriteChar),
+	offsetof(enginefuncs_t, pfnWriteShort),
+	offsetof(enginefuncs_t, pfnWriteLong),
+	offsetof(enginefuncs_t, pfnWriteAngle),
+	offsetof(enginefuncs_t, pfnWriteCoord),
+	offsetof(enginefuncs_t, pfnWriteString),
+	offsetof(enginefuncs_t, pfnWriteEntity),
 };
 
-// Safety check for metamod-bot-plugin bugfix.
-//  engine_api->pfnRunPlayerMove calls dllapi-functions before it returns.
-//  This causes problems with bots running as metamod plugins, because
-//  metamod assumed that PublicMetaGlobals is free to be used.
-//  With call_count we can fix this by backuping up PublicMetaGlobals if 
-//  it's already being used.
-static unsigned int call_count = 0;
+int api_hook_msg_type = 0;
 
-// get function pointer from api table by function pointer offset
-inline void * DLLINTERNAL get_api_function(const void * api_table, unsigned int func_offset) {
-	return(*(void**)((unsigned long)api_table + func_offset));
-}
+// Storage for one build of the subscriber lists.  Pools replaced while a
+// hook function is iterating them are kept on the retired list until no
+// hook function is running anymore.
+typedef struct api_hook_subscriber_pool_s {
+	struct api_hook_subscriber_pool_s *next;
+	api_hook_subscriber_t subscribers[1];
+} api_hook_subscriber_pool_t;
 
-// get data pointer from api_info table by function offset
-inline const api_info_t * DLLINTERNAL get_api_info(enum_api_t api, unsigned int api_info_offset) {
-	return((const api_info_t *)((unsigned long)api_info_tables[api] + api_info_offset));
-}
+const unsigned int api_func_base[3] = {
+	0,
+	NUM_ENGINE_FUNCS,
+	NUM_ENGINE_FUNCS + NUM_DLLAPI_FUNCS
+};
 
-// simplified 'void' version of main hook function
-void DLLINTERNAL main_hook_function_void(unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args) {
-	const api_info_t *api_info;
-	int i;
-	META_RES mres, status, prev_mres;
-	MPlugin *iplug;
-	void *pfn_routine;
-	int loglevel;
+static const unsigned int api_func_count[3] = {
+	NUM_ENGINE_FUNCS,
+	NUM_DLLAPI_FUNCS,
+	NUM_NEWAPI_FUNCS
+};
+
+api_hook_subscriber_list_t api_hook_subscribers[2][NUM_API_FUNCS];
+static api_hook_subscriber_pool_t *subscriber_pool = NULL;
+static api_hook_subscriber_pool_t *retired_subscriber_pools = NULL;
+
+unsigned int subscriber_generation = 0;
+mBOOL subscribers_stale = mFALSE;
+
+// Check that plugin still provides the given routine for this function.
+mBOOL DLLINTERNAL is_api_subscriber(int post, enum_api_t api, unsigned int func_offset, MPlugin *iplug, void *pfn_routine) {
 	const void *api_table;
-	meta_globals_t backup_meta_globals[1];
 	
-	//passing offset from api wrapper function makes code faster/smaller
-	api_info = get_api_info(api, api_info_offset);
-	
-	//Fix bug with metamod-bot-plugins.
-	if(unlikely(call_count++>0)) {
-		//Backup PublicMetaGlobals.
-		backup_meta_globals[0] = PublicMetaGlobals;
+	if(iplug->status != PL_RUNNING)
+		return(mFALSE);
+	api_table = post ? iplug->get_api_post_table(api) : iplug->get_api_table(api);
+	if(!api_table)
+		return(mFALSE);
+	return(get_api_function(api_table, func_offset) == pfn_routine ? mTRUE : mFALSE);
+}
+
+// Complain about missing original routine or api table.
+void DLLINTERNAL api_hook_no_routine(const api_info_t *api_info, enum_api_t api, const void *api_table) {
+	if(api_table) {
+		// don't complain for NULL routines in NEW_DLL_FUNCTIONS
+		if(api != e_api_newapi)
+			META_WARNING("Couldn't find api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name);
+	} else {
+		// don't complain for NULL NEW_DLL_FUNCTIONS-table
+		if(api != e_api_newapi)
+			META_DEBUG(api_info->loglevel, ("No api table defined for api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
 	}
+}
+
+// Passthrough of functions nobody hooks.
+//  With "passthrough" enabled in config.ini, the function tables held by
+//  the engine (our DLL_FUNCTIONS and NEW_DLL_FUNCTIONS) and by the gamedll
+//  (our enginefuncs) get the original engine/gamedll routine directly for
+//  functions that have no pre or post subscribers, so that those calls
+//  skip metamod entirely.  Tables are re-patched whenever the subscriber
+//  lists are rebuilt.  While the call recorder is running every function
+//  goes through our typed hook wrapper, so that no call is missed.
+
+// Functions that metamod itself needs to see, and that are never passed
+// through.
+static const unsigned int engine_no_passthrough[] = {
+	offsetof(enginefuncs_t, pfnCVarSetFloat),			// meta_debug_value
+	offsetof(enginefuncs_t, pfnCVarSetString),			// meta_debug_value
+	offsetof(enginefuncs_t, pfnCvar_DirectSet),			// meta_debug_value
+	offsetof(enginefuncs_t, pfnRegUserMsg),				// RegMsgs
+	offsetof(enginefuncs_t, pfnQueryClientCvarValue),	// pointer validity check
+	offsetof(enginefuncs_t, pfnQueryClientCvarValue2),	// pointer validity check
+	offsetof(enginefuncs_t, pfnEngCheckParm),			// pointer validity check
+	~0U
+};
+
+static const unsigned int dllapi_no_passthrough[] = {
+	offsetof(DLL_FUNCTIONS, pfnClientConnect),			// cvar queries
+	offsetof(DLL_FUNCTIONS, pfnClientDisconnect),		// cvar queries
+	offsetof(DLL_FUNCTIONS, pfnClientCommand),			// client 'meta' command
+	offsetof(DLL_FUNCTIONS, pfnServerDeactivate),		// plugin refresh
+	offsetof(DLL_FUNCTIONS, pfnStartFrame),				// meta_debug_value
+	offsetof(DLL_FUNCTIONS, pfnSys_Error),				// hook trace dump
+	~0U
+};
+
+static const unsigned int newapi_no_passthrough[] = {
+	offsetof(NEW_DLL_FUNCTIONS, pfnCvarValue),			// cvar queries
+	offsetof(NEW_DLL_FUNCTIONS, pfnGameShutdown),		// call recording, job and log threads
+	~0U
+};
+
+static const unsigned int * api_no_passthrough[3] = {
+	engine_no_passthrough,
+	dllapi_no_passthrough,
+	newapi_no_passthrough
+};
+
+static void ** const meta_engfuncs_ptr = (void**)&meta_engfuncs;
+
+// Our hooked tables, as handed out to engine and gamedll.
+static void ** const * api_hooked_tables[3] = {
+	&meta_engfuncs_ptr,
+	(void ** const *)&g_pHookedDllFunctions,
+	(void ** const *)&g_pHookedNewDllFunctions
+};
+
+// Copies of our hooked tables held by engine and gamedll.
+static void ** api_held_tables[3] = { NULL, NULL, NULL };
+static unsigned int api_held_count[3] = { 0, 0, 0 };
+
+// Functions metamod currently needs to see, see api_hook_internal_ref().
+static unsigned short api_internal_refs[NUM_API_FUNCS];
+
+mBOOL DLLINTERNAL is_api_passthrough_allowed(enum_api_t api, unsigned int func_offset) {
+	const unsigned int *ip;
 	
-	//Setup
-	loglevel=api_info->loglevel;
-	mres=MRES_UNSET;
-	status=MRES_UNSET;
-	prev_mres=MRES_UNSET;
-	pfn_routine=NULL;
+	if(api_internal_refs[api_func_base[api] + func_offset / sizeof(void*)])
+		return(mFALSE);
+	for(ip=api_no_passthrough[api]; *ip != ~0U; ip++)
+		if(*ip == func_offset)
+			return(mFALSE);
+	return(mTRUE);
+}
+
+void DLLINTERNAL api_hook_internal_ref(enum_api_t api, unsigned int func_offset, int delta) {
+	unsigned short *ref = &api_internal_refs[api_func_base[api] + func_offset / sizeof(void*)];
 	
-	//Pre plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
+	*ref += delta;
+	if((delta > 0 && *ref == delta) || (delta < 0 && *ref == 0))
+		update_api_passthrough();
+}
+
+// Patch tables held by engine and gamedll to match current subscribers.
+//  Functions without subscribers get the original routine (passthrough),
+//  everything else our normal hook wrapper.
+void DLLINTERNAL update_api_passthrough(void) {
+	int api, post, npassed;
+	unsigned int func, func_offset;
+	void **held, **hooked, **orig;
+	void *pfn_routine;
+	const api_hook_subscriber_list_t *slist;
+	
+	for(api=0; api < 3; api++) {
+		held=api_held_tables[api];
+		if(!held)
 			continue;
+		hooked = *api_hooked_tables[api];
+		orig = (void**)*api_tables[api];
+		npassed=0;
+		
+		for(func=0; func < api_held_count[api]; func++) {
+			func_offset=func * sizeof(void*);
+			pfn_routine=hooked[func];
+			
+			if(orig && orig[func] && is_api_passthrough_allowed((enum_api_t)api, func_offset)) {
+				for(post=0; post < 2; post++) {
+					slist=get_api_subscribers(post, (enum_api_t)api, func_offset);
+					if(slist->count)
+						break;
+				}
+				if(post == 2 && Config->passthrough && !subscribers_stale && !api_record_active) {
+					pfn_routine=orig[func];
+					npassed++;
+				}
+			}
+			
+			// Leave alone entries that the holder has changed by itself.
+			if(held[func] != hooked[func] && (!orig || held[func] != orig[func]))
+				continue;
+			held[func]=pfn_routine;
 		}
 		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s()", iplug->file, api_info->name));
-		api_info->api_caller(pfn_routine, packed_args);
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_UNSET))
-			META_WARNING("Plugin didn't set meta_result: %s:%s()", iplug->file, api_info->name);
+		META_DEBUG(6, ("Passing through %d of %u %s functions", npassed, api_held_count[api], 
+				(api==e_api_engine)?"engine":(api==e_api_dllapi)?"dllapi":"newapi"));
 	}
+}
+
+// Remember table, that engine or gamedll got a copy of our hooked table
+// into, for passthrough patching.
+void DLLINTERNAL set_api_passthrough_table(enum_api_t api, void *table, unsigned int num_funcs) {
+	if(num_funcs > api_func_count[api])
+		num_funcs = api_func_count[api];
 	
-	call_count--;
-	
-	//Api call
-	if(likely(status!=MRES_SUPERCEDE)) {
-		//get api table
-		api_table = *api_tables[api];
-		
-		if(likely(api_table)) {
-			pfn_routine = get_api_function(api_table, func_offset);
-			if(likely(pfn_routine)) {
-				META_DEBUG(loglevel, ("Calling %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-				api_info->api_caller(pfn_routine, packed_args);
-				API_UNPAUSE_TSC_TRACKING();
-			} else {
-				// don't complain for NULL routines in NEW_DLL_FUNCTIONS
-				if(unlikely(api != e_api_newapi))
-					META_WARNING("Couldn't find api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name);
-				status=MRES_UNSET;
-			}
-		} else {
-			// don't complain for NULL NEW_DLL_FUNCTIONS-table
-			if(unlikely(api != e_api_newapi))
-				META_DEBUG(loglevel, ("No api table defined for api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-			status=MRES_UNSET;
-		}
-	} else
-		META_DEBUG(loglevel, ("Skipped (supercede) %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-	
-	call_count++;
+	api_held_tables[api]=(void**)table;
+	api_held_count[api]=num_funcs;
 	
-	//Post plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_post_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
-			continue;
-		}
-		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s_Post()", iplug->file, api_info->name));
-		api_info->api_caller(pfn_routine, packed_args);
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_UNSET))
-			META_WARNING("Plugin didn't set meta_result: %s:%s_Post()", iplug->file, api_info->name);
-		else if(unlikely(mres==MRES_SUPERCEDE))
-			META_WARNING("MRES_SUPERCEDE not valid in Post functions: %s:%s_Post()", iplug->file, api_info->name);
-	}
+	if(table)
+		update_api_passthrough();
+}
 
-	if(unlikely(--call_count>0)) {
-		//Restore backup
-		PublicMetaGlobals = backup_meta_globals[0];
-	}
+// Number of plugins hooking function, pre and post.
+int DLLINTERNAL get_api_subscriber_count(enum_api_t api, unsigned int func_offset) {
+	return(get_api_subscribers(0, api, func_offset)->count + get_api_subscribers(1, api, func_offset)->count);
 }
 
-// full return typed version of main hook function
-void * DLLINTERNAL main_hook_function(const class_ret_t ret_init, unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args) {
-	const api_info_t *api_info;
+static mBOOL DLLINTERNAL is_api_msg_function(enum_api_t api, unsigned int func_offset) {
 	int i;
-	META_RES mres, status, prev_mres;
+	
+	if(api != e_api_engine)
+		return(mFALSE);
+	for(i=0; i < NUM_API_MSG_FUNCS; i++)
+		if(api_msg_funcs[i] == func_offset)
+			return(mTRUE);
+	return(mFALSE);
+}
+
+// Count or fill subscriber lists from the running plugins, in dispatch
+// order (see MPluginList::sort_dispatch).  With a NULL buffer only the
+// number of needed entries is returned.
+static int DLLINTERNAL collect_api_subscribers(api_hook_subscriber_t *buf) {
+	int post, api, i, n;
+	mBOOL msg_func, ent_func;
+	unsigned int func;
+	api_hook_subscriber_list_t *slist;
 	MPlugin *iplug;
-	void *pfn_routine;
-	int loglevel;
 	const void *api_table;
-	meta_globals_t backup_meta_globals[1];
-	
-	//passing offset from api wrapper function makes code faster/smaller
-	api_info = get_api_info(api, api_info_offset);
-	
-	//Fix bug with metamod-bot-plugins.
-	if(unlikely(call_count++>0)) {
-		//Backup PublicMetaGlobals.
-		backup_meta_globals[0] = PublicMetaGlobals;
-	}
-	
-	//Return class setup
-	class_ret_t dllret=ret_init;
-	class_ret_t override_ret=ret_init;
-	class_ret_t pub_override_ret=ret_init;
-	class_ret_t orig_ret=ret_init;
-	class_ret_t pub_orig_ret=ret_init;
-	
-	//Setup
-	loglevel=api_info->loglevel;
-	mres=MRES_UNSET;
-	status=MRES_UNSET;
-	prev_mres=MRES_UNSET;
-	pfn_routine=NULL;
+	void *pfn_routine;
 	
-	//Pre plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
-			continue;
-		}
-		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		pub_orig_ret = orig_ret;
-		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
-		if(unlikely(status==MRES_SUPERCEDE)) {
-			pub_override_ret = override_ret;
-			PublicMetaGlobals.override_ret = pub_override_ret.getptr();
-		}
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s()", iplug->file, api_info->name));
-		dllret = class_ret_t(api_info->api_caller(pfn_routine, packed_args));
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_SUPERCEDE)) {
-			pub_override_ret = dllret;
-			override_ret = dllret;
-		} 
-		else if(unlikely(mres==MRES_UNSET)) {
-			META_WARNING("Plugin didn't set meta_result: %s:%s()", iplug->file, api_info->name);
+	n=0;
+	for(post=0; post < 2; post++) {
+		for(api=0; api < 3; api++) {
+			for(func=0; func < api_func_count[api]; func++) {
+				slist=&api_hook_subscribers[post][api_func_base[api] + func];
+				msg_func=is_api_msg_function((enum_api_t)api, func * sizeof(void*));
+				ent_func=ent_filter_active ? is_ent_filter_function((enum_api_t)api, func * sizeof(void*)) : mFALSE;
+				if(buf) {
+					slist->list=&buf[n];
+					slist->count=0;
+				}
+				for(i=0; i < Plugins->ndispatch; i++) {
+					iplug=Plugins->dispatch[i];
+					api_table = post ? iplug->get_api_post_table((enum_api_t)api) : iplug->get_api_table((enum_api_t)api);
+					if(!api_table)
+						continue;
+					pfn_routine=get_api_function(api_table, func * sizeof(void*));
+					if(!pfn_routine)
+						continue;
+					if(buf) {
+						buf[n].plugin=iplug;
+						buf[n].pfn_routine=pfn_routine;
+						buf[n].msg_filter=(msg_func && iplug->msg_filtered[post]) ? iplug->msg_filter[post] : NULL;
+						buf[n].ent_bit=ent_func ? ent_filter_bit(iplug, post) : 0;
+						slist->count++;
+					}
+					n++;
+				}
+			}
 		}
 	}
+	return(n);
+}
+
+// Record timed call to hook trace and profile.
+void DLLINTERNAL api_hook_timed(int plugin_index, int post, enum_api_t api, unsigned int func_offset, unsigned long long start, META_RES mres) {
+	unsigned long long end = GET_TSC();
 	
-	call_count--;
+	if(meta_trace_value)
+		api_trace_record(plugin_index, post, api_func_base[api] + func_offset / sizeof(void*), api_hook_call_count, start, end, mres);
+	if(meta_prof_value)
+		api_prof_record(plugin_index, post, api, func_offset, end - start, mres);
+}
+
+// Rebuild subscriber lists; should be called after any plugin has changed
+// to or from running state.
+void DLLINTERNAL rebuild_api_hook_subscribers(void) {
+	api_hook_subscriber_pool_t *pool, *next;
+	int n;
 	
-	//Api call
-	if(likely(status!=MRES_SUPERCEDE)) {
-		//get api table
-		api_table = *api_tables[api];
-		
-		if(likely(api_table)) {
-			pfn_routine = get_api_function(api_table, func_offset);
-			if(likely(pfn_routine)) {
-				META_DEBUG(loglevel, ("Calling %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-				dllret = class_ret_t(api_info->api_caller(pfn_routine, packed_args));
-				API_UNPAUSE_TSC_TRACKING();
-				orig_ret = dllret;
-			} else {
-				// don't complain for NULL routines in NEW_DLL_FUNCTIONS
-				if(unlikely(api != e_api_newapi))
-					META_WARNING("Couldn't find api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name);
-				status=MRES_UNSET;
-			}
-		} else {
-			// don't complain for NULL NEW_DLL_FUNCTIONS-table
-			if(unlikely(api != e_api_newapi))
-				META_DEBUG(loglevel, ("No api table defined for api call: %s:%s", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-			status=MRES_UNSET;
+	// release pools no hook function is using anymore
+	if(!api_hook_call_count) {
+		for(pool=retired_subscriber_pools; pool; pool=next) {
+			next=pool->next;
+			free(pool);
 		}
-	} else {
-		META_DEBUG(loglevel, ("Skipped (supercede) %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
-		orig_ret = override_ret;
-		pub_orig_ret = override_ret;
-		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
+		retired_subscriber_pools=NULL;
 	}
 	
-	call_count++;
+	Plugins->sort_dispatch();
+	n=collect_api_subscribers(NULL);
+	pool=(api_hook_subscriber_pool_t *)calloc(1, sizeof(api_hook_subscriber_pool_t) + n * sizeof(api_hook_subscriber_t));
+	if(!pool) {
+		META_WARNING("Failed malloc() for api hook subscriber lists; keeping old lists");
+		subscriber_generation++;
+		subscribers_stale=mTRUE;
+		update_api_passthrough();
+		return;
+	}
 	
-	//Pre plugin functions
-	prev_mres=MRES_UNSET;
-	for(i=0; likely(i < Plugins->endlist); i++) {
-		iplug=&Plugins->plist[i];
-		
-		if(unlikely(iplug->status != PL_RUNNING))
-			continue;
-		
-		api_table = iplug->get_api_post_table(api);
-		if(likely(!api_table)) {
-			//plugin doesn't provide this api table
-			continue;
-		}
-		
-		pfn_routine=get_api_function(api_table, func_offset);
-		if(likely(!pfn_routine)) {
-			//plugin doesn't provide this function
-			continue;
-		}
-		
-		// initialize PublicMetaGlobals
-		PublicMetaGlobals.mres = MRES_UNSET;
-		PublicMetaGlobals.prev_mres = prev_mres;
-		PublicMetaGlobals.status = status;
-		pub_orig_ret = orig_ret;
-		PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
-		if(unlikely(status==MRES_OVERRIDE)) {
-			pub_override_ret = override_ret;
-			PublicMetaGlobals.override_ret = pub_override_ret.getptr();
-		}
-		
-		// call plugin
-		META_DEBUG(loglevel, ("Calling %s:%s_Post()", iplug->file, api_info->name));
-		dllret = class_ret_t(api_info->api_caller(pfn_routine, packed_args));
-		API_UNPAUSE_TSC_TRACKING();
-		
-		// plugin's result code
-		mres=PublicMetaGlobals.mres;
-		if(unlikely(mres > status))
-			status = mres;
-		
-		// save this for successive plugins to see
-		prev_mres = mres;
-		
-		if(unlikely(mres==MRES_OVERRIDE)) {
-			pub_override_ret = dllret;
-			override_ret = dllret;
-		}
-		else if(unlikely(mres==MRES_UNSET)) {
-			META_WARNING("Plugin didn't set meta_result: %s:%s_Post()", iplug->file, api_info->name);
-		}
-		else if(unlikely(mres==MRES_SUPERCEDE)) {
-			META_WARNING("MRES_SUPERCEDE not valid in Post functions: %s:%s_Post()", iplug->file, api_info->name);
+	// Current lists might be in use by a hook function up in the call
+	// stack; if so, retire them instead of freeing.
+	if(subscriber_pool) {
+		if(api_hook_call_count) {
+			subscriber_pool->next=retired_subscriber_pools;
+			retired_subscriber_pools=subscriber_pool;
 		}
+		else
+			free(subscriber_pool);
 	}
 	
-	if(unlikely(--call_count>0)) {
-		//Restore backup
-		PublicMetaGlobals = backup_meta_globals[0];
-	}
+	collect_api_subscribers(pool->subscribers);
+	subscriber_pool=pool;
+	subscriber_generation++;
+	subscribers_stale=mFALSE;
 	
-	//return value is passed through ret_init!
-	if(likely(status!=MRES_OVERRIDE)) {
-		return(*(void**)orig_ret.getptr());
-	} else {
-		META_DEBUG(loglevel, ("Returning (override) %s()", api_info->name));
-		return(*(void**)override_ret.getptr());
-	}
+	META_DEBUG(6, ("Rebuilt api hook subscriber lists; %d subscribers", n));
+	
+	update_api_passthrough();
 }
-
-//
-// Macros for creating api caller functions
-//
-#define BEGIN_API_CALLER_FUNC(ret_type, args_type_code) \
-	void * DLLINTERNAL _COMBINE4(api_caller_, ret_type, _args_, args_type_code)(const void * func, const void * packed_args) { \
-		_COMBINE2(pack_args_type_, args_type_code) * p ATTRIBUTE(unused)= (_COMBINE2(pack_args_type_, args_type_code) *)packed_args;
-#define END_API_CALLER_FUNC(ret_t, args_t, args) \
-		API_PAUSE_TSC_TRACKING(); \
-		return(*(void **)class_ret_t((*(( ret_t (*) args_t )func)) args).getptr()); \
-	}
-#define END_API_CALLER_FUNC_void(args_t, args) \
-		API_PAUSE_TSC_TRACKING(); \
-		return((*(( void* (*) args_t )func)) args); \
-	}
-
-//
-// API function callers.
-//
-
-//-
-BEGIN_API_CALLER_FUNC(void, ipV)
-END_API_CALLER_FUNC_void( (int, const void*, ...), (p->i1, p->p1, p->str) )
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pV)
-END_API_CALLER_FUNC_void( (const void*, const void*, ...), (p->p1, p->p2, p->str) )
-
-//-
-BEGIN_API_CALLER_FUNC(void, void)
-END_API_CALLER_FUNC_void( (void), () )
-
-BEGIN_API_CALLER_FUNC(ptr, void)
-END_API_CALLER_FUNC(void*, (void), () )
-
-BEGIN_API_CALLER_FUNC(int, void)
-END_API_CALLER_FUNC(int, (void), () )
-
-BEGIN_API_CALLER_FUNC(float, void)
-END_API_CALLER_FUNC(float, (void), () )
-
-//-
-BEGIN_API_CALLER_FUNC(float, 2f)
-END_API_CALLER_FUNC( float, (float, float), (p->f1, p->f2) )
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2i)
-END_API_CALLER_FUNC_void( (int, int), (p->i1, p->i2) );
-
-BEGIN_API_CALLER_FUNC(int, 2i)
-END_API_CALLER_FUNC(int, (int, int), (p->i1, p->i2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2i2p)
-END_API_CALLER_FUNC_void( (int, int, const void*, const void*), (p->i1, p->i2, p->p1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2i2pi2p)
-END_API_CALLER_FUNC_void( (int, int, const void*, const void*, int, const void*, const void*), (p->i1, p->i2, p->p1, p->p2, p->i3, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p)
-END_API_CALLER_FUNC_void( (const void*, const void*), (p->p1, p->p2) );
-
-BEGIN_API_CALLER_FUNC(ptr, 2p)
-END_API_CALLER_FUNC(void*, (const void*, const void*), (p->p1, p->p2) );
-
-BEGIN_API_CALLER_FUNC(int, 2p)
-END_API_CALLER_FUNC(int, (const void*, const void*), (p->p1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p2f)
-END_API_CALLER_FUNC_void( (const void*, const void*, float, float), (p->p1, p->p2, p->f1, p->f2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p2i2p)
-END_API_CALLER_FUNC_void( (const void*, const void*, int, int, const void*, const void*), (p->p1, p->p2, p->i1, p->i2, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2p3fus2uc)
-END_API_CALLER_FUNC_void( (const void*, const void*, float, float, float, unsigned short, unsigned char, unsigned char), (p->p1, p->p2, p->f1, p->f2, p->f3, p->us1, p->uc1, p->uc2) );
-
-//-
-BEGIN_API_CALLER_FUNC(ptr, 2pf)
-END_API_CALLER_FUNC(void*, (const void*, const void*, float), (p->p1, p->p2, p->f1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pfi)
-END_API_CALLER_FUNC_void( (const void*, const void*, float, int), (p->p1, p->p2, p->f1, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pi)
-END_API_CALLER_FUNC_void( (const void*, const void*, int), (p->p1, p->p2, p->i1) );
-
-BEGIN_API_CALLER_FUNC(int, 2pi)
-END_API_CALLER_FUNC(int, (const void*, const void*, int), (p->p1, p->p2, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pui)
-END_API_CALLER_FUNC_void( (const void*, const void*, unsigned int), (p->p1, p->p2, p->ui1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pi2p)
-END_API_CALLER_FUNC_void( (const void*, const void*, int, const void*, const void*), (p->p1, p->p2, p->i1, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 2pif2p)
-END_API_CALLER_FUNC_void( (const void*, const void*, int, float, const void*, const void*), (p->p1, p->p2, p->i1, p->f1, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(int, 3i)
-END_API_CALLER_FUNC(int, (int, int, int), (p->i1, p->i2, p->i3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 3p)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*), (p->p1, p->p2, p->p3) );
-
-BEGIN_API_CALLER_FUNC(ptr, 3p)
-END_API_CALLER_FUNC(void*, (const void*, const void*, const void*), (p->p1, p->p2, p->p3) );
-
-BEGIN_API_CALLER_FUNC(int, 3p)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*), (p->p1, p->p2, p->p3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 3p2f2i)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*, float, float, int, int), (p->p1, p->p2, p->p3, p->f1, p->f2, p->i1, p->i2) );
-
-//-
-BEGIN_API_CALLER_FUNC(int, 3pi2p)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*, int, const void*, const void*), (p->p1, p->p2, p->p3, p->i1, p->p4, p->p5) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 4p)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*, const void*), (p->p1, p->p2, p->p3, p->p4) );
-
-BEGIN_API_CALLER_FUNC(int, 4p)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*, const void*), (p->p1, p->p2, p->p3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, 4pi)
-END_API_CALLER_FUNC_void( (const void*, const void*, const void*, const void*, int), (p->p1, p->p2, p->p3, p->p4, p->i1) );
-
-BEGIN_API_CALLER_FUNC(int, 4pi)
-END_API_CALLER_FUNC(int, (const void*, const void*, const void*, const void*, int), (p->p1, p->p2, p->p3, p->p4, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, f)
-END_API_CALLER_FUNC_void( (float), (p->f1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, i)
-END_API_CALLER_FUNC_void( (int), (p->i1) );
-
-BEGIN_API_CALLER_FUNC(int, i)
-END_API_CALLER_FUNC(int, (int), (p->i1) );
-
-BEGIN_API_CALLER_FUNC(ptr, i)
-END_API_CALLER_FUNC(void*, (int), (p->i1) );
-
-BEGIN_API_CALLER_FUNC(uint, ui)
-END_API_CALLER_FUNC(unsigned int, (unsigned int), (p->ui1) );
-
-BEGIN_API_CALLER_FUNC(ptr, ui)
-END_API_CALLER_FUNC(void*, (unsigned int), (p->ui1) );
-
-//-
-BEGIN_API_CALLER_FUNC(ulong, ul)
-END_API_CALLER_FUNC(unsigned long, (unsigned long), (p->ul1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, i2p)
-END_API_CALLER_FUNC_void( (int, const void*, const void*), (p->i1, p->p1, p->p2) );
-
-BEGIN_API_CALLER_FUNC(int, i2p)
-END_API_CALLER_FUNC(int, (int, const void*, const void*), (p->i1, p->p1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, i3p)
-END_API_CALLER_FUNC_void( (int, const void*, const void*, const void*), (p->i1, p->p1, p->p2, p->p3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, ip)
-END_API_CALLER_FUNC_void( (int, const void*), (p->i1, p->p1) );
-
-BEGIN_API_CALLER_FUNC(ushort, ip)
-END_API_CALLER_FUNC( unsigned short, (int, const void*), (p->i1, p->p1) );
-
-BEGIN_API_CALLER_FUNC(int, ip)
-END_API_CALLER_FUNC( int, (int, const void*), (p->i1, p->p1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, ipusf2p2f4i)
-END_API_CALLER_FUNC_void( (int, const void*, unsigned short, float, const void*, const void*, float, float, int, int, int, int), (p->i1, p->p1, p->us1, p->f1, p->p2, p->p3, p->f2, p->f3, p->i2, p->i3, p->i4, p->i5) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, p)
-END_API_CALLER_FUNC_void( (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(ptr, p)
-END_API_CALLER_FUNC(void*, (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(char, p)
-END_API_CALLER_FUNC(char, (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(int, p)
-END_API_CALLER_FUNC(int, (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(uint, p)
-END_API_CALLER_FUNC(unsigned int, (const void*), (p->p1) );
-
-BEGIN_API_CALLER_FUNC(float, p)
-END_API_CALLER_FUNC(float, (const void*), (p->p1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, p2f)
-END_API_CALLER_FUNC_void( (const void*, float, float), (p->p1, p->f1, p->f2) );
-
-//-
-BEGIN_API_CALLER_FUNC(int, p2fi)
-END_API_CALLER_FUNC(int, (const void*, float, float, int), (p->p1, p->f1, p->f2, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, p2i)
-END_API_CALLER_FUNC_void( (const void*, int, int), (p->p1, p->i1, p->i2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, p3i)
-END_API_CALLER_FUNC_void( (const void*, int, int, int), (p->p1, p->i1, p->i2, p->i3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, p4i)
-END_API_CALLER_FUNC_void( (const void*, int, int, int, int), (p->p1, p->i1, p->i2, p->i3, p->i4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, puc)
-END_API_CALLER_FUNC_void( (const void*, unsigned char), (p->p1, p->uc1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, pf)
-END_API_CALLER_FUNC_void( (const void*, float), (p->p1, p->f1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, pfp)
-END_API_CALLER_FUNC_void( (const void*, float, const void*), (p->p1, p->f1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, pi)
-END_API_CALLER_FUNC_void( (const void*, int), (p->p1, p->i1) );
-
-BEGIN_API_CALLER_FUNC(ptr, pi)
-END_API_CALLER_FUNC(void*, (const void*, int), (p->p1, p->i1) );
-
-BEGIN_API_CALLER_FUNC(int, pi)
-END_API_CALLER_FUNC(int, (const void*, int), (p->p1, p->i1) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, pi2p)
-END_API_CALLER_FUNC_void( (const void*, int, const void*, const void*), (p->p1, p->i1, p->p2, p->p3) );
-
-//-
-BEGIN_API_CALLER_FUNC(int, pi2p2ip)
-END_API_CALLER_FUNC(int, (const void*, int, const void*, const void*, int, int, const void*), (p->p1, p->i1, p->p2, p->p3, p->i2, p->i3, p->p4) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, pip)
-END_API_CALLER_FUNC_void( (const void*, int, const void*), (p->p1, p->i1, p->p2) );
-
-BEGIN_API_CALLER_FUNC(ptr, pip)
-END_API_CALLER_FUNC(void*, (const void*, int, const void*), (p->p1, p->i1, p->p2) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, pip2f2i)
-END_API_CALLER_FUNC_void( (const void*, int, const void*, float, float, int, int), (p->p1, p->i1, p->p2, p->f1, p->f2, p->i2, p->i3) );
-
-//-
-BEGIN_API_CALLER_FUNC(void, pip2f4i2p)
-END_API_CALLER_FUNC_void( (const void*, int, const void*, float, float, int, int, int, int, const void*, const void*), (p->p1, p->i1, p->p2, p->f1, p->f2, p->i2, p->i3, p->i4, p->i5, p->p3, p->p4) );
@@ -31,367 +31,582 @@
 #ifndef API_HOOK_H
 #define API_HOOK_H
 
-#include "ret_type.h"
-#include "api_info.h"
-#include "meta_api.h"
-#include "osdep.h"		//OPEN_ARGS
-
-// Compine 4 parts for single name
-#define _COMBINE4(w,x,y,z) w##x##y##z
-#define _COMBINE2(x,y) x##y
-
-// simplified 'void' version of main hook function
-void DLLINTERNAL main_hook_function_void(unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args);
-
-// full return typed version of main hook function
-void * DLLINTERNAL main_hook_function(const class_ret_t ret_init, unsigned int api_info_offset, enum_api_t api, unsigned int func_offset, const void * packed_args);
+#include <stddef.h>			// NULL
+
+#include "api_info.h"			// api_info_t, enum_api_t
+#include "meta_api.h"			// META_RES, etc
+#include "mplugin.h"			// MPlugin
+#include "metamod.h"			// GameDLL, PublicMetaGlobals, etc
+#include "log_meta.h"			// META_DEBUG, etc
+#include "api_prof.h"			// PROF_ORIG_ROUTINE, meta_prof_value
+#include "api_trace.h"			// meta_trace_value
+#include "api_record.h"			// api_record_active, api_record_writer
+#include "ent_filter.h"			// api_hook_ent_mask
+#include "osdep.h"			// likely, unlikely
+
+// Number of functions in api tables
+#define NUM_ENGINE_FUNCS (sizeof(enginefuncs_t) / sizeof(void*))
+#define NUM_DLLAPI_FUNCS (sizeof(DLL_FUNCTIONS) / sizeof(void*))
+#define NUM_NEWAPI_FUNCS (sizeof(NEW_DLL_FUNCTIONS) / sizeof(void*))
+#define NUM_API_FUNCS (NUM_ENGINE_FUNCS + NUM_DLLAPI_FUNCS + NUM_NEWAPI_FUNCS)
+
+// rebuild per-function plugin subscriber lists used by hook functions;
+// call after plugin has started or stopped running
+void DLLINTERNAL rebuild_api_hook_subscribers(void);
+
+// remember table that engine or gamedll copied our hooked api table into;
+// unhooked functions are patched there to original routines when
+// passthrough is enabled
+void DLLINTERNAL set_api_passthrough_table(enum_api_t api, void *table, unsigned int num_funcs);
+
+// re-patch tables held by engine and gamedll; call when passthrough
+// conditions change
+void DLLINTERNAL update_api_passthrough(void);
+
+// whether function may bypass our hook wrapper (ie. metamod doesn't need
+// to see the call itself)
+mBOOL DLLINTERNAL is_api_passthrough_allowed(enum_api_t api, unsigned int func_offset);
+
+// Count metamod's own need to see calls of function (log events, etc);
+// function isn't passed through while count is nonzero.  'delta' is +1
+// or -1; passthrough is updated when count changes to or from zero.
+void DLLINTERNAL api_hook_internal_ref(enum_api_t api, unsigned int func_offset, int delta);
+
+// number of plugins hooking function, pre and post
+int DLLINTERNAL get_api_subscriber_count(enum_api_t api, unsigned int func_offset);
+
+// Compacted per-function subscriber lists.
+//  For each (api, function, pre/post) we keep a contiguous list of
+//  (plugin, routine) pairs, in dispatch order (by plugin priority), so
+//  that the hook functions only visit plugins that actually hook the
+//  called function instead of walking every plugin and its api tables.
+//  Lists are rebuilt by rebuild_api_hook_subscribers() whenever a plugin
+//  starts or stops running (load, unload, pause, unpause), or plugin
+//  priorities change.
+typedef struct api_hook_subscriber_s {
+	MPlugin *plugin;
+	void *pfn_routine;
+	const unsigned int *msg_filter;		// msg_types wanted, for message functions; NULL for all
+	unsigned long long ent_bit;			// entity filter slot, for entity functions; 0 for all
+} api_hook_subscriber_t;
+
+typedef struct api_hook_subscriber_list_s {
+	const api_hook_subscriber_t *list;
+	int count;
+} api_hook_subscriber_list_t;
+
+// Engine functions of a network message: MessageBegin, MessageEnd and
+// the Write* functions.
+#define NUM_API_MSG_FUNCS 10
+extern const unsigned int api_msg_funcs[NUM_API_MSG_FUNCS] DLLHIDDEN;
+
+// msg_type of message being sent (0-255), set by MessageBegin; plugins
+// with message filter (see ADD_MSG_FILTER) only get calls of messages
+// they want
+extern int api_hook_msg_type DLLHIDDEN;
+
+// whether subscriber wants calls of current message
+inline int DLLINTERNAL api_hook_msg_wanted(const api_hook_subscriber_t *sub) {
+	return(!sub->msg_filter || ((sub->msg_filter[api_hook_msg_type >> 5] >> (api_hook_msg_type & 31)) & 1));
+}
+
+// [0] = pre functions, [1] = post functions
+extern api_hook_subscriber_list_t api_hook_subscribers[2][NUM_API_FUNCS] DLLHIDDEN;
+extern const unsigned int api_func_base[3] DLLHIDDEN;
+
+// Bumped on every rebuild.  A hook function that sees this change while
+// iterating a list re-checks the remaining entries against the plugin,
+// since the list it holds may be out of date.  Lists left stale by a
+// failed rebuild (out of memory) are always checked.
+extern unsigned int subscriber_generation DLLHIDDEN;
+extern mBOOL subscribers_stale DLLHIDDEN;
+
+// Safety check for metamod-bot-plugin bugfix.
+//  engine_api->pfnRunPlayerMove calls dllapi-functions before it returns.
+//  This causes problems with bots running as metamod plugins, because
+//  metamod assumed that PublicMetaGlobals is free to be used.
+//  With api_hook_call_count we can fix this by backuping up
+//  PublicMetaGlobals if it's already being used.
+extern unsigned int api_hook_call_count DLLHIDDEN;
+
+// original (engine/gamedll) api tables, by api
+extern const void ** const api_tables[3] DLLHIDDEN;
+
+// get function pointer from api table by function pointer offset
+inline void * DLLINTERNAL get_api_function(const void * api_table, unsigned int func_offset) {
+	return(*(void**)((unsigned long)api_table + func_offset));
+}
+
+// get subscriber list by api and function pointer offset
+inline const api_hook_subscriber_list_t * DLLINTERNAL get_api_subscribers(int post, enum_api_t api, unsigned int func_offset) {
+	return(&api_hook_subscribers[post][api_func_base[api] + func_offset / sizeof(void*)]);
+}
+
+// check that plugin still provides the given routine for this function
+mBOOL DLLINTERNAL is_api_subscriber(int post, enum_api_t api, unsigned int func_offset, MPlugin *iplug, void *pfn_routine);
+
+// complain about missing original routine or api table
+void DLLINTERNAL api_hook_no_routine(const api_info_t *api_info, enum_api_t api, const void *api_table);
+
+// record timed call (started at cpu timestamp counter 'start') to hook
+// trace and profile, whichever is enabled
+void DLLINTERNAL api_hook_timed(int plugin_index, int post, enum_api_t api, unsigned int func_offset, unsigned long long start, META_RES mres);
 
 //
-// API function args structures/classes
+// Typed hook dispatcher.
 //
-#define API_PACK_ARGS(type, args) \
-	_COMBINE2(pack_args_type_, type) packed_args args;
-
-#define PACK_ARGS_CLASS_HEADER(type, constructor_args) \
-	class _COMBINE2(pack_args_type_, type) : public class_metamod_new { \
-		public: inline _COMBINE2(pack_args_type_, type) constructor_args
-
-#define PACK_ARGS_END };
+// api_hook_caller<FN_TYPE> holds the arguments of one api call with their
+// real types, calls any routine of type FN_TYPE with them, and writes
+// them to the call recorder (see api_record.h).  It's
+// specialized by function type, so the META_*_HANDLE macros only need to
+// name the FN_* typedef of the function (see engine_api.h, dllapi.h), and
+// the compiler instantiates the dispatcher once per signature.
+//
+template<typename fn_t> class api_hook_caller;
 
+// argument list for functions without arguments
 #define VOID_ARG 0
 
-PACK_ARGS_CLASS_HEADER(void, (int)) {};
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(i, (int _i1)): i1(_i1) {}; 
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2i, (int _i1, int _i2)): i1(_i1), i2(_i2) {}; 
-	int i1,i2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3i, (int _i1, int _i2, int _i3)): i1(_i1), i2(_i2), i3(_i3) {};
-	int i1,i2,i3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ui, (unsigned int _ui1)): ui1(_ui1) {}; 
-	unsigned int ui1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ul, (unsigned long _ul1)): ul1(_ul1) {}; 
-	unsigned long ul1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(f, (float _f1)): f1(_f1) {}; 
-	float f1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2f, (float _f1, float _f2)): f1(_f1), f2(_f2) {}; 
-	float f1,f2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p, (const void *_p1)): p1(_p1) {}; 
-	const void *p1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p, (const void *_p1, const void *_p2)): p1(_p1), p2(_p2) {}; 
-	const void *p1,*p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3p, (const void *_p1, const void *_p2, const void *_p3)): p1(_p1), p2(_p2), p3(_p3) {}; 
-	const void *p1,*p2,*p3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(4p, (const void *_p1, const void *_p2, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2,*p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pV, (const void *_p1, const void *_p2, const void *_str)): p1(_p1), p2(_p2), str(_str) {}; 
-	const void *p1,*p2,*str;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ipV, (int _i1, const void *_p1, const void *_str)): i1(_i1), p1(_p1), str(_str) {}; 
-	int i1;
-	const void *p1,*str;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2i2p, (int _i1, int _i2, const void *_p1, const void *_p2)): i1(_i1), i2(_i2), p1(_p1), p2(_p2) {}; 
-	int i1,i2;
-	const void *p1,*p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p2f, (const void *_p1, const void *_p2, float _f1, float _f2)): p1(_p1), p2(_p2), f1(_f1), f2(_f2) {}; 
-	const void *p1,*p2;
-	float f1,f2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p2i2p, (const void *_p1, const void *_p2, int _i1, int _i2, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), i1(_i1), i2(_i2), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2;
-	int i1,i2;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2p3fus2uc, (const void *_p1, const void *_p2, float _f1, float _f2, float _f3, unsigned short _us1, unsigned char _uc1, unsigned char _uc2)): p1(_p1), p2(_p2), f1(_f1), f2(_f2), f3(_f3), us1(_us1), uc1(_uc1), uc2(_uc2) {}; 
-	const void *p1,*p2;
-	float f1,f2,f3;
-	unsigned int us1;
-	unsigned int uc1,uc2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pf, (const void *_p1, const void *_p2, float _f1)): p1(_p1), p2(_p2), f1(_f1) {}; 
-	const void *p1,*p2;
-	float f1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pfi, (const void *_p1, const void *_p2, float _f1, int _i1)): p1(_p1), p2(_p2), f1(_f1), i1(_i1) {}; 
-	const void *p1,*p2;
-	float f1;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pi, (const void *_p1, const void *_p2, int _i1)): p1(_p1), p2(_p2), i1(_i1) {}; 
-	const void *p1,*p2;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pi2p, (const void *_p1, const void *_p2, int _i1, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), i1(_i1), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2;
-	int i1;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pif2p, (const void *_p1, const void *_p2, int _i1, float _f1, const void *_p3, const void *_p4)): p1(_p1), p2(_p2), i1(_i1), f1(_f1), p3(_p3), p4(_p4) {}; 
-	const void *p1,*p2;
-	int i1;
-	float f1;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3p2f2i, (const void *_p1, const void *_p2, const void *_p3, float _f1, float _f2, int _i1, int _i2)): p1(_p1), p2(_p2), p3(_p3), f1(_f1), f2(_f2), i1(_i1), i2(_i2) {}; 
-	const void *p1,*p2,*p3;	
-	float f1,f2;
-	int i1,i2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3pi2p, (const void *_p1, const void *_p2, const void *_p3, int _i1, const void *_p4, const void *_p5)): p1(_p1), p2(_p2), p3(_p3), i1(_i1), p4(_p4), p5(_p5) {}; 
-	const void *p1,*p2,*p3;	
-	int i1;
-	const void *p4,*p5;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(i3p, (int _i1, const void *_p1, const void *_p2, const void *_p3)): i1(_i1), p1(_p1), p2(_p2), p3(_p3) {}; 
-	int i1;
-	const void *p1,*p2,*p3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ip, (int _i1, const void *_p1)): i1(_i1), p1(_p1) {}; 
-	int i1;
-	const void *p1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(ipusf2p2f4i, (int _i1, const void *_p1, unsigned short _us1, float _f1, const void *_p2, const void *_p3, float _f2, float _f3, int _i2, int _i3, int _i4, int _i5)): i1(_i1), p1(_p1), us1(_us1), f1(_f1), p2(_p2), p3(_p3), f2(_f2), f3(_f3), i2(_i2), i3(_i3), i4(_i4), i5(_i5) {}; 
-	int i1;
-	const void *p1;
-	unsigned int us1;
-	float f1;
-	const void *p2,*p3;
-	float f2,f3;
-	int i2,i3,i4,i5;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(3pi, (const void *_p1, const void *_p2, const void *_p3, int _i1)): p1(_p1), p2(_p2), p3(_p3), i1(_i1) {}; 
-	const void *p1,*p2,*p3;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(4pi, (const void *_p1, const void *_p2, const void *_p3, const void *_p4, int _i1)): p1(_p1), p2(_p2), p3(_p3), p4(_p4), i1(_i1) {}; 
-	const void *p1,*p2,*p3,*p4;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pf, (const void *_p1, float _f1)): p1(_p1), f1(_f1) {}; 
-	const void *p1;
-	float f1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pfp, (const void *_p1, float _f1, const void *_p2)): p1(_p1), f1(_f1), p2(_p2) {}; 
-	const void *p1;
-	float f1;
-	const void *p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pi, (const void *_p1, int _i1)): p1(_p1), i1(_i1) {}; 
-	const void *p1;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pi2p, (const void *_p1, int _i1, const void *_p2, const void *_p3)): p1(_p1), i1(_i1), p2(_p2), p3(_p3) {}; 
-	const void *p1;
-	int i1;
-	const void *p2, *p3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pip, (const void *_p1, int _i1, const void *_p2)): p1(_p1), i1(_i1), p2(_p2) {}; 
-	const void *p1;
-	int i1;
-	const void *p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pip2f2i, (const void *_p1, int _i1, const void *_p2, float _f1, float _f2, int _i2, int _i3)): p1(_p1), i1(_i1), p2(_p2), f1(_f1), f2(_f2), i2(_i2), i3(_i3) {}; 
-	const void *p1;
-	int i1;
-	const void *p2;
-	float f1,f2;
-	int i2,i3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pip2f4i2p, (const void *_p1, int _i1, const void *_p2, float _f1, float _f2, int _i2, int _i3, int _i4, int _i5, const void *_p3, const void *_p4)): p1(_p1), i1(_i1), p2(_p2), f1(_f1), f2(_f2), i2(_i2), i3(_i3), i4(_i4), i5(_i5), p3(_p3), p4(_p4) {}; 
-	const void *p1;
-	int i1;
-	const void *p2;
-	float f1,f2;
-	int i2,i3,i4,i5;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(puc, (const void *_p1, unsigned char _uc1)): p1(_p1), uc1(_uc1) {}; 
-	const void *p1;
-	unsigned int uc1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2i2pi2p, (int _i1, int _i2, const void *_p1, const void *_p2, int _i3, const void *_p3, const void *_p4)): i1(_i1), i2(_i2), p1(_p1), p2(_p2), i3(_i3), p3(_p3), p4(_p4) {}; 
-	int i1,i2;
-	const void *p1,*p2;
-	int i3;
-	const void *p3,*p4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(2pui, (const void *_p1, const void *_p2, unsigned int _ui1)): p1(_p1), p2(_p2), ui1(_ui1) {}; 
-	const void *p1,*p2;
-	unsigned int ui1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(i2p, (int _i1, const void *_p1, const void *_p2)): i1(_i1), p1(_p1), p2(_p2) {}; 
-	int i1;
-	const void *p1,*p2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p2f, (const void *_p1, float _f1, float _f2)): p1(_p1), f1(_f1), f2(_f2) {}; 
-	const void *p1;
-	float f1,f2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p2fi, (const void *_p1, float _f1, float _f2, int _i1)): p1(_p1), f1(_f1), f2(_f2), i1(_i1) {}; 
-	const void *p1;
-	float f1,f2;
-	int i1;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p2i, (const void *_p1, int _i1, int _i2)): p1(_p1), i1(_i1), i2(_i2) {}; 
-	const void *p1;
-	int i1,i2;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p3i, (const void *_p1, int _i1, int _i2, int _i3)): p1(_p1), i1(_i1), i2(_i2), i3(_i3) {}; 
-	const void *p1;
-	int i1,i2,i3;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(p4i, (const void *_p1, int _i1, int _i2, int _i3, int _i4)): p1(_p1), i1(_i1), i2(_i2), i3(_i3), i4(_i4) {}; 
-	const void *p1;
-	int i1,i2,i3,i4;
-PACK_ARGS_END
-
-PACK_ARGS_CLASS_HEADER(pi2p2ip, (const void *_p1, int _i1, const void *_p2, const void *_p3, int _i2, int _i3, const void *_p4)): p1(_p1), i1(_i1), p2(_p2), p3(_p3), i2(_i2), i3(_i3), p4(_p4) {}; 
-	const void *p1;
-	int i1;
-	const void *p2,*p3;
-	int i2,i3;
-	const void *p4;
-PACK_ARGS_END
-
-//
-// API function callers.
-//
-#ifdef __METAMOD_BUILD__
-	#define EXTERN_API_CALLER_FUNCTION(ret_type, args_code) \
-		void * DLLINTERNAL _COMBINE4(api_caller_, ret_type, _args_, args_code)(const void * func, const void * packed_args)
-#else
-	#define EXTERN_API_CALLER_FUNCTION(ret_type, args_code) \
-		static const api_caller_func_t _COMBINE4(api_caller_, ret_type, _args_, args_code) DLLHIDDEN = (api_caller_func_t)0
-#endif
-
-EXTERN_API_CALLER_FUNCTION(void, ipV);
-EXTERN_API_CALLER_FUNCTION(void, 2pV);
-EXTERN_API_CALLER_FUNCTION(void, void);
-EXTERN_API_CALLER_FUNCTION(ptr, void);
-EXTERN_API_CALLER_FUNCTION(int, void);
-EXTERN_API_CALLER_FUNCTION(float, void);
-EXTERN_API_CALLER_FUNCTION(float, 2f);
-EXTERN_API_CALLER_FUNCTION(void, 2i);
-EXTERN_API_CALLER_FUNCTION(int, 2i);
-EXTERN_API_CALLER_FUNCTION(void, 2i2p);
-EXTERN_API_CALLER_FUNCTION(void, 2i2pi2p);
-EXTERN_API_CALLER_FUNCTION(void, 2p);
-EXTERN_API_CALLER_FUNCTION(ptr, 2p);
-EXTERN_API_CALLER_FUNCTION(int, 2p);
-EXTERN_API_CALLER_FUNCTION(void, 2p2f);
-EXTERN_API_CALLER_FUNCTION(void, 2p2i2p);
-EXTERN_API_CALLER_FUNCTION(void, 2p3fus2uc);
-EXTERN_API_CALLER_FUNCTION(ptr, 2pf);
-EXTERN_API_CALLER_FUNCTION(void, 2pfi);
-EXTERN_API_CALLER_FUNCTION(void, 2pi);
-EXTERN_API_CALLER_FUNCTION(int, 2pi);
-EXTERN_API_CALLER_FUNCTION(void, 2pui);
-EXTERN_API_CALLER_FUNCTION(void, 2pi2p);
-EXTERN_API_CALLER_FUNCTION(void, 2pif2p);
-EXTERN_API_CALLER_FUNCTION(int, 3i);
-EXTERN_API_CALLER_FUNCTION(void, 3p);
-EXTERN_API_CALLER_FUNCTION(ptr, 3p);
-EXTERN_API_CALLER_FUNCTION(int, 3p);
-EXTERN_API_CALLER_FUNCTION(void, 3p2f2i);
-EXTERN_API_CALLER_FUNCTION(int, 3pi2p);
-EXTERN_API_CALLER_FUNCTION(void, 4p);
-EXTERN_API_CALLER_FUNCTION(int, 4p);
-EXTERN_API_CALLER_FUNCTION(void, 4pi);
-EXTERN_API_CALLER_FUNCTION(int, 4pi);
-EXTERN_API_CALLER_FUNCTION(void, f);
-EXTERN_API_CALLER_FUNCTION(void, i);
-EXTERN_API_CALLER_FUNCTION(ptr, i);
-EXTERN_API_CALLER_FUNCTION(int, i);
-EXTERN_API_CALLER_FUNCTION(ptr, ui);
-EXTERN_API_CALLER_FUNCTION(uint, ui);
-EXTERN_API_CALLER_FUNCTION(ulong, ul);
-EXTERN_API_CALLER_FUNCTION(void, i2p);
-EXTERN_API_CALLER_FUNCTION(int, i2p);
-EXTERN_API_CALLER_FUNCTION(void, i3p);
-EXTERN_API_CALLER_FUNCTION(void, ip);
-EXTERN_API_CALLER_FUNCTION(ushort, ip);
-EXTERN_API_CALLER_FUNCTION(int, ip);
-EXTERN_API_CALLER_FUNCTION(void, ipusf2p2f4i);
-EXTERN_API_CALLER_FUNCTION(void, p);
-EXTERN_API_CALLER_FUNCTION(ptr, p);
-EXTERN_API_CALLER_FUNCTION(char, p);
-EXTERN_API_CALLER_FUNCTION(int, p);
-EXTERN_API_CALLER_FUNCTION(uint, p);
-EXTERN_API_CALLER_FUNCTION(float, p);
-EXTERN_API_CALLER_FUNCTION(void, p2f);
-EXTERN_API_CALLER_FUNCTION(int, p2fi);
-EXTERN_API_CALLER_FUNCTION(void, p2i);
-EXTERN_API_CALLER_FUNCTION(void, p3i);
-EXTERN_API_CALLER_FUNCTION(void, p4i);
-EXTERN_API_CALLER_FUNCTION(void, puc);
-EXTERN_API_CALLER_FUNCTION(void, pf);
-EXTERN_API_CALLER_FUNCTION(void, pfp);
-EXTERN_API_CALLER_FUNCTION(void, pi);
-EXTERN_API_CALLER_FUNCTION(ptr, pi);
-EXTERN_API_CALLER_FUNCTION(int, pi);
-EXTERN_API_CALLER_FUNCTION(void, pi2p);
-EXTERN_API_CALLER_FUNCTION(int, pi2p2ip);
-EXTERN_API_CALLER_FUNCTION(void, pip);
-EXTERN_API_CALLER_FUNCTION(ptr, pip);
-EXTERN_API_CALLER_FUNCTION(void, pip2f2i);
-EXTERN_API_CALLER_FUNCTION(void, pip2f4i2p);
+template<typename R>
+class api_hook_caller<R (*)(void)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(int) {};		// VOID_ARG
+	inline R operator()(void *pfn) const { return((*(R (*)(void))pfn)()); };
+	inline void record(api_record_writer &) const {};
+	inline void record_out(api_record_writer &) const {};
+	inline unsigned long long ent_mask(void) const { return(~0ULL); };
+};
+
+template<typename R, typename A1>
+class api_hook_caller<R (*)(A1)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1): a1(_a1) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1))pfn)(a1)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, 0)); };
+private:
+	A1 a1;
+};
+
+template<typename R, typename A1, typename A2>
+class api_hook_caller<R (*)(A1, A2)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2): a1(_a1), a2(_a2) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2))pfn)(a1, a2)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2;
+};
+
+template<typename R, typename A1, typename A2, typename A3>
+class api_hook_caller<R (*)(A1, A2, A3)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3): a1(_a1), a2(_a2), a3(_a3) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3))pfn)(a1, a2, a3)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4>
+class api_hook_caller<R (*)(A1, A2, A3, A4)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4): a1(_a1), a2(_a2), a3(_a3), a4(_a4) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4))pfn)(a1, a2, a3, a4)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5))pfn)(a1, a2, a3, a4, a5)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5, A6)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5, A6 _a6): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5), a6(_a6) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5, A6))pfn)(a1, a2, a3, a4, a5, a6)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); w.arg(a6); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); w.out(a6); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5, A6, A7)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5, A6 _a6, A7 _a7): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5), a6(_a6), a7(_a7) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5, A6, A7))pfn)(a1, a2, a3, a4, a5, a6, a7)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); w.arg(a6); w.arg(a7); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); w.out(a6); w.out(a7); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6; A7 a7;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5, A6, A7, A8)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5, A6 _a6, A7 _a7, A8 _a8): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5), a6(_a6), a7(_a7), a8(_a8) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5, A6, A7, A8))pfn)(a1, a2, a3, a4, a5, a6, a7, a8)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); w.arg(a6); w.arg(a7); w.arg(a8); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); w.out(a6); w.out(a7); w.out(a8); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6; A7 a7; A8 a8;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5, A6 _a6, A7 _a7, A8 _a8, A9 _a9): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5), a6(_a6), a7(_a7), a8(_a8), a9(_a9) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9))pfn)(a1, a2, a3, a4, a5, a6, a7, a8, a9)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); w.arg(a6); w.arg(a7); w.arg(a8); w.arg(a9); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); w.out(a6); w.out(a7); w.out(a8); w.out(a9); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6; A7 a7; A8 a8; A9 a9;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9, typename A10>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5, A6 _a6, A7 _a7, A8 _a8, A9 _a9, A10 _a10): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5), a6(_a6), a7(_a7), a8(_a8), a9(_a9), a10(_a10) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10))pfn)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); w.arg(a6); w.arg(a7); w.arg(a8); w.arg(a9); w.arg(a10); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); w.out(a6); w.out(a7); w.out(a8); w.out(a9); w.out(a10); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6; A7 a7; A8 a8; A9 a9; A10 a10;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9, typename A10, typename A11>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5, A6 _a6, A7 _a7, A8 _a8, A9 _a9, A10 _a10, A11 _a11): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5), a6(_a6), a7(_a7), a8(_a8), a9(_a9), a10(_a10), a11(_a11) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11))pfn)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); w.arg(a6); w.arg(a7); w.arg(a8); w.arg(a9); w.arg(a10); w.arg(a11); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); w.out(a6); w.out(a7); w.out(a8); w.out(a9); w.out(a10); w.out(a11); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6; A7 a7; A8 a8; A9 a9; A10 a10; A11 a11;
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9, typename A10, typename A11, typename A12>
+class api_hook_caller<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11, A12)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, A3 _a3, A4 _a4, A5 _a5, A6 _a6, A7 _a7, A8 _a8, A9 _a9, A10 _a10, A11 _a11, A12 _a12): a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5), a6(_a6), a7(_a7), a8(_a8), a9(_a9), a10(_a10), a11(_a11), a12(_a12) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11, A12))pfn)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(a3); w.arg(a4); w.arg(a5); w.arg(a6); w.arg(a7); w.arg(a8); w.arg(a9); w.arg(a10); w.arg(a11); w.arg(a12); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(a3); w.out(a4); w.out(a5); w.out(a6); w.out(a7); w.out(a8); w.out(a9); w.out(a10); w.out(a11); w.out(a12); };
+	inline unsigned long long ent_mask(void) const { return(api_hook_ent_mask(a1, a2)); };
+private:
+	A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6; A7 a7; A8 a8; A9 a9; A10 a10; A11 a11; A12 a12;
+};
+
+// printf-style functions; the string is formatted by our wrapper and
+// passed on as "%s" argument
+template<typename R, typename A1, typename A2>
+class api_hook_caller<R (*)(A1, A2, ...)> {
+public:
+	typedef R ret_t;
+	inline api_hook_caller(A1 _a1, A2 _a2, const char *_str): a1(_a1), a2(_a2), str(_str) {};
+	inline R operator()(void *pfn) const { return((*(R (*)(A1, A2, ...))pfn)(a1, a2, str)); };
+	inline void record(api_record_writer &w) const { w.arg(a1); w.arg(a2); w.arg(str); };
+	inline void record_out(api_record_writer &w) const { w.out(a1); w.out(a2); w.out(str); };
+	inline unsigned long long ent_mask(void) const { return(~0ULL); };
+private:
+	A1 a1; A2 a2; const char *str;
+};
+
+// Return value storage with the real return type.  The void version
+// stores nothing, and lets the compiler drop all return value handling
+// from void functions.
+template<typename ret_t> class api_hook_ret {
+public:
+	enum { has_ret = 1 };
+	typedef ret_t init_t;
+	inline api_hook_ret(init_t init): value(init) {};
+	inline void *getptr(void) { return(&value); };
+	inline ret_t get(void) const { return(value); };
+	template<class caller_t> inline void call(const caller_t &caller, void *pfn) { value = caller(pfn); };
+	inline void record(api_record_writer &w) const { w.ret(value); };
+private:
+	ret_t value;
+};
+
+template<> class api_hook_ret<void> {
+public:
+	enum { has_ret = 0 };
+	typedef int init_t;
+	inline api_hook_ret(init_t) {};
+	inline void *getptr(void) { return(NULL); };
+	inline void get(void) const {};
+	template<class caller_t> inline void call(const caller_t &caller, void *pfn) { caller(pfn); };
+	inline void record(api_record_writer &) const {};
+};
+
+// Main hook function: call pre plugin functions, original routine and
+// post plugin functions, handling META_RES of each plugin.  Return value
+// of void functions is ignored; pass 0 as ret_init.
+template<class caller_t>
+typename caller_t::ret_t api_hook_dispatch(const caller_t &caller, const api_info_t *api_info, enum_api_t api, unsigned int func_offset, typename api_hook_ret<typename caller_t::ret_t>::init_t ret_init) {
+	typedef api_hook_ret<typename caller_t::ret_t> ret_holder_t;
+	int i;
+	META_RES mres, status, prev_mres;
+	MPlugin *iplug;
+	void *pfn_routine;
+	int loglevel;
+	const void *api_table;
+	meta_globals_t backup_meta_globals[1];
+	api_hook_subscriber_list_t slist;
+	unsigned int generation;
+	int timing;
+	unsigned long long call_start=0;
+	int recording, called_orig;
+	unsigned long long ent_mask=0;
+	int ent_mask_set=0;
+	
+	//Fix bug with metamod-bot-plugins.
+	if(unlikely(api_hook_call_count++>0)) {
+		//Backup PublicMetaGlobals.
+		backup_meta_globals[0] = PublicMetaGlobals;
+	}
+	
+	//Return value setup
+	ret_holder_t dllret(ret_init);
+	ret_holder_t override_ret(ret_init);
+	ret_holder_t pub_override_ret(ret_init);
+	ret_holder_t orig_ret(ret_init);
+	ret_holder_t pub_orig_ret(ret_init);
+	
+	//Setup
+	loglevel=api_info->loglevel;
+	timing=(meta_trace_value || meta_prof_value);
+	status=MRES_UNSET;
+	called_orig=0;
+	
+	//Record call for replay
+	recording=api_record_active;
+	if(unlikely(recording))
+		api_record_call(caller, api, func_offset);
+	
+	//Pre plugin functions
+	prev_mres=MRES_UNSET;
+	slist = *get_api_subscribers(0, api, func_offset);
+	generation = subscriber_generation;
+	for(i=0; likely(i < slist.count); i++) {
+		iplug=slist.list[i].plugin;
+		pfn_routine=slist.list[i].pfn_routine;
+		
+		//plugin list changed under us (plugin unloaded or paused by a
+		//previous plugin); make sure this one is still valid
+		if(unlikely(generation != subscriber_generation || subscribers_stale)
+				&& !is_api_subscriber(0, api, func_offset, iplug, pfn_routine))
+			continue;
+		
+		//plugin doesn't want this message or entity
+		if(unlikely(!api_hook_msg_wanted(&slist.list[i])))
+			continue;
+		if(unlikely(slist.list[i].ent_bit)) {
+			if(!ent_mask_set) {
+				ent_mask=caller.ent_mask();
+				ent_mask_set=1;
+			}
+			if(!(ent_mask & slist.list[i].ent_bit))
+				continue;
+		}
+		
+		// initialize PublicMetaGlobals
+		PublicMetaGlobals.mres = MRES_UNSET;
+		PublicMetaGlobals.prev_mres = prev_mres;
+		PublicMetaGlobals.status = status;
+		if(ret_holder_t::has_ret) {
+			pub_orig_ret = orig_ret;
+			PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
+			if(unlikely(status==MRES_SUPERCEDE)) {
+				pub_override_ret = override_ret;
+				PublicMetaGlobals.override_ret = pub_override_ret.getptr();
+			}
+		}
+		
+		// call plugin
+		META_DEBUG(loglevel, ("Calling %s:%s()", iplug->file, api_info->name));
+		if(timing)
+			call_start=GET_TSC();
+		API_PAUSE_TSC_TRACKING();
+		dllret.call(caller, pfn_routine);
+		API_UNPAUSE_TSC_TRACKING();
+		
+		// plugin's result code
+		mres=PublicMetaGlobals.mres;
+		if(timing)
+			api_hook_timed(iplug->index, 0, api, func_offset, call_start, mres);
+		if(unlikely(mres > status))
+			status = mres;
+		
+		// save this for successive plugins to see
+		prev_mres = mres;
+		
+		if(unlikely(mres==MRES_SUPERCEDE)) {
+			if(ret_holder_t::has_ret) {
+				pub_override_ret = dllret;
+				override_ret = dllret;
+			}
+		} 
+		else if(unlikely(mres==MRES_UNSET)) {
+			META_WARNING("Plugin didn't set meta_result: %s:%s()", iplug->file, api_info->name);
+		}
+	}
+	
+	api_hook_call_count--;
+	
+	//Api call
+	if(likely(status!=MRES_SUPERCEDE)) {
+		//get api table
+		api_table = *api_tables[api];
+		pfn_routine = likely(api_table) ? get_api_function(api_table, func_offset) : NULL;
+		
+		if(likely(pfn_routine)) {
+			META_DEBUG(loglevel, ("Calling %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
+			if(timing)
+				call_start=GET_TSC();
+			API_PAUSE_TSC_TRACKING();
+			dllret.call(caller, pfn_routine);
+			API_UNPAUSE_TSC_TRACKING();
+			if(timing)
+				api_hook_timed(PROF_ORIG_ROUTINE, 0, api, func_offset, call_start, PROF_NO_MRES);
+			orig_ret = dllret;
+			called_orig=1;
+		} else {
+			api_hook_no_routine(api_info, api, api_table);
+			status=MRES_UNSET;
+		}
+	} else {
+		META_DEBUG(loglevel, ("Skipped (supercede) %s:%s()", (api==e_api_engine)?"engine":GameDLL.file, api_info->name));
+		if(ret_holder_t::has_ret) {
+			orig_ret = override_ret;
+			pub_orig_ret = override_ret;
+			PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
+		}
+	}
+	
+	if(unlikely(recording))
+		api_record_return(caller, orig_ret, api, func_offset, called_orig);
+	
+	api_hook_call_count++;
+	
+	//Post plugin functions
+	prev_mres=MRES_UNSET;
+	slist = *get_api_subscribers(1, api, func_offset);
+	generation = subscriber_generation;
+	for(i=0; likely(i < slist.count); i++) {
+		iplug=slist.list[i].plugin;
+		pfn_routine=slist.list[i].pfn_routine;
+		
+		//plugin list changed under us (plugin unloaded or paused by a
+		//previous plugin); make sure this one is still valid
+		if(unlikely(generation != subscriber_generation || subscribers_stale)
+				&& !is_api_subscriber(1, api, func_offset, iplug, pfn_routine))
+			continue;
+		
+		//plugin doesn't want this message or entity
+		if(unlikely(!api_hook_msg_wanted(&slist.list[i])))
+			continue;
+		if(unlikely(slist.list[i].ent_bit)) {
+			if(!ent_mask_set) {
+				ent_mask=caller.ent_mask();
+				ent_mask_set=1;
+			}
+			if(!(ent_mask & slist.list[i].ent_bit))
+				continue;
+		}
+		
+		// initialize PublicMetaGlobals
+		PublicMetaGlobals.mres = MRES_UNSET;
+		PublicMetaGlobals.prev_mres = prev_mres;
+		PublicMetaGlobals.status = status;
+		if(ret_holder_t::has_ret) {
+			pub_orig_ret = orig_ret;
+			PublicMetaGlobals.orig_ret = pub_orig_ret.getptr();
+			if(unlikely(status==MRES_OVERRIDE)) {
+				pub_override_ret = override_ret;
+				PublicMetaGlobals.override_ret = pub_override_ret.getptr();
+			}
+		}
+		
+		// call plugin
+		META_DEBUG(loglevel, ("Calling %s:%s_Post()", iplug->file, api_info->name));
+		if(timing)
+			call_start=GET_TSC();
+		API_PAUSE_TSC_TRACKING();
+		dllret.call(caller, pfn_routine);
+		API_UNPAUSE_TSC_TRACKING();
+		
+		// plugin's result code
+		mres=PublicMetaGlobals.mres;
+		if(timing)
+			api_hook_timed(iplug->index, 1, api, func_offset, call_start, mres);
+		if(unlikely(mres > status))
+			status = mres;
+		
+		// save this for successive plugins to see
+		prev_mres = mres;
+		
+		if(unlikely(mres==MRES_OVERRIDE)) {
+			if(ret_holder_t::has_ret) {
+				pub_override_ret = dllret;
+				override_ret = dllret;
+			}
+		}
+		else if(unlikely(mres==MRES_UNSET)) {
+			META_WARNING("Plugin didn't set meta_result: %s:%s_Post()", iplug->file, api_info->name);
+		}
+		else if(unlikely(mres==MRES_SUPERCEDE)) {
+			META_WARNING("MRES_SUPERCEDE not valid in Post functions: %s:%s_Post()", iplug->file, api_info->name);
+		}
+	}
+	
+	if(unlikely(--api_hook_call_count>0)) {
+		//Restore backup
+		PublicMetaGlobals = backup_meta_globals[0];
+	}
+	
+	if(ret_holder_t::has_ret && unlikely(status==MRES_OVERRIDE)) {
+		META_DEBUG(loglevel, ("Returning (override) %s()", api_info->name));
+		return(override_ret.get());
+	}
+	return(orig_ret.get());
+}
 
 #endif /*API_HOOK_H*/
@@ -53,14 +53,17 @@ typedef enum enum_api_t {
 	e_api_newapi = 2,
 } enum_api_t;
 
-// API caller function prototype
-typedef void * (DLLINTERNAL_NOVIS * api_caller_func_t)(const void * func, const void * packed_args);
+// Function signature as return type and argument codes, ie. "int_args_2pi"
+// for 'int func(void *, void *, int)'.  Argument codes are p (pointer),
+// i, ui, ul, f, us and uc, optionally preceded by repeat count, and V for
+// printf-style varargs.
+#define API_SIGNATURE(ret_type, args_code) #ret_type "_args_" #args_code
 
 
 typedef struct api_info_s {
 	mBOOL trace;			// if true, log info about this function
 	int loglevel;			// level at which to log info about this function
-	api_caller_func_t api_caller;	// argument format/type for single-main-hook-function optimization
+	const char *signature;	// argument format/type, see API_SIGNATURE
 	const char *name;		// string representation of function name
 } api_info_t;
 
@@ -309,4 +312,8 @@ extern const dllapi_info_t dllapi_info DLLHIDDEN;
 extern const newapi_info_t newapi_info DLLHIDDEN;
 extern const engine_info_t engine_info DLLHIDDEN;
 
+// get info for function by api and function pointer offset; NULL if
+// function is past the known part of the api table
+const api_info_t * DLLINTERNAL get_api_info(enum_api_t api, unsigned int func_offset);
+
 #endif /* API_INFO_H */
@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdio.h>			// fopen, etc
+#include <stdlib.h>			// qsort, calloc, etc
+#include <string.h>			// memset, etc
+#ifdef linux
+#include <sys/time.h>		// gettimeofday; win32 in osdep.h
+#endif
+
+#include <extdll.h>			// always
+
+#include "api_prof.h"		// me
+#include "api_hook.h"		// NUM_API_FUNCS, api_func_base
+#include "metamod.h"		// GET_TSC, GameDLL, etc
+#include "log_meta.h"		// META_CONS, etc
+#include "support_meta.h"	// full_gamedir_path, STRNCPY
+#include "osdep.h"			// strcasecmp, etc
+
+cvar_t meta_prof = {"meta_prof", "0", FCVAR_EXTDLL, 0, NULL};
+int meta_prof_value = 0;
+
+// Histogram bucket n counts calls that took less than 2^n ticks (and at
+// least 2^(n-1)); last bucket takes everything longer.
+#define PROF_BUCKETS 40
+
+typedef struct api_prof_stat_s {
+	unsigned long long calls;
+	unsigned long long total;			// ticks
+	unsigned long long max;				// ticks
+	unsigned int mres[MRES_SUPERCEDE + 1];	// calls by result code
+	unsigned int hist[PROF_BUCKETS];
+} api_prof_stat_t;
+
+// Statistics of one plugin index, by pre/post and function; allocated on
+// first call.
+typedef struct api_prof_plugin_s {
+	api_prof_stat_t *stats[2][NUM_API_FUNCS];
+	char name[MAX_DESC_LEN];
+} api_prof_plugin_t;
+
+// By plugin index, grown as needed.  Index 0 is original engine/gamedll
+// routine.
+static api_prof_plugin_t **prof_plugins = NULL;
+static int prof_num_plugins = 0;
+
+// Reference point for converting ticks to time.
+static unsigned long long prof_calib_tsc = 0;
+static struct timeval prof_calib_tv;
+
+static const char * const api_names[3] = { "engine", "dllapi", "newapi" };
+
+inline int DLLINTERNAL prof_bucket(unsigned long long ticks) {
+	int b;
+#ifdef __GNUC__
+	b = ticks ? 64 - __builtin_clzll(ticks) : 0;
+#else
+	for(b=0; ticks; b++)
+		ticks >>= 1;
+#endif
+	return(b < PROF_BUCKETS ? b : PROF_BUCKETS - 1);
+}
+
+// Statistics of plugin index, allocating them if needed; NULL if out of
+// memory.
+static api_prof_plugin_t * DLLINTERNAL prof_plugin(int plugin_index) {
+	api_prof_plugin_t **temp;
+	int newnum;
+	
+	if(plugin_index >= prof_num_plugins) {
+		newnum = plugin_index + 16;
+		temp = (api_prof_plugin_t **)realloc(prof_plugins, newnum * sizeof(api_prof_plugin_t *));
+		if(!temp)
+			return(NULL);
+		memset(&temp[prof_num_plugins], 0, (newnum - prof_num_plugins) * sizeof(api_prof_plugin_t *));
+		prof_plugins = temp;
+		prof_num_plugins = newnum;
+	}
+	if(!prof_plugins[plugin_index])
+		prof_plugins[plugin_index] = (api_prof_plugin_t *)calloc(1, sizeof(api_prof_plugin_t));
+	return(prof_plugins[plugin_index]);
+}
+
+// Record one call.
+void DLLINTERNAL api_prof_record(int plugin_index, int post, enum_api_t api, unsigned int func_offset, unsigned long long ticks, META_RES mres) {
+	api_prof_plugin_t *plug;
+	api_prof_stat_t **pstat, *stat;
+	
+	if(unlikely(plugin_index < 0))
+		return;
+	if(likely(plugin_index < prof_num_plugins && prof_plugins[plugin_index]))
+		plug = prof_plugins[plugin_index];
+	else if(!(plug = prof_plugin(plugin_index)))
+		return;
+	
+	pstat = &plug->stats[post][api_func_base[api] + func_offset / sizeof(void*)];
+	if(unlikely(!(stat = *pstat))) {
+		if(!(stat = (api_prof_stat_t *)calloc(1, sizeof(api_prof_stat_t))))
+			return;
+		*pstat = stat;
+		if(!prof_calib_tsc) {
+			prof_calib_tsc = GET_TSC();
+			gettimeofday(&prof_calib_tv, NULL);
+		}
+	}
+	
+	stat->calls++;
+	stat->total += ticks;
+	if(ticks > stat->max)
+		stat->max = ticks;
+	stat->hist[prof_bucket(ticks)]++;
+	if(mres >= MRES_UNSET && mres <= MRES_SUPERCEDE)
+		stat->mres[mres]++;
+}
+
+// Forget data collected for plugin index.
+static void DLLINTERNAL prof_clear(int plugin_index) {
+	api_prof_plugin_t *plug;
+	int post;
+	unsigned int func;
+	
+	if(plugin_index >= prof_num_plugins || !(plug = prof_plugins[plugin_index]))
+		return;
+	for(post=0; post < 2; post++) {
+		for(func=0; func < NUM_API_FUNCS; func++) {
+			if(plug->stats[post][func]) {
+				free(plug->stats[post][func]);
+				plug->stats[post][func] = NULL;
+			}
+		}
+	}
+}
+
+void DLLINTERNAL api_prof_plugin_loaded(int plugin_index, const char *name) {
+	api_prof_plugin_t *plug;
+	
+	if(plugin_index <= PROF_ORIG_ROUTINE)
+		return;
+	prof_clear(plugin_index);
+	if((plug = prof_plugin(plugin_index)))
+		STRNCPY(plug->name, name, sizeof(plug->name));
+}
+
+inline double DLLINTERNAL prof_usec(const struct timeval *tv) {
+	return(tv->tv_sec * 1000000.0 + tv->tv_usec);
+}
+
+// Ticks per microsecond, measured against wall clock since first call
+// was recorded.  If that was too recently, measure for a moment.
+static double DLLINTERNAL prof_ticks_per_usec(void) {
+	struct timeval tv, start_tv;
+	unsigned long long start_tsc;
+	double elapsed;
+	
+	if(prof_calib_tsc) {
+		gettimeofday(&tv, NULL);
+		elapsed = prof_usec(&tv) - prof_usec(&prof_calib_tv);
+		if(elapsed >= 100000.0)
+			return((GET_TSC() - prof_calib_tsc) / elapsed);
+	}
+	
+	start_tsc = GET_TSC();
+	gettimeofday(&start_tv, NULL);
+	do {
+		gettimeofday(&tv, NULL);
+		elapsed = prof_usec(&tv) - prof_usec(&start_tv);
+	} while(elapsed < 20000.0 && elapsed >= 0.0);
+	if(elapsed <= 0.0)
+		return(1.0);
+	return((GET_TSC() - start_tsc) / elapsed);
+}
+
+// Upper bound of histogram bucket holding given percentile, in ticks.
+static unsigned long long DLLINTERNAL prof_percentile(const api_prof_stat_t *stat, double pct) {
+	unsigned long long need, sum;
+	int b;
+	
+	need = (unsigned long long)(stat->calls * pct / 100.0);
+	if(need < 1)
+		need = 1;
+	for(b=0, sum=0; b < PROF_BUCKETS; b++) {
+		sum += stat->hist[b];
+		if(sum >= need)
+			break;
+	}
+	if(b >= PROF_BUCKETS - 1)
+		return(stat->max);
+	return(1ULL << b);
+}
+
+// One row for sorting and display.
+typedef struct prof_row_s {
+	int plugin_index;
+	int post;
+	enum_api_t api;
+	unsigned int func_offset;
+	const api_prof_stat_t *stat;
+	unsigned long long p99;
+} prof_row_t;
+
+typedef enum {
+	PROF_SORT_TOTAL = 0,
+	PROF_SORT_P99,
+	PROF_SORT_MEAN,
+	PROF_SORT_CALLS,
+} PROF_SORT;
+
+static PROF_SORT prof_sort_by = PROF_SORT_TOTAL;
+
+static int prof_row_cmp(const void *a, const void *b) {
+	const prof_row_t *ra=(const prof_row_t *)a, *rb=(const prof_row_t *)b;
+	unsigned long long va, vb;
+	
+	switch(prof_sort_by) {
+		case PROF_SORT_P99:
+			va=ra->p99; vb=rb->p99;
+			break;
+		case PROF_SORT_MEAN:
+			va=ra->stat->total / ra->stat->calls; vb=rb->stat->total / rb->stat->calls;
+			break;
+		case PROF_SORT_CALLS:
+			va=ra->stat->calls; vb=rb->stat->calls;
+			break;
+		default:
+			va=ra->stat->total; vb=rb->stat->total;
+			break;
+	}
+	return(va < vb ? 1 : va > vb ? -1 : 0);
+}
+
+// Collect rows with data; returns number of rows, or -1 on failure.
+static int DLLINTERNAL prof_collect(prof_row_t **prows) {
+	prof_row_t *rows;
+	int n, pi, post, api;
+	unsigned int func, nfuncs;
+	
+	rows=(prof_row_t *)calloc((prof_num_plugins ? prof_num_plugins : 1) * 2 * NUM_API_FUNCS, sizeof(prof_row_t));
+	if(!rows)
+		return(-1);
+	
+	n=0;
+	for(pi=0; pi < prof_num_plugins; pi++) {
+		if(!prof_plugins[pi])
+			continue;
+		for(post=0; post < 2; post++) {
+			for(api=0; api < 3; api++) {
+				nfuncs = (api == e_api_engine) ? NUM_ENGINE_FUNCS : (api == e_api_dllapi) ? NUM_DLLAPI_FUNCS : NUM_NEWAPI_FUNCS;
+				for(func=0; func < nfuncs; func++) {
+					const api_prof_stat_t *stat = prof_plugins[pi]->stats[post][api_func_base[api] + func];
+					if(!stat || !stat->calls)
+						continue;
+					rows[n].plugin_index=pi;
+					rows[n].post=post;
+					rows[n].api=(enum_api_t)api;
+					rows[n].func_offset=func * sizeof(void*);
+					rows[n].stat=stat;
+					rows[n].p99=prof_percentile(stat, 99.0);
+					n++;
+				}
+			}
+		}
+	}
+	*prows=rows;
+	return(n);
+}
+
+// Name of plugin or original routine for display.
+static const char * DLLINTERNAL prof_plugin_name(const prof_row_t *row) {
+	if(row->plugin_index == PROF_ORIG_ROUTINE)
+		return((row->api == e_api_engine) ? "engine" : GameDLL.name);
+	if(prof_plugins[row->plugin_index]->name[0])
+		return(prof_plugins[row->plugin_index]->name);
+	return("?");
+}
+
+// Name of function for display.
+static const char * DLLINTERNAL prof_func_name(const prof_row_t *row) {
+	const api_info_t *ainfo = get_api_info(row->api, row->func_offset);
+	return(ainfo ? ainfo->name : "?");
+}
+
+static void DLLINTERNAL prof_show(int top) {
+	prof_row_t *rows;
+	int i, n;
+	double tpu;
+	char fname[64];
+	const api_prof_stat_t *stat;
+	
+	n=prof_collect(&rows);
+	if(n < 0) {
+		META_CONS("Failed malloc() for profile data");
+		return;
+	}
+	tpu=prof_ticks_per_usec();
+	qsort(rows, n, sizeof(prof_row_t), prof_row_cmp);
+	
+	META_CONS("Hook profile (%s), %d hooks with data, times in usec:", meta_prof_value ? "enabled" : "disabled", n);
+	META_CONS("  %2s %-20s %-32s %10s %11s %8s %8s %8s  %s", "#", "plugin", "function", "calls", "total", "mean", "p99", "max", "ign/hnd/ovr/sup/unset");
+	for(i=0; i < n && i < top; i++) {
+		stat=rows[i].stat;
+		safevoid_snprintf(fname, sizeof(fname), "%s%s", prof_func_name(&rows[i]), rows[i].post ? "_Post" : "");
+		META_CONS("  %2d %-20.20s %-32.32s %10.0f %11.0f %8.2f %8.2f %8.2f  %u/%u/%u/%u/%u", 
+				rows[i].plugin_index, prof_plugin_name(&rows[i]), fname,
+				(double)stat->calls, stat->total / tpu, 
+				stat->total / tpu / stat->calls, rows[i].p99 / tpu, stat->max / tpu,
+				stat->mres[MRES_IGNORED], stat->mres[MRES_HANDLED], stat->mres[MRES_OVERRIDE], 
+				stat->mres[MRES_SUPERCEDE], stat->mres[MRES_UNSET]);
+	}
+	if(!meta_prof_value)
+		META_CONS("Set cvar meta_prof to 1 to collect data.");
+	
+	free(rows);
+}
+
+static void DLLINTERNAL prof_reset(void) {
+	int pi;
+	
+	for(pi=0; pi < prof_num_plugins; pi++)
+		prof_clear(pi);
+	prof_calib_tsc = 0;
+}
+
+static void DLLINTERNAL prof_dump(const char *filename) {
+	char path[PATH_MAX];
+	prof_row_t *rows;
+	int i, b, n, last;
+	double tpu;
+	FILE *fp;
+	const api_prof_stat_t *stat;
+	
+	full_gamedir_path(filename, path);
+	
+	n=prof_collect(&rows);
+	if(n < 0) {
+		META_CONS("Failed malloc() for profile data");
+		return;
+	}
+	if(!(fp=fopen(path, "w"))) {
+		META_CONS("Unable to open profile dump file '%s': %s", path, strerror(errno));
+		free(rows);
+		return;
+	}
+	tpu=prof_ticks_per_usec();
+	qsort(rows, n, sizeof(prof_row_t), prof_row_cmp);
+	
+	fprintf(fp, "# metamod hook profile; times in usec, %.1f ticks/usec\n", tpu);
+	fprintf(fp, "# plugin_index\tplugin\tapi\tfunction\tpost\tcalls\ttotal\tmean\tp50\tp99\tmax\tignored\thandled\toverride\tsupercede\tunset\thistogram(<2^n ticks: count,...)\n");
+	for(i=0; i < n; i++) {
+		stat=rows[i].stat;
+		fprintf(fp, "%d\t%s\t%s\t%s\t%d\t%.0f\t%.2f\t%.3f\t%.3f\t%.3f\t%.3f\t%u\t%u\t%u\t%u\t%u\t",
+				rows[i].plugin_index, prof_plugin_name(&rows[i]), api_names[rows[i].api], 
+				prof_func_name(&rows[i]), rows[i].post,
+				(double)stat->calls, stat->total / tpu, stat->total / tpu / stat->calls,
+				prof_percentile(stat, 50.0) / tpu, rows[i].p99 / tpu, stat->max / tpu,
+				stat->mres[MRES_IGNORED], stat->mres[MRES_HANDLED], stat->mres[MRES_OVERRIDE], 
+				stat->mres[MRES_SUPERCEDE], stat->mres[MRES_UNSET]);
+		for(last=PROF_BUCKETS - 1; last > 0 && !stat->hist[last]; last--)
+			;
+		for(b=0; b <= last; b++)
+			fprintf(fp, "%s%u", b ? "," : "", stat->hist[b]);
+		fprintf(fp, "\n");
+	}
+	fclose(fp);
+	free(rows);
+	
+	META_CONS("Dumped %d hook profiles to '%s'", n, path);
+}
+
+// "meta prof" console command.
+void DLLINTERNAL cmd_meta_prof(void) {
+	const char *cmd;
+	int argc, top;
+	
+	argc=CMD_ARGC();
+	cmd = (argc > 2) ? CMD_ARGV(2) : "top";
+	
+	if(!strcasecmp(cmd, "top")) {
+		top = (argc > 3) ? atoi(CMD_ARGV(3)) : 10;
+		if(top <= 0)
+			top = 10;
+		prof_sort_by = PROF_SORT_TOTAL;
+		if(argc > 4) {
+			if(!strcasecmp(CMD_ARGV(4), "p99"))
+				prof_sort_by = PROF_SORT_P99;
+			else if(!strcasecmp(CMD_ARGV(4), "mean"))
+				prof_sort_by = PROF_SORT_MEAN;
+			else if(!strcasecmp(CMD_ARGV(4), "calls"))
+				prof_sort_by = PROF_SORT_CALLS;
+			else if(strcasecmp(CMD_ARGV(4), "total")) {
+				META_CONS("Unknown sort key: %s", CMD_ARGV(4));
+				return;
+			}
+		}
+		prof_show(top);
+	}
+	else if(!strcasecmp(cmd, "reset")) {
+		prof_reset();
+		META_CONS("Hook profile data cleared");
+	}
+	else if(!strcasecmp(cmd, "dump")) {
+		prof_sort_by = PROF_SORT_TOTAL;
+		prof_dump((argc > 3) ? CMD_ARGV(3) : "metaprof.txt");
+	}
+	else {
+		META_CONS("usage: meta prof [top [<count>] [total|p99|mean|calls]]");
+		META_CONS("       meta prof reset");
+		META_CONS("       meta prof dump [<file>]");
+	}
+}
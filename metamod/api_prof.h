@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef API_PROF_H
+#define API_PROF_H
+
+#include "api_info.h"			// enum_api_t
+#include "meta_api.h"			// META_RES
+#include "comp_dep.h"
+
+// Hook profiler.
+//  When cvar "meta_prof" is nonzero, every call of a plugin's hook
+//  function (and of the original engine/gamedll routine) is timed, and
+//  counted into a log2 bucketed latency histogram and per META_RES
+//  counters, separately for each plugin, function and pre/post.  See
+//  "meta prof".
+
+extern cvar_t meta_prof DLLHIDDEN;
+extern int meta_prof_value DLLHIDDEN;	// preconverted meta_prof.value, like meta_debug_value
+
+// "plugin index" used for original engine/gamedll routine
+#define PROF_ORIG_ROUTINE 0
+
+// result code for calls that don't have one (original routine)
+#define PROF_NO_MRES ((META_RES)-1)
+
+// record one call; 'ticks' is call time in cpu timestamp counter ticks
+void DLLINTERNAL api_prof_record(int plugin_index, int post, enum_api_t api, unsigned int func_offset, unsigned long long ticks, META_RES mres);
+
+// forget collected data for plugin index, and remember name for new plugin
+void DLLINTERNAL api_prof_plugin_loaded(int plugin_index, const char *name);
+
+void DLLINTERNAL cmd_meta_prof(void);
+
+#endif /* API_PROF_H */
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdio.h>			// fopen, fwrite, etc
+#include <stdlib.h>			// malloc, free
+#include <string.h>			// memset, strerror, etc
+#include <errno.h>			// errno
+
+#include <extdll.h>			// always
+
+#include "api_record.h"		// me
+#include "api_hook.h"		// NUM_*_FUNCS, api_func_base, update_api_passthrough
+#include "metamod.h"		// GameDLL, gpGlobals, etc
+#include "log_meta.h"		// META_CONS, META_LOG, etc
+#include "support_meta.h"	// full_gamedir_path, STRNCPY
+#include "osdep.h"			// strcasecmp, etc
+
+// longest record; longer ones are truncated
+#define REC_MAX_SIZE 65536
+
+// stdio buffer for record file
+#define REC_FILE_BUFFER (1024 * 1024)
+
+// longest string argument; engine passes some output buffers as char *
+#define REC_MAX_STRING 4096
+
+int api_record_active = 0;
+
+static int record_armed = 0;
+static int record_stop_pending = 0;
+static int record_depth = 0;
+static FILE *record_file = NULL;
+static char *record_file_buffer = NULL;
+static char record_path[PATH_MAX];
+
+static unsigned long long record_bytes = 0;
+static unsigned long long record_count = 0;
+static unsigned long record_truncated = 0;
+
+// current record
+static api_record_header_t record_header;
+static unsigned char record_buf[sizeof(api_record_header_t) + REC_MAX_SIZE];
+static api_record_writer record_writer(record_buf, 0);
+
+// engine's edict array; moves on level change
+static const edict_t *record_edict_base = NULL;
+static int record_max_entities = 0;
+
+
+int DLLINTERNAL api_record_edict_index(const edict_t *pEdict) {
+	int index;
+
+	if(!pEdict)
+		return(REC_EDICT_NULL);
+
+	index = pEdict - record_edict_base;
+	if(unlikely(!record_edict_base || index < 0 || index >= record_max_entities)) {
+		// Edict array is reallocated on level change; PEntityOfEntOffset
+		// is plain pointer arithmetic in engine, and safe even while map
+		// is being loaded.
+		record_edict_base = (*g_engfuncs.pfnPEntityOfEntOffset)(0);
+		record_max_entities = gpGlobals->maxEntities;
+		index = pEdict - record_edict_base;
+		if(!record_edict_base || index < 0 || index >= record_max_entities)
+			return(REC_EDICT_UNKNOWN);
+	}
+	return(index);
+}
+
+void DLLINTERNAL api_record_writer::put_string(const char *str) {
+	int len;
+
+	if(!str) {
+		put_int(-1);
+		return;
+	}
+	for(len=0; len < REC_MAX_STRING - 1 && str[len]; len++)
+		;
+	put_int(len);
+	put(str, len);
+	put("", 1);
+}
+
+void DLLINTERNAL api_record_writer::put_vector(const float *vec) {
+	unsigned char present = (vec != NULL);
+
+	put(&present, sizeof(present));
+	if(vec)
+		put(vec, 3 * sizeof(float));
+}
+
+void DLLINTERNAL api_record_writer::put_intptr(const int *ptr) {
+	unsigned char present = (ptr != NULL);
+
+	put(&present, sizeof(present));
+	if(ptr)
+		put_int(*ptr);
+}
+
+void DLLINTERNAL api_record_writer::arg(KeyValueData *pkvd) {
+	if(!pkvd) {
+		put_string(NULL);
+		return;
+	}
+	put_string(pkvd->szClassName ? pkvd->szClassName : "");
+	put_string(pkvd->szKeyName);
+	put_string(pkvd->szValue);
+	put_int(pkvd->fHandled);
+}
+
+void DLLINTERNAL api_record_writer::arg(const usercmd_t *cmd) {
+	unsigned char present = (cmd != NULL);
+
+	put(&present, sizeof(present));
+	if(cmd)
+		put(cmd, sizeof(*cmd));
+}
+
+void DLLINTERNAL api_record_writer::out(TraceResult *ptr) {
+	unsigned char present = (ptr != NULL);
+
+	put(&present, sizeof(present));
+	if(ptr) {
+		put(ptr, sizeof(*ptr));
+		put_edict(ptr->pHit);
+	}
+}
+
+// Close record file and let passthrough take over again.
+static void DLLINTERNAL record_close(void) {
+	if(record_file) {
+		fclose(record_file);
+		record_file=NULL;
+	}
+	if(record_file_buffer) {
+		free(record_file_buffer);
+		record_file_buffer=NULL;
+	}
+	api_record_active=0;
+	record_stop_pending=0;
+	record_depth=0;
+	update_api_passthrough();
+
+	META_LOG("Call recording to '%s' stopped; %llu records, %llu bytes, %lu truncated",
+			record_path, record_count, record_bytes, record_truncated);
+}
+
+api_record_writer * DLLINTERNAL api_record_begin(int kind, enum_api_t api, unsigned int func_offset) {
+	record_header.kind = kind;
+	record_header.func = api_func_base[api] + func_offset / sizeof(void*);
+	if(kind == REC_CALL)
+		record_header.depth = record_depth++;
+	else
+		record_header.depth = --record_depth;
+
+	record_writer = api_record_writer(record_buf + sizeof(record_header), REC_MAX_SIZE);
+	if(kind == REC_CALL && api != e_api_engine) {
+		record_writer.put_float(gpGlobals->time);
+		record_writer.put_float(gpGlobals->frametime);
+	}
+	return(&record_writer);
+}
+
+void DLLINTERNAL api_record_end(api_record_writer *w) {
+	unsigned int len;
+
+	record_header.size = w->length();
+	if(unlikely(w->is_truncated()))
+		record_truncated++;
+	memcpy(record_buf, &record_header, sizeof(record_header));
+
+	len = sizeof(record_header) + record_header.size;
+	if(record_file) {
+		if(fwrite(record_buf, 1, len, record_file) != len) {
+			META_WARNING("Write to call record '%s' failed: %s; stopping", record_path, strerror(errno));
+			fclose(record_file);
+			record_file=NULL;
+			record_stop_pending=1;
+		}
+		record_bytes += len;
+		record_count++;
+	}
+
+	// close only once outermost call has returned, so that every call in
+	// file has its return record
+	if(unlikely(record_stop_pending) && record_depth <= 0)
+		record_close();
+}
+
+// Start armed recording.  Called at end of ServerDeactivate, so that the
+// stream begins right before next map's entities are spawned.
+void DLLINTERNAL api_record_level_change(void) {
+	api_record_file_header_t hdr;
+
+	if(!record_armed)
+		return;
+	record_armed=0;
+
+	record_file=fopen(record_path, "wb");
+	if(!record_file) {
+		META_WARNING("Unable to open call record file '%s': %s", record_path, strerror(errno));
+		return;
+	}
+	record_file_buffer=(char *)malloc(REC_FILE_BUFFER);
+	if(record_file_buffer)
+		setvbuf(record_file, record_file_buffer, _IOFBF, REC_FILE_BUFFER);
+
+	memset(&hdr, 0, sizeof(hdr));
+	STRNCPY(hdr.magic, REC_MAGIC, sizeof(hdr.magic));
+	hdr.version = REC_VERSION;
+	hdr.header_size = sizeof(hdr);
+	hdr.ptr_size = sizeof(void*);
+	hdr.num_funcs[e_api_engine] = NUM_ENGINE_FUNCS;
+	hdr.num_funcs[e_api_dllapi] = NUM_DLLAPI_FUNCS;
+	hdr.num_funcs[e_api_newapi] = NUM_NEWAPI_FUNCS;
+	hdr.max_entities = gpGlobals->maxEntities;
+	hdr.max_clients = gpGlobals->maxClients;
+	STRNCPY(hdr.gamedir, GameDLL.name, sizeof(hdr.gamedir));
+
+	if(fwrite(&hdr, 1, sizeof(hdr), record_file) != sizeof(hdr)) {
+		META_WARNING("Write to call record '%s' failed: %s", record_path, strerror(errno));
+		fclose(record_file);
+		record_file=NULL;
+		return;
+	}
+
+	record_bytes=sizeof(hdr);
+	record_count=0;
+	record_truncated=0;
+	record_depth=0;
+	record_stop_pending=0;
+	record_edict_base=NULL;
+	api_record_active=1;
+	update_api_passthrough();
+
+	META_LOG("Call recording to '%s' started", record_path);
+}
+
+// Stop recording, or disarm.
+void DLLINTERNAL api_record_stop(void) {
+	record_armed=0;
+	if(!api_record_active)
+		return;
+	if(record_depth > 0)
+		record_stop_pending=1;
+	else
+		record_close();
+}
+
+void DLLINTERNAL api_record_flush(void) {
+	if(record_file)
+		fflush(record_file);
+}
+
+// "meta record" console command.
+void DLLINTERNAL cmd_meta_record(void) {
+	const char *cmd;
+	int argc;
+
+	argc=CMD_ARGC();
+	cmd = (argc > 2) ? CMD_ARGV(2) : "";
+
+	if(argc == 2) {
+		if(api_record_active)
+			META_CONS("Recording calls to '%s'; %llu records, %llu bytes", record_path, record_count, record_bytes);
+		else if(record_armed)
+			META_CONS("Call recording to '%s' starts at next level change", record_path);
+		else
+			META_CONS("Not recording calls");
+	}
+	else if(!strcasecmp(cmd, "start")) {
+		if(api_record_active || record_armed) {
+			META_CONS("Already recording calls to '%s'", record_path);
+			return;
+		}
+		full_gamedir_path((argc > 3) ? CMD_ARGV(3) : "metarecord.bin", record_path);
+		record_armed=1;
+		META_CONS("Call recording to '%s' starts at next level change", record_path);
+	}
+	else if(!strcasecmp(cmd, "stop")) {
+		if(!api_record_active && !record_armed) {
+			META_CONS("Not recording calls");
+			return;
+		}
+		api_record_stop();
+		META_CONS("Call recording stopped");
+	}
+	else {
+		META_CONS("usage: meta record [start [<file>]|stop]");
+	}
+}
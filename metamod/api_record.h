@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef API_RECORD_H
+#define API_RECORD_H
+
+#include <string.h>			// memcpy
+
+#include <extdll.h>			// always
+#include <usercmd.h>		// usercmd_t
+
+#include "api_info.h"			// enum_api_t
+#include "types_meta.h"		// mBOOL
+#include "osdep.h"			// likely, unlikely
+#include "comp_dep.h"
+
+// Call stream recorder, for offline replay.
+//  "meta record start" arms the recorder; recording starts at the next
+//  level change (end of ServerDeactivate), so that the stream covers a
+//  whole map from entity spawning on.  From then on every call made
+//  through our hook functions - engine calling gamedll (dllapi, newapi)
+//  and gamedll calling engine - is written to file with its arguments,
+//  and for engine calls with the return value and output arguments the
+//  gamedll got back.  Edicts are stored by index.  replay/mmreplay loads
+//  metamod, gamedll and plugins without the engine, feeds them the
+//  recorded dllapi stream and answers their engine calls from it.
+//
+//  Calls that plugins make to engine directly don't go through metamod
+//  and aren't recorded; the replay engine answers those by itself.
+//
+// File format: api_record_file_header_t, then records, each an
+// api_record_header_t followed by 'size' bytes of payload:
+//  REC_CALL:   [dllapi, newapi: float time, float frametime], arguments
+//  REC_RETURN: return value, output arguments (engine calls only)
+//  REC_SUPERCEDE: none; a plugin superceded the call
+// Every REC_CALL has a matching REC_RETURN or REC_SUPERCEDE with the same
+// function and depth; calls recorded in between are nested in it.
+//
+// Argument encoding, by type:
+//  edict_t *, entvars_t *      int edict index, REC_EDICT_*
+//  char *, const char *        int length (-1 for NULL), chars, nul
+//  const float *               vector, see put_vector()
+//  int *                       vector-like: byte present, int value
+//  KeyValueData *              3 strings and int fHandled
+//  const usercmd_t *           byte present, raw struct
+//  other pointers              nothing
+//  everything else             raw value
+// Output arguments (REC_RETURN): float * as vector, int *, TraceResult *
+// (raw struct, then pHit as edict index).
+
+#define REC_MAGIC "MMREC"
+#define REC_VERSION 1
+
+#define REC_CALL		'C'
+#define REC_RETURN		'R'
+#define REC_SUPERCEDE	'S'
+
+#define REC_EDICT_NULL		-1
+#define REC_EDICT_UNKNOWN	-2
+
+typedef struct api_record_file_header_s {
+	char magic[8];					// REC_MAGIC
+	unsigned int version;			// REC_VERSION
+	unsigned int header_size;
+	unsigned int ptr_size;			// sizeof(void*) of recording server
+	unsigned int num_funcs[3];		// table sizes; engine, dllapi, newapi
+	int max_entities;
+	int max_clients;
+	char gamedir[64];
+} api_record_file_header_t;
+
+typedef struct api_record_header_s {
+	unsigned char kind;				// REC_*
+	unsigned char depth;			// call nesting depth
+	unsigned short func;			// function index; engine, dllapi, newapi
+	unsigned int size;				// payload size
+} api_record_header_t;
+
+// nonzero while recording
+extern int api_record_active DLLHIDDEN;
+
+// index of edict for recording
+int DLLINTERNAL api_record_edict_index(const edict_t *pEdict);
+
+// Serializes arguments and return values of one call into the record
+// buffer, picking encoding by argument type (see above).
+class api_record_writer {
+public:
+	inline api_record_writer(unsigned char *buf, unsigned int size): start(buf), pos(buf), end(buf + size), truncated(0) {};
+	inline unsigned int length(void) const { return(pos - start); };
+	inline int is_truncated(void) const { return(truncated); };
+
+	inline void put(const void *data, unsigned int len) {
+		if(unlikely(len > (unsigned int)(end - pos))) {
+			len = end - pos;
+			truncated = 1;
+		}
+		memcpy(pos, data, len);
+		pos += len;
+	};
+	inline void put_int(int value) { put(&value, sizeof(value)); };
+	inline void put_float(float value) { put(&value, sizeof(value)); };
+	inline void put_edict(const edict_t *pEdict) { put_int(api_record_edict_index(pEdict)); };
+	void DLLINTERNAL put_string(const char *str);
+	void DLLINTERNAL put_vector(const float *vec);
+	void DLLINTERNAL put_intptr(const int *ptr);
+
+	// arguments
+	template<typename T> inline void arg(T value) { put(&value, sizeof(value)); };
+	template<typename T> inline void arg(T *) {};
+	inline void arg(edict_t *pEdict) { put_edict(pEdict); };
+	inline void arg(const edict_t *pEdict) { put_edict(pEdict); };
+	inline void arg(entvars_t *pev) { put_edict(pev ? pev->pContainingEntity : NULL); };
+	inline void arg(char *str) { put_string(str); };
+	inline void arg(const char *str) { put_string(str); };
+	inline void arg(const float *vec) { put_vector(vec); };
+	inline void arg(int *ptr) { put_intptr(ptr); };
+	void DLLINTERNAL arg(KeyValueData *pkvd);
+	void DLLINTERNAL arg(const usercmd_t *cmd);
+
+	// output arguments, after call
+	template<typename T> inline void out(T) {};
+	inline void out(float *vec) { put_vector(vec); };
+	inline void out(int *ptr) { put_intptr(ptr); };
+	void DLLINTERNAL out(TraceResult *ptr);
+
+	// return values
+	template<typename T> inline void ret(T value) { put(&value, sizeof(value)); };
+	template<typename T> inline void ret(T *) {};
+	inline void ret(edict_t *pEdict) { put_edict(pEdict); };
+	inline void ret(char *str) { put_string(str); };
+	inline void ret(const char *str) { put_string(str); };
+private:
+	unsigned char *start;
+	unsigned char *pos;
+	unsigned char *end;
+	int truncated;
+};
+
+// start record of given kind; returns writer for payload
+api_record_writer * DLLINTERNAL api_record_begin(int kind, enum_api_t api, unsigned int func_offset);
+
+// finish record started by api_record_begin and write it out
+void DLLINTERNAL api_record_end(api_record_writer *w);
+
+// Record call entry; caller_t is api_hook_caller (see api_hook.h).
+template<class caller_t>
+inline void api_record_call(const caller_t &caller, enum_api_t api, unsigned int func_offset) {
+	api_record_writer *w = api_record_begin(REC_CALL, api, func_offset);
+
+	caller.record(*w);
+	api_record_end(w);
+}
+
+// Record call return; ret_holder_t is api_hook_ret (see api_hook.h).
+//  Return value and output arguments only matter for engine calls, as
+//  the replay engine has to give them back to the gamedll.
+template<class caller_t, class ret_holder_t>
+inline void api_record_return(const caller_t &caller, const ret_holder_t &ret, enum_api_t api, unsigned int func_offset, int called) {
+	api_record_writer *w = api_record_begin(called ? REC_RETURN : REC_SUPERCEDE, api, func_offset);
+
+	if(called && api == e_api_engine) {
+		ret.record(*w);
+		caller.record_out(*w);
+	}
+	api_record_end(w);
+}
+
+// start armed recording, on level change
+void DLLINTERNAL api_record_level_change(void);
+
+// stop recording, once current call has returned
+void DLLINTERNAL api_record_stop(void);
+
+// flush file, on fatal error
+void DLLINTERNAL api_record_flush(void);
+
+void DLLINTERNAL cmd_meta_record(void);
+
+#endif /* API_RECORD_H */
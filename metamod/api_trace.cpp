@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// atoi, etc
+#include <string.h>			// memset, strlen, etc
+#include <fcntl.h>			// open
+#include <sys/stat.h>		// S_IRUSR, etc
+
+#ifdef linux
+#include <sys/time.h>		// gettimeofday; win32 in osdep.h
+#include <signal.h>			// sigaction, etc
+#endif
+
+#include <extdll.h>			// always
+
+#include "api_trace.h"		// me
+#include "api_hook.h"		// NUM_API_FUNCS, api_func_base
+#include "metamod.h"		// GET_TSC, Plugins, etc
+#include "mlist.h"			// Plugins
+#include "log_meta.h"		// META_CONS, etc
+#include "support_meta.h"	// full_gamedir_path, STRNCPY
+#include "osdep.h"			// O_BINARY, strcasecmp, etc
+
+cvar_t meta_trace = {"meta_trace", "1", FCVAR_EXTDLL, 0, NULL};
+int meta_trace_value = 1;
+
+api_trace_record_t api_trace_ring[TRACE_RING_SIZE];
+unsigned int api_trace_pos = 0;
+
+// default dump file, built at init so that signal handler doesn't need to
+static char trace_dump_path[PATH_MAX] = "metatrace.bin";
+
+// reference point for converting ticks to time
+static unsigned long long trace_calib_tsc = 0;
+static struct timeval trace_calib_tv;
+
+// function names, by function index, as "api.Name"
+static char trace_func_names[NUM_API_FUNCS][48];
+
+#ifdef linux
+static struct sigaction trace_old_segv;
+static struct sigaction trace_old_abrt;
+#endif
+
+// Write whole buffer; returns mFALSE on failure.
+static mBOOL DLLINTERNAL trace_write(int fd, const void *buf, size_t len) {
+	const char *cp = (const char *)buf;
+	int n;
+	
+	while(len > 0) {
+		n = write(fd, cp, len);
+		if(n <= 0)
+			return(mFALSE);
+		cp += n;
+		len -= n;
+	}
+	return(mTRUE);
+}
+
+// Write ring to file, oldest record first.  Uses only plain system calls
+// and static data, so that it can be called from a signal handler.
+mBOOL DLLINTERNAL api_trace_dump(const char *path, const char *reason) {
+	api_trace_dump_header_t hdr;
+	struct timeval tv;
+	unsigned int pos, count, first, i;
+	const char *name;
+	double elapsed;
+	int fd;
+	mBOOL ok;
+	
+	pos = api_trace_pos;
+	count = pos < TRACE_RING_SIZE ? pos : TRACE_RING_SIZE;
+	
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, TRACE_DUMP_MAGIC, sizeof(TRACE_DUMP_MAGIC));
+	hdr.version = TRACE_DUMP_VERSION;
+	hdr.header_size = sizeof(hdr);
+	hdr.record_size = sizeof(api_trace_record_t);
+	hdr.num_records = count;
+	hdr.num_funcs = NUM_API_FUNCS;
+	hdr.num_plugins = (Plugins ? Plugins->endlist : 0) + 1;
+	hdr.dump_tsc = GET_TSC();
+	gettimeofday(&tv, NULL);
+	elapsed = (tv.tv_sec - trace_calib_tv.tv_sec) * 1000000.0 + (tv.tv_usec - trace_calib_tv.tv_usec);
+	hdr.ticks_per_usec = (trace_calib_tsc && elapsed > 0.0) ? (hdr.dump_tsc - trace_calib_tsc) / elapsed : 0.0;
+	if(reason) {
+		for(i=0; i < sizeof(hdr.reason) - 1 && reason[i]; i++)
+			hdr.reason[i] = reason[i];
+	}
+	
+	fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+	if(fd < 0)
+		return(mFALSE);
+	
+	ok = trace_write(fd, &hdr, sizeof(hdr));
+	for(i=0; ok && i < NUM_API_FUNCS; i++)
+		ok = trace_write(fd, trace_func_names[i], strlen(trace_func_names[i]) + 1);
+	for(i=0; ok && i < hdr.num_plugins; i++) {
+		name = "";
+		if(i == 0)
+			name = GameDLL.name;
+		else if(Plugins->plist[i-1]->status >= PL_VALID)
+			name = Plugins->plist[i-1]->desc;
+		ok = trace_write(fd, name, strlen(name) + 1);
+	}
+	
+	// ring may wrap in the middle; write in two parts
+	first = (pos - count) & (TRACE_RING_SIZE - 1);
+	if(ok && count) {
+		if(first + count <= TRACE_RING_SIZE)
+			ok = trace_write(fd, &api_trace_ring[first], count * sizeof(api_trace_record_t));
+		else {
+			ok = trace_write(fd, &api_trace_ring[first], (TRACE_RING_SIZE - first) * sizeof(api_trace_record_t));
+			if(ok)
+				ok = trace_write(fd, &api_trace_ring[0], (first + count - TRACE_RING_SIZE) * sizeof(api_trace_record_t));
+		}
+	}
+	
+	close(fd);
+	return(ok);
+}
+
+// Dump on fatal error from engine.
+void DLLINTERNAL api_trace_dump_fatal(const char *reason) {
+	if(!api_trace_pos)
+		return;
+	if(api_trace_dump(trace_dump_path, reason))
+		META_LOG("Hook trace written to '%s'", trace_dump_path);
+}
+
+#ifdef linux
+// Dump trace on crash, and hand signal to previous handler.
+static void trace_signal_handler(int sig) {
+	if(sig == SIGSEGV) {
+		sigaction(SIGSEGV, &trace_old_segv, NULL);
+		api_trace_dump(trace_dump_path, "SIGSEGV");
+	}
+	else {
+		sigaction(SIGABRT, &trace_old_abrt, NULL);
+		api_trace_dump(trace_dump_path, "SIGABRT");
+	}
+	// returning from SIGSEGV re-runs the faulting instruction, and from
+	// SIGABRT lets abort() raise again; previous handler gets it then
+	if(sig == SIGABRT)
+		raise(sig);
+}
+#endif
+
+// Set up dump path, function names and crash handlers.
+void DLLINTERNAL api_trace_init(void) {
+	const api_info_t *ainfo;
+	unsigned int func, nfuncs;
+	int api;
+	static const char * const api_names[3] = { "engine", "dllapi", "newapi" };
+	
+	full_gamedir_path("metatrace.bin", trace_dump_path);
+	
+	for(api=0; api < 3; api++) {
+		nfuncs = (api == e_api_engine) ? NUM_ENGINE_FUNCS : (api == e_api_dllapi) ? NUM_DLLAPI_FUNCS : NUM_NEWAPI_FUNCS;
+		for(func=0; func < nfuncs; func++) {
+			ainfo = get_api_info((enum_api_t)api, func * sizeof(void*));
+			if(ainfo)
+				safevoid_snprintf(trace_func_names[api_func_base[api] + func], sizeof(trace_func_names[0]), "%s.%s", api_names[api], ainfo->name);
+			else
+				safevoid_snprintf(trace_func_names[api_func_base[api] + func], sizeof(trace_func_names[0]), "%s.#%u", api_names[api], func);
+		}
+	}
+	
+	trace_calib_tsc = GET_TSC();
+	gettimeofday(&trace_calib_tv, NULL);
+	
+#ifdef linux
+	{
+		struct sigaction action;
+		
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = trace_signal_handler;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGSEGV, &action, &trace_old_segv);
+		sigaction(SIGABRT, &action, &trace_old_abrt);
+	}
+#endif
+}
+
+// "meta trace" console command.
+void DLLINTERNAL cmd_meta_trace(void) {
+	const char *cmd;
+	char path[PATH_MAX];
+	int argc;
+	
+	argc=CMD_ARGC();
+	cmd = (argc > 2) ? CMD_ARGV(2) : "";
+	
+	if(argc == 2) {
+		META_CONS("Hook trace %s; %u calls recorded, ring holds %d", 
+				meta_trace_value ? "enabled" : "disabled", api_trace_pos, TRACE_RING_SIZE);
+		META_CONS("Crash dump file: %s", trace_dump_path);
+	}
+	else if(!strcasecmp(cmd, "dump")) {
+		if(argc > 3)
+			full_gamedir_path(CMD_ARGV(3), path);
+		else
+			STRNCPY(path, trace_dump_path, sizeof(path));
+		if(api_trace_dump(path, "meta trace dump"))
+			META_CONS("Hook trace written to '%s'", path);
+		else
+			META_CONS("Unable to write hook trace to '%s': %s", path, strerror(errno));
+	}
+	else if(!strcasecmp(cmd, "clear")) {
+		api_trace_pos = 0;
+		META_CONS("Hook trace cleared");
+	}
+	else {
+		META_CONS("usage: meta trace [dump [<file>]|clear]");
+	}
+}
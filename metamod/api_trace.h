@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef API_TRACE_H
+#define API_TRACE_H
+
+#include "api_info.h"			// enum_api_t
+#include "meta_api.h"			// META_RES
+#include "comp_dep.h"
+
+// Hook flight recorder.
+//  Every plugin hook call and original engine/gamedll routine call made
+//  through our hook functions is recorded into a fixed size ring buffer,
+//  while cvar "meta_trace" is nonzero (default).  The ring is written to
+//  a file on gamedll's Sys_Error, on SIGSEGV and SIGABRT (linux), and on
+//  "meta trace dump".  tools/metatrace2json.py converts dump files to
+//  Chrome/Perfetto trace JSON.
+
+extern cvar_t meta_trace DLLHIDDEN;
+extern int meta_trace_value DLLHIDDEN;	// preconverted meta_trace.value, like meta_debug_value
+
+// number of records in ring; must be power of 2
+#define TRACE_RING_SIZE 32768
+
+#define TRACE_FLAG_POST 0x01		// post function
+
+// One recorded call.  Layout is fixed (24 bytes on both i386 and amd64)
+// since it's read back by tools/metatrace2json.py.
+typedef struct api_trace_record_s {
+	unsigned long long start;		// cpu timestamp counter at call
+	unsigned long long end;			// cpu timestamp counter at return
+	unsigned short func;			// function index; engine, dllapi, newapi
+	unsigned short plugin;			// plugin index, 0 = original routine
+	unsigned char flags;			// TRACE_FLAG_*
+	unsigned char depth;			// hook nesting depth
+	signed char mres;				// META_RES, -1 for original routine
+	unsigned char unused;
+} api_trace_record_t;
+
+// Dump file header, followed by function names and plugin names as
+// nul-terminated strings, and then records, oldest first.
+#define TRACE_DUMP_MAGIC "MMTRACE"
+#define TRACE_DUMP_VERSION 2
+
+typedef struct api_trace_dump_header_s {
+	char magic[8];					// TRACE_DUMP_MAGIC
+	unsigned int version;			// TRACE_DUMP_VERSION
+	unsigned int header_size;
+	unsigned int record_size;
+	unsigned int num_records;
+	unsigned int num_funcs;
+	unsigned int num_plugins;
+	double ticks_per_usec;
+	unsigned long long dump_tsc;
+	char reason[64];
+} api_trace_dump_header_t;
+
+extern api_trace_record_t api_trace_ring[TRACE_RING_SIZE] DLLHIDDEN;
+extern unsigned int api_trace_pos DLLHIDDEN;
+
+// record one call
+inline void DLLINTERNAL api_trace_record(int plugin_index, int post, unsigned int func, unsigned int depth, unsigned long long start, unsigned long long end, META_RES mres) {
+	api_trace_record_t *rec = &api_trace_ring[api_trace_pos & (TRACE_RING_SIZE - 1)];
+	
+	rec->start = start;
+	rec->end = end;
+	rec->func = func;
+	rec->plugin = plugin_index;
+	rec->flags = post ? TRACE_FLAG_POST : 0;
+	rec->depth = depth < 255 ? depth : 255;
+	rec->mres = mres;
+	
+	// publish record only after it's complete, for signal handler
+#ifdef __GNUC__
+	__asm__ __volatile__("" ::: "memory");
+#endif
+	api_trace_pos++;
+}
+
+// set up dump path and crash handlers; call once gamedir is known
+void DLLINTERNAL api_trace_init(void);
+
+// write ring to file; safe to call from signal handler
+mBOOL DLLINTERNAL api_trace_dump(const char *path, const char *reason);
+
+// dump on fatal error from engine
+void DLLINTERNAL api_trace_dump_fatal(const char *reason);
+
+void DLLINTERNAL cmd_meta_trace(void);
+
+#endif /* API_TRACE_H */
@@ -43,6 +43,21 @@
 #include "log_meta.h"		// META_CONS, etc
 #include "info_name.h"		// VNAME, etc
 #include "vdate.h"			// COMPILE_TIME, COMPILE_TZONE
+#include "api_prof.h"		// cmd_meta_prof, meta_prof
+#include "api_trace.h"		// cmd_meta_trace, meta_trace
+#include "api_record.h"		// cmd_meta_record
+#include "mjobs.h"			// cmd_meta_jobs
+#include "log_queue.h"		// cmd_meta_log
+#include "thread_logparse.h"	// cmd_meta_logevents
+#include "usermsg.h"		// cmd_meta_usermsgs
+#include "ent_filter.h"		// cmd_meta_entfilters
+#include "ent_index.h"		// cmd_meta_entindex
+#include "ent_grid.h"		// cmd_meta_entgrid
+#include "string_cache.h"	// cmd_meta_strings
+#include "cvar_watch.h"		// cmd_meta_cvarhooks
+#include "startup_timeline.h"	// cmd_meta_startup
+#include "linkent.h"			// cmd_meta_linkents
+#include "ent_class.h"		// cmd_meta_entclasses
 
 
 #ifdef META_PERFMON
@@ -73,8 +88,12 @@ void DLLINTERNAL cmd_meta_reset_tsc(void) {
 void DLLINTERNAL meta_register_cmdcvar() {
 	CVAR_REGISTER(&meta_debug);
 	CVAR_REGISTER(&meta_version);
+	CVAR_REGISTER(&meta_prof);
+	CVAR_REGISTER(&meta_trace);
 
 	meta_debug_value = (int)meta_debug.value;
+	meta_prof_value = (int)meta_prof.value;
+	meta_trace_value = (int)meta_trace.value;
 
 	REG_SVR_COMMAND("meta", svr_meta);
 }
@@ -100,6 +119,36 @@ void DLLHIDDEN svr_meta(void) {
 		cmd_meta_game();
 	else if(!strcasecmp(cmd, "config"))
 		cmd_meta_config();
+	else if(!strcasecmp(cmd, "prof"))
+		cmd_meta_prof();
+	else if(!strcasecmp(cmd, "trace"))
+		cmd_meta_trace();
+	else if(!strcasecmp(cmd, "record"))
+		cmd_meta_record();
+	else if(!strcasecmp(cmd, "jobs"))
+		cmd_meta_jobs();
+	else if(!strcasecmp(cmd, "log"))
+		cmd_meta_log();
+	else if(!strcasecmp(cmd, "logevents"))
+		cmd_meta_logevents();
+	else if(!strcasecmp(cmd, "usermsgs"))
+		cmd_meta_usermsgs();
+	else if(!strcasecmp(cmd, "entfilters"))
+		cmd_meta_entfilters();
+	else if(!strcasecmp(cmd, "entindex"))
+		cmd_meta_entindex();
+	else if(!strcasecmp(cmd, "entgrid"))
+		cmd_meta_entgrid();
+	else if(!strcasecmp(cmd, "strings"))
+		cmd_meta_strings();
+	else if(!strcasecmp(cmd, "cvarhooks"))
+		cmd_meta_cvarhooks();
+	else if(!strcasecmp(cmd, "startup"))
+		cmd_meta_startup();
+	else if(!strcasecmp(cmd, "linkents"))
+		cmd_meta_linkents();
+	else if(!strcasecmp(cmd, "entclasses"))
+		cmd_meta_entclasses();
 	// arguments: existing plugin(s)
 	else if(!strcasecmp(cmd, "pause"))
 		cmd_doplug(PC_PAUSE);
@@ -122,6 +171,9 @@ void DLLHIDDEN svr_meta(void) {
 	// arguments: filename, description
 	else if(!strcasecmp(cmd, "load"))
 		cmd_meta_load();
+	// arguments: existing plugin, optional new filename
+	else if(!strcasecmp(cmd, "hotreload"))
+		cmd_meta_hotreload();
 #ifdef META_PERFMON
 	else if(!strcasecmp(cmd, "tsc"))
 		cmd_meta_tsc();
@@ -168,9 +220,25 @@ void DLLINTERNAL cmd_meta_usage(void) {
 	META_CONS("   cvars            - list cvars registered by plugins");
 	META_CONS("   refresh          - load/unload any new/deleted/updated plugins");
 	META_CONS("   config           - show config info loaded from config.ini");
+	META_CONS("   prof [top|reset|dump] - show, clear or save hook profile (cvar meta_prof)");
+	META_CONS("   trace [dump|clear] - show, save or clear hook flight recorder (cvar meta_trace)");
+	META_CONS("   record [start|stop] - record engine/gamedll calls for replay, from next map");
+	META_CONS("   jobs             - show plugin job worker threads");
+	META_CONS("   log              - show log pipeline status");
+	META_CONS("   logevents        - list log event patterns registered by plugins");
+	META_CONS("   usermsgs         - list user message subscriptions and filters of plugins");
+	META_CONS("   entfilters       - list entity filters of plugins' entity hooks");
+	META_CONS("   entindex         - show entity index statistics");
+	META_CONS("   entgrid [bench]  - show entity grid status, or time sphere queries");
+	META_CONS("   strings          - show AllocString cache statistics");
+	META_CONS("   cvarhooks        - list cvar change subscriptions of plugins");
+	META_CONS("   startup          - show where server startup time went");
+	META_CONS("   linkents         - show entity lookups and time spent resolving them");
+	META_CONS("   entclasses       - list entity classes registered by plugins");
 	META_CONS("   load <name>      - find and load a plugin with the given name");
 	META_CONS("   unload <plugin>  - unload a loaded plugin");
 	META_CONS("   reload <plugin>  - unload a plugin and load it again");
+	META_CONS("   hotreload <plugin> [<file>] - reload a plugin now, keeping its state");
 	META_CONS("   info <plugin>    - show all information about a plugin");
 	META_CONS("   pause <plugin>   - pause a loaded, running plugin");
 	META_CONS("   unpause <plugin> - unpause a previously paused plugin");
@@ -347,8 +415,9 @@ void DLLINTERNAL cmd_meta_load(void) {
 	const char *args;
 	argc=CMD_ARGC();
 	if(argc < 3) {
-		META_CONS("usage: meta load <name> [<description>]");
+		META_CONS("usage: meta load <name> [@<priority>] [<description>]");
 		META_CONS("   where <name> is an identifier used to locate the plugin file.");
+		META_CONS("   Plugins with higher <priority> are called first; default is 0.");
 		META_CONS("   The system will look for a number of files based on this name, including:");
 		META_CONS("      name");
 #ifdef linux
@@ -379,6 +448,46 @@ void DLLINTERNAL cmd_meta_load(void) {
 	Plugins->cmd_addload(args);
 }
 
+// "meta hotreload" console command.
+void DLLINTERNAL cmd_meta_hotreload(void) {
+	int argc, pindex;
+	const char *arg;
+	char *endptr;
+	MPlugin *findp;
+
+	argc=CMD_ARGC();
+	if(argc < 3 || argc > 4) {
+		META_CONS("usage: meta hotreload <plugin> [<file>]");
+		META_CONS("   where <plugin> can be either the plugin index #");
+		META_CONS("   or a non-ambiguous prefix string matching name, desc, file, or logtag.");
+		META_CONS("   The plugin hands its state to the new instance, loaded from <file>");
+		META_CONS("   if given; it must export Meta_ExportState and Meta_ImportState.");
+		return;
+	}
+	arg=CMD_ARGV(2);
+	// try to match plugin id first
+	pindex = strtol(arg, &endptr, 10);
+	if(*arg && !*endptr)
+		findp=Plugins->find(pindex);
+	// else try to match some string (prefix)
+	else
+		findp=Plugins->find_match(arg);
+	if(!findp) {
+		if(meta_errno == ME_NOTUNIQ)
+			META_CONS("Couldn't find unique plugin matching '%s'", arg);
+		else
+			META_CONS("Couldn't find plugin matching '%s'", arg);
+		return;
+	}
+
+	if(findp->hot_reload(argc==4 ? CMD_ARGV(3) : NULL))
+		META_CONS("Hot reloaded plugin '%s'", findp->desc);
+	else if(meta_errno == ME_DLMISSING)
+		META_CONS("Hot reload not supported by plugin '%s'; use 'meta reload'", findp->desc);
+	else
+		META_CONS("Hot reload failed for plugin '%s'", findp->desc);
+}
+
 // Handle various console commands that refer to a known/loaded plugin.
 void DLLINTERNAL cmd_doplug(PLUG_CMD pcmd) {
 	int i=0, argc;
@@ -66,6 +66,7 @@ void DLLINTERNAL cmd_meta_gpl(void);
 void DLLINTERNAL cmd_meta_game(void);
 void DLLINTERNAL cmd_meta_refresh(void);
 void DLLINTERNAL cmd_meta_load(void);
+void DLLINTERNAL cmd_meta_hotreload(void);
 
 void DLLINTERNAL cmd_meta_pluginlist(void);
 void DLLINTERNAL cmd_meta_cmdlist(void);
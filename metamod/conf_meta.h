@@ -90,6 +90,13 @@ class MConfig : public class_metamod_new {
 		char *exec_cfg;		// ie metaexec.cfg, exec.cfg
 		int autodetect;		// autodetection of gamedll (Metamod-All-Support patch)
 		int clientmeta;         // control 'meta' client-command
+		int passthrough;	// pass unhooked functions directly to engine/gamedll
+		int job_threads;	// worker threads for plugin jobs; 0 for auto
+		int async_log;		// format and deliver log messages deferred
+		int log_rate;		// max log messages/sec per plugin; 0 for no limit
+		int string_cache;	// answer repeated AllocString calls from cache
+		int startup_threads;	// threads reading plugins ahead; 0 for auto
+		int linkent_table;	// resolve entities from merged export table
 		// functions
 		void DLLINTERNAL init(option_t *global_options);
 		mBOOL DLLINTERNAL load(const char *filename);
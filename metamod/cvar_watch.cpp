@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// malloc, free, etc
+#include <string.h>			// strcmp, strdup, etc
+
+#include <extdll.h>			// always
+
+#include "cvar_watch.h"		// me
+#include "api_hook.h"		// api_hook_internal_ref
+#include "log_meta.h"		// META_CONS, META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely, strcasecmp
+
+typedef struct cvar_watch_s {
+	cvar_t *cvar;
+	char *value;					// string value last seen
+	int nsubs;						// live subscriptions
+	unsigned long changes;
+} cvar_watch_t;
+
+typedef struct cvar_sub_s {
+	int id;
+	plid_t plid;
+	META_CVAR_FN fn;				// NULL once unregistered
+	void *data;
+	cvar_watch_t *watch;
+	unsigned long calls;
+} cvar_sub_t;
+
+int cvar_watch_active = 0;
+
+static cvar_watch_t **watches = NULL;
+static int num_watches = 0;
+static int max_watches = 0;
+
+static cvar_sub_t **subs = NULL;
+static int num_subs = 0;
+static int max_subs = 0;
+static int next_id = 1;
+static int subs_dirty = 0;
+static int cvar_watch_dispatching = 0;
+
+// Engine functions that set cvars.
+static const unsigned int cvar_set_funcs[] = {
+	offsetof(enginefuncs_t, pfnCVarSetFloat),
+	offsetof(enginefuncs_t, pfnCVarSetString),
+	offsetof(enginefuncs_t, pfnCvar_DirectSet),
+	~0U
+};
+
+
+static inline const char * DLLINTERNAL cvar_string(const cvar_t *cvar) {
+	return(cvar->string ? cvar->string : "");
+}
+
+static void DLLINTERNAL cvar_watch_set_active(int active) {
+	int i;
+
+	if(active == cvar_watch_active)
+		return;
+	cvar_watch_active=active;
+	// see gamedll's calls setting cvars
+	for(i=0; cvar_set_funcs[i] != ~0U; i++)
+		api_hook_internal_ref(e_api_engine, cvar_set_funcs[i], active ? 1 : -1);
+}
+
+// Free unregistered subscriptions, and cvars nobody watches any more,
+// once no callback is running.
+static void DLLINTERNAL cvar_watch_compact(void) {
+	int i, n;
+
+	if(!subs_dirty || cvar_watch_dispatching)
+		return;
+	for(i=0, n=0; i < num_subs; i++) {
+		if(subs[i]->fn)
+			subs[n++]=subs[i];
+		else
+			free(subs[i]);
+	}
+	num_subs=n;
+	for(i=0, n=0; i < num_watches; i++) {
+		if(watches[i]->nsubs)
+			watches[n++]=watches[i];
+		else {
+			free(watches[i]->value);
+			free(watches[i]);
+		}
+	}
+	num_watches=n;
+	subs_dirty=0;
+}
+
+// Call subscribers if cvar's value differs from the one last seen.
+static void DLLINTERNAL cvar_watch_notify(cvar_watch_t *w) {
+	cvar_sub_t *sub;
+	char *old, *copy;
+	int i, n;
+
+	if(likely(!strcmp(w->value, cvar_string(w->cvar))))
+		return;
+	copy=strdup(cvar_string(w->cvar));
+	if(!copy)
+		return;
+	old=w->value;
+	w->value=copy;
+	w->changes++;
+
+	cvar_watch_dispatching++;
+	for(i=0, n=num_subs; i < n; i++) {
+		sub=subs[i];
+		if(sub->watch != w || !sub->fn)
+			continue;
+		sub->calls++;
+		sub->fn(w->cvar, old, sub->data);
+	}
+	cvar_watch_dispatching--;
+	free(old);
+	cvar_watch_compact();
+}
+
+static cvar_watch_t * DLLINTERNAL cvar_watch_find(const cvar_t *cvar) {
+	int i;
+
+	for(i=0; i < num_watches; i++) {
+		if(watches[i]->cvar == cvar)
+			return(watches[i]);
+	}
+	return(NULL);
+}
+
+cvar_t * DLLINTERNAL cvar_watch_handle(const char *name) {
+	if(!name || !name[0])
+		return(NULL);
+	return((*g_engfuncs.pfnCVarGetPointer)(name));
+}
+
+int DLLINTERNAL cvar_watch_register(plid_t plid, const char *name, META_CVAR_FN fn, void *data) {
+	cvar_watch_t *w, **newwatches;
+	cvar_sub_t *sub, **newsubs;
+	cvar_t *cvar;
+	int newmax;
+
+	if(!fn || !name || !name[0])
+		RETURN_ERRNO(0, ME_ARGUMENT);
+	cvar=cvar_watch_handle(name);
+	if(!cvar)
+		RETURN_ERRNO(0, ME_NOTFOUND);
+
+	if(num_subs >= max_subs) {
+		newmax = max_subs ? max_subs * 2 : 16;
+		newsubs=(cvar_sub_t **)realloc(subs, newmax * sizeof(*subs));
+		if(!newsubs)
+			RETURN_ERRNO(0, ME_NOMEM);
+		subs=newsubs;
+		max_subs=newmax;
+	}
+	w=cvar_watch_find(cvar);
+	if(!w) {
+		if(num_watches >= max_watches) {
+			newmax = max_watches ? max_watches * 2 : 16;
+			newwatches=(cvar_watch_t **)realloc(watches, newmax * sizeof(*watches));
+			if(!newwatches)
+				RETURN_ERRNO(0, ME_NOMEM);
+			watches=newwatches;
+			max_watches=newmax;
+		}
+		w=(cvar_watch_t *)calloc(1, sizeof(cvar_watch_t));
+		if(!w)
+			RETURN_ERRNO(0, ME_NOMEM);
+		w->cvar=cvar;
+		w->value=strdup(cvar_string(cvar));
+		if(!w->value) {
+			free(w);
+			RETURN_ERRNO(0, ME_NOMEM);
+		}
+		watches[num_watches++]=w;
+	}
+	sub=(cvar_sub_t *)calloc(1, sizeof(cvar_sub_t));
+	if(!sub) {
+		// watch without subscriptions is freed by compact
+		subs_dirty=1;
+		cvar_watch_compact();
+		RETURN_ERRNO(0, ME_NOMEM);
+	}
+	sub->id=next_id++;
+	sub->plid=plid;
+	sub->fn=fn;
+	sub->data=data;
+	sub->watch=w;
+	w->nsubs++;
+	subs[num_subs++]=sub;
+	cvar_watch_set_active(1);
+
+	META_DEBUG(3, ("Plugin '%s' subscribed to cvar '%s'; id %d", plid->name, cvar->name, sub->id));
+	return(sub->id);
+}
+
+static void DLLINTERNAL cvar_watch_remove(cvar_sub_t *sub) {
+	sub->fn=NULL;
+	sub->watch->nsubs--;
+	subs_dirty=1;
+}
+
+static void DLLINTERNAL cvar_watch_update_active(void) {
+	int i;
+
+	for(i=0; i < num_watches; i++) {
+		if(watches[i]->nsubs)
+			return;
+	}
+	cvar_watch_set_active(0);
+}
+
+mBOOL DLLINTERNAL cvar_watch_unregister(plid_t plid, int id) {
+	int i;
+
+	for(i=0; i < num_subs; i++) {
+		if(subs[i]->id == id && subs[i]->plid == plid && subs[i]->fn) {
+			cvar_watch_remove(subs[i]);
+			cvar_watch_update_active();
+			cvar_watch_compact();
+			return(mTRUE);
+		}
+	}
+	RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+}
+
+void DLLINTERNAL cvar_watch_plugin_unloaded(plid_t plid) {
+	int i;
+
+	for(i=0; i < num_subs; i++) {
+		if(subs[i]->plid == plid && subs[i]->fn)
+			cvar_watch_remove(subs[i]);
+	}
+	cvar_watch_update_active();
+	cvar_watch_compact();
+}
+
+void DLLINTERNAL cvar_watch_check_name(const char *name) {
+	int i;
+
+	if(!name)
+		return;
+	for(i=0; i < num_watches; i++) {
+		if(!strcasecmp(watches[i]->cvar->name, name)) {
+			cvar_watch_notify(watches[i]);
+			return;
+		}
+	}
+}
+
+void DLLINTERNAL cvar_watch_check(const cvar_t *cvar) {
+	cvar_watch_t *w;
+
+	w=cvar_watch_find(cvar);
+	if(w)
+		cvar_watch_notify(w);
+}
+
+void DLLINTERNAL cvar_watch_frame(void) {
+	int i;
+
+	if(!cvar_watch_active)
+		return;
+	cvar_watch_dispatching++;
+	for(i=0; i < num_watches; i++)
+		cvar_watch_notify(watches[i]);
+	cvar_watch_dispatching--;
+	cvar_watch_compact();
+}
+
+void DLLINTERNAL cvar_watch_set_float(const char *szVarName, float flValue) {
+	(*g_engfuncs.pfnCVarSetFloat)(szVarName, flValue);
+	if(unlikely(cvar_watch_active))
+		cvar_watch_check_name(szVarName);
+}
+
+void DLLINTERNAL cvar_watch_set_string(const char *szVarName, const char *szValue) {
+	(*g_engfuncs.pfnCVarSetString)(szVarName, szValue);
+	if(unlikely(cvar_watch_active))
+		cvar_watch_check_name(szVarName);
+}
+
+void DLLINTERNAL cvar_watch_direct_set(struct cvar_s *var, char *value) {
+	(*g_engfuncs.pfnCvar_DirectSet)(var, value);
+	if(unlikely(cvar_watch_active))
+		cvar_watch_check(var);
+}
+
+// "meta cvarhooks" console command.
+void DLLINTERNAL cmd_meta_cvarhooks(void) {
+	cvar_sub_t *sub;
+	int i, n;
+
+	META_CONS("Cvar subscriptions:");
+	META_CONS("  %4s %-16s %-24s %10s", "id", "plugin", "cvar", "calls");
+	for(i=0, n=0; i < num_subs; i++) {
+		sub=subs[i];
+		if(!sub->fn)
+			continue;
+		META_CONS("  %4d %-16.16s %-24.24s %10lu", sub->id, sub->plid->name, sub->watch->cvar->name, sub->calls);
+		n++;
+	}
+	META_CONS("%d subscriptions to %d cvars", n, num_watches);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef CVAR_WATCH_H
+#define CVAR_WATCH_H
+
+#include <extdll.h>			// cvar_t
+
+#include "plinfo.h"			// plid_t
+#include "mhook.h"			// META_CVAR_FN
+#include "types_meta.h"		// mBOOL
+#include "comp_dep.h"
+
+// Cvar change notification.
+//  Instead of polling cvars with CVAR_GET_FLOAT every frame, which is a
+//  lookup by name in engine plus hook dispatch, plugins keep the cvar_t
+//  from GET_CVAR_HANDLE and read its value directly, and register a
+//  callback with REG_CVAR_HOOK for when the value changes.
+//
+//  Metamod keeps a copy of the string value of every watched cvar, and
+//  compares it after CVarSetFloat, CVarSetString and Cvar_DirectSet calls
+//  of gamedll and plugins, and once per frame for changes made from
+//  console or by engine.  Callbacks get the cvar and its old value.
+
+// nonzero while there are subscriptions
+extern int cvar_watch_active DLLHIDDEN;
+
+// cvar_t of cvar, or NULL if engine has none by that name
+cvar_t * DLLINTERNAL cvar_watch_handle(const char *name);
+
+// Subscribe to changes of cvar.  Returns subscription id, or 0 with
+// meta_errno set.
+int DLLINTERNAL cvar_watch_register(plid_t plid, const char *name, META_CVAR_FN fn, void *data);
+
+// unsubscribe by id
+mBOOL DLLINTERNAL cvar_watch_unregister(plid_t plid, int id);
+
+// unsubscribe plugin's cvars, on unload
+void DLLINTERNAL cvar_watch_plugin_unloaded(plid_t plid);
+
+// check cvar for change, after call that set it
+void DLLINTERNAL cvar_watch_check_name(const char *name);
+void DLLINTERNAL cvar_watch_check(const cvar_t *cvar);
+
+// check all watched cvars, on StartFrame
+void DLLINTERNAL cvar_watch_frame(void);
+
+// plugins' CVarSetFloat, CVarSetString and Cvar_DirectSet
+void DLLINTERNAL cvar_watch_set_float(const char *szVarName, float flValue);
+void DLLINTERNAL cvar_watch_set_string(const char *szVarName, const char *szValue);
+void DLLINTERNAL cvar_watch_direct_set(struct cvar_s *var, char *value);
+
+void DLLINTERNAL cmd_meta_cvarhooks(void);
+
+#endif /* CVAR_WATCH_H */
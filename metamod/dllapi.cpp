@@ -44,34 +44,39 @@
 #include "commands_meta.h"	// client_meta, etc
 #include "log_meta.h"		// META_ERROR, etc
 #include "api_hook.h"
+#include "api_record.h"		// api_record_level_change, etc
+#include "mjobs.h"			// meta_jobs_run_mailbox, etc
+#include "log_queue.h"		// log_queue_deliver, etc
+#include "ent_filter.h"		// ent_filter_level_change
+#include "ent_index.h"		// ent_index_update, etc
+#include "ent_grid.h"		// ent_grid_frame, etc
+#include "string_cache.h"	// string_cache_map_pending, etc
+#include "cvar_watch.h"		// cvar_watch_frame
+#include "linkent.h"		// linkent_level_change
 
 
 // Original DLL routines, functions returning "void".
 #define META_DLLAPI_HANDLE_void(FN_TYPE, pfnName, pack_args_type, pfn_args) \
 	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	main_hook_function_void(offsetof(dllapi_info_t, pfnName), e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), &packed_args); \
+	api_hook_dispatch(api_hook_caller<FN_TYPE> pfn_args, &dllapi_info.pfnName, e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), 0); \
 	API_END_TSC_TRACKING()
 
 // Original DLL routines, functions returning an actual value.
 #define META_DLLAPI_HANDLE(ret_t, ret_init, FN_TYPE, pfnName, pack_args_type, pfn_args) \
 	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	class_ret_t ret_val(main_hook_function(class_ret_t((ret_t)ret_init), offsetof(dllapi_info_t, pfnName), e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), &packed_args)); \
+	ret_t ret_val = api_hook_dispatch(api_hook_caller<FN_TYPE> pfn_args, &dllapi_info.pfnName, e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnName), (ret_t)ret_init); \
 	API_END_TSC_TRACKING()
 
 // The "new" api routines (just 3 right now), functions returning "void".
 #define META_NEWAPI_HANDLE_void(FN_TYPE, pfnName, pack_args_type, pfn_args) \
 	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	main_hook_function_void(offsetof(newapi_info_t, pfnName), e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), &packed_args); \
+	api_hook_dispatch(api_hook_caller<FN_TYPE> pfn_args, &newapi_info.pfnName, e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), 0); \
 	API_END_TSC_TRACKING()
 
 // The "new" api routines (just 3 right now), functions returning an actual value.
 #define META_NEWAPI_HANDLE(ret_t, ret_init, FN_TYPE, pfnName, pack_args_type, pfn_args) \
 	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	class_ret_t ret_val(main_hook_function(class_ret_t((ret_t)ret_init), offsetof(newapi_info_t, pfnName), e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), &packed_args)); \
+	ret_t ret_val = api_hook_dispatch(api_hook_caller<FN_TYPE> pfn_args, &newapi_info.pfnName, e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnName), (ret_t)ret_init); \
 	API_END_TSC_TRACKING()
 
 
@@ -83,8 +88,12 @@ static void mm_GameDLLInit(void) {
 
 // From SDK dlls/cbase.cpp:
 static int mm_DispatchSpawn(edict_t *pent) {
+	if(unlikely(string_cache_map_pending))
+		string_cache_map_start();
 	// 0==Success, -1==Failure ?
 	META_DLLAPI_HANDLE(int, 0, FN_DISPATCHSPAWN, pfnSpawn, p, (pent));
+	if(unlikely(ent_index_active))
+		ent_index_update(pent);
 	RETURN_API(int);
 }
 static void mm_DispatchThink(edict_t *pent) {
@@ -104,6 +113,8 @@ static void mm_DispatchBlocked(edict_t *pentBlocked, edict_t *pentOther) {
 	RETURN_API_void();
 }
 static void mm_DispatchKeyValue(edict_t *pentKeyvalue, KeyValueData *pkvd) {
+	if(unlikely(string_cache_map_pending))
+		string_cache_map_start();
 	META_DLLAPI_HANDLE_void(FN_DISPATCHKEYVALUE, pfnKeyValue, 2p, (pentKeyvalue, pkvd));
 	RETURN_API_void();
 }
@@ -112,6 +123,8 @@ static void mm_DispatchSave(edict_t *pent, SAVERESTOREDATA *pSaveData) {
 	RETURN_API_void();
 }
 static int mm_DispatchRestore(edict_t *pent, SAVERESTOREDATA *pSaveData, int globalEntity) {
+	if(unlikely(string_cache_map_pending))
+		string_cache_map_start();
 	// 0==Success, -1==Failure ?
 	META_DLLAPI_HANDLE(int, 0, FN_DISPATCHRESTORE, pfnRestore, 2pi, (pent, pSaveData, globalEntity));
 	RETURN_API(int);
@@ -197,6 +210,13 @@ static void mm_ServerDeactivate(void) {
 	// Plugins->retry_all(PT_CHANGELEVEL);
 	g_Players.clear_all_cvar_queries();
 	requestid_counter = 0;
+	// start call recording armed with "meta record start"
+	api_record_level_change();
+	ent_filter_level_change();
+	ent_index_level_change();
+	ent_grid_level_change();
+	string_cache_level_change();
+	linkent_level_change();
 	RETURN_API_void();
 }
 static void mm_PlayerPreThink(edict_t *pEntity) {
@@ -209,6 +229,13 @@ static void mm_PlayerPostThink(edict_t *pEntity) {
 }
 static void mm_StartFrame(void) {
 	meta_debug_value = (int)meta_debug.value;
+	meta_prof_value = (int)meta_prof.value;
+	meta_trace_value = (int)meta_trace.value;
+	log_queue_deliver();
+	meta_jobs_run_mailbox();
+	ent_index_frame();
+	ent_grid_frame();
+	cvar_watch_frame();
 
 	META_DLLAPI_HANDLE_void(FN_STARTFRAME, pfnStartFrame, void, (VOID_ARG));
 	RETURN_API_void();
@@ -242,6 +269,11 @@ static void mm_SpectatorThink(edict_t *pEntity) {
 	RETURN_API_void();
 }
 static void mm_Sys_Error(const char *error_string) {
+	// engine is going down; save what led here
+	api_trace_dump_fatal(error_string);
+	api_record_flush();
+	log_queue_flush();
+	
 	META_DLLAPI_HANDLE_void(FN_SYS_ERROR, pfnSys_Error, p, (error_string));
 	RETURN_API_void();
 }
@@ -318,11 +350,16 @@ static int mm_AllowLagCompensation(void) {
 // New API functions
 // From SDK ?
 static void mm_OnFreeEntPrivateData(edict_t *pEnt) {
+	if(unlikely(ent_index_active))
+		ent_index_remove(pEnt);
 	META_NEWAPI_HANDLE_void(FN_ONFREEENTPRIVATEDATA, pfnOnFreeEntPrivateData, p, (pEnt));
 	RETURN_API_void();
 }
 static void mm_GameShutdown(void) {
 	META_NEWAPI_HANDLE_void(FN_GAMESHUTDOWN, pfnGameShutdown, void, (VOID_ARG));
+	api_record_stop();
+	meta_jobs_shutdown();
+	log_queue_shutdown();
 	RETURN_API_void();
 }
 static int mm_ShouldCollide(edict_t *pentTouched, edict_t *pentOther) {
@@ -440,6 +477,7 @@ C_DLLEXPORT int GetEntityAPI(DLL_FUNCTIONS *pFunctionTable, int interfaceVersion
 		return(FALSE);
 	}
 	memcpy(pFunctionTable, &gFunctionTable, sizeof(DLL_FUNCTIONS));
+	set_api_passthrough_table(e_api_dllapi, pFunctionTable, sizeof(DLL_FUNCTIONS) / sizeof(void*));
 	return(TRUE);
 }
 
@@ -457,6 +495,7 @@ C_DLLEXPORT int GetEntityAPI2(DLL_FUNCTIONS *pFunctionTable, int *interfaceVersi
 		return(FALSE);
 	}
 	memcpy(pFunctionTable, &gFunctionTable, sizeof(DLL_FUNCTIONS));
+	set_api_passthrough_table(e_api_dllapi, pFunctionTable, sizeof(DLL_FUNCTIONS) / sizeof(void*));
 	return(TRUE);
 }
 
@@ -507,6 +546,7 @@ C_DLLEXPORT int GetNewDLLFunctions(NEW_DLL_FUNCTIONS *pNewFunctionTable, int *in
 	}
 
 	sNewFunctionTable.copy_to(pNewFunctionTable);
+	set_api_passthrough_table(e_api_newapi, pNewFunctionTable, sNewFunctionTable.get_size() / sizeof(void*));
 
 
 	return(TRUE);
@@ -43,7 +43,12 @@
 
 #include "engine_api.h"		// me
 #include "metamod.h"		// SETUP_API_CALLS, etc
-#include "thread_logparse.h"	// LogQueue, etc
+#include "thread_logparse.h"	// logparse_handle, etc
+#include "usermsg.h"		// usermsg_begin, etc
+#include "ent_index.h"		// ent_index_update
+#include "ent_grid.h"		// ent_grid_update
+#include "string_cache.h"	// string_cache_alloc, etc
+#include "cvar_watch.h"		// cvar_watch_check, etc
 #include "api_info.h"		// dllapi_info, etc
 #include "log_meta.h"		// META_ERROR, etc
 #include "osdep.h"		// win32 vsnprintf, etc
@@ -53,15 +58,13 @@
 // Engine routines, functions returning "void".
 #define META_ENGINE_HANDLE_void(FN_TYPE, pfnName, pack_args_type, pfn_args) \
 	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	main_hook_function_void(offsetof(engine_info_t, pfnName), e_api_engine, offsetof(enginefuncs_t, pfnName), &packed_args); \
+	api_hook_dispatch(api_hook_caller<FN_TYPE> pfn_args, &engine_info.pfnName, e_api_engine, offsetof(enginefuncs_t, pfnName), 0); \
 	API_END_TSC_TRACKING()
 
 // Engine routines, functions returning an actual value.
 #define META_ENGINE_HANDLE(ret_t, ret_init, FN_TYPE, pfnName, pack_args_type, pfn_args) \
 	API_START_TSC_TRACKING(); \
-	API_PACK_ARGS(pack_args_type, pfn_args); \
-	class_ret_t ret_val(main_hook_function(class_ret_t((ret_t)ret_init), offsetof(engine_info_t, pfnName), e_api_engine, offsetof(enginefuncs_t, pfnName), &packed_args)); \
+	ret_t ret_val = api_hook_dispatch(api_hook_caller<FN_TYPE> pfn_args, &engine_info.pfnName, e_api_engine, offsetof(enginefuncs_t, pfnName), (ret_t)ret_init); \
 	API_END_TSC_TRACKING()
 
 // For varargs functions
@@ -105,8 +108,7 @@
 	MAKE_FORMATED_STRING(fmt_arg); \
 	API_START_TSC_TRACKING(); \
 	META_DEBUG(engine_info.pfnName.loglevel, ("In %s: fmt=%s", engine_info.pfnName.name, fmt_arg)); \
-	API_PACK_ARGS(pack_args_type, (pfn_arg, "%s", buf)); \
-	main_hook_function_void(offsetof(engine_info_t, pfnName), e_api_engine, offsetof(enginefuncs_t, pfnName), &packed_args); \
+	api_hook_dispatch(api_hook_caller<FN_TYPE>(pfn_arg, "%s", buf), &engine_info.pfnName, e_api_engine, offsetof(enginefuncs_t, pfnName), 0); \
 	API_END_TSC_TRACKING() \
 	CLEAN_FORMATED_STRING()
 
@@ -115,8 +117,7 @@
 	MAKE_FORMATED_STRING(fmt_arg); \
 	API_START_TSC_TRACKING(); \
 	META_DEBUG(engine_info.pfnName.loglevel, ("In %s: fmt=%s", engine_info.pfnName.name, fmt_arg)); \
-	API_PACK_ARGS(pack_args_type, (pfn_arg, "%s", buf)); \
-	class_ret_t ret_val(main_hook_function(class_ret_t((ret_t)ret_init), offsetof(engine_info_t, pfnName), e_api_engine, offsetof(enginefuncs_t, pfnName), &packed_args)); \
+	ret_t ret_val = api_hook_dispatch(api_hook_caller<FN_TYPE>(pfn_arg, "%s", buf), &engine_info.pfnName, e_api_engine, offsetof(enginefuncs_t, pfnName), (ret_t)ret_init); \
 	API_END_TSC_TRACKING() \
 	CLEAN_FORMATED_STRING()
 
@@ -144,6 +145,8 @@ static int mm_ModelFrames(int modelIndex) {
 
 static void mm_SetSize(edict_t *e, const float *rgflMin, const float *rgflMax) {
 	META_ENGINE_HANDLE_void(FN_SETSIZE, pfnSetSize, 3p, (e, rgflMin, rgflMax));
+	if(unlikely(ent_grid_active))
+		ent_grid_update(e);
 	RETURN_API_void()
 }
 static void mm_ChangeLevel(char *s1, char *s2) {
@@ -216,10 +219,14 @@ static edict_t *mm_CreateEntity(void) {
 }
 static void mm_RemoveEntity(edict_t *e) {
 	META_ENGINE_HANDLE_void(FN_REMOVEENTITY, pfnRemoveEntity, p, (e));
+	if(unlikely(ent_index_active))
+		ent_index_update(e);
 	RETURN_API_void()
 }
 static edict_t *mm_CreateNamedEntity(int className) {
 	META_ENGINE_HANDLE(edict_t *, NULL, FN_CREATENAMEDENTITY, pfnCreateNamedEntity, i, (className));
+	if(unlikely(ent_index_active))
+		ent_index_update(ret_val);
 	RETURN_API(edict_t *)
 }
 
@@ -242,6 +249,8 @@ static int mm_WalkMove(edict_t *ent, float yaw, float dist, int iMode) {
 }
 static void mm_SetOrigin(edict_t *e, const float *rgflOrigin) {
 	META_ENGINE_HANDLE_void(FN_SETORIGIN, pfnSetOrigin, 2p, (e, rgflOrigin));
+	if(unlikely(ent_grid_active))
+		ent_grid_update(e);
 	RETURN_API_void()
 }
 
@@ -317,44 +326,70 @@ static int mm_PointContents(const float *rgflVector) {
 	RETURN_API(int)
 }
 
+// Messages plugins subscribed to with REG_USERMSG_HOOK are held back
+// until MessageEnd (see usermsg.h).
 static void mm_MessageBegin(int msg_dest, int msg_type, const float *pOrigin, edict_t *ed) {
+	// for plugins' message filters
+	api_hook_msg_type = msg_type & 0xff;
+	if(unlikely(usermsg_active) && usermsg_begin(msg_dest, msg_type, pOrigin, ed))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_MESSAGEBEGIN, pfnMessageBegin, 2i2p, (msg_dest, msg_type, pOrigin, ed));
 	RETURN_API_void()
 }
 static void mm_MessageEnd(void) {
+	if(unlikely(usermsg_capturing)) {
+		usermsg_end();
+		RETURN_API_void()
+	}
 	META_ENGINE_HANDLE_void(FN_MESSAGEEND, pfnMessageEnd, void, (VOID_ARG));
 	RETURN_API_void()
 }
 
 static void mm_WriteByte(int iValue) {
+	if(unlikely(usermsg_capturing) && usermsg_write_int(MSGARG_BYTE, iValue))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITEBYTE, pfnWriteByte, i, (iValue));
 	RETURN_API_void()
 }
 static void mm_WriteChar(int iValue) {
+	if(unlikely(usermsg_capturing) && usermsg_write_int(MSGARG_CHAR, iValue))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITECHAR, pfnWriteChar, i, (iValue));
 	RETURN_API_void()
 }
 static void mm_WriteShort(int iValue) {
+	if(unlikely(usermsg_capturing) && usermsg_write_int(MSGARG_SHORT, iValue))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITESHORT, pfnWriteShort, i, (iValue));
 	RETURN_API_void()
 }
 static void mm_WriteLong(int iValue) {
+	if(unlikely(usermsg_capturing) && usermsg_write_int(MSGARG_LONG, iValue))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITELONG, pfnWriteLong, i, (iValue));
 	RETURN_API_void()
 }
 static void mm_WriteAngle(float flValue) {
+	if(unlikely(usermsg_capturing) && usermsg_write_float(MSGARG_ANGLE, flValue))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITEANGLE, pfnWriteAngle, f, (flValue));
 	RETURN_API_void()
 }
 static void mm_WriteCoord(float flValue) {
+	if(unlikely(usermsg_capturing) && usermsg_write_float(MSGARG_COORD, flValue))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITECOORD, pfnWriteCoord, f, (flValue));
 	RETURN_API_void()
 }
 static void mm_WriteString(const char *sz) {
+	if(unlikely(usermsg_capturing) && usermsg_write_string(sz))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITESTRING, pfnWriteString, p, (sz));
 	RETURN_API_void()
 }
 static void mm_WriteEntity(int iValue) {
+	if(unlikely(usermsg_capturing) && usermsg_write_int(MSGARG_ENTITY, iValue))
+		RETURN_API_void()
 	META_ENGINE_HANDLE_void(FN_WRITEENTITY, pfnWriteEntity, i, (iValue));
 	RETURN_API_void()
 }
@@ -375,6 +410,10 @@ static void mm_CVarSetFloat(const char *szVarName, float flValue) {
 	META_ENGINE_HANDLE_void(FN_CVARSETFLOAT, pfnCVarSetFloat, pf, (szVarName, flValue));
 
 	meta_debug_value = (int)meta_debug.value;
+	meta_prof_value = (int)meta_prof.value;
+	meta_trace_value = (int)meta_trace.value;
+	if(unlikely(cvar_watch_active))
+		cvar_watch_check_name(szVarName);
 
 	RETURN_API_void()
 }
@@ -382,12 +421,24 @@ static void mm_CVarSetString(const char *szVarName, const char *szValue) {
 	META_ENGINE_HANDLE_void(FN_CVARSETSTRING, pfnCVarSetString, 2p, (szVarName, szValue));
 
 	meta_debug_value = (int)meta_debug.value;
+	meta_prof_value = (int)meta_prof.value;
+	meta_trace_value = (int)meta_trace.value;
+	if(unlikely(cvar_watch_active))
+		cvar_watch_check_name(szVarName);
 
 	RETURN_API_void()
 }
 
 static void mm_AlertMessage(ALERT_TYPE atype, char *szFmt, ...) {
-	META_ENGINE_HANDLE_void_varargs(FN_ALERTMESSAGE, pfnAlertMessage, ipV, atype, szFmt);
+	MAKE_FORMATED_STRING(szFmt);
+	API_START_TSC_TRACKING();
+	META_DEBUG(engine_info.pfnAlertMessage.loglevel, ("In %s: fmt=%s", engine_info.pfnAlertMessage.name, szFmt));
+	api_hook_dispatch(api_hook_caller<FN_ALERTMESSAGE>(atype, "%s", buf), &engine_info.pfnAlertMessage, e_api_engine, offsetof(enginefuncs_t, pfnAlertMessage), 0);
+	API_END_TSC_TRACKING()
+	// plugins' log event patterns, all in one pass
+	if(atype == at_logged && logparse_active)
+		logparse_handle(buf);
+	CLEAN_FORMATED_STRING()
 	RETURN_API_void()
 }
 #ifdef HLSDK_3_2_OLD_EIFACE
@@ -421,6 +472,9 @@ static const char *mm_SzFromIndex(int iString) {
 	RETURN_API(const char *)
 }
 static int mm_AllocString(const char *szValue) {
+	// unhooked calls are answered from cache
+	if(likely(string_cache_bypass()))
+		return(string_cache_alloc(szValue));
 	META_ENGINE_HANDLE(int, 0, FN_ALLOCSTRING, pfnAllocString, p, (szValue));
 	RETURN_API(int)
 }
@@ -460,7 +514,7 @@ static int mm_RegUserMsg(const char *pszName, int iSize) {
 	META_ENGINE_HANDLE(int, 0, FN_REGUSERMSG, pfnRegUserMsg, pi, (pszName, iSize));
 	// Expand the macro, since we need to do extra work.
 	/// RETURN_API(int)
-	imsgid = GET_RET_CLASS(ret_val, int);
+	imsgid = ret_val;
 	
 	// Add the msgid, name, and size to our saved list, if we haven't
 	// already.
@@ -473,8 +527,12 @@ static int mm_RegUserMsg(const char *pszName, int iSize) {
 			// This msgid was previously used by a different message name.
 			META_WARNING("user message id reused: msgid=%d, oldname=%s, newname=%s", imsgid, nmsg->name, pszName);
 	}
-	else
+	else {
 		RegMsgs->add(pszName, imsgid, iSize);
+		// resolve REG_USERMSG_HOOK subscriptions and ADD_MSG_FILTER
+		// filters waiting for this name
+		usermsg_msg_registered(pszName, imsgid);
+	}
 	return(imsgid);
 }
 
@@ -734,7 +792,7 @@ static void mm_DeltaUnsetField( struct delta_s *pFields, const char *fieldname )
 	RETURN_API_void()
 }
 static void mm_DeltaAddEncoder( char *name, void (*conditionalencode)( struct delta_s *pFields, const unsigned char *from, const unsigned char *to ) ) {
-	META_ENGINE_HANDLE_void(FN_DELTAADDENCODER, pfnDeltaAddEncoder, 2p, (name, (void*)conditionalencode));
+	META_ENGINE_HANDLE_void(FN_DELTAADDENCODER, pfnDeltaAddEncoder, 2p, (name, conditionalencode));
 	RETURN_API_void()
 }
 static int mm_GetCurrentPlayer( void ) {
@@ -771,6 +829,10 @@ static void mm_Cvar_DirectSet( struct cvar_s *var, char *value ) {
 	META_ENGINE_HANDLE_void(FN_CVAR_DIRECTSET, pfnCvar_DirectSet, 2p, (var, value));
 
 	meta_debug_value = (int)meta_debug.value;
+	meta_prof_value = (int)meta_prof.value;
+	meta_trace_value = (int)meta_trace.value;
+	if(unlikely(cvar_watch_active))
+		cvar_watch_check(var);
 
 	RETURN_API_void()
 }
@@ -789,7 +851,7 @@ static void mm_GetPlayerStats( const edict_t *pClient, int *ping, int *packet_lo
 }
 
 static void mm_AddServerCommand( char *cmd_name, void (*function) (void) ) {
-	META_ENGINE_HANDLE_void(FN_ADDSERVERCOMMAND, pfnAddServerCommand, 2p, (cmd_name, (void*)function));
+	META_ENGINE_HANDLE_void(FN_ADDSERVERCOMMAND, pfnAddServerCommand, 2p, (cmd_name, function));
 	RETURN_API_void()
 }
 
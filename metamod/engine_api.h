@@ -235,6 +235,6 @@ typedef void (*FN_QUERYCLIENTCVARVALUE) ( const edict_t *player, const char *cva
 // Added 2005/11/21 (no SDK update):
 typedef void (*FN_QUERYCLIENTCVARVALUE2) ( const edict_t *player, const char *cvarName, int requestID );
 // Added 2009/06/17 (no SDK update):
-typedef void (*FN_ENGCHECKPARM) ( const char *pchCmdLineToken, char **pchNextVal );
+typedef int (*FN_ENGCHECKPARM) ( const char *pchCmdLineToken, char **pchNextVal );
 
 #endif /* ENGINE_API_H */
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// calloc, free
+#include <string.h>			// strcmp, strdup
+
+#include <extdll.h>			// always
+
+#include "ent_class.h"		// me
+#include "metamod.h"		// GameDLL, metamod_handle
+#include "log_meta.h"		// META_CONS, META_DEBUG, etc
+#include "osdep.h"			// DLSYM, likely, unlikely
+
+#define ENT_CLASS_INITIAL	32
+
+typedef struct ent_class_s {
+	char *name;						// kept once added, for reuse
+	unsigned int hash;
+	META_ENTITY_FN fn;				// NULL once unregistered
+	plid_t plid;
+	unsigned long lookups;
+} ent_class_t;
+
+// Open-addressed by name; entries are never removed, so probing needs no
+// tombstones.
+static ent_class_t *table = NULL;
+static unsigned int table_size = 0;
+static unsigned int table_used = 0;
+static int num_live = 0;
+
+
+static inline unsigned int DLLINTERNAL ent_class_hash(const char *str) {
+	unsigned int h = 2166136261U;
+
+	while(*str) {
+		h ^= (unsigned char)*str++;
+		h *= 16777619U;
+	}
+	return(h);
+}
+
+static mBOOL DLLINTERNAL ent_class_grow(void) {
+	ent_class_t *newtable;
+	unsigned int newsize, i, j;
+
+	newsize = table_size ? table_size * 2 : ENT_CLASS_INITIAL;
+	newtable=(ent_class_t *)calloc(newsize, sizeof(ent_class_t));
+	if(!newtable)
+		return(mFALSE);
+	for(i=0; i < table_size; i++) {
+		if(!table[i].name)
+			continue;
+		for(j=table[i].hash & (newsize - 1); newtable[j].name; j=(j + 1) & (newsize - 1))
+			;
+		newtable[j]=table[i];
+	}
+	free(table);
+	table=newtable;
+	table_size=newsize;
+	return(mTRUE);
+}
+
+static ent_class_t * DLLINTERNAL ent_class_lookup(const char *classname, unsigned int hash) {
+	unsigned int i;
+
+	if(!table_size)
+		return(NULL);
+	for(i=hash & (table_size - 1); table[i].name; i=(i + 1) & (table_size - 1)) {
+		if(table[i].hash == hash && !strcmp(table[i].name, classname))
+			return(&table[i]);
+	}
+	return(NULL);
+}
+
+int DLLINTERNAL ent_class_register(plid_t plid, const char *classname, META_ENTITY_FN fn) {
+#ifdef _WIN32
+	RETURN_ERRNO(0, ME_OSNOTSUP);
+#else
+	ent_class_t *ec;
+	unsigned int hash, i;
+
+	if(!plid || !fn || !classname || !classname[0])
+		RETURN_ERRNO(0, ME_ARGUMENT);
+
+	hash=ent_class_hash(classname);
+	ec=ent_class_lookup(classname, hash);
+	if(ec && ec->fn) {
+		if(ec->plid != plid) {
+			META_WARNING("Plugin '%s' can't register entity class '%s'; already registered by plugin '%s'",
+					plid->name, classname, ec->plid->name);
+			RETURN_ERRNO(0, ME_ALREADY);
+		}
+		// re-registering own class
+		ec->fn=fn;
+		return(1);
+	}
+	// metamod and gamedll exports are found first, so a registration
+	// would never be used
+	if(DLSYM(GameDLL.handle, classname) || DLSYM(metamod_handle, classname)) {
+		META_WARNING("Plugin '%s' can't register entity class '%s'; exported by metamod or game DLL",
+				plid->name, classname);
+		RETURN_ERRNO(0, ME_ALREADY);
+	}
+
+	if(!ec) {
+		if((table_used + 1) * 2 > table_size && !ent_class_grow())
+			RETURN_ERRNO(0, ME_NOMEM);
+		for(i=hash & (table_size - 1); table[i].name; i=(i + 1) & (table_size - 1))
+			;
+		ec=&table[i];
+		if(!(ec->name=strdup(classname)))
+			RETURN_ERRNO(0, ME_NOMEM);
+		ec->hash=hash;
+		table_used++;
+	}
+	ec->fn=fn;
+	ec->plid=plid;
+	ec->lookups=0;
+	num_live++;
+	META_DEBUG(4, ("Plugin '%s' registered entity class '%s'", plid->name, classname));
+	return(1);
+#endif /* _WIN32 */
+}
+
+mBOOL DLLINTERNAL ent_class_unregister(plid_t plid, const char *classname) {
+	ent_class_t *ec;
+
+	if(!classname)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	ec=ent_class_lookup(classname, ent_class_hash(classname));
+	if(!ec || !ec->fn || ec->plid != plid)
+		RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+	ec->fn=NULL;
+	num_live--;
+	return(mTRUE);
+}
+
+void DLLINTERNAL ent_class_plugin_unloaded(plid_t plid) {
+	unsigned int i;
+
+	if(!num_live)
+		return;
+	for(i=0; i < table_size; i++) {
+		if(table[i].fn && table[i].plid == plid) {
+			META_DEBUG(4, ("Dropping entity class '%s' of plugin '%s'", table[i].name, plid->name));
+			table[i].fn=NULL;
+			num_live--;
+		}
+	}
+}
+
+META_ENTITY_FN DLLINTERNAL ent_class_find(const char *classname) {
+	ent_class_t *ec;
+
+	if(likely(!num_live) || unlikely(!classname))
+		return(NULL);
+	ec=ent_class_lookup(classname, ent_class_hash(classname));
+	if(!ec || !ec->fn)
+		return(NULL);
+	ec->lookups++;
+	return(ec->fn);
+}
+
+void DLLINTERNAL cmd_meta_entclasses(void) {
+	unsigned int i;
+
+	META_CONS("Entity classes registered by plugins:");
+	META_CONS("  %-24s %-16s %10s", "classname", "plugin", "lookups");
+	for(i=0; i < table_size; i++) {
+		if(!table[i].fn)
+			continue;
+		META_CONS("  %-24.24s %-16.16s %10lu", table[i].name, table[i].plid->name, table[i].lookups);
+	}
+	META_CONS("%d entity classes", num_live);
+}
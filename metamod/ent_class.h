@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef ENT_CLASS_H
+#define ENT_CLASS_H
+
+#include <extdll.h>			// entvars_t
+
+#include "plinfo.h"			// plid_t
+#include "mutil.h"			// META_ENTITY_FN
+#include "types_meta.h"		// mBOOL
+#include "comp_dep.h"
+
+// Entity classes of plugins.
+//  Instead of needing a LINK_ENTITY_TO_PLUGIN export compiled into
+//  metamod, plugins register their classnames with REG_ENTITY_CLASS,
+//  normally from Meta_Attach.  When the engine looks up a classname on
+//  metamod that neither metamod nor the gamedll exports, the linkent
+//  replacement finds it here.  Registrations of a plugin go away when it
+//  is unloaded; entities it spawned are its own business, as with
+//  LINK_ENTITY_TO_PLUGIN.
+//
+//  On win32 the engine reads metamod's export table directly, so
+//  registering fails there with ME_OSNOTSUP.
+
+// Register classname for plugin.  Returns 1, or 0 with meta_errno set.
+int DLLINTERNAL ent_class_register(plid_t plid, const char *classname, META_ENTITY_FN fn);
+
+// drop a registration by name
+mBOOL DLLINTERNAL ent_class_unregister(plid_t plid, const char *classname);
+
+// drop plugin's registrations, on unload
+void DLLINTERNAL ent_class_plugin_unloaded(plid_t plid);
+
+// spawn function registered for classname, or NULL
+META_ENTITY_FN DLLINTERNAL ent_class_find(const char *classname);
+
+void DLLINTERNAL cmd_meta_entclasses(void);
+
+#endif /* ENT_CLASS_H */
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// malloc, free, etc
+#include <string.h>			// strcmp, memset, etc
+
+#include <extdll.h>			// always
+
+#include "ent_filter.h"		// me
+#include "api_hook.h"		// api_hook_internal_ref, rebuild_api_hook_subscribers
+#include "mlist.h"			// Plugins
+#include "mplugin.h"		// MPlugin
+#include "metamod.h"		// gpGlobals
+#include "log_meta.h"		// META_CONS, META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely
+
+// classname hash table size, power of 2
+#define ENT_CLASS_HASH 256
+
+// highest edict index accepted for index filters
+#define ENT_FILTER_MAX_INDEX 65535
+
+typedef struct ent_filter_slot_s {
+	plid_t plid;					// NULL if slot is free
+	int post;
+	int nclasses;
+	int nindexes;
+} ent_filter_slot_t;
+
+typedef struct ent_class_s {
+	struct ent_class_s *next;
+	unsigned long long mask;		// slots wanting classname
+	char name[1];
+} ent_class_t;
+
+typedef struct ent_cache_s {
+	string_t classname;				// classname mask was computed for
+	unsigned int generation;		// cache_generation when computed
+	unsigned long long mask;
+} ent_cache_t;
+
+int ent_filter_active = 0;
+
+static ent_filter_slot_t slots[ENT_FILTER_MAX_SLOTS];
+static int num_slots = 0;
+
+static ent_class_t *class_hash[ENT_CLASS_HASH];
+
+// slots wanting edict, by index
+static unsigned long long *index_masks = NULL;
+static int num_index_masks = 0;
+
+// per-edict mask cache; entries with other generation are stale
+static ent_cache_t *cache = NULL;
+static int cache_size = 0;
+static unsigned int cache_generation = 1;
+
+// engine's edict array; moves on level change
+static const edict_t *edict_base = NULL;
+
+// Entity functions that filters apply to.
+static const unsigned int ent_filter_funcs[] = {
+	offsetof(DLL_FUNCTIONS, pfnSpawn),
+	offsetof(DLL_FUNCTIONS, pfnThink),
+	offsetof(DLL_FUNCTIONS, pfnUse),
+	offsetof(DLL_FUNCTIONS, pfnTouch),
+	offsetof(DLL_FUNCTIONS, pfnBlocked),
+	offsetof(DLL_FUNCTIONS, pfnKeyValue),
+	~0U
+};
+
+
+static inline unsigned int DLLINTERNAL ent_class_hash(const char *name) {
+	unsigned int h = 5381;
+
+	while(*name)
+		h = h * 33 + (unsigned char)*name++;
+	return(h & (ENT_CLASS_HASH - 1));
+}
+
+static ent_class_t * DLLINTERNAL ent_class_find(const char *name) {
+	ent_class_t *cls;
+
+	for(cls=class_hash[ent_class_hash(name)]; cls; cls=cls->next) {
+		if(!strcmp(cls->name, name))
+			return(cls);
+	}
+	return(NULL);
+}
+
+static inline unsigned long long DLLINTERNAL ent_class_mask(const char *name) {
+	ent_class_t *cls;
+
+	if(!name || !name[0])
+		return(0);
+	cls=ent_class_find(name);
+	return(cls ? cls->mask : 0);
+}
+
+// Index of edict in engine's edict array, or -1.
+static int DLLINTERNAL ent_filter_index(const edict_t *pEdict) {
+	int index, max;
+
+	max = gpGlobals->maxEntities;
+	index = pEdict - edict_base;
+	if(unlikely(!edict_base || index < 0 || index >= max)) {
+		edict_base = (*g_engfuncs.pfnPEntityOfEntOffset)(0);
+		index = pEdict - edict_base;
+		if(!edict_base || index < 0 || index >= max)
+			return(-1);
+	}
+	return(index);
+}
+
+unsigned long long DLLINTERNAL ent_filter_mask(const edict_t *pEdict, const KeyValueData *pkvd) {
+	unsigned long long mask;
+	ent_cache_t *c, *newcache;
+	int index, newsize;
+
+	if(unlikely(!pEdict))
+		return(pkvd ? ent_class_mask(pkvd->szClassName) : 0);
+	index=ent_filter_index(pEdict);
+	mask = (index >= 0 && index < num_index_masks) ? index_masks[index] : 0;
+
+	// entity being created from map; classname is only in KeyValueData
+	if(pkvd && pkvd->szClassName)
+		return(mask | ent_class_mask(pkvd->szClassName));
+
+	if(unlikely(index < 0))
+		return(mask | (pEdict->v.classname ? ent_class_mask(STRING(pEdict->v.classname)) : 0));
+
+	if(unlikely(index >= cache_size)) {
+		newsize = gpGlobals->maxEntities;
+		newcache=(ent_cache_t *)realloc(cache, newsize * sizeof(ent_cache_t));
+		if(!newcache)
+			return(mask | (pEdict->v.classname ? ent_class_mask(STRING(pEdict->v.classname)) : 0));
+		memset(&newcache[cache_size], 0, (newsize - cache_size) * sizeof(ent_cache_t));
+		cache=newcache;
+		cache_size=newsize;
+	}
+
+	c=&cache[index];
+	if(likely(c->generation == cache_generation && c->classname == pEdict->v.classname))
+		return(c->mask);
+	if(pEdict->v.classname)
+		mask |= ent_class_mask(STRING(pEdict->v.classname));
+	c->classname=pEdict->v.classname;
+	c->generation=cache_generation;
+	c->mask=mask;
+	return(mask);
+}
+
+mBOOL DLLINTERNAL is_ent_filter_function(enum_api_t api, unsigned int func_offset) {
+	int i;
+
+	if(api != e_api_dllapi)
+		return(mFALSE);
+	for(i=0; ent_filter_funcs[i] != ~0U; i++) {
+		if(ent_filter_funcs[i] == func_offset)
+			return(mTRUE);
+	}
+	return(mFALSE);
+}
+
+unsigned long long DLLINTERNAL ent_filter_bit(const MPlugin *plug, int post) {
+	int i;
+
+	if(!num_slots || !plug->info)
+		return(0);
+	for(i=0; i < ENT_FILTER_MAX_SLOTS; i++) {
+		if(slots[i].plid == plug->info && slots[i].post == post)
+			return(1ULL << i);
+	}
+	return(0);
+}
+
+static void DLLINTERNAL ent_filter_set_active(int active) {
+	int i;
+
+	if(active == ent_filter_active)
+		return;
+	ent_filter_active=active;
+	// Filters are applied by the typed hook functions; keep the entity
+	// functions out of passthrough.
+	for(i=0; ent_filter_funcs[i] != ~0U; i++)
+		api_hook_internal_ref(e_api_dllapi, ent_filter_funcs[i], active ? 1 : -1);
+}
+
+static int DLLINTERNAL ent_filter_find_slot(plid_t plid, int post) {
+	int i;
+
+	for(i=0; i < ENT_FILTER_MAX_SLOTS; i++) {
+		if(slots[i].plid == plid && slots[i].post == post)
+			return(i);
+	}
+	return(-1);
+}
+
+// Find or create slot for plugin's table.
+static int DLLINTERNAL ent_filter_get_slot(plid_t plid, int post) {
+	int i;
+
+	if(!Plugins->find(plid))
+		RETURN_ERRNO(-1, ME_NOTFOUND);
+	i=ent_filter_find_slot(plid, post);
+	if(i >= 0)
+		return(i);
+	i=ent_filter_find_slot(NULL, 0);
+	if(i < 0) {
+		META_WARNING("Plugin '%s': no free entity filter slots (max %d)", plid->name, ENT_FILTER_MAX_SLOTS);
+		RETURN_ERRNO(-1, ME_MAXREACHED);
+	}
+	memset(&slots[i], 0, sizeof(slots[i]));
+	slots[i].plid=plid;
+	slots[i].post=post;
+	num_slots++;
+	ent_filter_set_active(1);
+	cache_generation++;
+	rebuild_api_hook_subscribers();
+	return(i);
+}
+
+mBOOL DLLINTERNAL ent_filter_add_class(plid_t plid, int post, const char *classname) {
+	ent_class_t *cls, *newcls;
+	unsigned int h;
+	int slot, len;
+
+	if(!classname || !classname[0])
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	post = post ? 1 : 0;
+	cls=ent_class_find(classname);
+	newcls=NULL;
+	if(!cls) {
+		len=strlen(classname);
+		newcls=(ent_class_t *)calloc(1, sizeof(ent_class_t) + len);
+		if(!newcls)
+			RETURN_ERRNO(mFALSE, ME_NOMEM);
+		memcpy(newcls->name, classname, len + 1);
+	}
+	// hash new class only once we have a slot, so no entry is left
+	// behind without one
+	slot=ent_filter_get_slot(plid, post);
+	if(slot < 0) {
+		free(newcls);
+		// meta_errno set in ent_filter_get_slot()
+		return(mFALSE);
+	}
+	if(newcls) {
+		h=ent_class_hash(classname);
+		newcls->next=class_hash[h];
+		class_hash[h]=newcls;
+		cls=newcls;
+	}
+	if(!(cls->mask & (1ULL << slot))) {
+		cls->mask |= 1ULL << slot;
+		slots[slot].nclasses++;
+		cache_generation++;
+	}
+	META_DEBUG(3, ("Plugin '%s' added %s entity filter classname '%s'", plid->name, post ? "post" : "pre", classname));
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL ent_filter_add_index(plid_t plid, int post, int index) {
+	unsigned long long *newmasks;
+	int slot, newnum;
+
+	if(index < 0 || index > ENT_FILTER_MAX_INDEX)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	post = post ? 1 : 0;
+	if(index >= num_index_masks) {
+		newnum = index + 1 > gpGlobals->maxEntities ? index + 1 : gpGlobals->maxEntities;
+		newmasks=(unsigned long long *)realloc(index_masks, newnum * sizeof(*index_masks));
+		if(!newmasks)
+			RETURN_ERRNO(mFALSE, ME_NOMEM);
+		memset(&newmasks[num_index_masks], 0, (newnum - num_index_masks) * sizeof(*index_masks));
+		index_masks=newmasks;
+		num_index_masks=newnum;
+	}
+	slot=ent_filter_get_slot(plid, post);
+	if(slot < 0)
+		return(mFALSE);
+	if(!(index_masks[index] & (1ULL << slot))) {
+		index_masks[index] |= 1ULL << slot;
+		slots[slot].nindexes++;
+		cache_generation++;
+	}
+	META_DEBUG(3, ("Plugin '%s' added %s entity filter index %d", plid->name, post ? "post" : "pre", index));
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL ent_filter_clear(plid_t plid, int post) {
+	ent_class_t *cls, **prev;
+	unsigned long long bit;
+	int slot, i;
+
+	post = post ? 1 : 0;
+	slot=ent_filter_find_slot(plid, post);
+	if(!plid || slot < 0)
+		RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+	bit = 1ULL << slot;
+
+	for(i=0; i < ENT_CLASS_HASH; i++) {
+		for(prev=&class_hash[i]; (cls=*prev); ) {
+			cls->mask &= ~bit;
+			if(!cls->mask) {
+				*prev=cls->next;
+				free(cls);
+			}
+			else
+				prev=&cls->next;
+		}
+	}
+	for(i=0; i < num_index_masks; i++)
+		index_masks[i] &= ~bit;
+
+	memset(&slots[slot], 0, sizeof(slots[slot]));
+	num_slots--;
+	cache_generation++;
+	if(!num_slots)
+		ent_filter_set_active(0);
+	rebuild_api_hook_subscribers();
+	return(mTRUE);
+}
+
+void DLLINTERNAL ent_filter_plugin_unloaded(plid_t plid) {
+	if(!num_slots)
+		return;
+	if(ent_filter_find_slot(plid, 0) >= 0)
+		ent_filter_clear(plid, 0);
+	if(ent_filter_find_slot(plid, 1) >= 0)
+		ent_filter_clear(plid, 1);
+}
+
+void DLLINTERNAL ent_filter_level_change(void) {
+	// string_t values are reused by next map
+	cache_generation++;
+	edict_base=NULL;
+}
+
+// "meta entfilters" console command.
+void DLLINTERNAL cmd_meta_entfilters(void) {
+	ent_class_t *cls;
+	char buf[256];
+	int i, h, len;
+
+	META_CONS("Entity filters:");
+	META_CONS("  %-16s %-4s %7s  %s", "plugin", "hook", "indexes", "classnames");
+	for(i=0; i < ENT_FILTER_MAX_SLOTS; i++) {
+		if(!slots[i].plid)
+			continue;
+		len=0;
+		buf[0]='\0';
+		for(h=0; h < ENT_CLASS_HASH && len < (int)sizeof(buf) - 1; h++) {
+			for(cls=class_hash[h]; cls && len < (int)sizeof(buf) - 1; cls=cls->next) {
+				if(!(cls->mask & (1ULL << i)))
+					continue;
+				safevoid_snprintf(buf + len, sizeof(buf) - len, "%s%s", len ? " " : "", cls->name);
+				len+=strlen(buf + len);
+			}
+		}
+		META_CONS("  %-16.16s %-4s %7d  %s", slots[i].plid->name, slots[i].post ? "post" : "pre", 
+				slots[i].nindexes, buf);
+	}
+	META_CONS("%d of %d filter slots used", num_slots, ENT_FILTER_MAX_SLOTS);
+}
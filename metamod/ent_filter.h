@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef ENT_FILTER_H
+#define ENT_FILTER_H
+
+#include <extdll.h>			// edict_t, KeyValueData
+
+#include "plinfo.h"			// plid_t
+#include "api_info.h"		// enum_api_t
+#include "types_meta.h"		// mBOOL
+#include "comp_dep.h"
+
+class MPlugin;
+
+// Entity filters for entity hooks.
+//  Plugins whose Spawn, Think, Use, Touch, Blocked or KeyValue hooks
+//  only care about some entities declare them with ADD_ENT_CLASS_FILTER
+//  (by classname) and ADD_ENT_INDEX_FILTER (by edict index), per pre or
+//  post table.  Every such table gets a filter slot, and its entries in
+//  the subscriber lists the slot's bit.  For each call the hook function
+//  looks up the bitmask of slots that want the edict argument, and calls
+//  only the plugins whose bit is set, instead of every plugin comparing
+//  classnames by itself.
+//
+//  Classnames are interned in a hash table, each with the mask of slots
+//  wanting it.  The mask of an edict (its index bits and classname bits)
+//  is cached per edict, keyed by the edict's classname string_t, so that
+//  a lookup is normally one compare.  KeyValue calls during map load,
+//  before the entity has its classname, use the classname in
+//  KeyValueData.  Caches are dropped whenever filters change and on level
+//  change.
+
+// max plugin hook tables with entity filter
+#define ENT_FILTER_MAX_SLOTS 64
+
+// nonzero while there are filters
+extern int ent_filter_active DLLHIDDEN;
+
+// Mask of filter slots wanting calls for edict.
+unsigned long long DLLINTERNAL ent_filter_mask(const edict_t *pEdict, const KeyValueData *pkvd);
+
+// whether function is one of the entity functions filters apply to
+mBOOL DLLINTERNAL is_ent_filter_function(enum_api_t api, unsigned int func_offset);
+
+// Slot bit of plugin's pre or post table, for subscriber lists; 0 if it
+// has no filter.
+unsigned long long DLLINTERNAL ent_filter_bit(const MPlugin *plug, int post);
+
+// Add classname or edict index to filter of plugin's pre or post table;
+// creates filter.  Returns mFALSE with meta_errno set on error.
+mBOOL DLLINTERNAL ent_filter_add_class(plid_t plid, int post, const char *classname);
+mBOOL DLLINTERNAL ent_filter_add_index(plid_t plid, int post, int index);
+
+// Remove filter; hooks get calls for every entity again.
+mBOOL DLLINTERNAL ent_filter_clear(plid_t plid, int post);
+
+// remove plugin's filters, on unload
+void DLLINTERNAL ent_filter_plugin_unloaded(plid_t plid);
+
+// drop cached edict masks, on level change
+void DLLINTERNAL ent_filter_level_change(void);
+
+void DLLINTERNAL cmd_meta_entfilters(void);
+
+// Mask for hook arguments; for api_hook_caller::ent_mask().  Calls of
+// functions without edict argument aren't filtered.
+template<typename A1, typename A2>
+inline unsigned long long api_hook_ent_mask(A1, A2) {
+	return(~0ULL);
+}
+template<typename A2>
+inline unsigned long long api_hook_ent_mask(edict_t *pEdict, A2) {
+	return(ent_filter_mask(pEdict, NULL));
+}
+inline unsigned long long api_hook_ent_mask(edict_t *pEdict, KeyValueData *pkvd) {
+	return(ent_filter_mask(pEdict, pkvd));
+}
+
+#endif /* ENT_FILTER_H */
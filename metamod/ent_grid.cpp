@@ -0,0 +1,522 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// malloc, qsort, etc
+#include <string.h>			// memset, etc
+
+#include <extdll.h>			// always
+
+#include "ent_grid.h"		// me
+#include "api_hook.h"		// api_hook_internal_ref
+#include "metamod.h"		// gpGlobals, GET_TSC
+#include "log_meta.h"		// META_CONS, META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely, strcasecmp
+
+// cell size in units, and cells per side; grid covers -8192..8192 on x
+// and y, entities outside are kept in edge cells
+#define ENT_GRID_CELL 256.0f
+#define ENT_GRID_SIZE 64
+#define ENT_GRID_MIN (-ENT_GRID_CELL * ENT_GRID_SIZE / 2)
+
+// how far entities may move between refreshes, and longest frame assumed
+#define ENT_GRID_SLACK 32.0f
+#define ENT_GRID_MAX_FRAMETIME 0.1f
+
+// entities spanning more cells are tested on every query
+#define ENT_GRID_MAX_CELLS 16
+
+// seconds without queries before grid is dropped
+#define ENT_GRID_IDLE 30.0f
+
+enum {
+	GRID_NONE = 0,			// not a candidate; free, no classname, etc
+	GRID_CELLS,				// in cells x0..x1, y0..y1
+	GRID_ALWAYS,			// in always list
+};
+
+typedef struct ent_cell_s {
+	int *ents;				// edict indexes
+	int num;
+	int max;
+} ent_cell_t;
+
+typedef struct ent_grid_ent_s {
+	short x0, y0, x1, y1;
+	unsigned char where;			// GRID_*
+	int always_pos;					// position in always list
+	unsigned int stamp;				// query that last tested it
+} ent_grid_ent_t;
+
+int ent_grid_active = 0;
+
+static ent_cell_t *cells = NULL;
+static ent_grid_ent_t *ents = NULL;		// by edict index
+static int num_ents = 0;
+static int max_clients = 0;
+static const edict_t *edict_base = NULL;
+
+static ent_cell_t always = { NULL, 0, 0 };
+static ent_cell_t found = { NULL, 0, 0 };
+static unsigned int query_stamp = 0;
+static float last_query_time = 0.0f;
+
+static unsigned long long stat_queries = 0;
+static unsigned long long stat_tested = 0;
+static unsigned long long stat_found = 0;
+static unsigned long long stat_moves = 0;
+static unsigned long stat_builds = 0;
+
+// Functions whose calls update the grid.
+static const struct {
+	enum_api_t api;
+	unsigned int offset;
+} ent_grid_funcs[] = {
+	{ e_api_engine, offsetof(enginefuncs_t, pfnSetOrigin) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnSetSize) },
+};
+
+
+static mBOOL DLLINTERNAL ent_cell_add(ent_cell_t *cell, int index) {
+	int *newents, newmax;
+
+	if(unlikely(cell->num >= cell->max)) {
+		newmax = cell->max ? cell->max * 2 : 8;
+		newents=(int *)realloc(cell->ents, newmax * sizeof(int));
+		if(!newents)
+			return(mFALSE);
+		cell->ents=newents;
+		cell->max=newmax;
+	}
+	cell->ents[cell->num++]=index;
+	return(mTRUE);
+}
+
+static void DLLINTERNAL ent_cell_remove(ent_cell_t *cell, int index) {
+	int i;
+
+	for(i=0; i < cell->num; i++) {
+		if(cell->ents[i] == index) {
+			cell->ents[i]=cell->ents[--cell->num];
+			return;
+		}
+	}
+}
+
+static inline int DLLINTERNAL ent_grid_coord(float v) {
+	float f = (v - ENT_GRID_MIN) * (1.0f / ENT_GRID_CELL);
+
+	// also catches NaN
+	if(!(f > 0.0f))
+		return(0);
+	if(f >= ENT_GRID_SIZE)
+		return(ENT_GRID_SIZE - 1);
+	return((int)f);
+}
+
+static inline ent_cell_t * DLLINTERNAL ent_grid_cell(int x, int y) {
+	return(&cells[y * ENT_GRID_SIZE + x]);
+}
+
+// Whether client slot is in game.  Engine checks its own client state,
+// which we can't see; a client is flagged and has its private data from
+// the time gamedll puts it in server, however it got there (bots put in
+// by plugins don't pass through our ClientPutInServer).
+static inline int DLLINTERNAL ent_grid_client_active(const edict_t *pEdict) {
+	return((pEdict->v.flags & (FL_CLIENT | FL_FAKECLIENT)) && pEdict->pvPrivateData);
+}
+
+// Whether edict is a candidate at all; as engine, skips free edicts,
+// edicts without classname, and clients not in game.
+static inline int DLLINTERNAL ent_grid_valid(int index, const edict_t *pEdict) {
+	return(!pEdict->free && pEdict->v.classname 
+			&& (index > max_clients || ent_grid_client_active(pEdict)));
+}
+
+// Engine's test: distance from origin to nearest point of entity's box.
+static inline int DLLINTERNAL ent_grid_hit(const edict_t *pEdict, const float *origin, float rad2) {
+	float d, dist = 0.0f;
+	int j;
+
+	for(j=0; j < 3; j++) {
+		if(origin[j] < pEdict->v.absmin[j])
+			d = origin[j] - pEdict->v.absmin[j];
+		else if(origin[j] > pEdict->v.absmax[j])
+			d = origin[j] - pEdict->v.absmax[j];
+		else
+			continue;
+		dist += d * d;
+		if(dist > rad2)
+			return(0);
+	}
+	return(1);
+}
+
+static void DLLINTERNAL ent_grid_unplace(int index) {
+	ent_grid_ent_t *r = &ents[index];
+	int x, y, moved;
+
+	if(r->where == GRID_CELLS) {
+		for(y=r->y0; y <= r->y1; y++)
+			for(x=r->x0; x <= r->x1; x++)
+				ent_cell_remove(ent_grid_cell(x, y), index);
+	}
+	else if(r->where == GRID_ALWAYS) {
+		moved=always.ents[--always.num];
+		always.ents[r->always_pos]=moved;
+		ents[moved].always_pos=r->always_pos;
+	}
+	r->where=GRID_NONE;
+}
+
+static mBOOL DLLINTERNAL ent_grid_add_cells(int index) {
+	const ent_grid_ent_t *r = &ents[index];
+	int x, y;
+
+	for(y=r->y0; y <= r->y1; y++) {
+		for(x=r->x0; x <= r->x1; x++) {
+			if(!ent_cell_add(ent_grid_cell(x, y), index))
+				return(mFALSE);
+		}
+	}
+	return(mTRUE);
+}
+
+// Put edict where its current state belongs.
+static void DLLINTERNAL ent_grid_place(int index) {
+	const edict_t *pEdict = edict_base + index;
+	ent_grid_ent_t *r = &ents[index];
+	const float *vel;
+	int where, x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+	where=GRID_NONE;
+	if(index <= max_clients) {
+		// may enter game between refreshes; tested as it is at query
+		if(!pEdict->free)
+			where=GRID_ALWAYS;
+	}
+	else if(ent_grid_valid(index, pEdict)) {
+		vel=pEdict->v.velocity;
+		if(pEdict->v.movetype == MOVETYPE_FOLLOW 
+				|| (vel[0]*vel[0] + vel[1]*vel[1] + vel[2]*vel[2]) * (ENT_GRID_MAX_FRAMETIME * ENT_GRID_MAX_FRAMETIME) 
+					> ENT_GRID_SLACK * ENT_GRID_SLACK)
+			where=GRID_ALWAYS;
+		else {
+			x0=ent_grid_coord(pEdict->v.absmin[0]);
+			y0=ent_grid_coord(pEdict->v.absmin[1]);
+			x1=ent_grid_coord(pEdict->v.absmax[0]);
+			y1=ent_grid_coord(pEdict->v.absmax[1]);
+			if(x1 < x0 || y1 < y0 || (x1 - x0 + 1) * (y1 - y0 + 1) > ENT_GRID_MAX_CELLS)
+				where=GRID_ALWAYS;
+			else
+				where=GRID_CELLS;
+		}
+	}
+
+	if(likely(where == r->where)) {
+		if(where != GRID_CELLS || (x0 == r->x0 && y0 == r->y0 && x1 == r->x1 && y1 == r->y1))
+			return;
+	}
+	ent_grid_unplace(index);
+	stat_moves++;
+
+	if(where == GRID_CELLS) {
+		r->x0=x0; r->y0=y0; r->x1=x1; r->y1=y1;
+		r->where=GRID_CELLS;
+		if(likely(ent_grid_add_cells(index)))
+			return;
+		ent_grid_unplace(index);
+		where=GRID_ALWAYS;
+	}
+	if(where == GRID_ALWAYS) {
+		if(!ent_cell_add(&always, index)) {
+			META_WARNING("Entity grid: out of memory; entity %d left out", index);
+			return;
+		}
+		r->always_pos=always.num - 1;
+		r->where=GRID_ALWAYS;
+	}
+}
+
+static void DLLINTERNAL ent_grid_deactivate(void) {
+	unsigned int i;
+	int c;
+
+	if(!ent_grid_active)
+		return;
+	ent_grid_active=0;
+	for(i=0; i < sizeof(ent_grid_funcs) / sizeof(ent_grid_funcs[0]); i++)
+		api_hook_internal_ref(ent_grid_funcs[i].api, ent_grid_funcs[i].offset, -1);
+	for(c=0; c < ENT_GRID_SIZE * ENT_GRID_SIZE; c++)
+		free(cells[c].ents);
+	free(cells);
+	cells=NULL;
+	free(ents);
+	ents=NULL;
+	num_ents=0;
+	always.num=0;
+	edict_base=NULL;
+	META_DEBUG(2, ("Entity grid dropped"));
+}
+
+// Build grid from current edicts.
+static mBOOL DLLINTERNAL ent_grid_activate(void) {
+	unsigned int i;
+	int index;
+
+	if(ent_grid_active)
+		return(mTRUE);
+	edict_base=(*g_engfuncs.pfnPEntityOfEntOffset)(0);
+	if(!edict_base || gpGlobals->maxEntities <= 0)
+		return(mFALSE);
+	num_ents=gpGlobals->maxEntities;
+	max_clients=gpGlobals->maxClients;
+	cells=(ent_cell_t *)calloc(ENT_GRID_SIZE * ENT_GRID_SIZE, sizeof(ent_cell_t));
+	ents=(ent_grid_ent_t *)calloc(num_ents, sizeof(ent_grid_ent_t));
+	if(!cells || !ents) {
+		free(cells);
+		cells=NULL;
+		free(ents);
+		ents=NULL;
+		RETURN_ERRNO(mFALSE, ME_NOMEM);
+	}
+	ent_grid_active=1;
+	for(i=0; i < sizeof(ent_grid_funcs) / sizeof(ent_grid_funcs[0]); i++)
+		api_hook_internal_ref(ent_grid_funcs[i].api, ent_grid_funcs[i].offset, 1);
+
+	for(index=1; index < num_ents; index++)
+		ent_grid_place(index);
+	last_query_time=gpGlobals->time;
+	stat_builds++;
+	META_DEBUG(2, ("Entity grid built; %d edicts", num_ents));
+	return(mTRUE);
+}
+
+void DLLINTERNAL ent_grid_update(const edict_t *pEdict) {
+	int index;
+
+	if(!ent_grid_active || !pEdict)
+		return;
+	index = pEdict - edict_base;
+	if(index > 0 && index < num_ents)
+		ent_grid_place(index);
+}
+
+void DLLINTERNAL ent_grid_frame(void) {
+	int index;
+
+	if(!ent_grid_active)
+		return;
+	if(gpGlobals->time - last_query_time > ENT_GRID_IDLE || gpGlobals->time < last_query_time 
+			|| (*g_engfuncs.pfnPEntityOfEntOffset)(0) != edict_base) {
+		ent_grid_deactivate();
+		return;
+	}
+	for(index=1; index < num_ents; index++)
+		ent_grid_place(index);
+}
+
+void DLLINTERNAL ent_grid_level_change(void) {
+	ent_grid_deactivate();
+}
+
+static inline void DLLINTERNAL ent_grid_test(int index, const float *origin, float rad2) {
+	const edict_t *pEdict = edict_base + index;
+
+	stat_tested++;
+	if(ent_grid_valid(index, pEdict) && ent_grid_hit(pEdict, origin, rad2))
+		ent_cell_add(&found, index);
+}
+
+static int ent_grid_compare(const void *a, const void *b) {
+	return(*(const int *)a - *(const int *)b);
+}
+
+int DLLINTERNAL ent_grid_query(const float *origin, float radius, edict_t **list, int max) {
+	const ent_cell_t *cell;
+	float rad2, r;
+	int x, y, x0, y0, x1, y1, i, index;
+
+	if(!origin || !list || max <= 0 || !(radius >= 0.0f))
+		return(0);
+	if(!ent_grid_activate())
+		return(0);
+	last_query_time=gpGlobals->time;
+	stat_queries++;
+	if(unlikely(++query_stamp == 0)) {
+		for(index=0; index < num_ents; index++)
+			ents[index].stamp=0;
+		query_stamp=1;
+	}
+	found.num=0;
+	rad2 = radius * radius;
+	r = radius + ENT_GRID_SLACK;
+
+	x0=ent_grid_coord(origin[0] - r);
+	y0=ent_grid_coord(origin[1] - r);
+	x1=ent_grid_coord(origin[0] + r);
+	y1=ent_grid_coord(origin[1] + r);
+	if((x1 - x0 + 1) * (y1 - y0 + 1) > ENT_GRID_SIZE * ENT_GRID_SIZE / 4) {
+		// covers much of the map; plain scan is cheaper
+		for(index=1; index < num_ents; index++) {
+			if(ents[index].where == GRID_CELLS)
+				ent_grid_test(index, origin, rad2);
+		}
+	}
+	else {
+		for(y=y0; y <= y1; y++) {
+			for(x=x0; x <= x1; x++) {
+				cell=ent_grid_cell(x, y);
+				for(i=0; i < cell->num; i++) {
+					index=cell->ents[i];
+					if(ents[index].stamp == query_stamp)
+						continue;
+					ents[index].stamp=query_stamp;
+					ent_grid_test(index, origin, rad2);
+				}
+			}
+		}
+	}
+	for(i=0; i < always.num; i++)
+		ent_grid_test(always.ents[i], origin, rad2);
+
+	if(found.num > 1)
+		qsort(found.ents, found.num, sizeof(int), ent_grid_compare);
+	if(found.num < max)
+		max=found.num;
+	for(i=0; i < max; i++)
+		list[i]=(edict_t *)(edict_base + found.ents[i]);
+	stat_found += max;
+	return(max);
+}
+
+// Time sphere queries around entities of current map, by engine's scan
+// and by grid.
+static void DLLINTERNAL ent_grid_bench(float radius, int queries) {
+	const edict_t *pEdict;
+	edict_t **list;
+	float *centers, *org;
+	unsigned long long t0, t_engine, t_grid;
+	unsigned long long n_engine = 0, n_grid = 0;
+	int index, i, n, clients;
+
+	if(!ent_grid_activate()) {
+		META_CONS("Entity grid: no map running");
+		return;
+	}
+	centers=(float *)malloc(num_ents * 3 * sizeof(float));
+	list=(edict_t **)malloc(num_ents * sizeof(edict_t *));
+	if(!centers || !list) {
+		free(centers);
+		free(list);
+		META_CONS("Entity grid: out of memory");
+		return;
+	}
+	for(index=1, n=0, clients=0; index < num_ents; index++) {
+		pEdict=edict_base + index;
+		if(!ent_grid_valid(index, pEdict))
+			continue;
+		if(index <= max_clients)
+			clients++;
+		for(i=0; i < 3; i++)
+			centers[n * 3 + i] = (pEdict->v.absmin[i] + pEdict->v.absmax[i]) * 0.5f;
+		n++;
+	}
+	if(!n) {
+		META_CONS("Entity grid: no entities");
+		free(centers);
+		free(list);
+		return;
+	}
+
+	t0=GET_TSC();
+	for(i=0; i < queries; i++) {
+		org=&centers[(i % n) * 3];
+		// engine returns worldspawn when nothing is left
+		for(pEdict=(*g_engfuncs.pfnFindEntityInSphere)(NULL, org, radius); pEdict && pEdict != edict_base; 
+				pEdict=(*g_engfuncs.pfnFindEntityInSphere)((edict_t *)pEdict, org, radius))
+			n_engine++;
+	}
+	t_engine=GET_TSC() - t0;
+
+	t0=GET_TSC();
+	for(i=0; i < queries; i++)
+		n_grid += ent_grid_query(&centers[(i % n) * 3], radius, list, num_ents);
+	t_grid=GET_TSC() - t0;
+
+	META_CONS("Sphere queries of radius %.0f around %d entities (%d clients), %d queries:", radius, n, clients, queries);
+	META_CONS("  %-8s %14s %12s", "", "ticks/query", "found");
+	META_CONS("  %-8s %14.0f %12llu", "engine", (double)t_engine / queries, n_engine);
+	META_CONS("  %-8s %14.0f %12llu", "grid", (double)t_grid / queries, n_grid);
+	if(t_grid)
+		META_CONS("  grid is %.2fx engine's speed", (double)t_engine / t_grid);
+	free(centers);
+	free(list);
+}
+
+// "meta entgrid" console command.
+void DLLINTERNAL cmd_meta_entgrid(void) {
+	int argc, queries, index, in_cells, c, used;
+	float radius;
+
+	argc=CMD_ARGC();
+	if(argc == 2) {
+		if(!ent_grid_active) {
+			META_CONS("Entity grid not in use; built %lu times", stat_builds);
+			return;
+		}
+		for(index=1, in_cells=0; index < num_ents; index++) {
+			if(ents[index].where == GRID_CELLS)
+				in_cells++;
+		}
+		for(c=0, used=0; c < ENT_GRID_SIZE * ENT_GRID_SIZE; c++) {
+			if(cells[c].num)
+				used++;
+		}
+		META_CONS("Entity grid: %d entities in %d of %d cells, %d tested on every query", 
+				in_cells, used, ENT_GRID_SIZE * ENT_GRID_SIZE, always.num);
+		META_CONS("%llu queries, %.1f entities tested and %.1f found per query, %llu moves, built %lu times", 
+				stat_queries, stat_queries ? (double)stat_tested / stat_queries : 0.0, 
+				stat_queries ? (double)stat_found / stat_queries : 0.0, stat_moves, stat_builds);
+		return;
+	}
+	if(argc > 5 || strcasecmp(CMD_ARGV(2), "bench")) {
+		META_CONS("usage: meta entgrid [bench [<radius> [<queries>]]]");
+		return;
+	}
+	radius = (argc > 3) ? atof(CMD_ARGV(3)) : 512.0f;
+	queries = (argc > 4) ? atoi(CMD_ARGV(4)) : 10000;
+	if(radius <= 0.0f || queries <= 0) {
+		META_CONS("usage: meta entgrid [bench [<radius> [<queries>]]]");
+		return;
+	}
+	ent_grid_bench(radius, queries);
+}
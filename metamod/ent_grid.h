@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef ENT_GRID_H
+#define ENT_GRID_H
+
+#include <extdll.h>			// edict_t
+
+#include "comp_dep.h"
+
+// Spatial grid of entities, for sphere queries.
+//  FIND_ENTITY_IN_SPHERE has engine walk every edict for every result, so
+//  plugins collecting entities around a point pay for all edicts, over
+//  and over.  FIND_ENTITIES_IN_SPHERE answers from a uniform grid of
+//  cells on the horizontal plane instead, testing only entities in the
+//  cells the sphere overlaps, and returns all of them at once, in edict
+//  index order.  Test is the same as engine's: distance from center to
+//  the nearest point of entity's absmin/absmax box.
+//
+//  Grid is refreshed from edict state on every StartFrame, and for single
+//  edicts after gamedll's SetOrigin and SetSize calls.  Entities moving
+//  between refreshes are covered by growing query bounds by
+//  ENT_GRID_SLACK units; entities that may move farther than that in a
+//  frame (fast ones, MOVETYPE_FOLLOW, clients) and very large ones aren't
+//  put in cells but tested on every query.  Bounds and state are always
+//  tested as they are at query time.
+//
+//  Grid is built on first query, and dropped after ENT_GRID_IDLE seconds
+//  without queries, and on level change.
+
+// nonzero while grid is kept
+extern int ent_grid_active DLLHIDDEN;
+
+// refresh edict's cells, after call that may have moved it
+void DLLINTERNAL ent_grid_update(const edict_t *pEdict);
+
+// refresh, on StartFrame
+void DLLINTERNAL ent_grid_frame(void);
+
+// drop grid, on level change
+void DLLINTERNAL ent_grid_level_change(void);
+
+// Store up to max entities within radius of origin to list, in edict
+// index order; returns number stored.
+int DLLINTERNAL ent_grid_query(const float *origin, float radius, edict_t **list, int max);
+
+void DLLINTERNAL cmd_meta_entgrid(void);
+
+#endif /* ENT_GRID_H */
@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// malloc, free, etc
+#include <string.h>			// strcmp, memset, etc
+
+#include <extdll.h>			// always
+
+#include "ent_index.h"		// me
+#include "api_hook.h"		// api_hook_internal_ref
+#include "metamod.h"		// gpGlobals
+#include "log_meta.h"		// META_CONS, META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely
+
+// name hash table size, power of 2
+#define ENT_NAME_HASH 1024
+
+typedef struct ent_name_s {
+	struct ent_name_s *next;		// hash chain
+	int id;
+	int head[NUM_ENTKEYS];			// first and last edict index in
+	int tail[NUM_ENTKEYS];			//  list of each key, -1 if empty
+	int count[NUM_ENTKEYS];
+	char name[1];
+} ent_name_t;
+
+typedef struct ent_slot_s {
+	string_t str[NUM_ENTKEYS];		// string_t indexed under
+	int id[NUM_ENTKEYS];			// name id; 0 if not in a list
+	int prev[NUM_ENTKEYS];			// neighbours in list, -1 at ends
+	int next[NUM_ENTKEYS];
+} ent_slot_t;
+
+int ent_index_active = 0;
+
+static ent_name_t *name_hash[ENT_NAME_HASH];
+static ent_name_t **names = NULL;		// by id
+static int num_names = 0;				// highest id
+static int max_names = 0;
+
+static ent_slot_t *slots = NULL;		// by edict index
+static int num_slots = 0;
+
+// engine's edict array; moves on level change
+static const edict_t *edict_base = NULL;
+
+static int num_indexed[NUM_ENTKEYS];
+static unsigned long long stat_lookups = 0;
+static unsigned long long stat_stale = 0;
+static unsigned long long stat_updates = 0;
+static unsigned long long stat_sweep_fixes = 0;
+
+static const char * const entkey_names[NUM_ENTKEYS] = {
+	"classname",
+	"targetname",
+	"target",
+};
+
+// Functions whose calls update the index.
+static const struct {
+	enum_api_t api;
+	unsigned int offset;
+} ent_index_funcs[] = {
+	{ e_api_dllapi, offsetof(DLL_FUNCTIONS, pfnSpawn) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnCreateNamedEntity) },
+	{ e_api_engine, offsetof(enginefuncs_t, pfnRemoveEntity) },
+	{ e_api_newapi, offsetof(NEW_DLL_FUNCTIONS, pfnOnFreeEntPrivateData) },
+};
+
+
+static inline unsigned int DLLINTERNAL ent_name_hash(const char *name) {
+	unsigned int h = 5381;
+
+	while(*name)
+		h = h * 33 + (unsigned char)*name++;
+	return(h & (ENT_NAME_HASH - 1));
+}
+
+static ent_name_t * DLLINTERNAL ent_name_find(const char *name) {
+	ent_name_t *n;
+
+	for(n=name_hash[ent_name_hash(name)]; n; n=n->next) {
+		if(!strcmp(n->name, name))
+			return(n);
+	}
+	return(NULL);
+}
+
+static ent_name_t * DLLINTERNAL ent_name_intern(const char *name) {
+	ent_name_t *n, **newnames;
+	unsigned int h;
+	int len, k, newmax;
+
+	n=ent_name_find(name);
+	if(likely(n != NULL))
+		return(n);
+
+	if(num_names + 1 >= max_names) {
+		newmax = max_names ? max_names * 2 : 256;
+		newnames=(ent_name_t **)realloc(names, newmax * sizeof(ent_name_t *));
+		if(!newnames)
+			RETURN_ERRNO(NULL, ME_NOMEM);
+		names=newnames;
+		max_names=newmax;
+	}
+	len=strlen(name);
+	n=(ent_name_t *)calloc(1, sizeof(ent_name_t) + len);
+	if(!n)
+		RETURN_ERRNO(NULL, ME_NOMEM);
+	memcpy(n->name, name, len + 1);
+	for(k=0; k < NUM_ENTKEYS; k++) {
+		n->head[k]=-1;
+		n->tail[k]=-1;
+	}
+	n->id=++num_names;
+	names[n->id]=n;
+	h=ent_name_hash(name);
+	n->next=name_hash[h];
+	name_hash[h]=n;
+	return(n);
+}
+
+static inline string_t DLLINTERNAL ent_key_string(const edict_t *pEdict, int key) {
+	if(pEdict->free)
+		return(0);
+	switch(key) {
+		case ENTKEY_CLASSNAME:
+			return(pEdict->v.classname);
+		case ENTKEY_TARGETNAME:
+			return(pEdict->v.targetname);
+		default:
+			return(pEdict->v.target);
+	}
+}
+
+// Make room for all edicts of current map.
+static mBOOL DLLINTERNAL ent_index_alloc(void) {
+	ent_slot_t *newslots;
+	int newnum;
+
+	newnum = gpGlobals->maxEntities;
+	if(likely(newnum <= num_slots))
+		return(mTRUE);
+	newslots=(ent_slot_t *)realloc(slots, newnum * sizeof(ent_slot_t));
+	if(!newslots)
+		return(mFALSE);
+	memset(&newslots[num_slots], 0, (newnum - num_slots) * sizeof(ent_slot_t));
+	slots=newslots;
+	num_slots=newnum;
+	return(mTRUE);
+}
+
+// Index of edict in engine's edict array, or -1.
+static int DLLINTERNAL ent_index_of(const edict_t *pEdict) {
+	int index;
+
+	index = pEdict - edict_base;
+	if(unlikely(!edict_base || index < 0 || index >= num_slots)) {
+		edict_base = (*g_engfuncs.pfnPEntityOfEntOffset)(0);
+		if(!ent_index_alloc())
+			return(-1);
+		index = pEdict - edict_base;
+		if(!edict_base || index < 0 || index >= num_slots)
+			return(-1);
+	}
+	return(index);
+}
+
+static void DLLINTERNAL ent_slot_unlink(int index, int key) {
+	ent_slot_t *s = &slots[index];
+	ent_name_t *n;
+
+	if(!s->id[key])
+		return;
+	n=names[s->id[key]];
+	if(s->prev[key] >= 0)
+		slots[s->prev[key]].next[key]=s->next[key];
+	else
+		n->head[key]=s->next[key];
+	if(s->next[key] >= 0)
+		slots[s->next[key]].prev[key]=s->prev[key];
+	else
+		n->tail[key]=s->prev[key];
+	n->count[key]--;
+	num_indexed[key]--;
+	s->id[key]=0;
+}
+
+// Insert edict to name's list, keeping edict index order.  Edicts are
+// mostly spawned in index order, so usually it's appended.
+static void DLLINTERNAL ent_slot_link(int index, int key, ent_name_t *n) {
+	ent_slot_t *s = &slots[index];
+	int prev, next;
+
+	if(n->tail[key] < index) {
+		prev=n->tail[key];
+		next=-1;
+	}
+	else {
+		for(next=n->head[key]; next < index; next=slots[next].next[key])
+			;
+		prev=slots[next].prev[key];
+	}
+	s->prev[key]=prev;
+	s->next[key]=next;
+	if(prev >= 0)
+		slots[prev].next[key]=index;
+	else
+		n->head[key]=index;
+	if(next >= 0)
+		slots[next].prev[key]=index;
+	else
+		n->tail[key]=index;
+	s->id[key]=n->id;
+	n->count[key]++;
+	num_indexed[key]++;
+}
+
+// Bring edict's entries up to date; returns number of keys changed.
+static int DLLINTERNAL ent_slot_update(int index) {
+	const edict_t *pEdict = edict_base + index;
+	ent_slot_t *s = &slots[index];
+	ent_name_t *n;
+	const char *str;
+	string_t value;
+	int key, changed = 0;
+
+	for(key=0; key < NUM_ENTKEYS; key++) {
+		value=ent_key_string(pEdict, key);
+		if(likely(value == s->str[key]))
+			continue;
+		s->str[key]=value;
+		str = value ? STRING(value) : NULL;
+		n = (str && str[0]) ? ent_name_intern(str) : NULL;
+		if(n && n->id == s->id[key])
+			continue;
+		ent_slot_unlink(index, key);
+		if(n)
+			ent_slot_link(index, key, n);
+		changed++;
+	}
+	return(changed);
+}
+
+static void DLLINTERNAL ent_slot_clear(int index) {
+	int key;
+
+	for(key=0; key < NUM_ENTKEYS; key++) {
+		ent_slot_unlink(index, key);
+		slots[index].str[key]=0;
+	}
+}
+
+// Start keeping the index, on first use.
+static void DLLINTERNAL ent_index_activate(void) {
+	unsigned int i;
+
+	if(likely(ent_index_active))
+		return;
+	ent_index_active=1;
+	// hook functions update the index; keep them out of passthrough
+	for(i=0; i < sizeof(ent_index_funcs) / sizeof(ent_index_funcs[0]); i++)
+		api_hook_internal_ref(ent_index_funcs[i].api, ent_index_funcs[i].offset, 1);
+	edict_base=NULL;
+	ent_index_frame();
+	META_DEBUG(2, ("Entity index built; %d classnames, %d targetnames, %d targets", 
+			num_indexed[ENTKEY_CLASSNAME], num_indexed[ENTKEY_TARGETNAME], num_indexed[ENTKEY_TARGET]));
+}
+
+void DLLINTERNAL ent_index_update(const edict_t *pEdict) {
+	int index;
+
+	if(unlikely(!pEdict))
+		return;
+	index=ent_index_of(pEdict);
+	if(index < 0)
+		return;
+	if(ent_slot_update(index))
+		stat_updates++;
+}
+
+void DLLINTERNAL ent_index_remove(const edict_t *pEdict) {
+	int index;
+
+	// Nothing indexed yet on this map; edicts of old map are freed after
+	// level change, and mustn't make us pick up the old edict array.
+	if(unlikely(!pEdict || !edict_base))
+		return;
+	index=ent_index_of(pEdict);
+	if(index >= 0)
+		ent_slot_clear(index);
+}
+
+void DLLINTERNAL ent_index_frame(void) {
+	const edict_t *base;
+	int i, max;
+
+	if(!ent_index_active)
+		return;
+	base=(*g_engfuncs.pfnPEntityOfEntOffset)(0);
+	if(unlikely(base != edict_base)) {
+		ent_index_level_change();
+		edict_base=base;
+	}
+	if(!edict_base || !ent_index_alloc())
+		return;
+	max = gpGlobals->maxEntities;
+	for(i=0; i < max; i++) {
+		if(unlikely(ent_slot_update(i)))
+			stat_sweep_fixes++;
+	}
+}
+
+void DLLINTERNAL ent_index_level_change(void) {
+	int i, key;
+
+	// ids stay; string_t values and edicts are reused by next map
+	if(slots)
+		memset(slots, 0, num_slots * sizeof(ent_slot_t));
+	for(i=1; i <= num_names; i++) {
+		for(key=0; key < NUM_ENTKEYS; key++) {
+			names[i]->head[key]=-1;
+			names[i]->tail[key]=-1;
+			names[i]->count[key]=0;
+		}
+	}
+	memset(num_indexed, 0, sizeof(num_indexed));
+	edict_base=NULL;
+}
+
+int DLLINTERNAL ent_index_string_id(const char *str) {
+	ent_name_t *n;
+
+	if(!str || !str[0])
+		return(0);
+	ent_index_activate();
+	n=ent_name_intern(str);
+	return(n ? n->id : 0);
+}
+
+int DLLINTERNAL ent_index_key_id(const edict_t *pEdict, entkey_t key) {
+	ent_name_t *n;
+	string_t value;
+	int index;
+
+	if(!pEdict || (unsigned int)key >= NUM_ENTKEYS)
+		return(0);
+	ent_index_activate();
+	index=ent_index_of(pEdict);
+	if(likely(index >= 0)) {
+		ent_slot_update(index);
+		return(slots[index].id[key]);
+	}
+	value=ent_key_string(pEdict, key);
+	if(!value || !STRING(value)[0])
+		return(0);
+	n=ent_name_intern(STRING(value));
+	return(n ? n->id : 0);
+}
+
+edict_t * DLLINTERNAL ent_index_find(const edict_t *pStart, entkey_t key, int id) {
+	const edict_t *pEdict;
+	ent_name_t *n;
+	int start, i, next;
+
+	if((unsigned int)key >= NUM_ENTKEYS || id <= 0 || id > num_names)
+		return(NULL);
+	ent_index_activate();
+	stat_lookups++;
+	if(pStart) {
+		start=ent_index_of(pStart);
+		if(start < 0)
+			return(NULL);
+	}
+	else {
+		// as FIND_ENTITY_BY_STRING, start after worldspawn
+		if(ent_index_of((*g_engfuncs.pfnPEntityOfEntOffset)(0)) < 0)
+			return(NULL);
+		start=0;
+	}
+
+	n=names[id];
+	if(start > 0 && slots[start].id[key] == id)
+		i=slots[start].next[key];
+	else {
+		for(i=n->head[key]; i >= 0 && i <= start; i=slots[i].next[key])
+			;
+	}
+
+	while(i >= 0) {
+		pEdict = edict_base + i;
+		if(likely(ent_key_string(pEdict, key) == slots[i].str[key]))
+			return((edict_t *)pEdict);
+		// renamed or freed since last sweep
+		stat_stale++;
+		next=slots[i].next[key];
+		ent_slot_update(i);
+		if(slots[i].id[key] == id)
+			return((edict_t *)pEdict);
+		i=next;
+	}
+	return(NULL);
+}
+
+edict_t * DLLINTERNAL ent_index_find_name(const edict_t *pStart, entkey_t key, const char *name) {
+	ent_name_t *n;
+
+	if(!name || !name[0])
+		return(NULL);
+	// names are interned by the first sweep
+	ent_index_activate();
+	n=ent_name_find(name);
+	if(!n)
+		return(NULL);
+	return(ent_index_find(pStart, key, n->id));
+}
+
+// "meta entindex" console command.
+void DLLINTERNAL cmd_meta_entindex(void) {
+	int key;
+
+	if(!ent_index_active) {
+		META_CONS("Entity index not in use");
+		return;
+	}
+	META_CONS("Entity index: %d names, %d edicts", num_names, num_slots);
+	for(key=0; key < NUM_ENTKEYS; key++)
+		META_CONS("  %-10s %6d entities", entkey_names[key], num_indexed[key]);
+	META_CONS("%llu lookups, %llu stale entries met, %llu hook updates, %llu sweep fixes", 
+			stat_lookups, stat_stale, stat_updates, stat_sweep_fixes);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef ENT_INDEX_H
+#define ENT_INDEX_H
+
+#include <extdll.h>			// edict_t
+
+#include "mutil.h"			// entkey_t
+#include "comp_dep.h"
+
+// Entity index by classname, targetname and target.
+//  Plugins looking up entities by name with FIND_ENTITY_BY_STRING have
+//  engine compare strings of every edict for every lookup.  Instead,
+//  metamod keeps, per key, a list of edicts for each name, in edict index
+//  order, so FIND_ENTITY_BY_KEY walks only the matching edicts and never
+//  enters engine.
+//
+//  Names are interned to integer ids, valid until server shutdown, so
+//  plugins can compare entities by id (GET_ENTITY_KEY_ID) instead of by
+//  string.  Per edict the index keeps the string_t each key was indexed
+//  under; an edict whose string_t changed is reindexed when met.
+//
+//  Lists are updated after Spawn, CreateNamedEntity and RemoveEntity
+//  calls of gamedll and on OnFreeEntPrivateData, and every frame a sweep
+//  compares string_t's of all edicts, to catch names set by gamedll or
+//  plugins afterwards, and entities that plugins created by calling
+//  engine directly.  So an entity whose name was set in the current frame
+//  outside of those calls may be missing from lookups until next frame.
+//
+//  Index is built when a plugin first uses it, and kept from then on.
+
+#define NUM_ENTKEYS 3
+
+// nonzero once index is in use
+extern int ent_index_active DLLHIDDEN;
+
+// (re)index edict, after call that may have changed it
+void DLLINTERNAL ent_index_update(const edict_t *pEdict);
+
+// drop edict from index, before it's freed
+void DLLINTERNAL ent_index_remove(const edict_t *pEdict);
+
+// sweep of all edicts, on StartFrame
+void DLLINTERNAL ent_index_frame(void);
+
+// drop entities of old map, on level change
+void DLLINTERNAL ent_index_level_change(void);
+
+// Id of name; creates one if needed.  0 for NULL or empty name.
+int DLLINTERNAL ent_index_string_id(const char *str);
+
+// Id of edict's name under key; 0 if none.
+int DLLINTERNAL ent_index_key_id(const edict_t *pEdict, entkey_t key);
+
+// Next edict after pStart (NULL to start from first) whose name under
+// key has given id or name; NULL if none left.
+edict_t * DLLINTERNAL ent_index_find(const edict_t *pStart, entkey_t key, int id);
+edict_t * DLLINTERNAL ent_index_find_name(const edict_t *pStart, entkey_t key, const char *name);
+
+void DLLINTERNAL cmd_meta_entindex(void);
+
+#endif /* ENT_INDEX_H */
@@ -34,15 +34,115 @@
  *
  */
 
+#include <stdio.h>				// fopen, fgets, etc
+#include <stdlib.h>				// calloc, free
+#include <sys/types.h>				// stat
+#include <sys/stat.h>				// stat
+
 #include <extdll.h>				// always
 #include "osdep_p.h"				// is_gamedll, ...
 #include "game_autodetect.h"			// me
 #include "support_meta.h"			// full_gamedir_path,
 
 
+// Verdicts of is_gamedll(), kept in AUTODETECT_CACHE between runs, so
+// the libraries in gamedir/dlls are only scanned again when they change.
+// Entries are keyed by path, and only used while size, mtime and inode
+// still match.  One line per library:
+//   <verdict> <size> <mtime> <inode> <path>
+typedef struct autodetect_entry_s {
+	int verdict;
+	long long size;
+	long mtime;
+	unsigned long inode;
+	char path[256];
+} autodetect_entry_t;
+
+static autodetect_entry_t *cache = NULL;
+static int cache_count = 0;
+static int cache_dirty = 0;
+
+static void DLLINTERNAL cache_load(const char *gamedir) {
+	char path[PATH_MAX];
+	char line[512];
+	autodetect_entry_t *ent;
+	FILE *fp;
+
+	cache = (autodetect_entry_t *)calloc(AUTODETECT_CACHE_MAX, sizeof(autodetect_entry_t));
+	cache_count = 0;
+	cache_dirty = 0;
+	if(!cache)
+		return;
+	safevoid_snprintf(path, sizeof(path), "%s/%s", gamedir, AUTODETECT_CACHE);
+	if(!(fp=fopen(path, "r")))
+		return;
+	while(cache_count < AUTODETECT_CACHE_MAX && fgets(line, sizeof(line), fp)) {
+		ent = &cache[cache_count];
+		if(sscanf(line, "%d %lld %ld %lu %255[^\r\n]", &ent->verdict, &ent->size, 
+					&ent->mtime, &ent->inode, ent->path) == 5)
+			cache_count++;
+	}
+	fclose(fp);
+	META_DEBUG(3, ("GameDLL-Autodetection: %d cached verdicts from %s", cache_count, path));
+}
+
+static void DLLINTERNAL cache_save(const char *gamedir) {
+	char path[PATH_MAX];
+	FILE *fp;
+	int i;
+
+	if(cache && cache_dirty) {
+		safevoid_snprintf(path, sizeof(path), "%s/%s", gamedir, AUTODETECT_CACHE);
+		if((fp=fopen(path, "w"))) {
+			for(i=0; i < cache_count; i++)
+				fprintf(fp, "%d %lld %ld %lu %s\n", cache[i].verdict, cache[i].size, 
+						cache[i].mtime, cache[i].inode, cache[i].path);
+			fclose(fp);
+		}
+		else
+			META_DEBUG(3, ("GameDLL-Autodetection: Couldn't write %s", path));
+	}
+	if(cache)
+		free(cache);
+	cache = NULL;
+	cache_count = 0;
+}
+
+// is_gamedll(), answered from cache if file is unchanged.
+static mBOOL DLLINTERNAL cached_is_gamedll(const char *filename) {
+	autodetect_entry_t *ent = NULL;
+	struct stat st;
+	int i;
+
+	if(!cache || stat(filename, &st) != 0)
+		return(is_gamedll(filename));
+	for(i=0; i < cache_count; i++) {
+		if(strmatch(cache[i].path, filename)) {
+			ent = &cache[i];
+			break;
+		}
+	}
+	if(ent && ent->size == (long long)st.st_size && ent->mtime == (long)st.st_mtime 
+			&& ent->inode == (unsigned long)st.st_ino) {
+		META_DEBUG(8, ("is_gamedll(%s): cached %d.", filename, ent->verdict));
+		return(ent->verdict ? mTRUE : mFALSE);
+	}
+	if(!ent && cache_count < AUTODETECT_CACHE_MAX)
+		ent = &cache[cache_count++];
+	if(!ent)
+		return(is_gamedll(filename));
+	ent->verdict = is_gamedll(filename) ? 1 : 0;
+	ent->size = st.st_size;
+	ent->mtime = st.st_mtime;
+	ent->inode = st.st_ino;
+	STRNCPY(ent->path, filename, sizeof(ent->path));
+	cache_dirty = 1;
+	return(ent->verdict ? mTRUE : mFALSE);
+}
+
 // Search gamedir/dlls/*.dll for gamedlls
 //TODO: add META_DEBUG
-const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char *knownfn)
+static const char * DLLINTERNAL find_gamedll(const gamedll_t *gamedll, const char *knownfn)
 {
 	static char buf[256];
 	char dllpath[256];
@@ -63,7 +163,7 @@ const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char
 	safevoid_snprintf(fnpath, sizeof(fnpath), "%s/%s", dllpath, knownfn);
 	
 	// Check if knownfn exists and is valid gamedll
-	if(is_gamedll(fnpath)) {
+	if(cached_is_gamedll(fnpath)) {
 		// knownfn exists and is loadable gamedll, return 0.
 		return(0);
 	}
@@ -111,7 +211,7 @@ const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char
 		safevoid_snprintf(fnpath, sizeof(fnpath), "%s/%s", dllpath, ent->d_name);
 		
 		// Check if dll is gamedll
-		if(is_gamedll(fnpath)) {
+		if(cached_is_gamedll(fnpath)) {
 			META_DEBUG(8, ("is_gamedll(%s): ok.", fnpath));
 			//gamedll detected
 			STRNCPY(buf, ent->d_name, sizeof(buf));
@@ -128,3 +228,13 @@ const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char
 	return(0);
 }
 
+
+const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char *knownfn)
+{
+	const char *found;
+
+	cache_load(gamedll->gamedir);
+	found = find_gamedll(gamedll, knownfn);
+	cache_save(gamedll->gamedir);
+	return(found);
+}
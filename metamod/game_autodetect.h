@@ -38,6 +38,11 @@
 #define GAME_AUTODETECT_H
 
 #include "metamod.h"
+
+// Cache of autodetection verdicts, in gamedir; see game_autodetect.cpp.
+#define AUTODETECT_CACHE		"addons/metamod/autodetect.cache"
+#define AUTODETECT_CACHE_MAX	256
+
 const char * DLLINTERNAL autodetect_gamedll(const gamedll_t *gamedll, const char *knownfn);
 
 #endif /*GAME_AUTODETECT_H*/
@@ -49,6 +49,12 @@
 //Initializes replacement code
 int DLLINTERNAL init_linkent_replacement(DLHANDLE moduleMetamod, DLHANDLE moduleGame);
 
+//Starts counting entity lookups for the next map; from ServerDeactivate
+void DLLINTERNAL linkent_level_change(void);
+
+//"meta linkents" console command
+void DLLINTERNAL cmd_meta_linkents(void);
+
 
 // Comments from SDK dlls/util.h:
 //! This is the glue that hooks .MAP entity class names to our CPP classes.
@@ -60,11 +66,9 @@ int DLLINTERNAL init_linkent_replacement(DLHANDLE moduleMetamod, DLHANDLE module
 typedef void (*ENTITY_FN) (entvars_t *);
 
 
-// For now, we have to explicitly export functions for plugin entities,
-// just as for gamedll entities.  Ideally, this could be generalized in
-// some manner, so that plugins can declare and use their own entities
-// without having them explicitly supported by metamod, but I don't know
-// yet if that is actually possible.
+// These are the entities of plugins that metamod exports explicitly,
+// just as for gamedll entities.  On linux, plugins can instead register
+// their own entity classes with REG_ENTITY_CLASS; see ent_class.h.
 //
 // LINK_ENTITY_TO_PLUGIN
 //  - if plugin not loaded & running, return
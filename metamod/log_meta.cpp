@@ -44,20 +44,12 @@
 #include "log_meta.h"			// me
 #include "osdep.h"				// win32 vsnprintf, etc
 #include "support_meta.h"		// MAX
+#include "log_queue.h"			// log_queue_msg, etc
 
 cvar_t meta_debug = {"meta_debug", "0", FCVAR_EXTDLL, 0, NULL};
 
 int meta_debug_value = 0; //meta_debug_value is converted from float(meta_debug.value) to int on every frame
 
-enum MLOG_SERVICE {
-	mlsCONS = 1,
-	mlsDEV,
-	mlsIWEL,
-	mlsCLIENT
-};
-
-static void buffered_ALERT(MLOG_SERVICE service, ALERT_TYPE atype, const char *prefix, const char *fmt, va_list ap);
-
 // Print to console.
 void DLLINTERNAL META_CONS(const char *fmt, ...) {
 	va_list ap;
@@ -90,7 +82,7 @@ void DLLINTERNAL META_DEV(const char *fmt, ...) {
 	}
 
 	va_start(ap, fmt);
-	buffered_ALERT(mlsDEV, at_logged, prefixDEV, fmt, ap);
+	log_queue_msg(at_logged, 1, prefixDEV, fmt, ap);
 	va_end(ap);
 }
 
@@ -100,7 +92,7 @@ void DLLINTERNAL META_INFO(const char *fmt, ...) {
 	va_list ap;
 
 	va_start(ap, fmt);
-	buffered_ALERT(mlsIWEL, at_logged, prefixINFO, fmt, ap);
+	log_queue_msg(at_logged, 0, prefixINFO, fmt, ap);
 	va_end(ap);
 }
 
@@ -110,7 +102,7 @@ void DLLINTERNAL META_WARNING(const char *fmt, ...) {
 	va_list ap;
 
 	va_start(ap, fmt);
-	buffered_ALERT(mlsIWEL, at_logged, prefixWARNING, fmt, ap);
+	log_queue_msg(at_logged, 0, prefixWARNING, fmt, ap);
 	va_end(ap);
 }
 
@@ -120,7 +112,7 @@ void DLLINTERNAL META_ERROR(const char *fmt, ...) {
 	va_list ap;
 
 	va_start(ap, fmt);
-	buffered_ALERT(mlsIWEL, at_logged, prefixERROR, fmt, ap);
+	log_queue_msg(at_logged, 0, prefixERROR, fmt, ap);
 	va_end(ap);
 }
 
@@ -130,7 +122,7 @@ void DLLINTERNAL META_LOG(const char *fmt, ...) {
 	va_list ap;
 
 	va_start(ap, fmt);
-	buffered_ALERT(mlsIWEL, at_logged, prefixLOG, fmt, ap);
+	log_queue_msg(at_logged, 0, prefixLOG, fmt, ap);
 	va_end(ap);
 }
 
@@ -163,78 +155,20 @@ void DLLINTERNAL META_DEBUG_SET_LEVEL(int level) {
 }
 
 void DLLINTERNAL META_DO_DEBUG(const char *fmt, ...) {
-	char meta_debug_str[1024];
+	char head[32];
 	va_list ap;
 	
+	safevoid_snprintf(head, sizeof(head), "[META] (debug:%d)", debug_level);
 	va_start(ap, fmt);
-	safevoid_vsnprintf(meta_debug_str, sizeof(meta_debug_str), fmt, ap);
+	log_queue_msg(at_logged, 0, head, fmt, ap);
 	va_end(ap);
-	
-	ALERT(at_logged, "[META] (debug:%d) %s\n", debug_level, meta_debug_str);
 }
 
 #endif /*!__BUILD_FAST_METAMOD__*/
 
-class BufferedMessage : public class_metamod_new {
-public:
-	MLOG_SERVICE service;
-	ALERT_TYPE atype;
-	const char *prefix;
-	char buf[MAX_LOGMSG_LEN];
-	BufferedMessage *next;
-};
-
-static BufferedMessage *messageQueueStart = NULL;
-static BufferedMessage *messageQueueEnd   = NULL;
-
-static void buffered_ALERT(MLOG_SERVICE service, ALERT_TYPE atype, const char *prefix, const char *fmt, va_list ap) {
-	char buf[MAX_LOGMSG_LEN];
-	BufferedMessage *msg;
-
-	if (NULL != g_engfuncs.pfnAlertMessage) {
-		vsnprintf(buf, sizeof(buf), fmt, ap);
-		ALERT(atype, "%s %s\n", prefix, buf);
-		return;
-	}
-
-	// Engine AlertMessage function not available. Buffer message.
-	msg = new BufferedMessage;
-	if (NULL == msg) {
-		// though luck, gonna lose this message
-		return;
-	}
-	msg->service = service;
-	msg->atype = atype;
-	msg->prefix = prefix;
-	vsnprintf(msg->buf, sizeof(buf), fmt, ap);
-	msg->next = NULL;
-
-	if (NULL == messageQueueEnd) {
-		messageQueueStart = messageQueueEnd = msg;
-	} else {
-		messageQueueEnd->next = msg;
-		messageQueueEnd = msg;
-	}	
-} 
-
-
-// Flushes the message queue, printing messages to the respective
-// service. This function doesn't check anymore if the g_engfuncs
-// jumptable is set. Don't call it if it isn't set.
+// Flushes messages queued before engine's AlertMessage was available.
+// This function doesn't check anymore if the g_engfuncs jumptable is
+// set. Don't call it if it isn't set.
 void DLLINTERNAL flush_ALERT_buffer(void) {
-	BufferedMessage *msg = messageQueueStart;
-	int dev = (int) CVAR_GET_FLOAT("developer");
-
-	while (NULL != msg) {
-		if(msg->service == mlsDEV && dev==0) {
-			;
-		} else {
-			ALERT(msg->atype, "b>%s %s\n", msg->prefix, msg->buf);
-		}
-		messageQueueStart = messageQueueStart->next;
-		delete msg;
-		msg = messageQueueStart;
-	}
-
-	messageQueueStart = messageQueueEnd = NULL;
+	log_queue_flush();
 }
@@ -0,0 +1,821 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdio.h>			// snprintf, etc
+#include <stdarg.h>			// va_copy, etc
+#include <string.h>			// memcpy, memset, strlen
+#include <time.h>			// time
+
+#include <extdll.h>			// always
+#include "enginecallbacks.h"		// ALERT, etc
+
+#include "log_queue.h"		// me
+#include "log_meta.h"		// MAX_LOGMSG_LEN, META_CONS, etc
+#include "metamod.h"		// Config
+#include "conf_meta.h"		// MConfig
+#include "sdk_util.h"		// CVAR_GET_FLOAT
+#include "support_meta.h"	// STRNCPY
+#include "osdep.h"			// os_thread_start, os_sem_*, etc
+
+// Capture ring record.  Ring memory is kept zeroed outside of reserved
+// records, so 'state' reads LOGQ_FREE until writer has finished.
+typedef struct logq_rec_s {
+	unsigned int size;				// bytes, header included; multiple of 8
+	unsigned int volatile state;	// LOGQ_*
+} logq_rec_t;
+
+#define LOGQ_FREE	0
+#define LOGQ_READY	1
+#define LOGQ_PAD	2				// filler to end of ring
+
+// record flags
+#define LOGQF_DEFERRED	0x01		// format and arguments, else text
+#define LOGQF_DEV		0x02		// only if "developer" nonzero
+#define LOGQF_BUFFERED	0x04		// before engine's AlertMessage
+
+// formatted text for main thread
+typedef struct logq_out_s {
+	unsigned int size;				// bytes, header included; multiple of 8
+	unsigned char pad;				// filler to end of ring
+	unsigned char atype;
+	unsigned char dev;
+	unsigned char unused;
+} logq_out_t;
+
+#define LOGQ_ALIGN(n) (((n) + 7) & ~7)
+
+// longest record payload; longer are formatted on caller
+#define LOGQ_MAX_RECORD 4096
+
+// longest conversion specification, ie "%-08.*lld"
+#define LOGQ_MAX_SPEC 32
+
+static unsigned int logq_ring_mem[LOGQ_RING_SIZE / sizeof(unsigned int)];
+static unsigned char * const logq_ring = (unsigned char *)logq_ring_mem;
+static unsigned int volatile ring_head = 0;		// reserved up to
+static unsigned int volatile ring_tail = 0;		// consumed up to
+static unsigned int ring_high = 0;
+
+static unsigned int logq_out_mem[LOGQ_OUT_SIZE / sizeof(unsigned int)];
+static unsigned char * const logq_out = (unsigned char *)logq_out_mem;
+static unsigned int volatile out_head = 0;
+static unsigned int volatile out_tail = 0;
+
+// formatter thread
+static os_thread_t logq_thread;
+static os_sem_t logq_wake;
+static os_mutex_t logq_lock;		// consumer of ring; formatter or main thread
+static int logq_thread_running = 0;
+static int logq_thread_failed = 0;
+static int volatile logq_stopping = 0;
+static int volatile logq_kicked = 0;
+
+static unsigned long logq_main_tid = 0;
+static int logq_main_known = 0;
+
+// stats
+static unsigned long volatile logq_queued = 0;
+static unsigned long volatile logq_preformatted = 0;
+static unsigned long volatile logq_dropped = 0;
+static int volatile logq_drops_pending = 0;
+static unsigned long logq_delivered = 0;
+
+// per-plugin rate limit
+typedef struct logq_rate_s {
+	plid_t volatile plid;
+	int volatile lock;
+	time_t window;					// second counted
+	int count;
+	int suppressed;					// in 'window', not yet reported
+	unsigned long total;			// suppressed, ever
+	char tag[32];
+} logq_rate_t;
+
+static logq_rate_t logq_rates[LOGQ_RATE_SLOTS];
+
+
+inline int logq_is_main(void) {
+	return(!logq_main_known || os_thread_id() == logq_main_tid);
+}
+
+// Printf conversion argument classes.
+typedef enum {
+	LA_INT = 0,
+	LA_LONG,
+	LA_LLONG,
+	LA_DOUBLE,
+	LA_LDOUBLE,
+	LA_PTR,
+	LA_STR,
+} logq_arg_t;
+
+typedef struct logq_spec_s {
+	const char *start;		// '%'
+	int len;
+	int nstar;				// '*' width/precision arguments before value
+	logq_arg_t arg;
+} logq_spec_t;
+
+// Parse conversion specification; 'p' is just after '%'.  Returns end of
+// specification, or NULL for ones not deferred (positional, %n, wide).
+static const char * DLLINTERNAL logq_parse_spec(const char *p, logq_spec_t *spec) {
+	int lng=0, dbl=0;
+
+	spec->start=p-1;
+	spec->nstar=0;
+
+	while(*p && strchr("-+ #0'", *p))
+		p++;
+	if(*p=='*') {
+		spec->nstar++;
+		p++;
+	}
+	else {
+		while(*p >= '0' && *p <= '9')
+			p++;
+		if(*p=='$')
+			return(NULL);
+	}
+	if(*p=='.') {
+		p++;
+		if(*p=='*') {
+			spec->nstar++;
+			p++;
+		}
+		else {
+			while(*p >= '0' && *p <= '9')
+				p++;
+		}
+	}
+	for(;; p++) {
+		if(*p=='h')
+			;
+		else if(*p=='l' || *p=='z' || *p=='t')
+			lng++;
+		else if(*p=='q' || *p=='j')
+			lng=2;
+		else if(*p=='L')
+			dbl=lng=2;
+		else
+			break;
+	}
+
+	switch(*p) {
+		case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+			if(*p=='c' && lng)
+				return(NULL);
+			spec->arg = (lng >= 2) ? LA_LLONG : lng ? LA_LONG : LA_INT;
+			break;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			spec->arg = dbl ? LA_LDOUBLE : LA_DOUBLE;
+			break;
+		case 's':
+			if(lng)
+				return(NULL);
+			spec->arg = LA_STR;
+			break;
+		case 'p':
+			spec->arg = LA_PTR;
+			break;
+		default:
+			return(NULL);
+	}
+	p++;
+	spec->len = p - spec->start;
+	if(spec->len >= LOGQ_MAX_SPEC)
+		return(NULL);
+	return(p);
+}
+
+// Builds record payload in caller's buffer.
+class logq_writer {
+public:
+	inline logq_writer(unsigned char *buf, unsigned int size): start(buf), pos(buf), end(buf + size), overflow(0) {};
+	inline unsigned int length(void) const { return(pos - start); };
+	inline int is_overflow(void) const { return(overflow); };
+	inline void put(const void *data, unsigned int len) {
+		if(unlikely(len > (unsigned int)(end - pos))) {
+			overflow=1;
+			return;
+		}
+		memcpy(pos, data, len);
+		pos += len;
+	};
+	template<typename T> inline void put_val(T value) { put(&value, sizeof(value)); };
+	inline void put_str(const char *str) {
+		unsigned int len;
+
+		if(!str)
+			str="(null)";
+		for(len=0; len < MAX_LOGMSG_LEN - 1 && str[len]; len++)
+			;
+		put(str, len);
+		put("", 1);
+	};
+private:
+	unsigned char *start;
+	unsigned char *pos;
+	unsigned char *end;
+	int overflow;
+};
+
+// Reads record payload, in order written.
+class logq_reader {
+public:
+	inline logq_reader(const unsigned char *buf): pos(buf) {};
+	template<typename T> inline T get_val(void) {
+		T value;
+		memcpy(&value, pos, sizeof(value));
+		pos += sizeof(value);
+		return(value);
+	};
+	inline const char *get_str(void) {
+		const char *str = (const char *)pos;
+		pos += strlen(str) + 1;
+		return(str);
+	};
+private:
+	const unsigned char *pos;
+};
+
+// Copy arguments referenced by 'fmt'.  Returns 0 if format has
+// conversions that aren't deferred.
+static int DLLINTERNAL logq_capture_args(logq_writer *w, const char *fmt, va_list ap) {
+	logq_spec_t spec;
+	const char *p;
+	int i;
+
+	for(p=fmt; *p; ) {
+		if(*p++ != '%')
+			continue;
+		if(*p=='%') {
+			p++;
+			continue;
+		}
+		if(!(p=logq_parse_spec(p, &spec)))
+			return(0);
+		for(i=0; i < spec.nstar; i++)
+			w->put_val(va_arg(ap, int));
+		switch(spec.arg) {
+			case LA_INT: w->put_val(va_arg(ap, int)); break;
+			case LA_LONG: w->put_val(va_arg(ap, long)); break;
+			case LA_LLONG: w->put_val(va_arg(ap, long long)); break;
+			case LA_DOUBLE: w->put_val(va_arg(ap, double)); break;
+			case LA_LDOUBLE: w->put_val(va_arg(ap, long double)); break;
+			case LA_PTR: w->put_val(va_arg(ap, void *)); break;
+			case LA_STR: w->put_str(va_arg(ap, const char *)); break;
+		}
+	}
+	return(1);
+}
+
+template<typename T>
+static int logq_print(char *out, int left, const char *spec, int nstar, const int *star, T value) {
+	switch(nstar) {
+		case 0: return(snprintf(out, left, spec, value));
+		case 1: return(snprintf(out, left, spec, star[0], value));
+		default: return(snprintf(out, left, spec, star[0], star[1], value));
+	}
+}
+
+// Format deferred record text; mirror of logq_capture_args.
+static void DLLINTERNAL logq_format(logq_reader *r, const char *fmt, char *out, int size) {
+	char specbuf[LOGQ_MAX_SPEC];
+	logq_spec_t spec;
+	const char *p, *lit;
+	int star[2];
+	int pos, n, i;
+
+	pos=0;
+	for(p=fmt; *p && pos < size - 1; ) {
+		for(lit=p; *p && *p != '%'; p++)
+			;
+		n = p - lit;
+		if(n > size - 1 - pos)
+			n = size - 1 - pos;
+		memcpy(out + pos, lit, n);
+		pos += n;
+		if(!*p || pos >= size - 1)
+			break;
+
+		p++;
+		if(*p=='%') {
+			out[pos++]='%';
+			p++;
+			continue;
+		}
+		// parsed successfully at capture
+		p=logq_parse_spec(p, &spec);
+		memcpy(specbuf, spec.start, spec.len);
+		specbuf[spec.len]='\0';
+		for(i=0; i < spec.nstar; i++)
+			star[i]=r->get_val<int>();
+
+		switch(spec.arg) {
+			case LA_INT: n=logq_print(out + pos, size - pos, specbuf, spec.nstar, star, r->get_val<int>()); break;
+			case LA_LONG: n=logq_print(out + pos, size - pos, specbuf, spec.nstar, star, r->get_val<long>()); break;
+			case LA_LLONG: n=logq_print(out + pos, size - pos, specbuf, spec.nstar, star, r->get_val<long long>()); break;
+			case LA_DOUBLE: n=logq_print(out + pos, size - pos, specbuf, spec.nstar, star, r->get_val<double>()); break;
+			case LA_LDOUBLE: n=logq_print(out + pos, size - pos, specbuf, spec.nstar, star, r->get_val<long double>()); break;
+			case LA_PTR: n=logq_print(out + pos, size - pos, specbuf, spec.nstar, star, r->get_val<void *>()); break;
+			case LA_STR: n=logq_print(out + pos, size - pos, specbuf, spec.nstar, star, r->get_str()); break;
+			default: n=0; break;
+		}
+		// win32 _snprintf gives -1 when truncated
+		if(n < 0 || n >= size - pos)
+			n = size - 1 - pos;
+		pos += n;
+	}
+	out[pos]='\0';
+}
+
+// Reserve record of 'len' payload bytes in ring; NULL if full.
+static logq_rec_t * DLLINTERNAL logq_reserve(unsigned int len) {
+	unsigned int size, head, off, pad, used;
+	logq_rec_t *rec;
+
+	size = LOGQ_ALIGN(sizeof(logq_rec_t) + len);
+	do {
+		head = ring_head;
+		off = head & (LOGQ_RING_SIZE - 1);
+		pad = (off + size > LOGQ_RING_SIZE) ? LOGQ_RING_SIZE - off : 0;
+		used = head + pad + size - ring_tail;
+		if(used > LOGQ_RING_SIZE)
+			return(NULL);
+	} while(!os_atomic_cas(&ring_head, head, head + pad + size));
+
+	if(used > ring_high)
+		ring_high = used;
+
+	if(pad) {
+		rec = (logq_rec_t *)(logq_ring + off);
+		rec->size = pad;
+		os_memory_barrier();
+		rec->state = LOGQ_PAD;
+	}
+	rec = (logq_rec_t *)(logq_ring + ((head + pad) & (LOGQ_RING_SIZE - 1)));
+	rec->size = size;
+	return(rec);
+}
+
+// Queue formatted text; formatter or main thread, with ring consumer
+// role.  Returns 0 if full.
+static int DLLINTERNAL logq_out_put(int atype, int dev, const char *line, int len) {
+	unsigned int size, head, off, pad;
+	logq_out_t *ent;
+
+	size = LOGQ_ALIGN(sizeof(logq_out_t) + len + 1);
+	head = out_head;
+	off = head & (LOGQ_OUT_SIZE - 1);
+	pad = (off + size > LOGQ_OUT_SIZE) ? LOGQ_OUT_SIZE - off : 0;
+	if(head + pad + size - out_tail > LOGQ_OUT_SIZE)
+		return(0);
+
+	if(pad) {
+		ent = (logq_out_t *)(logq_out + off);
+		ent->size = pad;
+		ent->pad = 1;
+	}
+	ent = (logq_out_t *)(logq_out + ((head + pad) & (LOGQ_OUT_SIZE - 1)));
+	ent->size = size;
+	ent->pad = 0;
+	ent->atype = atype;
+	ent->dev = dev;
+	memcpy(ent + 1, line, len + 1);
+	os_memory_barrier();
+	out_head = head + pad + size;
+	return(1);
+}
+
+// Format queued records; formatter thread, or main thread holding
+// logq_lock when formatter runs.  Stops at record still being written,
+// or when formatted text doesn't fit.
+static void DLLINTERNAL logq_consume(void) {
+	char text[MAX_LOGMSG_LEN];
+	char line[MAX_LOGMSG_LEN + 80];
+	unsigned int tail, size, state;
+	unsigned char atype, flags;
+	const char *head, *fmt;
+	logq_rec_t *rec;
+	int len;
+
+	tail = ring_tail;
+	while(tail != ring_head) {
+		rec = (logq_rec_t *)(logq_ring + (tail & (LOGQ_RING_SIZE - 1)));
+		state = rec->state;
+		if(state == LOGQ_FREE)
+			break;
+		os_memory_barrier();
+		size = rec->size;
+
+		if(state == LOGQ_READY) {
+			logq_reader r((const unsigned char *)(rec + 1));
+			atype = r.get_val<unsigned char>();
+			flags = r.get_val<unsigned char>();
+			head = r.get_str();
+			if(flags & LOGQF_DEFERRED) {
+				fmt = r.get_str();
+				logq_format(&r, fmt, text, sizeof(text));
+			}
+			else
+				STRNCPY(text, r.get_str(), sizeof(text));
+
+			len = snprintf(line, sizeof(line), "%s%s %s\n", (flags & LOGQF_BUFFERED) ? "b>" : "", head, text);
+			if(len < 0 || len >= (int)sizeof(line)) {
+				len = sizeof(line) - 1;
+				line[len - 1] = '\n';
+				line[len] = '\0';
+			}
+			if(!logq_out_put(atype, flags & LOGQF_DEV, line, len))
+				break;
+		}
+
+		memset(rec, 0, size);
+		os_memory_barrier();
+		tail += size;
+		ring_tail = tail;
+	}
+}
+
+// Pass formatted text to engine; main thread.  Returns messages passed.
+static int DLLINTERNAL logq_out_deliver(void) {
+	unsigned int tail;
+	logq_out_t *ent;
+	int dev = -1, n = 0;
+
+	tail = out_tail;
+	while(tail != out_head) {
+		os_memory_barrier();
+		ent = (logq_out_t *)(logq_out + (tail & (LOGQ_OUT_SIZE - 1)));
+		if(!ent->pad) {
+			if(ent->dev && dev < 0)
+				dev = (int)CVAR_GET_FLOAT("developer");
+			if(!ent->dev || dev) {
+				ALERT((ALERT_TYPE)ent->atype, "%s", (const char *)(ent + 1));
+				n++;
+			}
+		}
+		tail += ent->size;
+		out_tail = tail;
+	}
+	logq_delivered += n;
+	return(n);
+}
+
+static void DLLINTERNAL logq_kick(void) {
+	if(logq_thread_running && os_atomic_cas(&logq_kicked, 0, 1))
+		os_sem_post(&logq_wake);
+}
+
+// Store record; returns 0 if no room.
+static int DLLINTERNAL logq_store(const unsigned char *payload, unsigned int len) {
+	logq_rec_t *rec;
+	int waited;
+
+	rec = logq_reserve(len);
+	if(unlikely(!rec)) {
+		if(logq_is_main()) {
+			// main thread delivers; make room by flushing now
+			if(g_engfuncs.pfnAlertMessage) {
+				log_queue_flush();
+				rec = logq_reserve(len);
+			}
+		}
+		else {
+			for(waited=0; !rec && waited < LOGQ_WAIT_MS; waited++) {
+				logq_kick();
+				os_sleep_ms(1);
+				rec = logq_reserve(len);
+			}
+		}
+		if(!rec) {
+			os_atomic_add(&logq_dropped, 1);
+			os_atomic_add(&logq_drops_pending, 1);
+			return(0);
+		}
+	}
+	memcpy(rec + 1, payload, len);
+	os_memory_barrier();
+	rec->state = LOGQ_READY;
+
+	os_atomic_add(&logq_queued, 1);
+	if(ring_head - ring_tail > LOGQ_RING_SIZE / 2)
+		logq_kick();
+	return(1);
+}
+
+void DLLINTERNAL log_queue_msg(ALERT_TYPE atype, int dev, const char *head, const char *fmt, va_list ap) {
+	unsigned char buf[LOGQ_MAX_RECORD];
+	char text[MAX_LOGMSG_LEN];
+	unsigned char flags;
+	int engine;
+	va_list ap2;
+
+	engine = (g_engfuncs.pfnAlertMessage != NULL);
+
+	// synchronous mode; keep order with anything queued before
+	if(!Config->async_log && engine && logq_is_main()) {
+		if(ring_head != ring_tail || out_head != out_tail)
+			log_queue_flush();
+		if(dev && (int)CVAR_GET_FLOAT("developer") == 0)
+			return;
+		safevoid_vsnprintf(text, sizeof(text), fmt, ap);
+		ALERT(atype, "%s %s\n", head, text);
+		logq_delivered++;
+		return;
+	}
+
+	flags = LOGQF_DEFERRED;
+	if(dev)
+		flags |= LOGQF_DEV;
+	if(!engine)
+		flags |= LOGQF_BUFFERED;
+
+	logq_writer w(buf, sizeof(buf));
+	w.put_val((unsigned char)atype);
+	w.put_val(flags);
+	w.put_str(head);
+	w.put_str(fmt);
+
+	va_copy(ap2, ap);
+	if(!logq_capture_args(&w, fmt, ap2) || w.is_overflow()) {
+		// format here; text only
+		flags &= ~LOGQF_DEFERRED;
+		safevoid_vsnprintf(text, sizeof(text), fmt, ap);
+		w = logq_writer(buf, sizeof(buf));
+		w.put_val((unsigned char)atype);
+		w.put_val(flags);
+		w.put_str(head);
+		w.put_str(text);
+		os_atomic_add(&logq_preformatted, 1);
+	}
+	va_end(ap2);
+
+	logq_store(buf, w.length());
+}
+
+// log_queue_msg with varargs
+static void DLLINTERNAL logq_msgf(int dev, const char *head, const char *fmt, ...) {
+	va_list ap;
+
+	va_start(ap, fmt);
+	log_queue_msg(at_logged, dev, head, fmt, ap);
+	va_end(ap);
+}
+
+// Report suppressed messages of rate slot.
+static void DLLINTERNAL logq_rate_report(logq_rate_t *slot, int n) {
+	char head[sizeof(slot->tag) + 2];
+
+	safevoid_snprintf(head, sizeof(head), "[%s]", slot->tag);
+	logq_msgf(0, head, "%d messages suppressed (log_rate %d)", n, Config->log_rate);
+}
+
+static logq_rate_t * DLLINTERNAL logq_rate_slot(plid_t plid) {
+	logq_rate_t *slot;
+	int i;
+
+	for(i=0; i < LOGQ_RATE_SLOTS; i++) {
+		if(logq_rates[i].plid == plid)
+			return(&logq_rates[i]);
+	}
+	for(i=0; i < LOGQ_RATE_SLOTS; i++) {
+		slot = &logq_rates[i];
+		if(!slot->plid && os_atomic_cas(&slot->plid, (plugin_info_t *)NULL, plid)) {
+			STRNCPY(slot->tag, plid->logtag ? plid->logtag : "", sizeof(slot->tag));
+			return(slot);
+		}
+	}
+	return(NULL);
+}
+
+inline void logq_rate_lock(logq_rate_t *slot) {
+	while(os_atomic_swap(&slot->lock, 1))
+		;
+}
+
+inline void logq_rate_unlock(logq_rate_t *slot) {
+	os_atomic_release(&slot->lock);
+}
+
+void DLLINTERNAL log_queue_plugin(plid_t plid, logq_level_t level, const char *fmt, va_list ap) {
+	static const char *const levels[] = { "", " ERROR:", " dev:" };
+	char head[48];
+	logq_rate_t *slot;
+	time_t now;
+	int rate, report, allow;
+
+	// cvar can only be read on main thread; elsewhere checked at delivery
+	if(level == LOGQ_DEVELOPER && logq_is_main() && g_engfuncs.pfnCVarGetFloat
+			&& (int)CVAR_GET_FLOAT("developer") == 0)
+		return;
+
+	rate = Config->log_rate;
+	if(rate > 0 && (slot=logq_rate_slot(plid))) {
+		now = time(NULL);
+		logq_rate_lock(slot);
+		report = 0;
+		if(now != slot->window) {
+			report = slot->suppressed;
+			slot->window = now;
+			slot->count = 0;
+			slot->suppressed = 0;
+		}
+		allow = (++slot->count <= rate);
+		if(!allow) {
+			slot->suppressed++;
+			slot->total++;
+		}
+		logq_rate_unlock(slot);
+
+		if(report)
+			logq_rate_report(slot, report);
+		if(!allow)
+			return;
+	}
+
+	safevoid_snprintf(head, sizeof(head), "[%s]%s", plid->logtag, levels[level]);
+	log_queue_msg(at_logged, level == LOGQ_DEVELOPER, head, fmt, ap);
+}
+
+// Report suppressed counts of finished windows; main thread.
+static void DLLINTERNAL logq_rate_tick(void) {
+	logq_rate_t *slot;
+	time_t now;
+	int i, report;
+
+	now = time(NULL);
+	for(i=0; i < LOGQ_RATE_SLOTS; i++) {
+		slot = &logq_rates[i];
+		if(!slot->plid || !slot->suppressed || slot->window == now)
+			continue;
+		logq_rate_lock(slot);
+		report = slot->suppressed;
+		slot->suppressed = 0;
+		slot->count = 0;
+		slot->window = now;
+		logq_rate_unlock(slot);
+		if(report)
+			logq_rate_report(slot, report);
+	}
+}
+
+void DLLINTERNAL log_queue_plugin_unloaded(plid_t plid) {
+	logq_rate_t *slot;
+	int i;
+
+	for(i=0; i < LOGQ_RATE_SLOTS; i++) {
+		slot = &logq_rates[i];
+		if(slot->plid != plid)
+			continue;
+		if(slot->suppressed)
+			logq_rate_report(slot, slot->suppressed);
+		memset(slot, 0, sizeof(*slot));
+	}
+}
+
+OS_THREAD_FN(logq_thread_main, arg) {
+	for(;;) {
+		os_sem_wait(&logq_wake);
+		logq_kicked = 0;
+		if(logq_stopping)
+			break;
+		os_mutex_lock(&logq_lock);
+		logq_consume();
+		os_mutex_unlock(&logq_lock);
+	}
+	OS_THREAD_RETURN;
+}
+
+static void DLLINTERNAL logq_start_thread(void) {
+	if(!os_sem_init(&logq_wake)) {
+		logq_thread_failed = 1;
+		return;
+	}
+	os_mutex_init(&logq_lock);
+	logq_stopping = 0;
+	logq_kicked = 0;
+	if(!os_thread_start(&logq_thread, logq_thread_main, NULL)) {
+		os_mutex_destroy(&logq_lock);
+		os_sem_destroy(&logq_wake);
+		logq_thread_failed = 1;
+		META_WARNING("Unable to start log formatter thread; formatting logs on main thread");
+		return;
+	}
+	logq_thread_running = 1;
+}
+
+inline void logq_set_main(void) {
+	if(!logq_main_known) {
+		logq_main_tid = os_thread_id();
+		logq_main_known = 1;
+	}
+}
+
+void DLLINTERNAL log_queue_deliver(void) {
+	int n;
+
+	logq_set_main();
+	if(!g_engfuncs.pfnAlertMessage)
+		return;
+
+	if(Config->async_log && !logq_thread_running && !logq_thread_failed)
+		logq_start_thread();
+
+	logq_rate_tick();
+	if(logq_drops_pending) {
+		n = os_atomic_swap(&logq_drops_pending, 0);
+		if(n)
+			logq_msgf(0, "[META] WARNING:", "%d log messages dropped; log ring full", n);
+	}
+
+	if(!logq_thread_running)
+		logq_consume();
+	logq_out_deliver();
+	if(ring_head != ring_tail)
+		logq_kick();
+}
+
+void DLLINTERNAL log_queue_flush(void) {
+	unsigned int tail;
+	int n;
+
+	logq_set_main();
+	if(!g_engfuncs.pfnAlertMessage)
+		return;
+
+	do {
+		tail = ring_tail;
+		if(logq_thread_running)
+			os_mutex_lock(&logq_lock);
+		logq_consume();
+		if(logq_thread_running)
+			os_mutex_unlock(&logq_lock);
+		n = logq_out_deliver();
+	} while(ring_tail != ring_head && (ring_tail != tail || n));
+}
+
+void DLLINTERNAL log_queue_shutdown(void) {
+	if(logq_thread_running) {
+		logq_stopping = 1;
+		os_sem_post(&logq_wake);
+		os_thread_join(&logq_thread);
+		os_mutex_destroy(&logq_lock);
+		os_sem_destroy(&logq_wake);
+		logq_thread_running = 0;
+	}
+	log_queue_flush();
+}
+
+// "meta log" console command.
+void DLLINTERNAL cmd_meta_log(void) {
+	int i, n;
+
+	META_CONS("Log pipeline: %s%s", Config->async_log ? "async" : "sync",
+			logq_thread_running ? ", formatter thread running" : "");
+	META_CONS("  ring: %u/%u bytes used, %u high water; formatted waiting: %u bytes",
+			ring_head - ring_tail, LOGQ_RING_SIZE, ring_high, out_head - out_tail);
+	META_CONS("  messages: %lu queued, %lu delivered, %lu formatted by caller, %lu dropped",
+			logq_queued, logq_delivered, logq_preformatted, logq_dropped);
+	if(Config->log_rate <= 0) {
+		META_CONS("  rate limit: none");
+		return;
+	}
+	META_CONS("  rate limit: %d messages/sec per plugin", Config->log_rate);
+	for(i=0, n=0; i < LOGQ_RATE_SLOTS; i++) {
+		if(logq_rates[i].plid && logq_rates[i].total) {
+			META_CONS("    [%s] %lu suppressed", logq_rates[i].tag, logq_rates[i].total);
+			n++;
+		}
+	}
+	if(!n)
+		META_CONS("    none suppressed");
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+#include <stdarg.h>			// va_list
+
+#include <extdll.h>			// ALERT_TYPE
+
+#include "plinfo.h"			// plid_t
+#include "comp_dep.h"
+
+// Deferred log pipeline.
+//  META_LOG and friends, and plugins' LOG_MESSAGE, LOG_ERROR and
+//  LOG_DEVELOPER, don't format and ALERT on the calling thread.  The
+//  format string and the arguments it refers to (strings copied) are
+//  put in a preallocated lock-free ring, that any thread can write to.  A
+//  formatter thread turns records into text, and the main thread passes
+//  the text to engine, in order, at StartFrame.
+//
+//  When the ring fills, the main thread formats and delivers everything
+//  queued itself, and other threads wait for a while; if there still
+//  isn't room, message is dropped and counted.  Per-plugin rate limit
+//  (config option "log_rate") suppresses messages above a number per
+//  second, with a summary of how many were suppressed.
+//
+//  Messages logged before engine's AlertMessage is available are held
+//  in the ring too, and delivered with "b>" prefix.  With config option
+//  "async_log" off, messages are delivered right away on main thread.
+
+// capture ring; power of two
+#define LOGQ_RING_SIZE (256 * 1024)
+
+// formatted text waiting for main thread; power of two
+#define LOGQ_OUT_SIZE (256 * 1024)
+
+// longest wait for room in ring, for threads other than main thread
+#define LOGQ_WAIT_MS 100
+
+// plugins tracked for rate limits
+#define LOGQ_RATE_SLOTS 64
+
+// LOG_* level of plugin message
+typedef enum {
+	LOGQ_MESSAGE = 0,
+	LOGQ_ERROR,
+	LOGQ_DEVELOPER,
+} logq_level_t;
+
+// Queue message; 'head' is put before the formatted text.  'dev' ones
+// are dropped if cvar "developer" is 0 at delivery.
+void DLLINTERNAL log_queue_msg(ALERT_TYPE atype, int dev, const char *head, const char *fmt, va_list ap);
+
+// queue plugin message, subject to rate limit
+void DLLINTERNAL log_queue_plugin(plid_t plid, logq_level_t level, const char *fmt, va_list ap);
+
+// deliver formatted messages and wake formatter; main thread, StartFrame
+void DLLINTERNAL log_queue_deliver(void);
+
+// format and deliver everything queued now; main thread
+void DLLINTERNAL log_queue_flush(void);
+
+// flush, and stop formatter thread
+void DLLINTERNAL log_queue_shutdown(void);
+
+// forget rate limit of plugin, printing its pending summary
+void DLLINTERNAL log_queue_plugin_unloaded(plid_t plid);
+
+void DLLINTERNAL cmd_meta_log(void);
+
+#endif /* LOG_QUEUE_H */
@@ -63,7 +63,22 @@
 // Version 5:11 added plugin loading and unloading API [v1.18]
 // Version 5:12 added IS_QUERYING_CLIENT_CVAR to mutils [v1.18]
 // Version 5:13 added MAKE_REQUESTID and GET_HOOK_TABLES to mutils [v1.19]
-#define META_INTERFACE_VERSION "5:13"
+// Version 5:14 added QUEUE_JOB and QUEUE_MAIN_THREAD to mutils [v1.19]
+// Version 5:15 added REG_LOG_EVENT and UNREG_LOG_EVENT to mutils [v1.19]
+// Version 5:16 added REG_USERMSG_HOOK and UNREG_USERMSG_HOOK to mutils [v1.19]
+// Version 5:17 added ADD_MSG_FILTER and CLEAR_MSG_FILTER to mutils [v1.19]
+// Version 5:18 added ADD_ENT_CLASS_FILTER, ADD_ENT_INDEX_FILTER and
+//              CLEAR_ENT_FILTER to mutils [v1.19]
+// Version 5:19 added GET_STRING_ID, GET_ENTITY_KEY_ID, FIND_ENTITY_BY_KEY
+//              and FIND_ENTITY_BY_KEY_ID to mutils [v1.19]
+// Version 5:20 added FIND_ENTITIES_IN_SPHERE to mutils [v1.19]
+// Version 5:21 added GET_CVAR_HANDLE, REG_CVAR_HOOK and UNREG_CVAR_HOOK
+//              to mutils [v1.19]
+// Version 5:22 added optional Meta_ExportState and Meta_ImportState, and
+//              PNL_HOT_RELOAD [v1.19]
+// Version 5:23 added REG_ENTITY_CLASS and UNREG_ENTITY_CLASS to mutils
+//              [v1.19]
+#define META_INTERFACE_VERSION "5:23"
 
 // Flags returned by a plugin's api function.
 // NOTE: order is crucial, as greater/less comparisons are made.
@@ -149,6 +164,19 @@ typedef int (*META_ATTACH_FN) (PLUG_LOADTIME now,
 C_DLLEXPORT int Meta_Detach(PLUG_LOADTIME now, PL_UNLOAD_REASON reason);
 typedef int (*META_DETACH_FN) (PLUG_LOADTIME now, PL_UNLOAD_REASON reason);
 
+// Optional; for "meta hotreload".  Copy the plugin's state into pData, 
+// and return the number of bytes used.  Called first with pData NULL and 
+// size 0, to get the size needed.  Return -1 to refuse the handoff.  A 
+// plugin exporting this can be swapped at any time, regardless of its 
+// loadable/unloadable times.
+C_DLLEXPORT int Meta_ExportState(void *pData, int size);
+typedef int (*META_EXPORT_STATE_FN) (void *pData, int size);
+
+// Optional; for "meta hotreload".  Take the state exported by the old 
+// instance, after Meta_Attach (and GameInit).  Return TRUE if it was used.
+C_DLLEXPORT int Meta_ImportState(const void *pData, int size);
+typedef int (*META_IMPORT_STATE_FN) (const void *pData, int size);
+
 // Standard HL SDK interface function prototypes.
 C_DLLEXPORT int GetEntityAPI_Post(DLL_FUNCTIONS *pFunctionTable, 
 		int interfaceVersion );
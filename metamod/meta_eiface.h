@@ -87,6 +87,17 @@ struct meta_new_dll_functions_t : public NEW_DLL_FUNCTIONS {
 	// return the engine's version of NEW_DLL_FUNCTIONS
 	int DLLINTERNAL version( void );
 
+	// Comfort function to determine the size of the NEW_DLL_FUNCTIONS
+	// struct for the different versions.
+	// If passed a version number other than 0, the size for that
+	// specific version is returned. 
+	// If passed 0 as version number (default) the size for the version
+	// that was determined to be the version of the currently connected
+	// engine's interface. Should that version have not yet been
+	// determined (via the enginefuncs_t interface), 0 is returned to
+	// indicated this error state.
+	size_t DLLINTERNAL get_size( int version = 0 );
+
 	private:
 
 	// data :
@@ -120,17 +131,6 @@ struct meta_new_dll_functions_t : public NEW_DLL_FUNCTIONS {
 		// NEW_DLL_FUNCTIONS interface. Stores this version for future
 		// reference in m_version and returns it.
 		int DLLINTERNAL determine_interface_version( void );
-
-		// Comfort function to determine the size of the NEW_DLL_FUNCTIONS
-		// struct for the different versions.
-		// If passed a version number other than 0, the size for that
-		// specific version is returned. 
-		// If passed 0 as version number (default) the size for the version
-		// that was determined to be the version of the currently connected
-		// engine's interface. Should that version have not yet been
-		// determined (via the enginefuncs_t interface), 0 is returned to
-		// indicated this error state.
-		size_t DLLINTERNAL get_size( int version = 0 );
 };
 
 
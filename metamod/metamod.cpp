@@ -56,6 +56,11 @@
 #include "info_name.h"			// VNAME, etc
 #include "vdate.h"				// COMPILE_TIME, etc
 #include "linkent.h"
+#include "api_hook.h"				// set_api_passthrough_table
+#include "api_trace.h"			// api_trace_init
+#include "string_cache.h"		// string_cache_init, etc
+#include "cvar_watch.h"			// cvar_watch_set_float, etc
+#include "startup_timeline.h"	// startup_timeline_begin, etc
 
 cvar_t meta_version = {"metamod_version", VVERSION, FCVAR_SERVER, 0, NULL};
 
@@ -68,6 +73,13 @@ option_t global_options[] = {
 	{ "exec_cfg",		CF_STR,			&Config->exec_cfg,		EXEC_CFG },
 	{ "autodetect",		CF_BOOL,		&Config->autodetect,	"yes" },
 	{ "clientmeta",		CF_BOOL,		&Config->clientmeta,	"yes" },
+	{ "passthrough",	CF_BOOL,		&Config->passthrough,	"no" },
+	{ "job_threads",	CF_INT,			&Config->job_threads,	"0" },
+	{ "async_log",		CF_BOOL,		&Config->async_log,		"no" },
+	{ "log_rate",		CF_INT,			&Config->log_rate,		"0" },
+	{ "string_cache",	CF_BOOL,		&Config->string_cache,	"no" },
+	{ "startup_threads",	CF_INT,		&Config->startup_threads,	"0" },
+	{ "linkent_table",	CF_BOOL,		&Config->linkent_table,	"yes" },
 	// list terminator
 	{ NULL, CF_NONE, NULL, NULL }
 };
@@ -96,6 +108,8 @@ int metamod_not_loaded = 0;
 int DLLINTERNAL metamod_startup(void) {	
 	char *cp, *mmfile=NULL, *cfile=NULL;
 
+	startup_timeline_begin();
+
 	META_CONS("   ");
 	META_CONS("   %s version %s Copyright (c) 2001-%s %s", VNAME, VVERSION, COPYRIGHT_YEAR, VAUTHOR);
 	META_CONS("     Patch: %s v%d Copyright (c) 2004-%s %s", VPATCH_NAME, VPATCH_IVERSION, VPATCH_COPYRIGHT_YEAR, VPATCH_AUTHOR);
@@ -128,6 +142,9 @@ int DLLINTERNAL metamod_startup(void) {
 	// Can I do these here, rather than waiting for GameDLLInit() ?  
 	// Looks like it works okay..
 	meta_register_cmdcvar();
+	
+	// Hook flight recorder; dumps on crash.
+	api_trace_init();
 	{
 		//dirty hacks
 		int vers[4] = {RC_VERS_DWORD};
@@ -190,6 +207,34 @@ int DLLINTERNAL metamod_startup(void) {
 		META_LOG("Clientmeta specified via localinfo: %s", cp);
 		Config->set("clientmeta", cp);
 	}
+	if((cp=LOCALINFO("mm_passthrough")) && *cp != '\0') {
+		META_LOG("Passthrough specified via localinfo: %s", cp);
+		Config->set("passthrough", cp);
+	}
+	if((cp=LOCALINFO("mm_jobthreads")) && *cp != '\0') {
+		META_LOG("Job_threads specified via localinfo: %s", cp);
+		Config->set("job_threads", cp);
+	}
+	if((cp=LOCALINFO("mm_asynclog")) && *cp != '\0') {
+		META_LOG("Async_log specified via localinfo: %s", cp);
+		Config->set("async_log", cp);
+	}
+	if((cp=LOCALINFO("mm_lograte")) && *cp != '\0') {
+		META_LOG("Log_rate specified via localinfo: %s", cp);
+		Config->set("log_rate", cp);
+	}
+	if((cp=LOCALINFO("mm_stringcache")) && *cp != '\0') {
+		META_LOG("String_cache specified via localinfo: %s", cp);
+		Config->set("string_cache", cp);
+	}
+	if((cp=LOCALINFO("mm_startupthreads")) && *cp != '\0') {
+		META_LOG("Startup_threads specified via localinfo: %s", cp);
+		Config->set("startup_threads", cp);
+	}
+	if((cp=LOCALINFO("mm_linkenttable")) && *cp != '\0') {
+		META_LOG("Linkent_table specified via localinfo: %s", cp);
+		Config->set("linkent_table", cp);
+	}
 
 
 	// Check for an initial debug level, since cfg files don't get exec'd
@@ -197,6 +242,7 @@ int DLLINTERNAL metamod_startup(void) {
 	if(Config->debuglevel != 0) {
 		CVAR_SET_FLOAT("meta_debug", (float)(meta_debug_value = Config->debuglevel));
 	}
+	startup_phase("config");
 
 	// Prepare for registered commands from plugins.
 	RegCmds = new MRegCmdList();
@@ -204,7 +250,7 @@ int DLLINTERNAL metamod_startup(void) {
 
 	// Prepare for registered user messages from gamedll.
 	RegMsgs = new MRegMsgList();
-	
+
 	// Copy, and store pointer in Engine struct.  Yes, we could just store
 	// the actual engine_t struct in Engine, but then it wouldn't be a
 	// pointer to match the other g_engfuncs.
@@ -221,6 +267,15 @@ int DLLINTERNAL metamod_startup(void) {
 		Engine.pl_funcs->pfnQueryClientCvarValue = NULL;
 	if(!IS_VALID_PTR((void*)Engine.pl_funcs->pfnQueryClientCvarValue2))
 		Engine.pl_funcs->pfnQueryClientCvarValue2 = NULL;
+	// notice cvars set by plugins, see cvar_watch.h
+	Engine.pl_funcs->pfnCVarSetFloat = cvar_watch_set_float;
+	Engine.pl_funcs->pfnCVarSetString = cvar_watch_set_string;
+	Engine.pl_funcs->pfnCvar_DirectSet = cvar_watch_direct_set;
+	// answer AllocString of plugins and gamedll from cache
+	if(Config->string_cache) {
+		string_cache_init();
+		Engine.pl_funcs->pfnAllocString = string_cache_alloc;
+	}
 		
 	// Before, we loaded plugins before loading the game DLL, so that if no
 	// plugins caught engine functions, we could pass engine funcs straight
@@ -260,10 +315,12 @@ int DLLINTERNAL metamod_startup(void) {
 		META_ERROR("Failure to load game DLL; exiting...");
 		return(0);
 	}
+	startup_phase("gamedll");
 	if(!Plugins->load()) {
 		META_WARNING("Failure to load plugins...");
 		// Exit on failure here?  Dunno...
 	}
+	startup_timeline_end();
 
 	// Allow for commands to metamod plugins at startup.  Autoexec.cfg is
 	// read too early, and server.cfg is read too late.
@@ -340,6 +397,35 @@ mBOOL DLLINTERNAL meta_init_gamedll(void) {
 	return(mTRUE);
 }
 
+// Find the gamedll's own copy of the engine functions we gave it in
+// GiveFnptrsToDll, so that engine functions no plugin hooks can be passed
+// straight through to the engine.  Standard SDK gamedlls keep this in the
+// global 'g_engfuncs', which is visible with dlsym at least under linux.
+// Only the leading part of it that matches our table is used, in case the
+// gamedll was built with an older/shorter enginefuncs_t.
+static void DLLINTERNAL meta_find_gamedll_engfuncs(void) {
+	void **gamedll_engfuncs;
+	void **our_engfuncs;
+	unsigned int i, n;
+
+	gamedll_engfuncs = (void**) DLSYM(GameDLL.handle, "g_engfuncs");
+	if(!gamedll_engfuncs) {
+		META_DEBUG(3, ("dll: Game '%s': Couldn't find g_engfuncs; engine functions won't be passed through", GameDLL.name));
+		return;
+	}
+
+	our_engfuncs = (void**) &meta_engfuncs;
+	n = sizeof(enginefuncs_t) / sizeof(void*);
+	for(i=0; i < n && gamedll_engfuncs[i] == our_engfuncs[i]; i++);
+	if(i == 0) {
+		META_DEBUG(3, ("dll: Game '%s': g_engfuncs doesn't match our engine functions; engine functions won't be passed through", GameDLL.name));
+		return;
+	}
+
+	META_DEBUG(3, ("dll: Game '%s': Found g_engfuncs with %u of %u engine functions", GameDLL.name, i, n));
+	set_api_passthrough_table(e_api_engine, gamedll_engfuncs, i);
+}
+
 // Load game DLL.
 // meta_errno values:
 //  - ME_DLOPEN		couldn't dlopen game dll file
@@ -377,6 +463,9 @@ mBOOL DLLINTERNAL meta_load_gamedll(void) {
 			META_DEBUG(3, ("dll: Game '%s': Called GiveFnptrsToDll", 
 						GameDLL.name));
 			
+			if(Config->passthrough)
+				meta_find_gamedll_engfuncs();
+			
 			//activate linkent-replacement after give_engfuncs so that if game dll is 
 			//plugin too and uses same method we get combined export table of plugin 
 			//and game dll
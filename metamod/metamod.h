@@ -191,21 +191,11 @@ mBOOL DLLINTERNAL meta_load_gamedll(void);
 
 // return a value
 #define RETURN_API(ret_t) \
-	{return(GET_RET_CLASS(ret_val, ret_t));}
+	{return(ret_val);}
 
 // ===== end macros ===========================================================
 
-#ifdef META_PERFMON
-
-// ============================================================================
-// Api-hook performance monitoring
-// ============================================================================
-
-extern long double total_tsc DLLHIDDEN;
-extern unsigned long long count_tsc DLLHIDDEN;
-extern unsigned long long active_tsc DLLHIDDEN;
-extern unsigned long long min_tsc DLLHIDDEN;
-
+// Read cpu timestamp counter; used by META_PERFMON and hook profiler.
 inline unsigned long long DLLINTERNAL GET_TSC(void) {
 	union { struct { unsigned int eax, edx;	} split; unsigned long long full; } tsc;
 #ifdef __GNUC__
@@ -221,6 +211,17 @@ inline unsigned long long DLLINTERNAL GET_TSC(void) {
 	return(tsc.full);
 }
 
+#ifdef META_PERFMON
+
+// ============================================================================
+// Api-hook performance monitoring
+// ============================================================================
+
+extern long double total_tsc DLLHIDDEN;
+extern unsigned long long count_tsc DLLHIDDEN;
+extern unsigned long long active_tsc DLLHIDDEN;
+extern unsigned long long min_tsc DLLHIDDEN;
+
 #define API_START_TSC_TRACKING() \
 	active_tsc = GET_TSC()
 
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef MHOOK_H
+#define MHOOK_H
+
+// Event notification for plugins; see REG_LOG_EVENT in mutil.h.
+
+// max fields captured by one log event pattern
+#define LOGEV_MAX_FIELDS 8
+
+// Field captured by "%s", "%d" or "%f" in pattern.  'ival' and 'fval'
+// are set for "%d" and "%f" fields.
+typedef struct meta_log_field_s {
+	const char *str;
+	int ival;
+	float fval;
+} meta_log_field_t;
+
+// Log line that matched a pattern.  Valid only during callback.
+typedef struct meta_log_event_s {
+	int id;							// as returned by REG_LOG_EVENT
+	const char *line;				// whole line, without newline
+	int nfields;
+	meta_log_field_t field[LOGEV_MAX_FIELDS];
+} meta_log_event_t;
+
+typedef void (*META_LOG_EVENT_FN)(const meta_log_event_t *event, void *data);
+
+// User message capture; see REG_USERMSG_HOOK in mutil.h.
+
+// max arguments (Write* calls) captured in one message
+#define USERMSG_MAX_ARGS 512
+
+typedef enum {
+	MSGARG_BYTE = 0,
+	MSGARG_CHAR,
+	MSGARG_SHORT,
+	MSGARG_LONG,
+	MSGARG_ANGLE,
+	MSGARG_COORD,
+	MSGARG_STRING,
+	MSGARG_ENTITY,
+} meta_msgarg_type_t;
+
+// One Write* call.  Integer types use 'ival', ANGLE and COORD 'fval',
+// STRING 'str'; the other members are set too, converted ('str' is ""
+// for non-strings), for reading only.  To rewrite message, change the member for the type; a new
+// 'str' must stay valid until the callback of every plugin has returned.
+typedef struct meta_msgarg_s {
+	meta_msgarg_type_t type;
+	int ival;
+	float fval;
+	const char *str;
+} meta_msgarg_t;
+
+// Message gamedll sent, assembled at MessageEnd.  Valid only during
+// callback.
+typedef struct meta_usermsg_s {
+	int id;							// as returned by REG_USERMSG_HOOK
+	int msg_dest;					// MSG_ONE, MSG_ALL, etc
+	int msg_type;
+	const char *name;				// registered name, NULL for engine msgs
+	int size;						// registered size, -1 if variable
+	const float *origin;			// NULL if none
+	edict_t *ed;
+	int nargs;
+	meta_msgarg_t *args;
+	int pos;						// read cursor, see USERMSG_READ_*
+	int block;						// set nonzero to not send message
+} meta_usermsg_t;
+
+typedef void (*META_USERMSG_FN)(meta_usermsg_t *msg, void *data);
+
+// Read cursor over message arguments.  Past the last argument, readers
+// return 0 or "".
+inline int USERMSG_ARGS_LEFT(const meta_usermsg_t *msg) {
+	return(msg->nargs - msg->pos);
+}
+inline int USERMSG_READ_INT(meta_usermsg_t *msg) {
+	return(msg->pos < msg->nargs ? msg->args[msg->pos++].ival : 0);
+}
+inline float USERMSG_READ_FLOAT(meta_usermsg_t *msg) {
+	return(msg->pos < msg->nargs ? msg->args[msg->pos++].fval : 0.0f);
+}
+inline const char *USERMSG_READ_STRING(meta_usermsg_t *msg) {
+	return(msg->pos < msg->nargs ? msg->args[msg->pos++].str : "");
+}
+#define USERMSG_READ_BYTE	USERMSG_READ_INT
+#define USERMSG_READ_CHAR	USERMSG_READ_INT
+#define USERMSG_READ_SHORT	USERMSG_READ_INT
+#define USERMSG_READ_LONG	USERMSG_READ_INT
+#define USERMSG_READ_ENTITY	USERMSG_READ_INT
+#define USERMSG_READ_ANGLE	USERMSG_READ_FLOAT
+#define USERMSG_READ_COORD	USERMSG_READ_FLOAT
+
+// Cvar change notification; see REG_CVAR_HOOK in mutil.h.  'old_value'
+// is the string value before the change, valid only during callback.
+typedef void (*META_CVAR_FN)(struct cvar_s *cvar, const char *old_value, void *data);
+
+#endif /* MHOOK_H */
@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// calloc, free
+
+#include <extdll.h>			// always
+
+#include "mjobs.h"			// me
+#include "metamod.h"		// Config
+#include "conf_meta.h"		// MConfig
+#include "log_meta.h"		// META_CONS, META_LOG, etc
+#include "types_meta.h"		// mBOOL, meta_errno
+#include "osdep.h"			// os_thread_start, os_sem_*, etc
+
+typedef struct meta_job_s {
+	struct meta_job_s *next;		// mailbox link
+	plid_t plid;
+	META_JOB_FN work;				// NULL for main thread function
+	META_JOB_FN done;
+	void *data;
+} meta_job_t;
+
+// Worker and its deque.  Deque is a ring; owner pushes and takes at
+// 'tail', thieves take at 'head'.  'running' is set under lock when job
+// is taken, so that meta_jobs_cancel() sees every job of a plugin either
+// queued or running.  It is cleared under worker's own lock, which posts
+// 'cancel_done' if meta_jobs_cancel() is waiting for the job.
+typedef struct job_worker_s {
+	os_mutex_t lock;
+	meta_job_t *queue[JOBS_QUEUE_SIZE];
+	unsigned int head;
+	unsigned int tail;
+	plid_t volatile running;
+	int cancel_wait;
+	os_thread_t thread;
+	int index;
+	// stats; written by worker only
+	unsigned long executed;
+	unsigned long stolen;
+} job_worker_t;
+
+static job_worker_t *workers = NULL;
+static int num_workers = 0;
+static int volatile jobs_stopping = 0;
+static os_sem_t jobs_available;
+static os_sem_t cancel_done;
+// plugin whose jobs are being cancelled; new jobs for it are refused
+static plid_t volatile cancelling = NULL;
+static unsigned int next_worker = 0;
+
+// index of worker running on this thread, -1 for other threads
+static OS_THREAD_LOCAL int current_worker = -1;
+
+// Mailbox; lock-free stack pushed by any thread, taken as whole by main
+// thread and moved to FIFO 'pending' list.
+static meta_job_t * volatile mailbox = NULL;
+static int volatile mailbox_count = 0;
+static meta_job_t *pending_head = NULL;
+static meta_job_t *pending_tail = NULL;
+
+// stats
+static unsigned long volatile jobs_queued = 0;
+static unsigned long volatile jobs_rejected = 0;
+static unsigned long mailbox_run = 0;
+
+
+static void DLLINTERNAL mailbox_push(meta_job_t *job) {
+	meta_job_t *old;
+
+	do {
+		old = mailbox;
+		job->next = old;
+	} while(!os_atomic_cas(&mailbox, old, job));
+}
+
+// Move mailbox contents to end of pending list, in queued order.
+static void DLLINTERNAL mailbox_collect(void) {
+	meta_job_t *list, *rev, *next;
+
+	list = os_atomic_swap(&mailbox, (meta_job_t *)NULL);
+	if(!list)
+		return;
+
+	for(rev=NULL; list; list=next) {
+		next=list->next;
+		list->next=rev;
+		rev=list;
+	}
+	if(pending_tail)
+		pending_tail->next=rev;
+	else
+		pending_head=rev;
+	for(pending_tail=rev; pending_tail->next; pending_tail=pending_tail->next)
+		;
+}
+
+// Take job for worker; own deque first, then steal.
+static meta_job_t * DLLINTERNAL worker_take(job_worker_t *self) {
+	meta_job_t *job = NULL;
+	job_worker_t *victim;
+	int i;
+
+	os_mutex_lock(&self->lock);
+	if(self->tail != self->head) {
+		job = self->queue[--self->tail & (JOBS_QUEUE_SIZE - 1)];
+		self->running = job->plid;
+	}
+	os_mutex_unlock(&self->lock);
+	if(job)
+		return(job);
+
+	for(i=1; i < num_workers && !job; i++) {
+		victim = &workers[(self->index + i) % num_workers];
+		os_mutex_lock(&victim->lock);
+		if(victim->tail != victim->head) {
+			job = victim->queue[victim->head++ & (JOBS_QUEUE_SIZE - 1)];
+			// visible under victim's lock, for meta_jobs_cancel
+			self->running = job->plid;
+			self->stolen++;
+		}
+		os_mutex_unlock(&victim->lock);
+	}
+	return(job);
+}
+
+OS_THREAD_FN(worker_main, arg) {
+	job_worker_t *self = (job_worker_t *)arg;
+	meta_job_t *job;
+
+	current_worker = self->index;
+	for(;;) {
+		os_sem_wait(&jobs_available);
+		if(jobs_stopping)
+			break;
+		// Semaphore count can exceed queued jobs after cancel.
+		job = worker_take(self);
+		if(!job)
+			continue;
+
+		job->work(job->data);
+		self->executed++;
+
+		if(job->done)
+			mailbox_push(job);
+		else
+			free(job);
+		os_mutex_lock(&self->lock);
+		self->running = NULL;
+		if(self->cancel_wait) {
+			self->cancel_wait = 0;
+			os_sem_post(&cancel_done);
+		}
+		os_mutex_unlock(&self->lock);
+	}
+	OS_THREAD_RETURN;
+}
+
+static mBOOL DLLINTERNAL jobs_start(void) {
+	int i, n;
+
+	n = Config->job_threads;
+	if(n <= 0)
+		n = os_num_cpus() - 1;
+	if(n < 1)
+		n = 1;
+	if(n > JOBS_MAX_THREADS)
+		n = JOBS_MAX_THREADS;
+
+	if(!os_sem_init(&jobs_available)) {
+		META_WARNING("Unable to create job semaphore");
+		RETURN_ERRNO(mFALSE, ME_OSNOTSUP);
+	}
+	if(!os_sem_init(&cancel_done)) {
+		META_WARNING("Unable to create job semaphore");
+		os_sem_destroy(&jobs_available);
+		RETURN_ERRNO(mFALSE, ME_OSNOTSUP);
+	}
+	workers = (job_worker_t *)calloc(n, sizeof(job_worker_t));
+	if(!workers) {
+		os_sem_destroy(&cancel_done);
+		os_sem_destroy(&jobs_available);
+		RETURN_ERRNO(mFALSE, ME_NOMEM);
+	}
+	jobs_stopping = 0;
+	for(i=0; i < n; i++) {
+		os_mutex_init(&workers[i].lock);
+		workers[i].index = i;
+		num_workers = i + 1;
+		if(!os_thread_start(&workers[i].thread, worker_main, &workers[i])) {
+			os_mutex_destroy(&workers[i].lock);
+			num_workers = i;
+			break;
+		}
+	}
+	if(!num_workers) {
+		META_WARNING("Unable to start job worker threads");
+		free(workers);
+		workers = NULL;
+		os_sem_destroy(&cancel_done);
+		os_sem_destroy(&jobs_available);
+		RETURN_ERRNO(mFALSE, ME_OSNOTSUP);
+	}
+	META_LOG("Started %d job worker threads", num_workers);
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL meta_jobs_queue(plid_t plid, META_JOB_FN work, META_JOB_FN done, void *data) {
+	meta_job_t *job;
+	job_worker_t *w;
+	int self, i, start;
+
+	if(!work)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+
+	self = current_worker;
+	// first job starts threads; meta_errno set in jobs_start()
+	if(!workers && !jobs_start())
+		return(mFALSE);
+
+	job = (meta_job_t *)calloc(1, sizeof(meta_job_t));
+	if(!job)
+		RETURN_ERRNO(mFALSE, ME_NOMEM);
+	job->plid = plid;
+	job->work = work;
+	job->done = done;
+	job->data = data;
+
+	// own deque for jobs queued by jobs, else round-robin; next one if full
+	start = (self >= 0) ? self : (int)(os_atomic_add(&next_worker, 1) % num_workers);
+	for(i=0; i < num_workers; i++) {
+		w = &workers[(start + i) % num_workers];
+		os_mutex_lock(&w->lock);
+		// Checked under lock; meta_jobs_cancel() sets it before taking
+		// the locks, so job is either refused here or seen by its scan.
+		if(unlikely(cancelling == plid)) {
+			os_mutex_unlock(&w->lock);
+			free(job);
+			RETURN_ERRNO(mFALSE, ME_NOTALLOWED);
+		}
+		if(w->tail - w->head < JOBS_QUEUE_SIZE) {
+			w->queue[w->tail++ & (JOBS_QUEUE_SIZE - 1)] = job;
+			os_mutex_unlock(&w->lock);
+			os_atomic_add(&jobs_queued, 1);
+			os_sem_post(&jobs_available);
+			return(mTRUE);
+		}
+		os_mutex_unlock(&w->lock);
+	}
+
+	free(job);
+	os_atomic_add(&jobs_rejected, 1);
+	RETURN_ERRNO(mFALSE, ME_MAXREACHED);
+}
+
+mBOOL DLLINTERNAL meta_jobs_queue_main(plid_t plid, META_JOB_FN func, void *data) {
+	meta_job_t *job;
+
+	if(!func)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	if(os_atomic_add(&mailbox_count, 1) >= JOBS_MAILBOX_MAX) {
+		os_atomic_add(&mailbox_count, -1);
+		os_atomic_add(&jobs_rejected, 1);
+		RETURN_ERRNO(mFALSE, ME_MAXREACHED);
+	}
+
+	job = (meta_job_t *)calloc(1, sizeof(meta_job_t));
+	if(!job) {
+		os_atomic_add(&mailbox_count, -1);
+		RETURN_ERRNO(mFALSE, ME_NOMEM);
+	}
+	job->plid = plid;
+	job->done = func;
+	job->data = data;
+	mailbox_push(job);
+	return(mTRUE);
+}
+
+void DLLINTERNAL meta_jobs_run_mailbox(void) {
+	meta_job_t *job;
+
+	if(!mailbox && !pending_head)
+		return;
+	mailbox_collect();
+
+	// Unlink one at a time; callback may unload a plugin and cancel
+	// entries still on the list.
+	while((job=pending_head)) {
+		pending_head=job->next;
+		if(!pending_head)
+			pending_tail=NULL;
+		if(!job->work)
+			os_atomic_add(&mailbox_count, -1);
+
+		job->done(job->data);
+		mailbox_run++;
+		free(job);
+	}
+}
+
+// Remove plugin's entries from pending list.
+static void DLLINTERNAL pending_cancel(plid_t plid) {
+	meta_job_t *job, **pprev;
+
+	mailbox_collect();
+	pending_tail=NULL;
+	for(pprev=&pending_head; (job=*pprev); ) {
+		if(job->plid != plid) {
+			pending_tail=job;
+			pprev=&job->next;
+			continue;
+		}
+		*pprev=job->next;
+		if(!job->work)
+			os_atomic_add(&mailbox_count, -1);
+		free(job);
+	}
+}
+
+void DLLINTERNAL meta_jobs_cancel(plid_t plid) {
+	job_worker_t *w;
+	meta_job_t *job;
+	unsigned int i, j, k;
+	int n, busy;
+
+	// Running jobs of the plugin may queue more jobs while we wait for
+	// them; those are refused from here on.
+	cancelling = plid;
+	n=0;
+	for(i=0; i < (unsigned int)num_workers; i++) {
+		w = &workers[i];
+		os_mutex_lock(&w->lock);
+		for(j=w->head; j != w->tail; ) {
+			job = w->queue[j & (JOBS_QUEUE_SIZE - 1)];
+			if(job->plid != plid) {
+				j++;
+				continue;
+			}
+			// close gap by moving later jobs down
+			for(k=j; k + 1 != w->tail; k++)
+				w->queue[k & (JOBS_QUEUE_SIZE - 1)] = w->queue[(k + 1) & (JOBS_QUEUE_SIZE - 1)];
+			w->tail--;
+			free(job);
+			n++;
+		}
+		os_mutex_unlock(&w->lock);
+	}
+
+	// Jobs stolen before the scan above have 'running' set by now.  Each
+	// worker still running one posts 'cancel_done' when it finishes; it
+	// pushes the completion before that.
+	busy=0;
+	for(i=0; i < (unsigned int)num_workers; i++) {
+		w = &workers[i];
+		os_mutex_lock(&w->lock);
+		if(w->running == plid) {
+			w->cancel_wait = 1;
+			busy++;
+		}
+		os_mutex_unlock(&w->lock);
+	}
+	while(busy--)
+		os_sem_wait(&cancel_done);
+	cancelling = NULL;
+
+	pending_cancel(plid);
+
+	if(n)
+		META_DEBUG(2, ("Dropped %d queued jobs of plugin '%s'", n, plid->name));
+}
+
+void DLLINTERNAL meta_jobs_shutdown(void) {
+	meta_job_t *job;
+	int i;
+
+	if(!workers)
+		return;
+
+	jobs_stopping = 1;
+	for(i=0; i < num_workers; i++)
+		os_sem_post(&jobs_available);
+	for(i=0; i < num_workers; i++)
+		os_thread_join(&workers[i].thread);
+
+	for(i=0; i < num_workers; i++) {
+		while(workers[i].tail != workers[i].head)
+			free(workers[i].queue[workers[i].head++ & (JOBS_QUEUE_SIZE - 1)]);
+		os_mutex_destroy(&workers[i].lock);
+	}
+	free(workers);
+	workers = NULL;
+	num_workers = 0;
+	os_sem_destroy(&cancel_done);
+	os_sem_destroy(&jobs_available);
+
+	mailbox_collect();
+	while((job=pending_head)) {
+		pending_head=job->next;
+		free(job);
+	}
+	pending_tail=NULL;
+	mailbox_count=0;
+}
+
+// "meta jobs" console command.
+void DLLINTERNAL cmd_meta_jobs(void) {
+	job_worker_t *w;
+	int i;
+
+	if(!workers) {
+		META_CONS("No job worker threads running (job_threads %d)", Config->job_threads);
+	}
+	else {
+		META_CONS("Job worker threads: %d", num_workers);
+		META_CONS("  %3s %8s %12s %12s", "", "queued", "executed", "stolen");
+		for(i=0; i < num_workers; i++) {
+			w = &workers[i];
+			META_CONS(" [%3d] %8u %12lu %12lu", i + 1, w->tail - w->head, w->executed, w->stolen);
+		}
+	}
+	META_CONS("Jobs queued: %lu; rejected: %lu; main thread callbacks run: %lu; pending main thread functions: %d",
+			jobs_queued, jobs_rejected, mailbox_run, mailbox_count);
+}
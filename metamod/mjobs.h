@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef MJOBS_H
+#define MJOBS_H
+
+#include "plinfo.h"			// plid_t
+#include "mutil.h"			// META_JOB_FN
+#include "comp_dep.h"
+
+// Shared worker thread pool for plugins.
+//  Plugins queue jobs with QUEUE_JOB; the 'work' function runs on one of
+//  metamod's worker threads, and the optional 'done' function runs later
+//  on the main thread, from StartFrame.  Worker code must not call engine
+//  or gamedll; it can ask for a function to be run on the main thread with
+//  QUEUE_MAIN_THREAD instead.
+//
+//  Each worker has its own bounded deque.  Jobs from the main thread are
+//  spread round-robin, jobs queued by a job go to the worker's own deque.
+//  A worker takes the newest job from its own deque and, when that is
+//  empty, steals the oldest job from another worker.
+//
+//  Threads are started when the first job is queued; number is set with
+//  config option "job_threads".  Completions and main thread functions
+//  are passed back through a lock-free mailbox drained each frame.
+
+// max number of worker threads
+#define JOBS_MAX_THREADS 16
+
+// queued jobs per worker; power of two
+#define JOBS_QUEUE_SIZE 256
+
+// max pending main thread functions (completions don't count)
+#define JOBS_MAILBOX_MAX 4096
+
+// queue job; main thread or job
+mBOOL DLLINTERNAL meta_jobs_queue(plid_t plid, META_JOB_FN work, META_JOB_FN done, void *data);
+
+// queue function to run on main thread; any thread
+mBOOL DLLINTERNAL meta_jobs_queue_main(plid_t plid, META_JOB_FN func, void *data);
+
+// run completions and main thread functions; main thread, from StartFrame
+void DLLINTERNAL meta_jobs_run_mailbox(void);
+
+// drop plugin's queued jobs and completions, and wait for its running
+// jobs to finish, refusing new jobs for it meanwhile; before plugin is
+// unloaded
+void DLLINTERNAL meta_jobs_cancel(plid_t plid);
+
+// stop worker threads
+void DLLINTERNAL meta_jobs_shutdown(void);
+
+void DLLINTERNAL cmd_meta_jobs(void);
+
+#endif /* MJOBS_H */
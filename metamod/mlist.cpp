@@ -35,6 +35,11 @@
  */
 
 #include <errno.h>				// errno, etc
+#include <stdio.h>				// fopen, fread, etc
+#include <stdlib.h>				// qsort, realloc, etc
+#ifdef linux
+#include <sys/time.h>			// gettimeofday; win32 in osdep.h
+#endif
 
 #include <extdll.h>				// always
 
@@ -45,31 +50,187 @@
 #include "metamod.h"			// GameDLL, etc
 #include "types_meta.h"			// mBOOL
 #include "log_meta.h"			// META_LOG, etc
+#include "api_hook.h"			// rebuild_api_hook_subscribers
+#include "startup_timeline.h"	// startup_phase, etc
 #include "osdep.h"				// win32 snprintf, normalize_pathname,
 #include "osdep_p.h"
 
+// Read-ahead of plugin files at startup.
+//  dlopen() is serialized by the dynamic loader's own lock, and plugins'
+//  Meta_Init/GiveFnptrsToDll/Meta_Query and Meta_Attach may call engine,
+//  so all of loading stays on the main thread, in plugins.ini order.  What
+//  can go in parallel is getting the files off disk: worker threads read
+//  each file once, ahead of the main thread, so its dlopen() finds the
+//  pages in cache.  Workers only touch the prefetch_file_t's.
+typedef struct prefetch_file_s {
+	MPlugin *plug;				// for timeline; not touched by workers
+	char path[PATH_MAX];
+	struct timeval start;
+	struct timeval end;
+	int worker;
+} prefetch_file_t;
+
+static prefetch_file_t *prefetch_files = NULL;
+static int prefetch_count = 0;
+static volatile int prefetch_next = 0;
+static os_thread_t prefetch_threads[PREFETCH_MAX_THREADS];
+static int prefetch_num_threads = 0;
+
+OS_THREAD_FN(prefetch_worker, arg) {
+	char buf[65536];
+	prefetch_file_t *pf;
+	FILE *fp;
+	int i;
+
+	while((i=os_atomic_add(&prefetch_next, 1)) < prefetch_count) {
+		pf = &prefetch_files[i];
+		pf->worker = (int)(long)arg;
+		gettimeofday(&pf->start, NULL);
+		if((fp=fopen(pf->path, "rb"))) {
+			while(fread(buf, 1, sizeof(buf), fp) == sizeof(buf))
+				;
+			fclose(fp);
+		}
+		gettimeofday(&pf->end, NULL);
+	}
+	OS_THREAD_RETURN;
+}
+
+// Start reading files of plugins to load ahead.  Failure just means
+// plugins are read by dlopen() as usual.
+static void DLLINTERNAL prefetch_start(MPlugin **plist, int endlist) {
+	int i, n;
+
+	prefetch_files = (prefetch_file_t *)calloc(endlist ? endlist : 1, 
+			sizeof(prefetch_file_t));
+	if(!prefetch_files)
+		return;
+	prefetch_count = 0;
+	for(i=0; i < endlist; i++) {
+		if(plist[i]->status < PL_VALID)
+			continue;
+		prefetch_files[prefetch_count].plug = plist[i];
+		STRNCPY(prefetch_files[prefetch_count].path, plist[i]->pathname, 
+				PATH_MAX);
+		prefetch_files[prefetch_count].worker = -1;
+		prefetch_count++;
+	}
+	prefetch_next = 0;
+
+	n = Config->startup_threads;
+	if(n <= 0)
+		n = os_num_cpus();
+	if(n > PREFETCH_MAX_THREADS)
+		n = PREFETCH_MAX_THREADS;
+	if(n > prefetch_count)
+		n = prefetch_count;
+	for(i=0; i < n; i++) {
+		if(!os_thread_start(&prefetch_threads[i], prefetch_worker, 
+					(void *)(long)i)) {
+			META_DEBUG(2, ("dll: Couldn't start plugin read-ahead thread %d", i));
+			break;
+		}
+	}
+	prefetch_num_threads = i;
+	META_DEBUG(3, ("dll: Reading %d plugin files ahead on %d threads", 
+				prefetch_count, prefetch_num_threads));
+}
+
+// Wait for read-ahead threads, and put their times in startup timeline.
+static void DLLINTERNAL prefetch_wait(void) {
+	int i;
+
+	for(i=0; i < prefetch_num_threads; i++)
+		os_thread_join(&prefetch_threads[i]);
+	for(i=0; i < prefetch_count; i++) {
+		if(prefetch_files[i].worker >= 0)
+			startup_plugin_step(prefetch_files[i].plug, SS_READ, 
+					&prefetch_files[i].start, &prefetch_files[i].end, 
+					prefetch_files[i].worker);
+	}
+	prefetch_num_threads = 0;
+	prefetch_count = 0;
+	if(prefetch_files) {
+		free(prefetch_files);
+		prefetch_files = NULL;
+	}
+}
+
 // Constructor
 MPluginList::MPluginList(const char *ifile) 
-	: size(MAX_PLUGINS), endlist(0)
+	: plist(0), size(0), endlist(0), dispatch(0), ndispatch(0)
 {
-	int i;
 	// store filename of ini file
 	STRNCPY(inifile, ifile, sizeof(inifile));
 	// initialize array
-	for(i=0; i < size; i++) {
-		//reset to empty
-		plist[i].index=i+1;
-		reset_plugin(&plist[i]);
-	}
+	grow();
 	endlist=0;
 }
 
+// Add PLUGIN_GROWSIZE empty plugins to the list.
+// meta_errno values:
+//  - ME_NOMEM		couldn't realloc or malloc
+mBOOL DLLINTERNAL MPluginList::grow(void) {
+	MPlugin **temp;
+	int i, newsize;
+
+	newsize=size+PLUGIN_GROWSIZE;
+	META_DEBUG(6, ("Growing plugin list from %d to %d", size, newsize));
+	temp=(MPlugin **) realloc(plist, newsize*sizeof(MPlugin *));
+	if(!temp) {
+		META_WARNING("Couldn't grow plugin list to %d: %s", newsize, strerror(errno));
+		RETURN_ERRNO(mFALSE, ME_NOMEM);
+	}
+	plist=temp;
+	// dispatch never holds more than the whole list
+	temp=(MPlugin **) realloc(dispatch, newsize*sizeof(MPlugin *));
+	if(!temp) {
+		META_WARNING("Couldn't grow plugin list to %d: %s", newsize, strerror(errno));
+		RETURN_ERRNO(mFALSE, ME_NOMEM);
+	}
+	dispatch=temp;
+	for(i=size; i < newsize; i++) {
+		plist[i]=(MPlugin *) calloc(1, sizeof(MPlugin));
+		if(!plist[i]) {
+			META_WARNING("Couldn't grow plugin list to %d: %s", newsize, strerror(errno));
+			RETURN_ERRNO(mFALSE, ME_NOMEM);
+		}
+		plist[i]->index=i+1;		// 1-based
+		size=i+1;
+	}
+	return(mTRUE);
+}
+
+// Dispatch order: higher priority first; same priority in list order, as
+// read from plugins.ini.
+static int DLLINTERNAL cmp_dispatch(const void *a, const void *b) {
+	const MPlugin *pa = *(const MPlugin * const *)a;
+	const MPlugin *pb = *(const MPlugin * const *)b;
+
+	if(pa->priority != pb->priority)
+		return(pa->priority > pb->priority ? -1 : 1);
+	return(pa->index - pb->index);
+}
+
+// Collect running plugins into dispatch, in dispatch order.  Called when
+// api hook subscriber lists are rebuilt.
+void DLLINTERNAL MPluginList::sort_dispatch(void) {
+	int i;
+
+	ndispatch=0;
+	for(i=0; i < endlist; i++) {
+		if(plist[i]->status == PL_RUNNING)
+			dispatch[ndispatch++]=plist[i];
+	}
+	qsort(dispatch, ndispatch, sizeof(MPlugin *), cmp_dispatch);
+}
+
 // Resets plugin to empty
 void DLLINTERNAL MPluginList::reset_plugin(MPlugin *pl_find) {
 	int i;
 	
-	//calculate index
-	i = pl_find - &plist[0];
+	//keep index
+	i = pl_find->index;
 	
 	//free any pointers first
 	pl_find->free_api_pointers();
@@ -77,7 +238,7 @@ void DLLINTERNAL MPluginList::reset_plugin(MPlugin *pl_find) {
 	//set zero
 	memset(pl_find, 0, sizeof(*pl_find));
 	
-	pl_find->index=i+1;		// 1-based
+	pl_find->index=i;		// 1-based
 }
 
 // Find a plugin based on the plugin index #.
@@ -88,7 +249,9 @@ MPlugin * DLLINTERNAL MPluginList::find(int pindex) {
 	MPlugin *pfound;
 	if(pindex <= 0)
 		RETURN_ERRNO(NULL, ME_ARGUMENT);
-	pfound=&plist[pindex-1];
+	if(pindex > endlist)
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	pfound=plist[pindex-1];
 	if(pfound->status < PL_VALID)
 		RETURN_ERRNO(NULL, ME_NOTFOUND);
 	else
@@ -105,10 +268,10 @@ MPlugin * DLLINTERNAL MPluginList::find(DLHANDLE handle) {
 	if(!handle)
 		RETURN_ERRNO(NULL, ME_ARGUMENT);
 	for(i=0; i < endlist; i++) {
-		if(plist[i].status < PL_VALID)
+		if(plist[i]->status < PL_VALID)
 			continue;
-		if(plist[i].handle == handle)
-			return(&plist[i]);
+		if(plist[i]->handle == handle)
+			return(plist[i]);
 	}
 	RETURN_ERRNO(NULL, ME_NOTFOUND);
 }
@@ -121,10 +284,10 @@ void DLLINTERNAL MPluginList::clear_source_plugin_index(int source_index) {
 		return;
 	
 	for(i=0; i < endlist; i++) {
-		if(plist[i].status < PL_VALID)
+		if(plist[i]->status < PL_VALID)
 			continue;
-		if(plist[i].source_plugin_index == source_index)
-			plist[i].source_plugin_index = -1;
+		if(plist[i]->source_plugin_index == source_index)
+			plist[i]->source_plugin_index = -1;
 	}
 }
 
@@ -136,9 +299,9 @@ mBOOL DLLINTERNAL MPluginList::found_child_plugins(int source_index) {
 		return(mFALSE);
 	
 	for(i=0; i < endlist; i++) {
-		if(plist[i].status < PL_VALID)
+		if(plist[i]->status < PL_VALID)
 			continue;
-		if(plist[i].source_plugin_index == source_index)
+		if(plist[i]->source_plugin_index == source_index)
 			return(mTRUE);
 	}
 	
@@ -153,7 +316,7 @@ void DLLINTERNAL MPluginList::trim_list(void) {
 		return;
 	
 	for(i=0,n=0; i < endlist; i++) {
-		if(plist[i].status == PL_EMPTY)
+		if(plist[i]->status == PL_EMPTY)
 			continue;
 		n=i+1;
 	}
@@ -172,10 +335,10 @@ MPlugin * DLLINTERNAL MPluginList::find(plid_t id) {
 	if(!id)
 		RETURN_ERRNO(NULL, ME_ARGUMENT);
 	for(i=0; i < endlist; i++) {
-		if(plist[i].status < PL_VALID)
+		if(plist[i]->status < PL_VALID)
 			continue;
-		if(plist[i].info == id)
-			return(&plist[i]);
+		if(plist[i]->info == id)
+			return(plist[i]);
 	}
 	RETURN_ERRNO(NULL, ME_NOTFOUND);
 }
@@ -191,12 +354,12 @@ MPlugin * DLLINTERNAL MPluginList::find(const char *findpath) {
 		RETURN_ERRNO(NULL, ME_ARGUMENT);
 	META_DEBUG(8, ("Looking for loaded plugin with dlfnamepath: %s", findpath));
 	for(i=0; i < endlist; i++) {
-		META_DEBUG(9, ("Looking at: plugin %s loadedpath: %s", plist[i].file, plist[i].pathname));
-		if(plist[i].status < PL_VALID)
+		META_DEBUG(9, ("Looking at: plugin %s loadedpath: %s", plist[i]->file, plist[i]->pathname));
+		if(plist[i]->status < PL_VALID)
 			continue;
-		if(strmatch(plist[i].pathname, findpath)) {
-			META_DEBUG(8, ("Found loaded plugin %s", plist[i].file));
-			return(&plist[i]);
+		if(strmatch(plist[i]->pathname, findpath)) {
+			META_DEBUG(8, ("Found loaded plugin %s", plist[i]->file));
+			return(plist[i]);
 		}
 	}
 	META_DEBUG(8, ("No loaded plugin found with path: %s", findpath));
@@ -207,20 +370,19 @@ MPlugin * DLLINTERNAL MPluginList::find(const char *findpath) {
 // meta_errno values:
 //  - ME_ARGUMENT	null memptr
 //  - ME_NOTFOUND	couldn't find a matching plugin
-//  - errno's from DLFNAME()
 MPlugin * DLLINTERNAL MPluginList::find_memloc(void *memptr) {
 #ifdef linux
-	const char *dlfile;
+	int pindex;
 
 	if(!memptr)
 		RETURN_ERRNO(NULL, ME_ARGUMENT);
-	if(!(dlfile=DLFNAME(memptr))) {
-		META_DEBUG(8, ("DLFNAME failed to find memloc %d", memptr));
-		// meta_errno should be already set in DLFNAME
-		return(NULL);
+	// plugin whose module's address range holds memptr
+	if(!(pindex=modmap_plugin(memptr))) {
+		META_DEBUG(8, ("No plugin module found at memloc %p", memptr));
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
 	}
 	
-	return(find(dlfile));
+	return(find(pindex));
 #else
 	DLHANDLE dlhandle;
 	
@@ -252,7 +414,7 @@ MPlugin * DLLINTERNAL MPluginList::find_match(const char *prefix) {
 	len=strlen(prefix);
 	safevoid_snprintf(buf, sizeof(buf), "mm_%s", prefix);
 	for(i=0; i < endlist; i++) {
-		iplug=&plist[i];
+		iplug=plist[i];
 		if(iplug->status < PL_VALID)
 			continue;
 		if(iplug->info && strncasecmp(iplug->info->name, prefix, len) == 0) {
@@ -307,7 +469,7 @@ MPlugin * DLLINTERNAL MPluginList::find_match(MPlugin *pmatch) {
 		RETURN_ERRNO(NULL, ME_ARGUMENT);
 	pfound=NULL;
 	for(i=0; i < endlist; i++) {
-		iplug=&plist[i];
+		iplug=plist[i];
 		if(pmatch->platform_match(iplug)) {
 			pfound=iplug;
 			break;
@@ -322,7 +484,7 @@ MPlugin * DLLINTERNAL MPluginList::find_match(MPlugin *pmatch) {
 
 // Add a plugin to the list.
 // meta_errno values:
-//  - ME_MAXREACHED		reached max plugins
+//  - ME_NOMEM		couldn't grow list
 MPlugin * DLLINTERNAL MPluginList::add(MPlugin *padd) {
 	int i;
 	MPlugin *iplug;
@@ -330,19 +492,19 @@ MPlugin * DLLINTERNAL MPluginList::add(MPlugin *padd) {
 	// Find either:
 	//  - a slot in the list that's not being used
 	//  - the end of the list
-	for(i=0; i < endlist && plist[i].status != PL_EMPTY; i++);
+	for(i=0; i < endlist && plist[i]->status != PL_EMPTY; i++);
 
-	// couldn't find a slot to use
-	if(i==size) {
-		META_WARNING("Couldn't add plugin '%s' to list; reached max plugins (%d)", 
-				padd->file, i);
-		RETURN_ERRNO(NULL, ME_MAXREACHED);
+	// no slot to use; make some
+	if(i==size && !grow()) {
+		META_WARNING("Couldn't add plugin '%s' to list", padd->file);
+		// meta_errno should be already set in grow()
+		return(NULL);
 	}
 
 	// if we found the end of the list, advance end marker
 	if(i==endlist)
 		endlist++;
-	iplug = &plist[i];
+	iplug = plist[i];
 
 	// copy filename into this free slot
 	STRNCPY(iplug->filename, padd->filename, sizeof(iplug->filename));
@@ -360,6 +522,8 @@ MPlugin * DLLINTERNAL MPluginList::add(MPlugin *padd) {
 	iplug->source_plugin_index=padd->source_plugin_index;
 	// copy status
 	iplug->status=padd->status;
+	// copy priority
+	iplug->priority=padd->priority;
 
 	return(iplug);
 }
@@ -388,7 +552,7 @@ mBOOL DLLINTERNAL MPluginList::ini_startup() {
 	}
 
 	META_LOG("ini: Begin reading plugins list: %s", inifile);
-	for(n=0, ln=1; !feof(fp) && fgets(line, sizeof(line), fp) && n < size; ln++) {
+	for(n=0, ln=1; !feof(fp) && fgets(line, sizeof(line), fp); ln++) {
 		// Remove line terminations.
 		char *cp;
 		if((cp=strrchr(line, '\r')))
@@ -396,34 +560,38 @@ mBOOL DLLINTERNAL MPluginList::ini_startup() {
 		if((cp=strrchr(line, '\n')))
 			*cp='\0';
 		// Parse directly into next entry in array
-		if(!plist[n].ini_parseline(line)) {
+		if(n==size && !grow()) {
+			META_WARNING("ini: Skipping rest of %s from line %d; couldn't grow plugin list", inifile, ln);
+			break;
+		}
+		if(!plist[n]->ini_parseline(line)) {
 			if(meta_errno==ME_FORMAT)
 				META_WARNING("ini: Skipping malformed line %d of %s", ln, 
 						inifile);
 			continue;
 		}
 		// Check for a duplicate - an existing entry with this pathname.
-		if(find(plist[n].pathname)) {
+		if(find(plist[n]->pathname)) {
 			// Should we check platform specific level here?
 			META_INFO("ini: Skipping duplicate plugin, line %d of %s: %s", 
-					ln, inifile, plist[n].pathname);
+					ln, inifile, plist[n]->pathname);
 			continue;
 		}
 		// Check for a matching platform with different platform specifics
 		// level.
-		if(NULL != (pmatch=find_match(&plist[n]))) {
-			if(pmatch->pfspecific >= plist[n].pfspecific) {
+		if(NULL != (pmatch=find_match(plist[n]))) {
+			if(pmatch->pfspecific >= plist[n]->pfspecific) {
 				META_DEBUG(1, ("ini: Skipping plugin, line %d of %s: plugin with higher platform specific level already exists. (%d >= %d)",
-                         ln, inifile, pmatch->pfspecific, plist[n].pfspecific)); 
+                         ln, inifile, pmatch->pfspecific, plist[n]->pfspecific)); 
 				continue;
 			}
 			META_DEBUG(1, ("ini: Plugin in line %d overrides existing plugin with lower platform specific level %d, ours %d",
-					ln, pmatch->pfspecific, plist[n].pfspecific));
+					ln, pmatch->pfspecific, plist[n]->pfspecific));
 			//reset to empty
 			reset_plugin(pmatch);
 		}
-		plist[n].action=PA_LOAD;
-		META_LOG("ini: Read plugin config for: %s", plist[n].desc);
+		plist[n]->action=PA_LOAD;
+		META_LOG("ini: Read plugin config for: %s", plist[n]->desc);
 		n++;
 		endlist=n;		// mark end of list
 	}
@@ -446,6 +614,7 @@ mBOOL DLLINTERNAL MPluginList::ini_refresh() {
 	int n, ln;
 	MPlugin pl_temp;
 	MPlugin *pl_found, *pl_added;
+	mBOOL reorder=mFALSE;
 
 	fp=fopen(inifile, "r");
 	if(!fp) {
@@ -455,7 +624,7 @@ mBOOL DLLINTERNAL MPluginList::ini_refresh() {
 	}
 
 	META_LOG("ini: Begin re-reading plugins list: %s", inifile);
-	for(n=0, ln=1; !feof(fp) && fgets(line, sizeof(line), fp) && n < size; ln++) 
+	for(n=0, ln=1; !feof(fp) && fgets(line, sizeof(line), fp); ln++) 
 	{
 		// Remove line terminations.
 		char *cp;
@@ -509,6 +678,11 @@ mBOOL DLLINTERNAL MPluginList::ini_refresh() {
 			// plugins.ini.
 			if(pl_temp.desc[0] != '<')
 				STRNCPY(pl_found->desc, pl_temp.desc, sizeof(pl_found->desc));
+			// New priority applies right away, also to running plugins.
+			if(pl_found->priority != pl_temp.priority) {
+				pl_found->priority=pl_temp.priority;
+				reorder=mTRUE;
+			}
 
 			// Check the file to see if it looks like it's been modified
 			// since we last loaded it.
@@ -544,6 +718,8 @@ mBOOL DLLINTERNAL MPluginList::ini_refresh() {
 	META_LOG("ini: Finished reading plugins list: %s; Found %d plugins", inifile, n);
 
 	fclose(fp);
+	if(reorder)
+		rebuild_api_hook_subscribers();
 	if(!n) {
 		META_WARNING("ini: Warning; no plugins found to load?");
 	}
@@ -704,18 +880,22 @@ mBOOL DLLINTERNAL MPluginList::load() {
 		// meta_errno should be already set in ini_startup()
 		return(mFALSE);
 	}
+	startup_phase("plugins.ini");
 
+	prefetch_start(plist, endlist);
 	META_LOG("dll: Loading plugins...");
 	for(i=0, n=0; i < endlist; i++) {
-		if(plist[i].status < PL_VALID)
+		if(plist[i]->status < PL_VALID)
 			continue;
-		if(plist[i].load(PT_STARTUP) == mTRUE)
+		if(plist[i]->load(PT_STARTUP) == mTRUE)
 			n++;
 		else
 			// all plugins should be loadable at startup...
-			META_WARNING("dll: Failed to load plugin '%s'", plist[i].file);
+			META_WARNING("dll: Failed to load plugin '%s'", plist[i]->file);
 	}
+	prefetch_wait();
 	META_LOG("dll: Finished loading %d plugins", n);
+	startup_phase("plugins");
 	return(mTRUE);
 }
 
@@ -734,7 +914,7 @@ mBOOL DLLINTERNAL MPluginList::refresh(PLUG_LOADTIME now) {
 
 	META_LOG("dll: Updating plugins...");
 	for(i=0; i < endlist; i++) {
-		iplug=&plist[i];
+		iplug=plist[i];
 		if(iplug->status < PL_VALID)
 			continue;
 		switch(iplug->action) {
@@ -805,7 +985,7 @@ void DLLINTERNAL MPluginList::unpause_all(void) {
 	int i;
 	MPlugin *iplug;
 	for(i=0; i < endlist; i++) {
-		iplug=&plist[i];
+		iplug=plist[i];
 		if(iplug->status==PL_PAUSED)
 			iplug->unpause();
 	}
@@ -819,7 +999,7 @@ void DLLINTERNAL MPluginList::retry_all(PLUG_LOADTIME now) {
 	int i;
 	MPlugin *iplug;
 	for(i=0; i < endlist; i++) {
-		iplug=&plist[i];
+		iplug=plist[i];
 		if(iplug->action != PA_NONE)
 			iplug->retry(now, PNL_DELAYED);
 	}
@@ -847,7 +1027,7 @@ void DLLINTERNAL MPluginList::show(int source_index) {
 			"load ", "unlod");
 	
 	for(i=0; i < endlist; i++) {
-		pl=&plist[i];
+		pl=plist[i];
 		if(pl->status < PL_VALID)
 			continue;
 		if(source_index > 0 && pl->source_plugin_index != source_index)
@@ -885,7 +1065,7 @@ void DLLINTERNAL MPluginList::show_client(edict_t *pEntity) {
 	MPlugin *pl;
 	META_CLIENT(pEntity, "Currently running plugins:");
 	for(i=0; i < endlist; i++) {
-		pl=&plist[i];
+		pl=plist[i];
 		if(pl->status != PL_RUNNING || !pl->info)
 			continue;
 		n++;
@@ -42,27 +42,37 @@
 #include "plinfo.h"			// plid_t, etc
 #include "new_baseclass.h"
 
-// Max number of plugins we can manage.  This is an arbitrary, fixed number,
-// for convenience.  It would probably be better to dynamically grow the
-// list as needed, but we do this for now.
-#define MAX_PLUGINS 50
-// Width required to printf above MAX, for show() functions.
+// Number of plugin slots to add when the list needs to grow.
+#define PLUGIN_GROWSIZE 32
+// Width required to printf a plugin index, for show() functions.
 #define WIDTH_MAX_PLUGINS	2
 
+// Max number of threads reading plugin files ahead at startup.
+#define PREFETCH_MAX_THREADS	8
+
 
 // A list of plugins.
 class MPluginList : public class_metamod_new {
 	public:
 	// data:
-		MPlugin plist[MAX_PLUGINS];			// array of plugins
-		int size;					// size of list, ie MAX_PLUGINS
+		// Plugins are allocated one by one, so that growing the list
+		// doesn't move them; api hook subscriber lists and callers up in
+		// the stack hold pointers to them.
+		MPlugin **plist;				// malloc'd array of plugins
+		int size;					// current size of list
 		int endlist;					// index of last used entry
+		// Running plugins in dispatch order: by priority, highest first,
+		// then by index.  Filled by sort_dispatch().
+		MPlugin **dispatch;
+		int ndispatch;
 		char inifile[PATH_MAX];				// full pathname
 
 	// constructor:
 		MPluginList(const char *ifile) DLLINTERNAL;
 
 	// functions:
+		mBOOL DLLINTERNAL grow(void);				// add PLUGIN_GROWSIZE slots
+		void DLLINTERNAL sort_dispatch(void);			// refill dispatch
 		void DLLINTERNAL reset_plugin(MPlugin *pl_find);
 		MPlugin * DLLINTERNAL find(int pindex);			// find by index
 		MPlugin * DLLINTERNAL find(const char *findpath); 	// find by pathname
@@ -89,6 +99,11 @@ class MPluginList : public class_metamod_new {
 		void DLLINTERNAL show(int source_index);		// list plugins to console
 		void DLLINTERNAL show(void) { show(-1); };		// list plugins to console
 		void DLLINTERNAL show_client(edict_t *pEntity);		// list plugins to player client
+	private:
+		// Private; to satisfy -Weffc++ "has pointer data members but does
+		// not override" copy/assignment constructor.
+		void operator=(const MPluginList &src);
+		MPluginList(const MPluginList &src);
 };
 
 #endif /* MLIST_H */
@@ -38,13 +38,20 @@
 #include <malloc.h>				// malloc, etc
 #include <sys/types.h>			// stat
 #include <sys/stat.h>			// stat
+#ifdef linux
+#include <sys/time.h>			// gettimeofday; win32 in osdep.h
+#endif
 
 #include <extdll.h>				// always
 
 #include "mplugin.h"			// me
 #include "metamod.h"			// GameDLL, etc
 #include "mreg.h"				// MRegCmdList::show(int), etc
-#include "mhook.h"				// class MHook
+#include "thread_logparse.h"	// logparse_plugin_unloaded
+#include "usermsg.h"			// usermsg_plugin_unloaded
+#include "ent_filter.h"			// ent_filter_plugin_unloaded
+#include "cvar_watch.h"			// cvar_watch_plugin_unloaded
+#include "ent_class.h"			// ent_class_plugin_unloaded
 #include "h_export.h"			// GIVE_ENGINE_FUNCTIONS_FN, etc
 #include "dllapi.h"				// FN_GAMEINIT, etc
 #include "support_meta.h"		// full_gamedir_path,
@@ -52,7 +59,30 @@
 #include "log_meta.h"			// logging functions, etc
 #include "osdep.h"				// win32 snprintf, is_absolute_path,
 #include "mm_pextensions.h"
-
+#include "api_hook.h"			// rebuild_api_hook_subscribers
+#include "api_prof.h"			// api_prof_plugin_loaded
+#include "mjobs.h"				// meta_jobs_cancel
+#include "log_queue.h"			// log_queue_plugin_unloaded
+#include "startup_timeline.h"	// startup_plugin_step
+#include "osdep_p.h"				// modmap_plugin_loaded, etc
+
+
+// Take optional "@<priority>" off the start of the rest of a plugins.ini
+// or "meta load" line, ie what's left after the filename.  Returns the
+// rest after it, ie the description.
+static char * DLLINTERNAL parse_priority(char *rest, int *priority) {
+	char *end;
+	long val;
+
+	rest=rest+strspn(rest, " \t");			// skip whitespace
+	if(rest[0] != '@')
+		return(rest);
+	val=strtol(rest+1, &end, 10);
+	if(end==rest+1 || (*end && *end!=' ' && *end!='\t'))
+		return(rest);
+	*priority=val;
+	return(end+strspn(end, " \t"));
+}
 
 // Parse a line from plugins.ini into a plugin.
 // meta_errno values:
@@ -122,13 +152,14 @@ mBOOL DLLINTERNAL MPlugin::ini_parseline(const char *line) {
 	else
 		file=filename;
 
-	// Grab description.
+	// Grab priority and description.
 	// Just get the the rest of the line, minus line-termination.
+	priority=0;
 	token=strtok_r(NULL, "\n\r", &ptr_token);
-	if(token) {
-		token=token+strspn(token, " \t");			// skip whitespace
+	if(token)
+		token=parse_priority(token, &priority);
+	if(token && token[0])
 		STRNCPY(desc, token, sizeof(desc));
-	}
 	else {
 		// If no description is specified, temporarily use plugin file,
 		// until plugin can be queried, and desc replaced with info->name.
@@ -175,13 +206,14 @@ mBOOL DLLINTERNAL MPlugin::cmd_parseline(const char *line) {
 	else
 		file=filename;
 
-	// Grab description.
+	// Grab priority and description.
 	// Specify no delimiter chars, as we just want the rest of the line.
+	priority=0;
 	token=strtok_r(NULL, "", &ptr_token);
-	if(token) {
-		token=token+strspn(token, " \t");			// skip whitespace
+	if(token)
+		token=parse_priority(token, &priority);
+	if(token && token[0])
 		STRNCPY(desc, token, sizeof(desc));
-	}
 	else {
 		// if no description is specified, temporarily use plugin file,
 		// until plugin can be queried, and desc replaced with info->name.
@@ -541,6 +573,8 @@ mBOOL DLLINTERNAL MPlugin::platform_match(MPlugin* other) {
 //  - errno's from attach()
 //  - errno's from check_input()
 mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
+	struct timeval start, end;
+
 	if(!check_input()) {
 		// details logged, meta_errno set in check_input()
 		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
@@ -550,13 +584,15 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 				desc, str_status());
 		RETURN_ERRNO(mFALSE, ME_ALREADY);
 	}
-	if(action != PA_LOAD && action != PA_ATTACH && action != PA_RELOAD) {
+	if(action != PA_LOAD && action != PA_ATTACH && action != PA_RELOAD
+			&& action != PA_HANDOFF) {
 		META_WARNING("dll: Not loading plugin '%s'; not marked for load (action=%s)", desc, str_action());
 		RETURN_ERRNO(mFALSE, ME_BADREQ);
 	}
 
 	if(status <= PL_OPENED) {
 		// query plugin; open file and get info about it
+		gettimeofday(&start, NULL);
 		if(!query()) {
 			META_WARNING("dll: Skipping plugin '%s'; couldn't query", desc);
 			if(meta_errno != ME_DLOPEN) {
@@ -566,6 +602,7 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 				}
 				else
 					handle=NULL;
+				modmap_plugin_unloaded(index);
 			}
 			status=PL_BADFILE;
 			info=NULL; // prevent crash
@@ -573,10 +610,14 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 			return(mFALSE);
 		}
 		status=PL_OPENED;
+		gettimeofday(&end, NULL);
+		startup_plugin_step(this, SS_QUERY, &start, &end, -1);
 	}
 
 	// are we allowed to attach this plugin at this time?
-	if(info->loadable < now) {
+	// Handoff plugins said they can be swapped anytime, by exporting
+	// Meta_ExportState.
+	if(info->loadable < now && action != PA_HANDOFF) {
 		if(info->loadable > PT_STARTUP) {
 			// will try to attach again at next opportunity
 			META_DEBUG(2, ("dll: Delaying load plugin '%s'; can't attach now: allowed=%s; now=%s", 
@@ -593,6 +634,7 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 	}
 
 	// attach plugin; get function tables
+	gettimeofday(&start, NULL);
 	if(attach(now) != mTRUE) {
 		META_WARNING("dll: Failed to attach plugin '%s'", desc);
 		// Note we don't dlclose() here, since we're returning PL_FAILED,
@@ -604,9 +646,13 @@ mBOOL DLLINTERNAL MPlugin::load(PLUG_LOADTIME now) {
 		// meta_errno should be already set in attach()
 		return(mFALSE);
 	}
+	gettimeofday(&end, NULL);
+	startup_plugin_step(this, SS_ATTACH, &start, &end, -1);
 	
 	status=PL_RUNNING;
 	action=PA_NONE;
+	api_prof_plugin_loaded(index, desc);
+	rebuild_api_hook_subscribers();
 		
 	// If not loading at server startup, then need to call plugin's
 	// GameInit, since we've passed that.
@@ -650,6 +696,7 @@ mBOOL DLLINTERNAL MPlugin::query(void) {
 				desc, pathname, DLERROR());
 		RETURN_ERRNO(mFALSE, ME_DLOPEN);
 	}
+	modmap_plugin_loaded(index, handle);
 
 	// First, we check to see if they have a Meta_Query.  We would normally
 	// dlsym this just prior to calling it, after having called
@@ -1012,12 +1059,13 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
 	}
 	if(status < PL_RUNNING) {
-		if(reason != PNL_CMD_FORCED && reason != PNL_RELOAD) {
+		if(reason != PNL_CMD_FORCED && reason != PNL_RELOAD
+				&& reason != PNL_HOT_RELOAD) {
 			META_WARNING("dll: Not unloading plugin '%s'; already unloaded (status=%s)", desc, str_status());
 			RETURN_ERRNO(mFALSE, ME_ALREADY);
 		}
 	}
-	if(action != PA_UNLOAD && action != PA_RELOAD) {
+	if(action != PA_UNLOAD && action != PA_RELOAD && action != PA_HANDOFF) {
 		META_WARNING("dll: Not unloading plugin '%s'; not marked for unload (action=%s)", desc, str_action());
 		RETURN_ERRNO(mFALSE, ME_BADREQ);
 	}
@@ -1028,6 +1076,9 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 		if(reason == PNL_CMD_FORCED) {
 			META_DEBUG(2, ("dll: Forced unload plugin '%s' overriding allowed times: allowed=%s; now=%s", desc, str_unloadable(), str_loadtime(now, SL_SIMPLE)));
 		}
+		else if(reason == PNL_HOT_RELOAD) {
+			META_DEBUG(2, ("dll: Hot reload plugin '%s' overriding allowed times: allowed=%s; now=%s", desc, str_unloadable(), str_loadtime(now, SL_SIMPLE)));
+		}
 		else {
 			if(info->unloadable > PT_STARTUP) {
 				META_DEBUG(2, ("dll: Delaying unload plugin '%s'; can't detach now: allowed=%s; now=%s", desc, str_unloadable(), str_loadtime(now, SL_SIMPLE)));
@@ -1073,6 +1124,14 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 	RegCmds->disable(index);
 	// Unmark registered cvars for this plugin (by index number).
 	RegCvars->disable(index);
+	// Drop queued jobs, and wait for running ones.
+	meta_jobs_cancel(info);
+	log_queue_plugin_unloaded(info);
+	logparse_plugin_unloaded(info);
+	usermsg_plugin_unloaded(info);
+	ent_filter_plugin_unloaded(info);
+	cvar_watch_plugin_unloaded(info);
+	ent_class_plugin_unloaded(info);
 
 	// Close the file.  Note: after this, attempts to reference any memory
 	// locations in the file will produce a segfault.
@@ -1082,6 +1141,7 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 		META_WARNING("dll: Couldn't dlclose plugin file '%s': %s", file, DLERROR());
 	}
 	handle=NULL;
+	modmap_plugin_unloaded(index);
 
 	if(action==PA_UNLOAD) {
 		status=PL_EMPTY;
@@ -1092,6 +1152,12 @@ mBOOL DLLINTERNAL MPlugin::unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL
 		action=PA_LOAD;
 		clear();
 	}
+	else if(action==PA_HANDOFF) {
+		// hot_reload() loads the new instance right away; keep the
+		// action so load() knows to skip the loadable check.
+		status=PL_VALID;
+	}
+	rebuild_api_hook_subscribers();
 	META_LOG("dll: Unloaded plugin '%s' for reason '%s'", desc, str_reason(reason, real_reason));
 	return(mTRUE);
 }
@@ -1173,6 +1239,133 @@ mBOOL DLLINTERNAL MPlugin::reload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason) {
 	return(mTRUE);
 }
 
+// Hot reload a plugin; unload and load again (optionally from a different
+// file), handing the old instance's state to the new one via
+// Meta_ExportState/Meta_ImportState.  This all happens within the one
+// console command, so the engine sees no frame with the plugin missing.
+// Note the old instance has to be closed before the new one is opened, as
+// dlopen() of the same path would just give back the old handle.
+// meta_errno values:
+//  - ME_BADREQ		plugin not running
+//  - ME_DLMISSING	plugin doesn't export Meta_ExportState
+//  - ME_DLERROR	plugin refused to export its state
+//  - ME_NOMEM		couldn't malloc state buffer
+//  - ME_NOTFOUND	couldn't resolve newfile
+//  - ME_ALREADY	newfile belongs to another loaded plugin
+//  - errno's from check_input()
+//  - errno's from unload()
+//  - errno's from load()
+mBOOL DLLINTERNAL MPlugin::hot_reload(const char *newfile) {
+	META_EXPORT_STATE_FN pfn_export;
+	META_IMPORT_STATE_FN pfn_import;
+	char old_filename[PATH_MAX];
+	char old_pathname[PATH_MAX];
+	int old_file;
+	struct timeval start, end;
+	MPlugin *findp;
+	void *data=NULL;
+	int size, ret, nomem=0;
+
+	if(!check_input()) {
+		// details logged, meta_errno set in check_input()
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+	}
+	if(status < PL_RUNNING) {
+		META_WARNING("dll: Cannot hot reload plugin '%s'; not running (status=%s)", desc, str_status());
+		RETURN_ERRNO(mFALSE, ME_BADREQ);
+	}
+	if(!(pfn_export = (META_EXPORT_STATE_FN) DLSYM(handle, "Meta_ExportState"))) {
+		META_WARNING("dll: Cannot hot reload plugin '%s'; no Meta_ExportState(); use 'meta reload'", desc);
+		RETURN_ERRNO(mFALSE, ME_DLMISSING);
+	}
+
+	// Switch to the new file, if given, before touching the old instance.
+	STRNCPY(old_filename, filename, sizeof(old_filename));
+	STRNCPY(old_pathname, pathname, sizeof(old_pathname));
+	old_file=file-pathname;
+	if(newfile && newfile[0]) {
+		STRNCPY(filename, newfile, sizeof(filename));
+		if(!resolve()) {
+			META_WARNING("dll: Cannot hot reload plugin '%s'; couldn't resolve '%s'", desc, newfile);
+			STRNCPY(filename, old_filename, sizeof(filename));
+			STRNCPY(pathname, old_pathname, sizeof(pathname));
+			file=pathname+old_file;
+			RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+		}
+		findp=Plugins->find(pathname);
+		if(findp && findp != this) {
+			META_WARNING("dll: Cannot hot reload plugin '%s'; file '%s' is already loaded as plugin '%s'", desc, pathname, findp->desc);
+			STRNCPY(filename, old_filename, sizeof(filename));
+			STRNCPY(pathname, old_pathname, sizeof(pathname));
+			file=pathname+old_file;
+			RETURN_ERRNO(mFALSE, ME_ALREADY);
+		}
+	}
+
+	gettimeofday(&start, NULL);
+
+	// Ask for the size first, then for the state itself.
+	size=pfn_export(NULL, 0);
+	if(size > 0) {
+		if(!(data=malloc(size))) {
+			META_WARNING("dll: Cannot hot reload plugin '%s'; failed malloc() of %d bytes for state", desc, size);
+			size=-1;
+			nomem=1;
+		}
+		else
+			size=pfn_export(data, size);
+	}
+	if(size < 0) {
+		if(data)
+			free(data);
+		if(nomem)
+			meta_errno=ME_NOMEM;
+		else {
+			META_WARNING("dll: Cannot hot reload plugin '%s'; Meta_ExportState() refused", desc);
+			meta_errno=ME_DLERROR;
+		}
+		STRNCPY(filename, old_filename, sizeof(filename));
+		STRNCPY(pathname, old_pathname, sizeof(pathname));
+		file=pathname+old_file;
+		return(mFALSE);
+	}
+
+	action=PA_HANDOFF;
+	if(!unload(PT_ANYTIME, PNL_HOT_RELOAD, PNL_HOT_RELOAD)) {
+		META_WARNING("dll: Failed to unload plugin '%s' for hot reload", desc);
+		free(data);
+		action=PA_NONE;
+		// old instance still runs from the old file
+		STRNCPY(filename, old_filename, sizeof(filename));
+		STRNCPY(pathname, old_pathname, sizeof(pathname));
+		file=pathname+old_file;
+		// meta_errno should be set already in unload()
+		return(mFALSE);
+	}
+	if(!load(PT_ANYTIME)) {
+		META_WARNING("dll: Failed to hot reload plugin '%s' after unloading; state is lost", desc);
+		free(data);
+		// leave it for 'meta retry', as a plain load
+		action=PA_LOAD;
+		// meta_errno should be set already in load()
+		return(mFALSE);
+	}
+
+	pfn_import = (META_IMPORT_STATE_FN) DLSYM(handle, "Meta_ImportState");
+	if(!pfn_import)
+		META_WARNING("dll: Plugin '%s' has no Meta_ImportState(); state is lost", desc);
+	else if((ret=pfn_import(data, size)) != TRUE)
+		META_WARNING("dll: Plugin '%s' didn't take state: Error from Meta_ImportState(): %d", desc, ret);
+	free(data);
+
+	gettimeofday(&end, NULL);
+	META_LOG("dll: Hot reloaded plugin '%s' with %d bytes of state in %.3f ms", 
+			desc, size, 
+			(end.tv_sec - start.tv_sec) * 1000.0 
+			+ (end.tv_usec - start.tv_usec) / 1000.0);
+	return(mTRUE);
+}
+
 // Pause a plugin; temporarily disabled for API routines.
 // meta_errno values:
 //  - ME_ALREADY	this plugin already paused
@@ -1196,6 +1389,7 @@ mBOOL MPlugin::pause(void) {
 	}
 
 	status=PL_PAUSED;
+	rebuild_api_hook_subscribers();
 	META_LOG("Paused plugin '%s'", desc);
 	return(mTRUE);
 }
@@ -1209,6 +1403,7 @@ mBOOL DLLINTERNAL MPlugin::unpause(void) {
 		RETURN_ERRNO(mFALSE, ME_BADREQ);
 	}
 	status=PL_RUNNING;
+	rebuild_api_hook_subscribers();
 	META_LOG("Unpaused plugin '%s'", desc);
 	return(mTRUE);
 }
@@ -1268,11 +1463,15 @@ mBOOL DLLINTERNAL MPlugin::clear(void) {
 	}
 	// If file is open, close the file.  Note: after this, attempts to
 	// reference any memory locations in the file will produce a segfault.
+	if(handle && info)
+		meta_jobs_cancel(info);
 	if(handle && DLCLOSE(handle) != 0) {
 		META_WARNING("dll: Couldn't close plugin file '%s': %s", file, DLERROR());
 		status=PL_FAILED;
 		RETURN_ERRNO(mFALSE, ME_DLERROR);
 	}
+	if(handle)
+		modmap_plugin_unloaded(index);
 	handle=NULL;
 
 	free_api_pointers();
@@ -1305,6 +1504,7 @@ void DLLINTERNAL MPlugin::show(void) {
 	META_CONS("%*s: %s", width, "file", file);
 	META_CONS("%*s: %s", width, "pathname", pathname);
 	META_CONS("%*s: %d", width, "index", index);
+	META_CONS("%*s: %d", width, "priority", priority);
 	META_CONS("%*s: %s", width, "source", str_source());
 	META_CONS("%*s: %s", width, "loadable", str_loadable(SL_ALLOWED));
 	META_CONS("%*s: %s", width, "unloadable", str_unloadable(SL_ALLOWED));
@@ -1456,6 +1656,9 @@ const char * DLLINTERNAL MPlugin::str_action(STR_ACTION fmt) {
 		case PA_RELOAD:
 			if(fmt==SA_SHOW) return("relo");
 			else return("reload");
+		case PA_HANDOFF:
+			if(fmt==SA_SHOW) return("hand");
+			else return("handoff");
 		default:
 			if(fmt==SA_SHOW) return(META_UTIL_VarArgs("UNK%d", action));
 			else return(META_UTIL_VarArgs("unknown (%d)", action));
@@ -1530,6 +1733,8 @@ const char * DLLINTERNAL MPlugin::str_reason(PL_UNLOAD_REASON preason, PL_UNLOAD
 			return(META_UTIL_VarArgs("%s (forced request from plugin[%d])", buf, unloader_index));
 		case PNL_RELOAD:
 			return("reloading");
+		case PNL_HOT_RELOAD:
+			return("hot reload with state handoff");
 		default:
 			return(META_UTIL_VarArgs("unknown (%d)", preal_reason));
 	}
@@ -50,6 +50,9 @@
 #include "new_baseclass.h"
 
 
+// words in msg_type bitset of message filter, see MPlugin::msg_filter
+#define MSG_FILTER_WORDS (256 / 32)
+
 // Flags to indicate current "load" state of plugin.
 // NOTE: order is important, as greater/less comparisons are made.
 typedef enum {
@@ -72,6 +75,7 @@ typedef enum {
 	PA_ATTACH,			// attach
 	PA_UNLOAD,			// unload (detach, dlclose)
 	PA_RELOAD,			// unload and load again
+	PA_HANDOFF,			// unload and load again, handing over state
 } PLUG_ACTION;
 
 // Flags to indicate from where the plugin was loaded.
@@ -118,10 +122,18 @@ typedef struct {
 class MPlugin : public class_metamod_new {
 	public:
 	// data:
-		// reordered for faster api_hook.cpp functions
+		// reordered for faster api_hook.cpp functions; what the hook
+		// functions read comes first, ahead of the large name buffers
 		PLUG_STATUS status;				// current status of plugin (loaded, etc)
 		api_tables_t tables;
 		api_tables_t post_tables;
+		int index;					// 1-based
+		int priority;					// dispatch order; higher first, ties by index
+		
+		// msg_types wanted by the message hooks (MessageBegin, Write*,
+		// MessageEnd), pre and post; see ADD_MSG_FILTER in mutil.h
+		mBOOL msg_filtered[2];
+		unsigned int msg_filter[2][MSG_FILTER_WORDS];
 		
 		inline DLLINTERNAL void * get_api_table(enum_api_t api) {
 			return(((void**)&tables)[api]);
@@ -130,7 +142,6 @@ class MPlugin : public class_metamod_new {
 			return(((void**)&post_tables)[api]);
 		}
 		
-		int index;					// 1-based
 		int pfspecific;                  		// level of specific platform affinity, used during load time
 		PLUG_ACTION action;				// what to do with plugin (load, unload, etc)
 		PLOAD_SOURCE source;				// source of the request to load the plugin
@@ -164,6 +175,7 @@ class MPlugin : public class_metamod_new {
 		mBOOL DLLINTERNAL load(PLUG_LOADTIME now);
 		mBOOL DLLINTERNAL unload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason, PL_UNLOAD_REASON real_reason);
 		mBOOL DLLINTERNAL reload(PLUG_LOADTIME now, PL_UNLOAD_REASON reason);
+		mBOOL DLLINTERNAL hot_reload(const char *newfile);	// reload, keeping state
 		mBOOL DLLINTERNAL pause(void);
 		mBOOL DLLINTERNAL unpause(void);
 		mBOOL DLLINTERNAL retry(PLUG_LOADTIME now, PL_UNLOAD_REASON reason); // if previously failed
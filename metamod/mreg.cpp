@@ -42,12 +42,13 @@
 #endif /* linux */
 
 #include <string.h>			// strsignal, strdup, etc
+#include <ctype.h>			// tolower
 #include <errno.h>			// strerror, etc
 
 #include <extdll.h>			// always
 
 #include "mreg.h"			// me
-#include "metamod.h"		// Plugins, etc
+#include "metamod.h"		// Plugins, GET_TSC, etc
 #include "mlist.h"			// class MPluginList
 #include "mplugin.h"		// class MPlugin
 #include "types_meta.h"		// mBOOL
@@ -55,6 +56,32 @@
 #include "osdep.h"			// os_safe_call, etc
 
 
+// Initial size of the cmd and cvar name hashes.
+#define REG_HASH_MINSIZE	64
+
+// Case-insensitive name hash.  Also used for the case-sensitive usermsg
+// names; equal names still hash equal.
+static unsigned int DLLINTERNAL reg_hash(const char *name) {
+	unsigned int h=2166136261u;
+
+	while(*name)
+		h=(h ^ (unsigned char) tolower(*name++)) * 16777619u;
+	return(h);
+}
+
+// Put list index into an open-addressed table, at the first free slot
+// from the name's hash on.  Entries are never removed, so an earlier
+// entry with the same name is always found first, same as the linear
+// scan this replaced.
+static void DLLINTERNAL reg_hash_insert(int *table, int tsize, const char *name, int i) {
+	unsigned int slot;
+
+	for(slot=reg_hash(name) & (tsize-1); table[slot]; slot=(slot+1) & (tsize-1))
+		;
+	table[slot]=i+1;
+}
+
+
 ///// class MRegCmd:
 
 // Init values.  It would probably be more "proper" to use containers and
@@ -66,6 +93,9 @@ void DLLINTERNAL MRegCmd::init(int idx)
 	pfnCmd = NULL;
 	plugid = 0;
 	status = RG_INVALID;
+	calls = 0;
+	ticks = 0;
+	max_ticks = 0;
 }
 
 // Try to call the function.  Relies on OS-specific routine to attempt
@@ -74,7 +104,12 @@ void DLLINTERNAL MRegCmd::init(int idx)
 // meta_errno values:
 //  - ME_BADREQ		function disabled/invalid
 //  - ME_ARGUMENT	function pointer is null
+//
+// The function may register further commands, growing (and moving) the
+// list we're in; so after the call, find ourself again by index.
 mBOOL DLLINTERNAL MRegCmd::call(void) {
+	MRegCmd *self;
+	unsigned long long start, elapsed;
 	mBOOL ret;
 
 	// can we expect to call this function?
@@ -84,14 +119,25 @@ mBOOL DLLINTERNAL MRegCmd::call(void) {
 		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
 
 	// try to call this function
+	start=GET_TSC();
 	ret=os_safe_call(pfnCmd);
+	elapsed=GET_TSC() - start;
+
+	self=RegCmds->get(index);
+	if(!self)
+		return(ret);
 	if(!ret) {
-		META_DEBUG(4, ("Plugin reg_cmd '%s' called after unloaded; removed from list", name));
-		status=RG_INVALID;
-		pfnCmd=NULL;
+		META_DEBUG(4, ("Plugin reg_cmd '%s' called after unloaded; removed from list", self->name));
+		self->status=RG_INVALID;
+		self->pfnCmd=NULL;
 		// NOTE: we can't free the malloc'd space for the name, as that
 		// would just re-introduce the segfault problem..
+		return(ret);
 	}
+	self->calls++;
+	self->ticks += elapsed;
+	if(elapsed > self->max_ticks)
+		self->max_ticks = elapsed;
 	// meta_errno (if failed) is set already in os_safe_call()
 	return(ret);
 }
@@ -101,7 +147,7 @@ mBOOL DLLINTERNAL MRegCmd::call(void) {
 
 // Constructor
 MRegCmdList::MRegCmdList(void)
-	: mlist(0), size(REG_CMD_GROWSIZE), endlist(0)
+	: mlist(0), size(REG_CMD_GROWSIZE), endlist(0), hash(0), hashsize(REG_HASH_MINSIZE)
 {
 	int i;
 	mlist = (MRegCmd *) calloc(1, size * sizeof(MRegCmd));
@@ -109,13 +155,47 @@ MRegCmdList::MRegCmdList(void)
 	for(i=0; i < size; i++)
 		mlist[i].init(i+1);		// 1-based index
 	endlist=0;
+	hash = (int *) calloc(hashsize, sizeof(int));
+}
+
+// Add mlist[i] to the name hash, doubling the hash when it gets half
+// full.  If the hash can't be allocated, find() falls back to scanning
+// the list.
+void DLLINTERNAL MRegCmdList::hash_add(int i) {
+	int j, *temp;
+
+	if(!hash)
+		return;
+	if((i+1)*2 > hashsize) {
+		temp = (int *) calloc(hashsize*2, sizeof(int));
+		free(hash);
+		hash=temp;
+		if(!hash) {
+			META_WARNING("Couldn't grow registered command hash to %d: %s", hashsize*2, strerror(errno));
+			return;
+		}
+		hashsize*=2;
+		for(j=0; j < i; j++)
+			reg_hash_insert(hash, hashsize, mlist[j].name, j);
+	}
+	reg_hash_insert(hash, hashsize, mlist[i].name, i);
 }
 
 // Try to find a registered function with the given name.
 // meta_errno values:
 //  - ME_NOTFOUND	couldn't find a matching function
 MRegCmd * DLLINTERNAL MRegCmdList::find(const char *findname) {
+	unsigned int slot;
 	int i;
+
+	if(likely(hash)) {
+		for(slot=reg_hash(findname) & (hashsize-1); hash[slot]; slot=(slot+1) & (hashsize-1)) {
+			i=hash[slot]-1;
+			if(!strcasecmp(mlist[i].name, findname))
+				return(&mlist[i]);
+		}
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	}
 	for(i=0; i < endlist; i++) {
 		if(!strcasecmp(mlist[i].name, findname))
 			return(&mlist[i]);
@@ -123,6 +203,15 @@ MRegCmd * DLLINTERNAL MRegCmdList::find(const char *findname) {
 	RETURN_ERRNO(NULL, ME_NOTFOUND);
 }
 
+// Return the registered function with the given (1-based) index.
+// meta_errno values:
+//  - ME_NOTFOUND	no such function
+MRegCmd * DLLINTERNAL MRegCmdList::get(int getindex) {
+	if(getindex < 1 || getindex > endlist)
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	return(&mlist[getindex-1]);
+}
+
 // Add the given name to the list and return the instance.  This only
 // writes the "name" to the new cmd; other fields are writtin by caller
 // (meta_AddServerCommand).
@@ -164,6 +253,7 @@ MRegCmd * DLLINTERNAL MRegCmdList::add(const char *addname) {
 		RETURN_ERRNO(NULL, ME_NOMEM);
 	}
 	endlist++;
+	hash_add(endlist-1);
 	
 	return(icmd);
 }
@@ -185,9 +275,10 @@ void DLLINTERNAL MRegCmdList::show(void) {
 	char bplug[18+1];	// +1 for term null
 
 	META_CONS("Registered plugin commands:");
-	META_CONS("  %*s  %-*s  %-s", 
+	META_CONS("  %*s  %-*s  %7s  %10s  %10s  %-s", 
 			WIDTH_MAX_REG, "",
-			sizeof(bplug)-1, "plugin", "command");
+			sizeof(bplug)-1, "plugin",
+			"calls", "avg ticks", "max ticks", "command");
 	
 	for(i=0; i < endlist; i++) {
 		icmd = &mlist[i];
@@ -203,9 +294,12 @@ void DLLINTERNAL MRegCmdList::show(void) {
 		else
 			STRNCPY(bplug, "(unloaded)", sizeof(bplug));
 		
-		META_CONS(" [%*d] %-*s  %-s", 
+		META_CONS(" [%*d] %-*s  %7lu  %10llu  %10llu  %-s", 
 				WIDTH_MAX_REG, icmd->index, 
 				sizeof(bplug)-1, bplug,
+				icmd->calls,
+				icmd->calls ? icmd->ticks / icmd->calls : 0ULL,
+				icmd->max_ticks,
 				icmd->name);
 		
 		if(icmd->status==RG_VALID)
@@ -279,7 +373,7 @@ mBOOL DLLINTERNAL MRegCvar::set(cvar_t *src) {
 
 // Constructor
 MRegCvarList::MRegCvarList(void)
-	: vlist(0), size(REG_CVAR_GROWSIZE), endlist(0)
+	: vlist(0), size(REG_CVAR_GROWSIZE), endlist(0), hash(0), hashsize(REG_HASH_MINSIZE)
 {
 	int i;
 	vlist = (MRegCvar *) calloc(1, size * sizeof(MRegCvar));
@@ -287,6 +381,28 @@ MRegCvarList::MRegCvarList(void)
 	for(i=0; i < size; i++)
 		vlist[i].init(i+1);		// 1-based
 	endlist=0;
+	hash = (int *) calloc(hashsize, sizeof(int));
+}
+
+// Add vlist[i] to the name hash; see MRegCmdList::hash_add().
+void DLLINTERNAL MRegCvarList::hash_add(int i) {
+	int j, *temp;
+
+	if(!hash)
+		return;
+	if((i+1)*2 > hashsize) {
+		temp = (int *) calloc(hashsize*2, sizeof(int));
+		free(hash);
+		hash=temp;
+		if(!hash) {
+			META_WARNING("Couldn't grow registered cvar hash to %d: %s", hashsize*2, strerror(errno));
+			return;
+		}
+		hashsize*=2;
+		for(j=0; j < i; j++)
+			reg_hash_insert(hash, hashsize, vlist[j].data->name, j);
+	}
+	reg_hash_insert(hash, hashsize, vlist[i].data->name, i);
 }
 
 // Add the given cvar name to the list and return the instance.  This only
@@ -337,6 +453,7 @@ MRegCvar * DLLINTERNAL MRegCvarList::add(const char *addname) {
 		RETURN_ERRNO(NULL, ME_NOMEM);
 	}
 	endlist++;
+	hash_add(endlist-1);
 	
 	return(icvar);
 }
@@ -345,7 +462,17 @@ MRegCvar * DLLINTERNAL MRegCvarList::add(const char *addname) {
 // meta_errno values:
 //  - ME_NOTFOUND	couldn't find a matching cvar
 MRegCvar * DLLINTERNAL MRegCvarList::find(const char *findname) {
+	unsigned int slot;
 	int i;
+
+	if(likely(hash)) {
+		for(slot=reg_hash(findname) & (hashsize-1); hash[slot]; slot=(slot+1) & (hashsize-1)) {
+			i=hash[slot]-1;
+			if(!strcasecmp(vlist[i].data->name, findname))
+				return(&vlist[i]);
+		}
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	}
 	for(i=0; i < endlist; i++) {
 		if(!strcasecmp(vlist[i].data->name, findname))
 			return(&vlist[i]);
@@ -459,6 +586,8 @@ MRegMsgList::MRegMsgList(void)
 		mlist[i].index=i+1;		// 1-based
 	}
 	endlist=0;
+	memset(byid, 0, sizeof(byid));
+	memset(byname, 0, sizeof(byname));
 }
 
 // Add the given user msg the list and return the instance.
@@ -484,6 +613,17 @@ MRegMsg * DLLINTERNAL MRegMsgList::add(const char *addname, int addmsgid, int ad
 	imsg->msgid=addmsgid;
 	imsg->size=addsize;
 
+	// First registration of a msgid or name wins, as with a linear scan.
+	// byname has twice as many slots as mlist, so never fills up.
+	if(addmsgid >= 0 && addmsgid < MAX_REG_MSGS && !byid[addmsgid])
+		byid[addmsgid]=imsg->index;
+	if(addname) {
+		unsigned int slot;
+		for(slot=reg_hash(addname) % ARRAYSIZE(byname); byname[slot]; slot=(slot+1) % ARRAYSIZE(byname))
+			;
+		byname[slot]=imsg->index;
+	}
+
 	return(imsg);
 }
 
@@ -491,8 +631,13 @@ MRegMsg * DLLINTERNAL MRegMsgList::add(const char *addname, int addmsgid, int ad
 // meta_errno values:
 //  - ME_NOTFOUND	couldn't find a matching cvar
 MRegMsg * DLLINTERNAL MRegMsgList::find(const char *findname) {
+	unsigned int slot;
 	int i;
-	for(i=0; i < endlist; i++) {
+
+	if(!findname)
+		RETURN_ERRNO(NULL, ME_NOTFOUND);
+	for(slot=reg_hash(findname) % ARRAYSIZE(byname); byname[slot]; slot=(slot+1) % ARRAYSIZE(byname)) {
+		i=byname[slot]-1;
 		if(!mm_strcmp(mlist[i].name, findname))
 			return(&mlist[i]);
 	}
@@ -504,6 +649,13 @@ MRegMsg * DLLINTERNAL MRegMsgList::find(const char *findname) {
 //  - ME_NOTFOUND	couldn't find a matching cvar
 MRegMsg * DLLINTERNAL MRegMsgList::find(int findmsgid) {
 	int i;
+
+	// engine msgids are bytes; scan only for anything odd
+	if(likely(findmsgid >= 0 && findmsgid < MAX_REG_MSGS)) {
+		if(!byid[findmsgid])
+			RETURN_ERRNO(NULL, ME_NOTFOUND);
+		return(&mlist[byid[findmsgid]-1]);
+	}
 	for(i=0; i < endlist; i++) {
 		if(mlist[i].msgid == findmsgid)
 			return(&mlist[i]);
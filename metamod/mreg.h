@@ -82,6 +82,9 @@ class MRegCmd : public class_metamod_new {
 		REG_CMD_FN pfnCmd;		// pointer to the function
 		int plugid;			// index id of corresponding plugin
 		REG_STATUS status;		// whether corresponding plugin is loaded
+		unsigned long calls;		// times called, for "meta cmds"
+		unsigned long long ticks;	// total cpu ticks spent in function
+		unsigned long long max_ticks;	// longest single call, in ticks
 	// functions:
 		void DLLINTERNAL init(int idx);	// init values, as not using constructors
 		mBOOL DLLINTERNAL call(void);	// try to call the function
@@ -95,10 +98,14 @@ class MRegCmdList : public class_metamod_new {
 		MRegCmd *mlist;			// malloc'd array of registered commands
 		int size;			// current size of list
 		int endlist;			// index of last used entry
+		int *hash;			// name hash; open-addressed, mlist index+1
+		int hashsize;			// power of 2, at least twice endlist
 		// Private; to satisfy -Weffc++ "has pointer data members but does
 		// not override" copy/assignment constructor.
 		void operator=(const MRegCmdList &src);
 		MRegCmdList(const MRegCmdList &src);
+	// functions:
+		void DLLINTERNAL hash_add(int i);	// add mlist[i] to hash
 
 	public:
 	// constructor:
@@ -106,6 +113,7 @@ class MRegCmdList : public class_metamod_new {
 
 	// functions:
 		MRegCmd * DLLINTERNAL find(const char *findname);	// find by MRegCmd->name
+		MRegCmd * DLLINTERNAL get(int getindex);		// find by MRegCmd->index
 		MRegCmd * DLLINTERNAL add(const char *addname);
 		void DLLINTERNAL disable(int plugin_id);		// change status to Invalid
 		void DLLINTERNAL show(void);			// list all funcs to console
@@ -137,10 +145,14 @@ class MRegCvarList : public class_metamod_new {
 		MRegCvar *vlist;		// malloc'd array of registered cvars
 		int size;			// size of list, ie MAX_REG_CVARS
 		int endlist;			// index of last used entry
+		int *hash;			// name hash; open-addressed, vlist index+1
+		int hashsize;			// power of 2, at least twice endlist
 		// Private; to satisfy -Weffc++ "has pointer data members but does
 		// not override" copy/assignment constructor.
 		void operator=(const MRegCvarList &src);
 		MRegCvarList(const MRegCvarList &src);
+	// functions:
+		void DLLINTERNAL hash_add(int i);	// add vlist[i] to hash
 
 	public:
 	// constructor:
@@ -176,6 +188,9 @@ class MRegMsgList : public class_metamod_new {
 		MRegMsg mlist[MAX_REG_MSGS];	// array of registered msgs
 		int size;						// size of list, ie MAX_REG_MSGS
 		int endlist;					// index of last used entry
+		// mlist index+1 by msgid, and open-addressed by name hash
+		short byid[MAX_REG_MSGS];
+		short byname[MAX_REG_MSGS*2];
 
 	public:
 	// constructor:
@@ -42,12 +42,21 @@
 
 #include "meta_api.h"		// 
 #include "mutil.h"			// me
-#include "mhook.h"			// class MHookList, etc
+#include "mhook.h"			// META_LOG_EVENT_FN, etc
 #include "linkent.h"		// ENTITY_FN, etc
 #include "metamod.h"		// Hooks, etc
 #include "types_meta.h"		// mBOOL
 #include "osdep.h"			// win32 vsnprintf, etc
 #include "sdk_util.h"		// ALERT, etc
+#include "mjobs.h"			// meta_jobs_queue, etc
+#include "log_queue.h"		// log_queue_plugin
+#include "thread_logparse.h"	// logparse_register, etc
+#include "usermsg.h"		// usermsg_register, etc
+#include "ent_filter.h"		// ent_filter_add_class, etc
+#include "ent_index.h"		// ent_index_find, etc
+#include "ent_grid.h"		// ent_grid_query
+#include "cvar_watch.h"		// cvar_watch_register, etc
+#include "ent_class.h"		// ent_class_register, etc
 
 static hudtextparms_t default_csay_tparms = {
 	-1, 0.25,			// x, y
@@ -77,46 +86,31 @@ static void mutil_LogConsole(plid_t /* plid */, const char *fmt, ...) {
 	SERVER_PRINT(buf);
 }
 
-// Log regular message to logs; newline added.
+// Log regular message to logs; newline added.  Queued; see log_queue.h.
 static void mutil_LogMessage(plid_t plid, const char *fmt, ...) {
 	va_list ap;
-	char buf[MAX_LOGMSG_LEN];
-	plugin_info_t *plinfo;
 
-	plinfo=(plugin_info_t *)plid;
 	va_start(ap, fmt);
-	safevoid_vsnprintf(buf, sizeof(buf), fmt, ap);
+	log_queue_plugin(plid, LOGQ_MESSAGE, fmt, ap);
 	va_end(ap);
-	ALERT(at_logged, "[%s] %s\n", plinfo->logtag, buf);
 }
 
 // Log an error message to logs; newline added.
 static void mutil_LogError(plid_t plid, const char *fmt, ...) {
 	va_list ap;
-	char buf[MAX_LOGMSG_LEN];
-	plugin_info_t *plinfo;
 
-	plinfo=(plugin_info_t *)plid;
 	va_start(ap, fmt);
-	safevoid_vsnprintf(buf, sizeof(buf), fmt, ap);
+	log_queue_plugin(plid, LOGQ_ERROR, fmt, ap);
 	va_end(ap);
-	ALERT(at_logged, "[%s] ERROR: %s\n", plinfo->logtag, buf);
 }
 
 // Log a message only if cvar "developer" set; newline added.
 static void mutil_LogDeveloper(plid_t plid, const char *fmt, ...) {
 	va_list ap;
-	char buf[MAX_LOGMSG_LEN];
-	plugin_info_t *plinfo;
-
-	if((int)CVAR_GET_FLOAT("developer") == 0)
-		return;
 
-	plinfo=(plugin_info_t *)plid;
 	va_start(ap, fmt);
-	safevoid_vsnprintf(buf, sizeof(buf), fmt, ap);
+	log_queue_plugin(plid, LOGQ_DEVELOPER, fmt, ap);
 	va_end(ap);
-	ALERT(at_logged, "[%s] dev: %s\n", plinfo->logtag, buf);
 }
 
 // Print a center-message, with text parameters and varargs.  Provides
@@ -372,6 +366,121 @@ static void mutil_GetHookTables(plid_t plid, enginefuncs_t **peng, DLL_FUNCTIONS
 		*pnewdll = g_pHookedNewDllFunctions;
 }
 
+// Run 'work' on a metamod worker thread, and 'done' on main thread at
+// next StartFrame after it.
+static int mutil_QueueJob(plid_t plid, META_JOB_FN work, META_JOB_FN done, void *data) {
+	return(meta_jobs_queue(plid, work, done, data));
+}
+
+// Run 'func' on main thread at next StartFrame; for jobs that need to
+// call engine.
+static int mutil_QueueMainThread(plid_t plid, META_JOB_FN func, void *data) {
+	return(meta_jobs_queue_main(plid, func, data));
+}
+
+// Call 'fn' for every gamedll log line matching 'pattern' (see
+// thread_logparse.h).  Returns event id, or 0 if pattern is bad.
+static int mutil_RegLogEvent(plid_t plid, const char *pattern, META_LOG_EVENT_FN fn, void *data) {
+	return(logparse_register(plid, pattern, fn, data));
+}
+
+static int mutil_UnregLogEvent(plid_t plid, int id) {
+	return(logparse_unregister(plid, id));
+}
+
+// Call 'fn' at end of every message gamedll sends with the given name
+// (or msgid, if name is NULL), with the whole message; see usermsg.h.
+// Returns subscription id, or 0 on error.
+static int mutil_RegUserMsgHook(plid_t plid, const char *msgname, int msgid, META_USERMSG_FN fn, void *data) {
+	return(usermsg_register(plid, msgname, msgid, fn, data));
+}
+
+static int mutil_UnregUserMsgHook(plid_t plid, int id) {
+	return(usermsg_unregister(plid, id));
+}
+
+// Have plugin's MessageBegin, Write* and MessageEnd hooks (pre or post
+// table) called only for the messages added with this, by name or msgid
+// if name is NULL.
+static int mutil_AddMsgFilter(plid_t plid, int post, const char *msgname, int msgid) {
+	return(usermsg_filter_add(plid, post, msgname, msgid));
+}
+
+// Remove message filter; message hooks get every message again.
+static int mutil_ClearMsgFilter(plid_t plid, int post) {
+	return(usermsg_filter_clear(plid, post));
+}
+
+// Have plugin's Spawn, Think, Use, Touch, Blocked and KeyValue hooks
+// (pre or post table) called only for entities with the classnames or
+// edict indexes added with these; see ent_filter.h.
+static int mutil_AddEntClassFilter(plid_t plid, int post, const char *classname) {
+	return(ent_filter_add_class(plid, post, classname));
+}
+
+static int mutil_AddEntIndexFilter(plid_t plid, int post, int index) {
+	return(ent_filter_add_index(plid, post, index));
+}
+
+// Remove entity filter; entity hooks get every entity again.
+static int mutil_ClearEntFilter(plid_t plid, int post) {
+	return(ent_filter_clear(plid, post));
+}
+
+// Integer id of name, for comparing with GET_ENTITY_KEY_ID; see
+// ent_index.h.
+static int mutil_GetStringId(plid_t plid, const char *str) {
+	return(ent_index_string_id(str));
+}
+
+static int mutil_GetEntityKeyId(plid_t plid, const edict_t *pEdict, entkey_t key) {
+	return(ent_index_key_id(pEdict, key));
+}
+
+// Like FIND_ENTITY_BY_STRING with "classname", "targetname" or "target",
+// but from metamod's entity index, without calling engine.
+static edict_t *mutil_FindEntityByKey(plid_t plid, const edict_t *pStart, entkey_t key, const char *value) {
+	return(ent_index_find_name(pStart, key, value));
+}
+
+static edict_t *mutil_FindEntityByKeyId(plid_t plid, const edict_t *pStart, entkey_t key, int id) {
+	return(ent_index_find(pStart, key, id));
+}
+
+// Store up to 'max' entities that FIND_ENTITY_IN_SPHERE would return to
+// 'list', in the same order; answered from metamod's entity grid, see
+// ent_grid.h.  Returns number stored.
+static int mutil_FindEntitiesInSphere(plid_t plid, const float *origin, float radius, edict_t **list, int max) {
+	return(ent_grid_query(origin, radius, list, max));
+}
+
+// Engine's cvar_t for cvar, to read its value directly instead of with
+// CVAR_GET_FLOAT every frame.
+static cvar_t *mutil_GetCvarHandle(plid_t plid, const char *name) {
+	return(cvar_watch_handle(name));
+}
+
+// Call 'fn' whenever value of cvar changes; see cvar_watch.h.  Returns
+// subscription id, or 0 on error.
+static int mutil_RegCvarHook(plid_t plid, const char *name, META_CVAR_FN fn, void *data) {
+	return(cvar_watch_register(plid, name, fn, data));
+}
+
+static int mutil_UnregCvarHook(plid_t plid, int id) {
+	return(cvar_watch_unregister(plid, id));
+}
+
+// Have engine find 'fn' for entities of classname, like a
+// LINK_ENTITY_TO_CLASS export; see ent_class.h.  Returns 1, or 0 with
+// meta_errno set.
+static int mutil_RegEntityClass(plid_t plid, const char *classname, META_ENTITY_FN fn) {
+	return(ent_class_register(plid, classname, fn));
+}
+
+static int mutil_UnregEntityClass(plid_t plid, const char *classname) {
+	return(ent_class_unregister(plid, classname));
+}
+
 // Meta Utility Function table.
 mutil_funcs_t MetaUtilFunctions = {
 	mutil_LogConsole,		// pfnLogConsole
@@ -392,4 +501,25 @@ mutil_funcs_t MetaUtilFunctions = {
 	mutil_IsQueryingClientCvar, // pfnIsQueryingClientCvar
 	mutil_MakeRequestID, 	// pfnMakeRequestID
 	mutil_GetHookTables,   // pfnGetHookTables
+	mutil_QueueJob,			// pfnQueueJob
+	mutil_QueueMainThread,	// pfnQueueMainThread
+	mutil_RegLogEvent,		// pfnRegLogEvent
+	mutil_UnregLogEvent,	// pfnUnregLogEvent
+	mutil_RegUserMsgHook,	// pfnRegUserMsgHook
+	mutil_UnregUserMsgHook,	// pfnUnregUserMsgHook
+	mutil_AddMsgFilter,		// pfnAddMsgFilter
+	mutil_ClearMsgFilter,	// pfnClearMsgFilter
+	mutil_AddEntClassFilter,	// pfnAddEntClassFilter
+	mutil_AddEntIndexFilter,	// pfnAddEntIndexFilter
+	mutil_ClearEntFilter,	// pfnClearEntFilter
+	mutil_GetStringId,		// pfnGetStringId
+	mutil_GetEntityKeyId,	// pfnGetEntityKeyId
+	mutil_FindEntityByKey,	// pfnFindEntityByKey
+	mutil_FindEntityByKeyId,	// pfnFindEntityByKeyId
+	mutil_FindEntitiesInSphere,	// pfnFindEntitiesInSphere
+	mutil_GetCvarHandle,	// pfnGetCvarHandle
+	mutil_RegCvarHook,		// pfnRegCvarHook
+	mutil_UnregCvarHook,	// pfnUnregCvarHook
+	mutil_RegEntityClass,	// pfnRegEntityClass
+	mutil_UnregEntityClass,	// pfnUnregEntityClass
 };
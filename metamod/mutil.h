@@ -39,7 +39,7 @@
 
 #include "comp_dep.h"
 #include "plinfo.h"		// plugin_info_t, etc
-#include "mhook.h"		// game_event_t, etc
+#include "mhook.h"		// META_LOG_EVENT_FN, META_USERMSG_FN, etc
 #include "sdk_util.h"	// hudtextparms_t, etc
 
 // max buffer size for printed messages
@@ -55,6 +55,19 @@ typedef enum {
 	GINFO_REALDLL_FULLPATH,
 } ginfo_t;
 
+// For FindEntityByKey, etc:
+typedef enum {
+	ENTKEY_CLASSNAME = 0,
+	ENTKEY_TARGETNAME,
+	ENTKEY_TARGET,
+} entkey_t;
+
+// For QueueJob/QueueMainThread:
+typedef void (*META_JOB_FN)(void *data);
+
+// For RegEntityClass; same as the gamedll's LINK_ENTITY_TO_CLASS functions.
+typedef void (*META_ENTITY_FN)(entvars_t *pev);
+
 // Meta Utility Function table type.
 typedef struct meta_util_funcs_s {
 	void		(*pfnLogConsole)		(plid_t plid, const char *fmt, ...);
@@ -82,6 +95,36 @@ typedef struct meta_util_funcs_s {
 	int (*pfnMakeRequestID)	(plid_t plid);
 	
 	void            (*pfnGetHookTables)             (plid_t plid, enginefuncs_t **peng, DLL_FUNCTIONS **pdll, NEW_DLL_FUNCTIONS **pnewdll);
+	
+	int (*pfnQueueJob)	(plid_t plid, META_JOB_FN work, META_JOB_FN done, void *data);
+	int (*pfnQueueMainThread)	(plid_t plid, META_JOB_FN func, void *data);
+	
+	int (*pfnRegLogEvent)	(plid_t plid, const char *pattern, META_LOG_EVENT_FN fn, void *data);
+	int (*pfnUnregLogEvent)	(plid_t plid, int id);
+	
+	int (*pfnRegUserMsgHook)	(plid_t plid, const char *msgname, int msgid, META_USERMSG_FN fn, void *data);
+	int (*pfnUnregUserMsgHook)	(plid_t plid, int id);
+	
+	int (*pfnAddMsgFilter)	(plid_t plid, int post, const char *msgname, int msgid);
+	int (*pfnClearMsgFilter)	(plid_t plid, int post);
+	
+	int (*pfnAddEntClassFilter)	(plid_t plid, int post, const char *classname);
+	int (*pfnAddEntIndexFilter)	(plid_t plid, int post, int index);
+	int (*pfnClearEntFilter)	(plid_t plid, int post);
+	
+	int (*pfnGetStringId)	(plid_t plid, const char *str);
+	int (*pfnGetEntityKeyId)	(plid_t plid, const edict_t *pEdict, entkey_t key);
+	edict_t *(*pfnFindEntityByKey)	(plid_t plid, const edict_t *pStart, entkey_t key, const char *value);
+	edict_t *(*pfnFindEntityByKeyId)	(plid_t plid, const edict_t *pStart, entkey_t key, int id);
+	
+	int (*pfnFindEntitiesInSphere)	(plid_t plid, const float *origin, float radius, edict_t **list, int max);
+	
+	cvar_t *(*pfnGetCvarHandle)	(plid_t plid, const char *name);
+	int (*pfnRegCvarHook)	(plid_t plid, const char *name, META_CVAR_FN fn, void *data);
+	int (*pfnUnregCvarHook)	(plid_t plid, int id);
+	
+	int (*pfnRegEntityClass)	(plid_t plid, const char *classname, META_ENTITY_FN fn);
+	int (*pfnUnregEntityClass)	(plid_t plid, const char *classname);
 } mutil_funcs_t;
 extern mutil_funcs_t MetaUtilFunctions DLLHIDDEN;
 
@@ -104,5 +147,26 @@ extern mutil_funcs_t MetaUtilFunctions DLLHIDDEN;
 #define IS_QUERYING_CLIENT_CVAR (*gpMetaUtilFuncs->pfnIsQueryingClientCvar)
 #define MAKE_REQUESTID		(*gpMetaUtilFuncs->pfnMakeRequestID)
 #define GET_HOOK_TABLES         (*gpMetaUtilFuncs->pfnGetHookTables)
+#define QUEUE_JOB			(*gpMetaUtilFuncs->pfnQueueJob)
+#define QUEUE_MAIN_THREAD	(*gpMetaUtilFuncs->pfnQueueMainThread)
+#define REG_LOG_EVENT		(*gpMetaUtilFuncs->pfnRegLogEvent)
+#define UNREG_LOG_EVENT		(*gpMetaUtilFuncs->pfnUnregLogEvent)
+#define REG_USERMSG_HOOK	(*gpMetaUtilFuncs->pfnRegUserMsgHook)
+#define UNREG_USERMSG_HOOK	(*gpMetaUtilFuncs->pfnUnregUserMsgHook)
+#define ADD_MSG_FILTER		(*gpMetaUtilFuncs->pfnAddMsgFilter)
+#define CLEAR_MSG_FILTER	(*gpMetaUtilFuncs->pfnClearMsgFilter)
+#define ADD_ENT_CLASS_FILTER	(*gpMetaUtilFuncs->pfnAddEntClassFilter)
+#define ADD_ENT_INDEX_FILTER	(*gpMetaUtilFuncs->pfnAddEntIndexFilter)
+#define CLEAR_ENT_FILTER	(*gpMetaUtilFuncs->pfnClearEntFilter)
+#define GET_STRING_ID		(*gpMetaUtilFuncs->pfnGetStringId)
+#define GET_ENTITY_KEY_ID	(*gpMetaUtilFuncs->pfnGetEntityKeyId)
+#define FIND_ENTITY_BY_KEY	(*gpMetaUtilFuncs->pfnFindEntityByKey)
+#define FIND_ENTITY_BY_KEY_ID	(*gpMetaUtilFuncs->pfnFindEntityByKeyId)
+#define FIND_ENTITIES_IN_SPHERE	(*gpMetaUtilFuncs->pfnFindEntitiesInSphere)
+#define GET_CVAR_HANDLE		(*gpMetaUtilFuncs->pfnGetCvarHandle)
+#define REG_CVAR_HOOK		(*gpMetaUtilFuncs->pfnRegCvarHook)
+#define UNREG_CVAR_HOOK		(*gpMetaUtilFuncs->pfnUnregCvarHook)
+#define REG_ENTITY_CLASS	(*gpMetaUtilFuncs->pfnRegEntityClass)
+#define UNREG_ENTITY_CLASS	(*gpMetaUtilFuncs->pfnUnregEntityClass)
 
 #endif /* MUTIL_H */
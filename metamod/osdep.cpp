@@ -51,6 +51,7 @@
 #include "log_meta.h"		// META_ERROR, etc
 #include "types_meta.h"		// mBOOL
 #include "support_meta.h"	// MAX_STRBUF_LEN
+#include "osdep_p.h"			// modmap_fname
 #include "limits.h"		// INT_MAX
 
 
@@ -248,10 +249,9 @@ char * DLLINTERNAL str_GetLastError(void) {
 // Errno values:
 //  - ME_NOTFOUND	couldn't find a sharedlib that contains memory location
 const char * DLLINTERNAL DLFNAME(void *memptr) {
-	Dl_info dli;
-	memset(&dli, 0, sizeof(dli));
-	if(dladdr(memptr, &dli))
-		return(dli.dli_fname);
+	const char *fname;
+	if((fname=modmap_fname(memptr)))
+		return(fname);
 	else
 		RETURN_ERRNO(NULL, ME_NOTFOUND);
 }
@@ -357,15 +357,15 @@ char * DLLINTERNAL realpath(const char *file_name, char *resolved_name) {
 // should expect to be able to reference strings or functions at this
 // location without segfaulting).
 #ifdef linux
-// Simulate this with dladdr.  I'm not convinced this will be as generally
-// applicable as the native windows routine below, but it should do what
-// we need it for in this particular situation.
+// Simulate this by checking that the pointer is inside a loaded sharedlib,
+// looked up in the module map rather than with dladdr.  I'm not convinced
+// this will be as generally applicable as the native windows routine
+// below, but it should do what we need it for in this particular
+// situation.
 // meta_errno values:
 //  - ME_NOTFOUND	couldn't find a matching sharedlib for this ptr
 mBOOL DLLINTERNAL IS_VALID_PTR(void *memptr) {
-	Dl_info dli;
-	memset(&dli, 0, sizeof(dli));
-	if(dladdr(memptr, &dli))
+	if(modmap_fname(memptr))
 		return(mTRUE);
 	else
 		RETURN_ERRNO(mFALSE, ME_NOTFOUND);
@@ -213,6 +213,31 @@ mBOOL DLLINTERNAL os_safe_call(REG_CMD_FN pfn);
 	
 	#define sleep(x) Sleep(x*1000)
 
+	// struct timeval is in winsock, which WIN32_LEAN_AND_MEAN leaves out;
+	// mingw has gettimeofday itself, MSVC doesn't.
+	#include <winsock2.h>
+	#ifdef _MSC_VER
+		inline int DLLINTERNAL gettimeofday(struct timeval *tv, void *tz) {
+			FILETIME ft;
+			unsigned __int64 t;
+			GetSystemTimeAsFileTime(&ft);
+			// 100ns units since 1601 to usec since 1970
+			t = (((unsigned __int64)ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 10;
+			t -= 11644473600000000ULL;
+			tv->tv_sec = (long)(t / 1000000);
+			tv->tv_usec = (long)(t % 1000000);
+			return(0);
+		}
+	#else
+		#include <sys/time.h>
+	#endif /* _MSC_VER */
+
+	// MSVC before 12.0 has no va_copy; va_list is a plain pointer there.
+	#include <stdarg.h>
+	#ifndef va_copy
+		#define va_copy(d, s)	((d) = (s))
+	#endif
+
 	// Fixed MSVC compiling, by Nikolay "The Storm" Baklicharov.
 	#if defined(__GNUC__) || defined (_MSC_VER) && _MSC_VER >= 1400
 		#define snprintf	_snprintf
@@ -304,4 +329,118 @@ inline const char * DLLINTERNAL str_os_error(void) {
 }
 
 
+// Threads, for worker pool and log formatter.  Only the few primitives
+// needed; mutex, counting semaphore, thread start/join.
+#ifdef linux
+	#include <pthread.h>
+	#include <semaphore.h>
+	typedef pthread_mutex_t os_mutex_t;
+	typedef sem_t os_sem_t;
+	typedef pthread_t os_thread_t;
+	#define OS_THREAD_FN(name, arg) static void * name(void *arg)
+	#define OS_THREAD_RETURN return(NULL)
+	typedef void *(*os_thread_fn_t)(void *);
+
+	inline void DLLINTERNAL os_mutex_init(os_mutex_t *m) { pthread_mutex_init(m, NULL); }
+	inline void DLLINTERNAL os_mutex_lock(os_mutex_t *m) { pthread_mutex_lock(m); }
+	inline void DLLINTERNAL os_mutex_unlock(os_mutex_t *m) { pthread_mutex_unlock(m); }
+	inline void DLLINTERNAL os_mutex_destroy(os_mutex_t *m) { pthread_mutex_destroy(m); }
+	inline int DLLINTERNAL os_sem_init(os_sem_t *s) { return(sem_init(s, 0, 0) == 0); }
+	inline void DLLINTERNAL os_sem_wait(os_sem_t *s) { while(sem_wait(s) != 0 && errno == EINTR); }
+	inline void DLLINTERNAL os_sem_post(os_sem_t *s) { sem_post(s); }
+	inline void DLLINTERNAL os_sem_destroy(os_sem_t *s) { sem_destroy(s); }
+	inline int DLLINTERNAL os_thread_start(os_thread_t *t, os_thread_fn_t fn, void *arg) {
+		return(pthread_create(t, NULL, fn, arg) == 0);
+	}
+	inline void DLLINTERNAL os_thread_join(os_thread_t *t) { pthread_join(*t, NULL); }
+	inline unsigned long DLLINTERNAL os_thread_id(void) { return((unsigned long)pthread_self()); }
+	inline void DLLINTERNAL os_sleep_ms(int ms) { usleep(ms * 1000); }
+	inline int DLLINTERNAL os_num_cpus(void) { return(sysconf(_SC_NPROCESSORS_ONLN)); }
+#elif defined(_WIN32)
+	typedef CRITICAL_SECTION os_mutex_t;
+	typedef HANDLE os_sem_t;
+	typedef HANDLE os_thread_t;
+	#define OS_THREAD_FN(name, arg) static DWORD WINAPI name(LPVOID arg)
+	#define OS_THREAD_RETURN return(0)
+	typedef LPTHREAD_START_ROUTINE os_thread_fn_t;
+
+	inline void DLLINTERNAL os_mutex_init(os_mutex_t *m) { InitializeCriticalSection(m); }
+	inline void DLLINTERNAL os_mutex_lock(os_mutex_t *m) { EnterCriticalSection(m); }
+	inline void DLLINTERNAL os_mutex_unlock(os_mutex_t *m) { LeaveCriticalSection(m); }
+	inline void DLLINTERNAL os_mutex_destroy(os_mutex_t *m) { DeleteCriticalSection(m); }
+	inline int DLLINTERNAL os_sem_init(os_sem_t *s) {
+		*s = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+		return(*s != NULL);
+	}
+	inline void DLLINTERNAL os_sem_wait(os_sem_t *s) { WaitForSingleObject(*s, INFINITE); }
+	inline void DLLINTERNAL os_sem_post(os_sem_t *s) { ReleaseSemaphore(*s, 1, NULL); }
+	inline void DLLINTERNAL os_sem_destroy(os_sem_t *s) { CloseHandle(*s); }
+	inline int DLLINTERNAL os_thread_start(os_thread_t *t, os_thread_fn_t fn, void *arg) {
+		*t = CreateThread(NULL, 0, fn, arg, 0, NULL);
+		return(*t != NULL);
+	}
+	inline void DLLINTERNAL os_thread_join(os_thread_t *t) {
+		WaitForSingleObject(*t, INFINITE);
+		CloseHandle(*t);
+	}
+	inline unsigned long DLLINTERNAL os_thread_id(void) { return(GetCurrentThreadId()); }
+	inline void DLLINTERNAL os_sleep_ms(int ms) { Sleep(ms); }
+	inline int DLLINTERNAL os_num_cpus(void) {
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		return(si.dwNumberOfProcessors);
+	}
+#endif /* _WIN32 */
+
+// Atomic operations and thread-local storage, for counters and lists
+// shared with worker threads.  os_atomic_add and os_atomic_swap return
+// the previous value; os_atomic_cas returns true if *p was 'oldval' and
+// is now 'newval'.  Only the types in use are provided.
+#ifdef linux
+	#define OS_THREAD_LOCAL __thread
+
+	inline int DLLINTERNAL os_atomic_cas(int volatile *p, int oldval, int newval) {
+		return(__sync_bool_compare_and_swap(p, oldval, newval));
+	}
+	inline int DLLINTERNAL os_atomic_cas(unsigned int volatile *p, unsigned int oldval, unsigned int newval) {
+		return(__sync_bool_compare_and_swap(p, oldval, newval));
+	}
+	template<typename T> inline int DLLINTERNAL os_atomic_cas(T * volatile *p, T *oldval, T *newval) {
+		return(__sync_bool_compare_and_swap(p, oldval, newval));
+	}
+	inline int DLLINTERNAL os_atomic_add(int volatile *p, int n) { return(__sync_fetch_and_add(p, n)); }
+	inline unsigned int DLLINTERNAL os_atomic_add(unsigned int volatile *p, unsigned int n) { return(__sync_fetch_and_add(p, n)); }
+	inline unsigned long DLLINTERNAL os_atomic_add(unsigned long volatile *p, unsigned long n) { return(__sync_fetch_and_add(p, n)); }
+	inline int DLLINTERNAL os_atomic_swap(int volatile *p, int n) { return(__sync_lock_test_and_set(p, n)); }
+	template<typename T> inline T * DLLINTERNAL os_atomic_swap(T * volatile *p, T *n) {
+		return(__sync_lock_test_and_set(p, n));
+	}
+	// Store 0 after a os_atomic_swap spinlock.
+	inline void DLLINTERNAL os_atomic_release(int volatile *p) { __sync_lock_release(p); }
+	inline void DLLINTERNAL os_memory_barrier(void) { __sync_synchronize(); }
+#elif defined(_WIN32)
+	#define OS_THREAD_LOCAL __declspec(thread)
+
+	// int and long are both 32 bits on win32 and win64.
+	inline int DLLINTERNAL os_atomic_cas(int volatile *p, int oldval, int newval) {
+		return(InterlockedCompareExchange((LONG volatile *)p, newval, oldval) == oldval);
+	}
+	inline int DLLINTERNAL os_atomic_cas(unsigned int volatile *p, unsigned int oldval, unsigned int newval) {
+		return((unsigned int)InterlockedCompareExchange((LONG volatile *)p, newval, oldval) == oldval);
+	}
+	template<typename T> inline int DLLINTERNAL os_atomic_cas(T * volatile *p, T *oldval, T *newval) {
+		return(InterlockedCompareExchangePointer((PVOID volatile *)p, (PVOID)newval, (PVOID)oldval) == (PVOID)oldval);
+	}
+	inline int DLLINTERNAL os_atomic_add(int volatile *p, int n) { return(InterlockedExchangeAdd((LONG volatile *)p, n)); }
+	inline unsigned int DLLINTERNAL os_atomic_add(unsigned int volatile *p, unsigned int n) { return(InterlockedExchangeAdd((LONG volatile *)p, n)); }
+	inline unsigned long DLLINTERNAL os_atomic_add(unsigned long volatile *p, unsigned long n) { return(InterlockedExchangeAdd((LONG volatile *)p, n)); }
+	inline int DLLINTERNAL os_atomic_swap(int volatile *p, int n) { return(InterlockedExchange((LONG volatile *)p, n)); }
+	template<typename T> inline T * DLLINTERNAL os_atomic_swap(T * volatile *p, T *n) {
+		return((T *)InterlockedExchangePointer((PVOID volatile *)p, (PVOID)n));
+	}
+	inline void DLLINTERNAL os_atomic_release(int volatile *p) { InterlockedExchange((LONG volatile *)p, 0); }
+	inline void DLLINTERNAL os_memory_barrier(void) { MemoryBarrier(); }
+#endif /* _WIN32 */
+
+
 #endif /* OSDEP_H */
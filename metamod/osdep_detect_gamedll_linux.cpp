@@ -37,6 +37,9 @@
 #include <signal.h>			// sigaction, etc
 #include <setjmp.h>			// sigsetjmp, longjmp, etc
 #include <sys/mman.h>			// mmap, munmap, mprotect, etc
+#include <sys/stat.h>			// fstat
+#include <fcntl.h>			// open
+#include <unistd.h>			// close
 #include <link.h>
 #include <elf.h>
 
@@ -80,7 +83,8 @@ static void signal_handler_sigsegv(int) {
 		return(mFALSE); \
 	} while(0)
 
-mBOOL DLLINTERNAL is_gamedll(const char *filename) {
+// Section scan, for libraries without DT_GNU_HASH/DT_HASH.
+static mBOOL DLLINTERNAL_NOVIS is_gamedll_sections(const char *filename) {
 	// When these are not static there are some mysterious hidden bugs that I can't find/solve.
 	// So this is simple workaround.
 	static struct sigaction action;
@@ -339,3 +343,299 @@ mBOOL DLLINTERNAL is_gamedll(const char *filename) {
 	
 	return(mFALSE);
 }
+
+
+// Dynamic symbol lookup.
+//  A library's exports are all in its dynamic symbol table, which the
+//  dynamic linker finds through PT_DYNAMIC and searches with the
+//  DT_GNU_HASH or DT_HASH table.  We do the same on the mmap'd file, so
+//  only the headers, the hash table and the few symbols and names looked
+//  up are read, rather than every symbol of every section.  All reads are
+//  checked against the file size, so no SIGSEGV handler is needed.
+#ifdef __x86_64__
+#define ELFW_ST_TYPE(x)	ELF64_ST_TYPE(x)
+#define ELFW_ST_BIND(x)	ELF64_ST_BIND(x)
+#define ELF_CLASS_WANT	ELFCLASS64
+#define ELF_MACHINE_WANT	EM_X86_64
+#else
+#define ELFW_ST_TYPE(x)	ELF32_ST_TYPE(x)
+#define ELFW_ST_BIND(x)	ELF32_ST_BIND(x)
+#define ELF_CLASS_WANT	ELFCLASS32
+#define ELF_MACHINE_WANT	EM_386
+#endif
+
+typedef struct elf_image_s {
+	const char *base;
+	unsigned long size;
+	const ElfW(Phdr) *phdr;
+	int phnum;
+	const ElfW(Sym) *symtab;
+	unsigned long nsyms;			// symbols that fit in file
+	const char *strtab;
+	unsigned long strsz;
+	const Elf32_Word *gnu_hash;
+	const Elf32_Word *hash;
+} elf_image_t;
+
+// Pointer to len bytes at file offset, or NULL if outside file.
+static inline const void * DLLINTERNAL_NOVIS elf_at(const elf_image_t *img,
+		unsigned long offset, unsigned long len)
+{
+	if(offset > img->size || len > img->size - offset)
+		return(NULL);
+	return(img->base + offset);
+}
+
+// Pointer to len bytes at virtual address, through PT_LOAD segments.
+static const void * DLLINTERNAL_NOVIS elf_vaddr(const elf_image_t *img,
+		ElfW(Addr) vaddr, unsigned long len)
+{
+	int i;
+
+	for(i=0; i < img->phnum; i++) {
+		const ElfW(Phdr) *ph = &img->phdr[i];
+		if(ph->p_type != PT_LOAD)
+			continue;
+		if(vaddr >= ph->p_vaddr && vaddr - ph->p_vaddr < ph->p_filesz)
+			return(elf_at(img, ph->p_offset + (vaddr - ph->p_vaddr), len));
+	}
+	return(NULL);
+}
+
+// Whether symbol i is called name.
+static int DLLINTERNAL_NOVIS elf_sym_is(const elf_image_t *img,
+		unsigned long i, const char *name, unsigned long len)
+{
+	unsigned long st_name;
+
+	if(i >= img->nsyms)
+		return(0);
+	st_name = img->symtab[i].st_name;
+	if(st_name >= img->strsz || len >= img->strsz - st_name)
+		return(0);
+	return(!memcmp(img->strtab + st_name, name, len)
+			&& img->strtab[st_name + len] == '\0');
+}
+
+static const ElfW(Sym) * DLLINTERNAL_NOVIS elf_lookup_gnu(const elf_image_t *img,
+		const char *name)
+{
+	const Elf32_Word *hdr, *buckets, *chain;
+	const ElfW(Addr) *bloom;
+	Elf32_Word nbuckets, symoffset, bloom_size, bloom_shift;
+	unsigned long off, len, i;
+	ElfW(Addr) word, mask;
+	Elf32_Word h, h2;
+	const unsigned char *cp;
+
+	hdr = img->gnu_hash;
+	nbuckets = hdr[0];
+	symoffset = hdr[1];
+	bloom_size = hdr[2];
+	bloom_shift = hdr[3];
+	// sizes checked first, so the multiplies below can't overflow
+	if(!nbuckets || !bloom_size || nbuckets > img->size / sizeof(Elf32_Word)
+			|| bloom_size > img->size / sizeof(ElfW(Addr)))
+		return(NULL);
+	off = (const char *)hdr - img->base + 4 * sizeof(Elf32_Word);
+	if(!(bloom=(const ElfW(Addr) *)elf_at(img, off, bloom_size * sizeof(ElfW(Addr)))))
+		return(NULL);
+	off += bloom_size * sizeof(ElfW(Addr));
+	if(!(buckets=(const Elf32_Word *)elf_at(img, off, nbuckets * sizeof(Elf32_Word))))
+		return(NULL);
+	off += nbuckets * sizeof(Elf32_Word);
+	chain = (const Elf32_Word *)(img->base + off);
+
+	for(h=5381, cp=(const unsigned char *)name; *cp; cp++)
+		h = h * 33 + *cp;
+	len = (const char *)cp - name;
+
+	// bloom filter rules out most misses without touching the chains
+	word = bloom[(h / (8 * sizeof(ElfW(Addr)))) % bloom_size];
+	mask = ((ElfW(Addr))1 << (h % (8 * sizeof(ElfW(Addr)))))
+		| ((ElfW(Addr))1 << ((h >> bloom_shift) % (8 * sizeof(ElfW(Addr)))));
+	if((word & mask) != mask)
+		return(NULL);
+
+	i = buckets[h % nbuckets];
+	if(i < symoffset)
+		return(NULL);
+	for(;; i++) {
+		if(!elf_at(img, off + (i - symoffset) * sizeof(Elf32_Word), sizeof(Elf32_Word)))
+			return(NULL);
+		h2 = chain[i - symoffset];
+		if((h | 1) == (h2 | 1) && elf_sym_is(img, i, name, len))
+			return(&img->symtab[i]);
+		// low bit marks end of chain
+		if(h2 & 1)
+			return(NULL);
+	}
+}
+
+static const ElfW(Sym) * DLLINTERNAL_NOVIS elf_lookup_sysv(const elf_image_t *img,
+		const char *name)
+{
+	const Elf32_Word *buckets, *chain;
+	Elf32_Word nbucket, nchain, h, g;
+	unsigned long len, i, n;
+	const unsigned char *cp;
+
+	nbucket = img->hash[0];
+	nchain = img->hash[1];
+	if(!nbucket || nbucket > img->size / sizeof(Elf32_Word)
+			|| nchain > img->size / sizeof(Elf32_Word)
+			|| !elf_at(img, (const char *)img->hash - img->base,
+				(2 + nbucket + nchain) * sizeof(Elf32_Word)))
+		return(NULL);
+	buckets = &img->hash[2];
+	chain = &buckets[nbucket];
+
+	for(h=0, cp=(const unsigned char *)name; *cp; cp++) {
+		h = (h << 4) + *cp;
+		if((g = h & 0xf0000000))
+			h ^= g >> 24;
+		h &= ~g;
+	}
+	len = (const char *)cp - name;
+
+	// n guards against loops in a corrupt chain
+	for(i=buckets[h % nbucket], n=0; i && i < nchain && n < nchain; i=chain[i], n++) {
+		if(elf_sym_is(img, i, name, len))
+			return(&img->symtab[i]);
+	}
+	return(NULL);
+}
+
+// Whether library exports function name.
+static int DLLINTERNAL_NOVIS elf_exports(const elf_image_t *img, const char *name) {
+	const ElfW(Sym) *sym;
+
+	if(img->gnu_hash)
+		sym = elf_lookup_gnu(img, name);
+	else
+		sym = elf_lookup_sysv(img, name);
+	return(sym && sym->st_shndx != SHN_UNDEF
+			&& ELFW_ST_TYPE(sym->st_info) == STT_FUNC
+			&& ELFW_ST_BIND(sym->st_info) == STB_GLOBAL);
+}
+
+// Find dynamic symbol and hash tables.  Returns 1 if found, 0 if library
+// has no hash table, -1 if it isn't a valid library for this platform.
+static int DLLINTERNAL_NOVIS elf_dynamic(elf_image_t *img, const char *filename) {
+	const ElfW(Ehdr) *ehdr;
+	const ElfW(Dyn) *dyn;
+	ElfW(Addr) symtab=0, strtab=0, gnu_hash=0, hash=0;
+	unsigned long ndyn, i;
+	int j;
+
+	ehdr = (const ElfW(Ehdr) *)elf_at(img, 0, sizeof(ElfW(Ehdr)));
+	if(!ehdr || mm_strncmp((const char *)ehdr, ELFMAG, SELFMAG) != 0
+			|| ehdr->e_ident[EI_VERSION] != EV_CURRENT) {
+		META_DEBUG(3, ("is_gamedll(%s): Failed, file isn't ELF.", filename));
+		return(-1);
+	}
+	if(ehdr->e_ident[EI_CLASS] != ELF_CLASS_WANT || ehdr->e_type != ET_DYN
+			|| ehdr->e_machine != ELF_MACHINE_WANT) {
+		META_DEBUG(3, ("is_gamedll(%s): Failed, ELF isn't for this target. [%x:%x:%x]", filename,
+			ehdr->e_ident[EI_CLASS], ehdr->e_type, ehdr->e_machine));
+		return(-1);
+	}
+	if(ehdr->e_phentsize != sizeof(ElfW(Phdr))
+			|| !(img->phdr=(const ElfW(Phdr) *)elf_at(img, ehdr->e_phoff,
+					ehdr->e_phnum * sizeof(ElfW(Phdr))))) {
+		META_DEBUG(3, ("is_gamedll(%s): Invalid ELF program headers.", filename));
+		return(-1);
+	}
+	img->phnum = ehdr->e_phnum;
+
+	for(j=0, dyn=NULL, ndyn=0; j < img->phnum; j++) {
+		if(img->phdr[j].p_type == PT_DYNAMIC) {
+			ndyn = img->phdr[j].p_filesz / sizeof(ElfW(Dyn));
+			dyn = (const ElfW(Dyn) *)elf_at(img, img->phdr[j].p_offset,
+					ndyn * sizeof(ElfW(Dyn)));
+			break;
+		}
+	}
+	if(!dyn) {
+		META_DEBUG(3, ("is_gamedll(%s): No dynamic section.", filename));
+		return(0);
+	}
+	for(i=0; i < ndyn && dyn[i].d_tag != DT_NULL; i++) {
+		switch(dyn[i].d_tag) {
+			case DT_SYMTAB:		symtab = dyn[i].d_un.d_ptr; break;
+			case DT_STRTAB:		strtab = dyn[i].d_un.d_ptr; break;
+			case DT_STRSZ:		img->strsz = dyn[i].d_un.d_val; break;
+			case DT_GNU_HASH:	gnu_hash = dyn[i].d_un.d_ptr; break;
+			case DT_HASH:		hash = dyn[i].d_un.d_ptr; break;
+		}
+	}
+
+	img->symtab = (const ElfW(Sym) *)elf_vaddr(img, symtab, sizeof(ElfW(Sym)));
+	img->strtab = (const char *)elf_vaddr(img, strtab, img->strsz);
+	if(gnu_hash)
+		img->gnu_hash = (const Elf32_Word *)elf_vaddr(img, gnu_hash, 4 * sizeof(Elf32_Word));
+	if(hash)
+		img->hash = (const Elf32_Word *)elf_vaddr(img, hash, 2 * sizeof(Elf32_Word));
+	if(!img->symtab || !img->strtab || (!img->gnu_hash && !img->hash)) {
+		META_DEBUG(3, ("is_gamedll(%s): No dynamic symbol hash table.", filename));
+		return(0);
+	}
+	img->nsyms = (img->size - ((const char *)img->symtab - img->base)) / sizeof(ElfW(Sym));
+	return(1);
+}
+
+mBOOL DLLINTERNAL is_gamedll(const char *filename) {
+	elf_image_t img;
+	struct stat st;
+	void *map;
+	int fd, ret;
+	mBOOL gamedll;
+
+	if((fd=open(filename, O_RDONLY)) < 0) {
+		META_DEBUG(3, ("is_gamedll(%s): Failed, cannot open() file.", filename));
+		return(mFALSE);
+	}
+	if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ElfW(Ehdr))) {
+		META_DEBUG(3, ("is_gamedll(%s): Failed, file is too small to be ELF.", filename));
+		close(fd);
+		return(mFALSE);
+	}
+	map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) {
+		META_DEBUG(3, ("is_gamedll(%s): Failed, mmap()", filename));
+		return(mFALSE);
+	}
+
+	memset(&img, 0, sizeof(img));
+	img.base = (const char *)map;
+	img.size = st.st_size;
+	ret = elf_dynamic(&img, filename);
+	if(ret < 0) {
+		// details logged in elf_dynamic()
+		munmap(map, st.st_size);
+		return(mFALSE);
+	}
+	if(ret == 0) {
+		// no hash table; walk section symbol tables instead
+		munmap(map, st.st_size);
+		return(is_gamedll_sections(filename));
+	}
+
+	gamedll = mFALSE;
+	if(elf_exports(&img, "Meta_Init") || elf_exports(&img, "Meta_Query")
+			|| elf_exports(&img, "Meta_Attach") || elf_exports(&img, "Meta_Detach")) {
+		// Metamod plugin.. is not gamedll
+		META_DEBUG(5, ("is_gamedll(%s): Detected Metamod plugin.", filename));
+	}
+	else if(elf_exports(&img, "GiveFnptrsToDll")
+			&& (elf_exports(&img, "GetEntityAPI2") || elf_exports(&img, "GetEntityAPI"))) {
+		META_DEBUG(5, ("is_gamedll(%s): Detected GameDLL.", filename));
+		gamedll = mTRUE;
+	}
+	else
+		META_DEBUG(5, ("is_gamedll(%s): Library isn't GameDLL.", filename));
+
+	munmap(map, st.st_size);
+	return(gamedll);
+}
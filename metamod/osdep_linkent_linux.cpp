@@ -37,6 +37,7 @@
 
 #include <dlfcn.h>
 #include <sys/mman.h>
+#include <sys/time.h>		// gettimeofday
 #define PAGE_SIZE 4096UL
 #define PAGE_MASK (~(PAGE_SIZE-1))
 #define PAGE_ALIGN(addr) (((addr)+PAGE_SIZE-1)&PAGE_MASK)
@@ -47,6 +48,9 @@
 #include "osdep_p.h"
 #include "log_meta.h"			// META_LOG, etc
 #include "support_meta.h"
+#include "metamod.h"			// Engine, Config, GET_TSC
+#include "linkent.h"			// cmd_meta_linkents, etc
+#include "ent_class.h"			// ent_class_find
 
 //
 // Linux code for dynamic linkents
@@ -73,6 +77,76 @@ static unsigned char dlsym_old_bytes[BYTES_SIZE];
 //Mutex for our protection
 static pthread_mutex_t mutex_replacement_dlsym = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 
+//
+// Merged export table.  Built once at init from the dynamic symbol
+// tables of metamod (which includes the LINK_ENTITY_TO_PLUGIN exports)
+// and the game dll, metamod's symbols first, just as dlsym on the metamod
+// handle is tried before the game dll.  It is never changed afterwards,
+// so lookups need no lock.  Entries with a null address are symbols that
+// dlsym has to resolve itself (ifuncs, tls).  Names not in the table are
+// looked up among the entity classes registered by plugins, and then
+// passed to the real dlsym.
+//
+typedef struct linkent_sym_s {
+	const char *name;		// in the module's dynamic string table
+	void *addr;
+	unsigned int hash;
+} linkent_sym_t;
+
+static linkent_sym_t *linkent_table = 0;
+static unsigned int linkent_table_mask = 0;
+static int linkent_table_count = 0;
+
+// Set when the engine's import of dlsym was pointed at us, so that dlsym
+// itself stays unpatched and other callers never reach us.
+static int linkent_got_patched = 0;
+
+// Lookups on the metamod handle, per map.  Only the engine's main thread
+// resolves entities, so these are plain counters.
+typedef struct linkent_stats_s {
+	unsigned long lookups;		// dlsym calls on the metamod handle
+	unsigned long hits;			// answered from the export table
+	unsigned long plugin;		// entity classes registered by plugins
+	unsigned long fallbacks;	// passed on to the real dlsym
+	unsigned long long ticks;	// total time resolving
+} linkent_stats_t;
+
+static linkent_stats_t linkent_map;
+static linkent_stats_t linkent_lastmap;
+
+// For converting ticks to usec in "meta linkents".
+static unsigned long long linkent_calib_tsc = 0;
+static struct timeval linkent_calib_tv;
+
+#if defined(__x86_64__)
+#define LINKENT_R_JUMP_SLOT	R_X86_64_JUMP_SLOT
+#define LINKENT_R_GLOB_DAT	R_X86_64_GLOB_DAT
+#define LINKENT_R_SYM(i)	ELF64_R_SYM(i)
+#define LINKENT_R_TYPE(i)	ELF64_R_TYPE(i)
+#else
+#define LINKENT_R_JUMP_SLOT	R_386_JMP_SLOT
+#define LINKENT_R_GLOB_DAT	R_386_GLOB_DAT
+#define LINKENT_R_SYM(i)	ELF32_R_SYM(i)
+#define LINKENT_R_TYPE(i)	ELF32_R_TYPE(i)
+#endif
+
+// The parts of a loaded module's dynamic section we use.
+typedef struct linkent_dyn_s {
+	ElfW(Addr) base;
+	const ElfW(Sym) *symtab;
+	const char *strtab;
+	const Elf32_Word *hash;			// DT_HASH
+	const Elf32_Word *gnu_hash;		// DT_GNU_HASH
+	const ElfW(Half) *versym;
+	ElfW(Addr) jmprel;
+	size_t pltrelsz;
+	int pltrel;
+	ElfW(Addr) rel;
+	size_t relsz;
+	ElfW(Addr) rela;
+	size_t relasz;
+} linkent_dyn_t;
+
 //constructs new jmp forwarder
 inline void construct_jmp_instruction(void *x, void *place, void* target)
 {
@@ -111,9 +185,10 @@ inline void DLLINTERNAL reset_dlsym_hook(void)
 }
 
 //
-// Replacement dlsym function
+// dlsym through the patched code of dlsym itself, used when the engine's
+// import couldn't be redirected
 //
-static void * __replacement_dlsym(void * module, const char * funcname)
+static void * DLLINTERNAL_NOVIS locked_dlsym(void * module, const char * funcname)
 {
 	//these are needed in case dlsym calls dlsym, default one doesn't do
 	//it but some LD_PRELOADed library that hooks dlsym might actually
@@ -183,21 +258,411 @@ static void * __replacement_dlsym(void * module, const char * funcname)
 }
 
 //
-// Initialize
+// Hash of symbol name, as used by DT_GNU_HASH
 //
-int DLLINTERNAL init_linkent_replacement(DLHANDLE MetamodHandle, DLHANDLE GameDllHandle)
+inline unsigned int DLLINTERNAL linkent_hash(const char *name)
 {
-	metamod_module_handle = MetamodHandle;
-	gamedll_module_handle = GameDllHandle;
+	unsigned int h = 5381;
 	
-	// dlsym is already known to be pointing to valid function, we loaded gamedll using it earlier!
-	void * sym_ptr = (void*)&dlsym;
-	while(is_code_trampoline_jmp_opcode(sym_ptr)) {
-		sym_ptr = extract_function_pointer_from_trampoline_jmp(sym_ptr);
+	while(*name)
+		h = h * 33 + (unsigned char)*name++;
+	return(h);
+}
+
+//
+// Finds name in the export table.  Returns the entry, or null if the name
+// isn't there.
+//
+static const linkent_sym_t * DLLINTERNAL_NOVIS linkent_table_find(const char *name)
+{
+	unsigned int h, slot;
+	
+	if(!linkent_table)
+		return(0);
+	
+	h = linkent_hash(name);
+	for(slot = h & linkent_table_mask; linkent_table[slot].name; slot = (slot + 1) & linkent_table_mask)
+	{
+		if(linkent_table[slot].hash == h && !strcmp(linkent_table[slot].name, name))
+			return(&linkent_table[slot]);
 	}
+	return(0);
+}
+
+//
+// Resolves name on the metamod handle: from the export table if it's
+// there, else from plugins' entity classes, else as dlsym would on
+// metamod and then the game dll.
+//
+static void * DLLINTERNAL_NOVIS linkent_resolve(const char * funcname)
+{
+	unsigned long long start = GET_TSC();
+	const linkent_sym_t *sym;
+	void * func;
 	
-	dlsym_original = (dlsym_func)sym_ptr;
+	linkent_map.lookups++;
+	
+	if((sym = linkent_table_find(funcname)) && sym->addr)
+	{
+		linkent_map.hits++;
+		func = sym->addr;
+	}
+	else if(!sym && (func = (void *)ent_class_find(funcname)))
+	{
+		linkent_map.plugin++;
+	}
+	else
+	{
+		linkent_map.fallbacks++;
+		if(linkent_got_patched)
+		{
+			if(!(func = dlsym_original(metamod_module_handle, funcname)))
+				func = dlsym_original(gamedll_module_handle, funcname);
+		}
+		else
+			func = locked_dlsym(metamod_module_handle, funcname);
+	}
+	
+	linkent_map.ticks += GET_TSC() - start;
+	return(func);
+}
+
+//
+// Replacement dlsym function
+//
+static void * __replacement_dlsym(void * module, const char * funcname)
+{
+	if(module == metamod_module_handle && metamod_module_handle && gamedll_module_handle)
+		return(linkent_resolve(funcname));
 	
+	//not for us; with the engine's import redirected, dlsym itself is
+	//still intact
+	if(linkent_got_patched)
+		return(dlsym_original(module, funcname));
+	
+	return(locked_dlsym(module, funcname));
+}
+
+//
+// Dynamic section pointers are relocated by the loader on most targets,
+// but not on all; accept both.
+//
+inline ElfW(Addr) DLLINTERNAL linkent_dyn_ptr(ElfW(Addr) base, ElfW(Addr) ptr)
+{
+	return(ptr < base ? base + ptr : ptr);
+}
+
+//
+// Collects what we need from a loaded module's dynamic section.
+//
+static void DLLINTERNAL_NOVIS linkent_read_dynamic(linkent_dyn_t *dyn, ElfW(Addr) base, const ElfW(Dyn) *d)
+{
+	memset(dyn, 0, sizeof(*dyn));
+	dyn->base = base;
+	
+	for(; d->d_tag != DT_NULL; d++)
+	{
+		switch(d->d_tag)
+		{
+			case DT_SYMTAB:
+				dyn->symtab = (const ElfW(Sym) *)linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_STRTAB:
+				dyn->strtab = (const char *)linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_HASH:
+				dyn->hash = (const Elf32_Word *)linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_GNU_HASH:
+				dyn->gnu_hash = (const Elf32_Word *)linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_VERSYM:
+				dyn->versym = (const ElfW(Half) *)linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_JMPREL:
+				dyn->jmprel = linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_PLTRELSZ:
+				dyn->pltrelsz = d->d_un.d_val;
+				break;
+			case DT_PLTREL:
+				dyn->pltrel = d->d_un.d_val;
+				break;
+			case DT_REL:
+				dyn->rel = linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_RELSZ:
+				dyn->relsz = d->d_un.d_val;
+				break;
+			case DT_RELA:
+				dyn->rela = linkent_dyn_ptr(base, d->d_un.d_ptr);
+				break;
+			case DT_RELASZ:
+				dyn->relasz = d->d_un.d_val;
+				break;
+		}
+	}
+}
+
+//
+// Number of entries in the dynamic symbol table, which the ELF headers
+// only give through the hash tables.
+//
+static unsigned int DLLINTERNAL_NOVIS linkent_num_syms(const linkent_dyn_t *dyn)
+{
+	const Elf32_Word *buckets, *chains;
+	unsigned int nbuckets, symoffset, i, last;
+	
+	if(dyn->hash)
+		return(dyn->hash[1]);
+	if(!dyn->gnu_hash)
+		return(0);
+	
+	nbuckets = dyn->gnu_hash[0];
+	symoffset = dyn->gnu_hash[1];
+	buckets = dyn->gnu_hash + 4 + dyn->gnu_hash[2] * (sizeof(ElfW(Addr)) / sizeof(Elf32_Word));
+	chains = buckets + nbuckets;
+	
+	for(last = 0, i = 0; i < nbuckets; i++)
+		if(buckets[i] > last)
+			last = buckets[i];
+	if(last < symoffset)
+		return(symoffset);
+	
+	//walk the last chain to its end
+	while(!(chains[last - symoffset] & 1))
+		last++;
+	return(last + 1);
+}
+
+//
+// Adds the exported symbols of a loaded module to the table.  Names
+// already in the table are kept, so the first module added wins.
+//
+static void DLLINTERNAL_NOVIS linkent_table_add_module(const linkent_dyn_t *dyn)
+{
+	unsigned int i, nsyms, h, slot;
+	const ElfW(Sym) *sym;
+	const char *name;
+	int bind, type;
+	
+	if(!dyn->symtab || !dyn->strtab)
+		return;
+	
+	nsyms = linkent_num_syms(dyn);
+	for(i = 1; i < nsyms; i++)
+	{
+		sym = &dyn->symtab[i];
+		bind = ELF32_ST_BIND(sym->st_info);
+		type = ELF32_ST_TYPE(sym->st_info);
+		
+		if(sym->st_shndx == SHN_UNDEF || (bind != STB_GLOBAL && bind != STB_WEAK))
+			continue;
+		//local, or not the default version
+		if(dyn->versym && ((dyn->versym[i] & 0x7fff) == 0 || (dyn->versym[i] & 0x8000)))
+			continue;
+		
+		name = dyn->strtab + sym->st_name;
+		if(!*name)
+			continue;
+		
+		h = linkent_hash(name);
+		for(slot = h & linkent_table_mask; linkent_table[slot].name; slot = (slot + 1) & linkent_table_mask)
+		{
+			if(linkent_table[slot].hash == h && !strcmp(linkent_table[slot].name, name))
+				break;
+		}
+		if(linkent_table[slot].name)
+			continue;
+		
+		linkent_table[slot].name = name;
+		linkent_table[slot].hash = h;
+		if((type == STT_FUNC || type == STT_OBJECT || type == STT_NOTYPE) && sym->st_shndx != SHN_ABS)
+			linkent_table[slot].addr = (void *)(dyn->base + sym->st_value);
+		else
+			linkent_table[slot].addr = 0;
+		linkent_table_count++;
+	}
+}
+
+//
+// Reads the dynamic section of a module opened with dlopen.
+//
+static int DLLINTERNAL_NOVIS linkent_handle_dynamic(DLHANDLE handle, linkent_dyn_t *dyn)
+{
+	struct link_map *lm = 0;
+	
+	if(dlinfo(handle, RTLD_DI_LINKMAP, &lm) || !lm || !lm->l_ld)
+		return(0);
+	
+	linkent_read_dynamic(dyn, lm->l_addr, lm->l_ld);
+	return(1);
+}
+
+//
+// Builds the merged export table of metamod and the game dll.
+//
+static int DLLINTERNAL_NOVIS linkent_table_build(DLHANDLE MetamodHandle, DLHANDLE GameDllHandle)
+{
+	linkent_dyn_t mm_dyn, game_dyn;
+	unsigned int size;
+	
+	if(!linkent_handle_dynamic(MetamodHandle, &mm_dyn) || !linkent_handle_dynamic(GameDllHandle, &game_dyn))
+		return(0);
+	
+	//half full at most
+	for(size = 64; size < 2 * (linkent_num_syms(&mm_dyn) + linkent_num_syms(&game_dyn)); size *= 2)
+		;
+	
+	if(!(linkent_table = (linkent_sym_t *)calloc(size, sizeof(linkent_sym_t))))
+		return(0);
+	linkent_table_mask = size - 1;
+	linkent_table_count = 0;
+	
+	linkent_table_add_module(&mm_dyn);
+	linkent_table_add_module(&game_dyn);
+	
+	META_DEBUG(3, ("Linkent export table: %d symbols, %u slots", linkent_table_count, size));
+	return(1);
+}
+
+// Module found by dl_iterate_phdr, containing a given address.
+typedef struct linkent_module_s {
+	ElfW(Addr) addr;
+	ElfW(Addr) base;
+	const ElfW(Phdr) *phdr;
+	int phnum;
+} linkent_module_t;
+
+static int DLLINTERNAL_NOVIS linkent_find_module(struct dl_phdr_info *info, size_t size, void *data)
+{
+	linkent_module_t *mod = (linkent_module_t *)data;
+	ElfW(Addr) start;
+	int i;
+	
+	for(i = 0; i < info->dlpi_phnum; i++)
+	{
+		if(info->dlpi_phdr[i].p_type != PT_LOAD)
+			continue;
+		
+		start = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+		if(mod->addr >= start && mod->addr < start + info->dlpi_phdr[i].p_memsz)
+		{
+			mod->base = info->dlpi_addr;
+			mod->phdr = info->dlpi_phdr;
+			mod->phnum = info->dlpi_phnum;
+			return(1);
+		}
+	}
+	return(0);
+}
+
+//
+// Points one GOT slot at our dlsym, making it writable for the moment if
+// it is in the module's RELRO segment.
+//
+static int DLLINTERNAL_NOVIS linkent_patch_slot(const linkent_module_t *mod, void **slot)
+{
+	unsigned long start_of_page = (unsigned long)slot & PAGE_MASK;
+	unsigned long size_of_pages = PAGE_ALIGN((unsigned long)(slot + 1)) - start_of_page;
+	ElfW(Addr) relro_start, relro_end;
+	int i;
+	
+	for(i = 0; i < mod->phnum; i++)
+	{
+		if(mod->phdr[i].p_type != PT_GNU_RELRO)
+			continue;
+		
+		relro_start = mod->base + mod->phdr[i].p_vaddr;
+		relro_end = relro_start + mod->phdr[i].p_memsz;
+		if((ElfW(Addr))slot >= relro_start && (ElfW(Addr))slot < relro_end)
+		{
+			if(mprotect((void*)start_of_page, size_of_pages, PROT_READ|PROT_WRITE))
+				return(0);
+			*slot = (void*)&__replacement_dlsym;
+			mprotect((void*)start_of_page, size_of_pages, PROT_READ);
+			return(1);
+		}
+	}
+	
+	*slot = (void*)&__replacement_dlsym;
+	return(1);
+}
+
+//
+// Redirects the dlsym relocations in a relocation table.  Rel and Rela
+// entries begin alike, we only step by a different size.
+//
+static int DLLINTERNAL_NOVIS linkent_patch_relocs(const linkent_module_t *mod, const linkent_dyn_t *dyn, ElfW(Addr) rel, size_t relsz, size_t entsize)
+{
+	const ElfW(Rel) *r;
+	const char *name;
+	unsigned long type;
+	size_t off;
+	int patched = 0;
+	
+	if(!rel || !relsz)
+		return(0);
+	
+	for(off = 0; off + entsize <= relsz; off += entsize)
+	{
+		r = (const ElfW(Rel) *)(rel + off);
+		type = LINKENT_R_TYPE(r->r_info);
+		
+		if((type != LINKENT_R_JUMP_SLOT && type != LINKENT_R_GLOB_DAT) || !LINKENT_R_SYM(r->r_info))
+			continue;
+		
+		name = dyn->strtab + dyn->symtab[LINKENT_R_SYM(r->r_info)].st_name;
+		if(strcmp(name, "dlsym"))
+			continue;
+		
+		if(linkent_patch_slot(mod, (void **)(dyn->base + r->r_offset)))
+			patched++;
+	}
+	return(patched);
+}
+
+//
+// Points the engine's imports of dlsym at our replacement.  Returns the
+// number of slots changed.
+//
+static int DLLINTERNAL_NOVIS linkent_patch_engine(void)
+{
+	linkent_module_t mod;
+	linkent_dyn_t dyn;
+	int i, patched;
+	size_t pltentsize;
+	
+	if(!Engine.funcs || !Engine.funcs->pfnPrecacheModel)
+		return(0);
+	
+	memset(&mod, 0, sizeof(mod));
+	mod.addr = (ElfW(Addr))Engine.funcs->pfnPrecacheModel;
+	if(!dl_iterate_phdr(linkent_find_module, &mod))
+		return(0);
+	
+	for(i = 0; i < mod.phnum; i++)
+		if(mod.phdr[i].p_type == PT_DYNAMIC)
+			break;
+	if(i == mod.phnum)
+		return(0);
+	
+	linkent_read_dynamic(&dyn, mod.base, (const ElfW(Dyn) *)(mod.base + mod.phdr[i].p_vaddr));
+	if(!dyn.symtab || !dyn.strtab)
+		return(0);
+	
+	pltentsize = dyn.pltrel == DT_RELA ? sizeof(ElfW(Rela)) : sizeof(ElfW(Rel));
+	patched = linkent_patch_relocs(&mod, &dyn, dyn.jmprel, dyn.pltrelsz, pltentsize);
+	patched += linkent_patch_relocs(&mod, &dyn, dyn.rel, dyn.relsz, sizeof(ElfW(Rel)));
+	patched += linkent_patch_relocs(&mod, &dyn, dyn.rela, dyn.relasz, sizeof(ElfW(Rela)));
+	return(patched);
+}
+
+//
+// Patches the code of dlsym itself to jump to our replacement.
+//
+static int DLLINTERNAL_NOVIS linkent_patch_dlsym(void)
+{
 	//Backup old bytes of "dlsym" function
 	memcpy(dlsym_old_bytes, (void*)dlsym_original, BYTES_SIZE);
 	
@@ -228,7 +693,90 @@ int DLLINTERNAL init_linkent_replacement(DLHANDLE MetamodHandle, DLHANDLE GameDl
 	
 	//Write our own jmp-forwarder on "dlsym"
 	reset_dlsym_hook();
-		
+	
 	//done
 	return(1);
 }
+
+//
+// Initialize
+//
+int DLLINTERNAL init_linkent_replacement(DLHANDLE MetamodHandle, DLHANDLE GameDllHandle)
+{
+	metamod_module_handle = MetamodHandle;
+	gamedll_module_handle = GameDllHandle;
+	
+	linkent_calib_tsc = GET_TSC();
+	gettimeofday(&linkent_calib_tv, NULL);
+	
+	// dlsym is already known to be pointing to valid function, we loaded gamedll using it earlier!
+	void * sym_ptr = (void*)&dlsym;
+	while(is_code_trampoline_jmp_opcode(sym_ptr)) {
+		sym_ptr = extract_function_pointer_from_trampoline_jmp(sym_ptr);
+	}
+	
+	dlsym_original = (dlsym_func)sym_ptr;
+	
+	//With the export table, redirect only the engine's dlsym import;
+	//without it, or if the engine's import can't be found, patch dlsym.
+	if(Config->linkent_table)
+	{
+		if(!linkent_table_build(MetamodHandle, GameDllHandle))
+			META_WARNING("Couldn't build linkent export table; resolving entities with dlsym");
+		else if(linkent_patch_engine())
+		{
+			linkent_got_patched = 1;
+			META_DEBUG(3, ("Linkents resolved through engine's dlsym import"));
+			return(1);
+		}
+	}
+	
+	return(linkent_patch_dlsym());
+}
+
+//
+// Starts counting lookups for the next map.
+//
+void DLLINTERNAL linkent_level_change(void)
+{
+	linkent_lastmap = linkent_map;
+	memset(&linkent_map, 0, sizeof(linkent_map));
+}
+
+static void DLLINTERNAL_NOVIS show_linkent_stats(const char *label, const linkent_stats_t *stats, double tpu)
+{
+	double usec = stats->ticks / tpu;
+	
+	META_CONS("%-14s %8lu %8lu %8lu %8lu %12.1f %10.3f", label, stats->lookups, stats->hits, stats->plugin, stats->fallbacks,
+			usec, stats->lookups ? usec / stats->lookups : 0.0);
+}
+
+//
+// "meta linkents" - entity lookups and time spent resolving them
+//
+void DLLINTERNAL cmd_meta_linkents(void)
+{
+	struct timeval tv;
+	double elapsed, tpu = 1.0;
+	
+	if(!metamod_module_handle) {
+		META_CONS("Linkent replacement not initialized");
+		return;
+	}
+	
+	gettimeofday(&tv, NULL);
+	elapsed = (tv.tv_sec - linkent_calib_tv.tv_sec) * 1000000.0 + (tv.tv_usec - linkent_calib_tv.tv_usec);
+	if(elapsed > 0.0)
+		tpu = (GET_TSC() - linkent_calib_tsc) / elapsed;
+	
+	if(linkent_got_patched)
+		META_CONS("Linkents: export table (%d symbols), engine's dlsym import redirected", linkent_table_count);
+	else if(linkent_table)
+		META_CONS("Linkents: export table (%d symbols), dlsym patched", linkent_table_count);
+	else
+		META_CONS("Linkents: dlsym patched, no export table");
+	
+	META_CONS("%-14s %8s %8s %8s %8s %12s %10s", "", "lookups", "table", "plugin", "dlsym", "total usec", "avg usec");
+	show_linkent_stats("this map", &linkent_map, tpu);
+	show_linkent_stats("previous map", &linkent_lastmap, tpu);
+}
@@ -34,6 +34,7 @@
 
 #include "log_meta.h"			// META_LOG, etc
 #include "support_meta.h"
+#include "linkent.h"			// cmd_meta_linkents, etc
 
 
 //
@@ -243,3 +244,16 @@ int DLLINTERNAL init_linkent_replacement(DLHANDLE moduleMetamod, DLHANDLE module
 {
 	return(combine_module_export_tables(moduleMetamod, moduleGame));
 }
+
+//
+// Lookups go straight to the combined export table, without passing
+// through metamod, so there is nothing to count.
+//
+void DLLINTERNAL linkent_level_change(void)
+{
+}
+
+void DLLINTERNAL cmd_meta_linkents(void)
+{
+	META_CONS("Linkents: resolved by the system from the combined export table; no lookup statistics");
+}
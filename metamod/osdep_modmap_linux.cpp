@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// qsort, realloc, free
+#include <string.h>			// strdup
+#include <stddef.h>			// offsetof
+
+#include <extdll.h>			// always
+
+#ifndef __USE_GNU
+#define __USE_GNU
+#endif
+
+#include <dlfcn.h>			// dlinfo, dladdr
+#include <link.h>			// dl_iterate_phdr
+
+#include "osdep.h"			// DLHANDLE, etc
+#include "osdep_p.h"		// me
+#include "log_meta.h"		// META_DEBUG, etc
+
+//
+// Address ranges of loaded modules.
+//  IS_VALID_PTR, DLFNAME and MPluginList::find_memloc used to call
+//  dladdr() each time, which takes the loader's lock and walks every
+//  loaded module.  Instead, the PT_LOAD segments of all modules are kept
+//  in a table sorted by address, and a pointer is found with a binary
+//  search.  The table is rebuilt with dl_iterate_phdr when plugins are
+//  loaded or unloaded, and whenever the loader reports modules added or
+//  removed since the last build.  That check is one dl_iterate_phdr step
+//  per lookup, so ranges of a module dlclosed elsewhere (a plugin's own
+//  helper library, gamedll between maps) are never trusted.  Plugins are
+//  matched to modules by load base when they are opened, so finding the
+//  plugin owning a pointer needs no path compares.
+//
+//  Used from the main thread only.
+//
+
+typedef struct modmap_range_s {
+	unsigned long start;
+	unsigned long end;				// one past last byte
+	int module;						// index in modules[]
+} modmap_range_t;
+
+typedef struct modmap_module_s {
+	unsigned long base;
+	char *fname;					// path module was loaded by
+	int plugin;						// plugin index, or 0
+} modmap_module_t;
+
+typedef struct modmap_plugin_s {
+	int pindex;
+	unsigned long base;
+} modmap_plugin_t;
+
+static modmap_range_t *ranges = NULL;
+static int num_ranges = 0;
+static int max_ranges = 0;
+
+static modmap_module_t *modules = NULL;
+static int num_modules = 0;
+static int max_modules = 0;
+
+static modmap_plugin_t *plugins = NULL;
+static int num_plugins = 0;
+static int max_plugins = 0;
+
+static int modmap_dirty = 1;
+
+// Loader's counts of modules added and removed, at last build.
+static unsigned long long modmap_adds = 0;
+static unsigned long long modmap_subs = 0;
+
+// Whether dl_phdr_info from this libc has the adds/subs counters.
+#define MODMAP_HAS_COUNTS(size) \
+	((size) >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(((struct dl_phdr_info *)0)->dlpi_subs))
+
+
+static int DLLINTERNAL modmap_cmp(const void *a, const void *b) {
+	const modmap_range_t *ra=(const modmap_range_t *)a;
+	const modmap_range_t *rb=(const modmap_range_t *)b;
+
+	if(ra->start < rb->start)
+		return(-1);
+	return(ra->start > rb->start);
+}
+
+static int DLLINTERNAL modmap_add_module(struct dl_phdr_info *info, size_t size, void *data) {
+	modmap_module_t *newmodules;
+	modmap_range_t *newranges;
+	unsigned long start;
+	int i, newmax;
+
+	if(MODMAP_HAS_COUNTS(size)) {
+		modmap_adds=info->dlpi_adds;
+		modmap_subs=info->dlpi_subs;
+	}
+
+	if(num_modules >= max_modules) {
+		newmax = max_modules ? max_modules * 2 : 32;
+		newmodules=(modmap_module_t *)realloc(modules, newmax * sizeof(*modules));
+		if(!newmodules)
+			return(1);
+		modules=newmodules;
+		max_modules=newmax;
+	}
+	modules[num_modules].base=info->dlpi_addr;
+	modules[num_modules].fname=strdup(info->dlpi_name ? info->dlpi_name : "");
+	modules[num_modules].plugin=0;
+	for(i=0; i < num_plugins; i++) {
+		if(plugins[i].base == info->dlpi_addr) {
+			modules[num_modules].plugin=plugins[i].pindex;
+			break;
+		}
+	}
+
+	for(i=0; i < info->dlpi_phnum; i++) {
+		if(info->dlpi_phdr[i].p_type != PT_LOAD || !info->dlpi_phdr[i].p_memsz)
+			continue;
+		if(num_ranges >= max_ranges) {
+			newmax = max_ranges ? max_ranges * 2 : 128;
+			newranges=(modmap_range_t *)realloc(ranges, newmax * sizeof(*ranges));
+			if(!newranges)
+				return(1);
+			ranges=newranges;
+			max_ranges=newmax;
+		}
+		start=info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+		ranges[num_ranges].start=start;
+		ranges[num_ranges].end=start + info->dlpi_phdr[i].p_memsz;
+		ranges[num_ranges].module=num_modules;
+		num_ranges++;
+	}
+	num_modules++;
+	return(0);
+}
+
+static void DLLINTERNAL modmap_build(void) {
+	modmap_module_t *mod;
+	Dl_info dlinfo;
+	int i;
+
+	for(i=0; i < num_modules; i++)
+		free(modules[i].fname);
+	num_modules=0;
+	num_ranges=0;
+
+	dl_iterate_phdr(modmap_add_module, NULL);
+	// Loader has no name for main program, where dladdr() gives its path
+	// as run; ask it, outside dl_iterate_phdr.
+	for(i=0; i < num_ranges; i++) {
+		mod=&modules[ranges[i].module];
+		if(mod->fname && !mod->fname[0] 
+				&& dladdr((void *)ranges[i].start, &dlinfo) && dlinfo.dli_fname && dlinfo.dli_fname[0]) {
+			free(mod->fname);
+			mod->fname=strdup(dlinfo.dli_fname);
+		}
+	}
+	qsort(ranges, num_ranges, sizeof(*ranges), modmap_cmp);
+	modmap_dirty=0;
+	META_DEBUG(9, ("Module map: %d modules, %d ranges", num_modules, num_ranges));
+}
+
+// Stops at the first module; it only has to report the counts.
+static int DLLINTERNAL modmap_read_counts(struct dl_phdr_info *info, size_t size, void *data) {
+	int *changed=(int *)data;
+
+	if(MODMAP_HAS_COUNTS(size))
+		*changed = info->dlpi_adds != modmap_adds || info->dlpi_subs != modmap_subs;
+	return(1);
+}
+
+static const modmap_range_t * DLLINTERNAL modmap_search(unsigned long addr) {
+	int lo, hi, mid;
+
+	// last range starting at or before addr
+	for(lo=0, hi=num_ranges; lo < hi; ) {
+		mid=(lo + hi) / 2;
+		if(ranges[mid].start <= addr)
+			lo=mid + 1;
+		else
+			hi=mid;
+	}
+	if(lo == 0 || addr >= ranges[lo - 1].end)
+		return(NULL);
+	return(&ranges[lo - 1]);
+}
+
+static const modmap_module_t * DLLINTERNAL modmap_find(const void *memptr) {
+	const modmap_range_t *range;
+	int changed;
+
+	if(!memptr)
+		return(NULL);
+	// Modules may have come and gone outside MPlugin; without the
+	// counters, always rebuild.
+	if(likely(!modmap_dirty)) {
+		changed=1;
+		dl_iterate_phdr(modmap_read_counts, &changed);
+		if(unlikely(changed))
+			modmap_dirty=1;
+	}
+	if(unlikely(modmap_dirty))
+		modmap_build();
+	if(likely((range=modmap_search((unsigned long)memptr)) != NULL))
+		return(&modules[range->module]);
+	return(NULL);
+}
+
+void DLLINTERNAL modmap_plugin_loaded(int pindex, DLHANDLE handle) {
+	struct link_map *lm=NULL;
+	modmap_plugin_t *newplugins;
+	int i, newmax;
+
+	modmap_dirty=1;
+	if(dlinfo(handle, RTLD_DI_LINKMAP, &lm) || !lm) {
+		META_DEBUG(4, ("Module map: no link map for plugin %d: %s", pindex, dlerror()));
+		return;
+	}
+	for(i=0; i < num_plugins; i++) {
+		if(plugins[i].pindex == pindex)
+			break;
+	}
+	if(i == num_plugins) {
+		if(num_plugins >= max_plugins) {
+			newmax = max_plugins ? max_plugins * 2 : 16;
+			newplugins=(modmap_plugin_t *)realloc(plugins, newmax * sizeof(*plugins));
+			if(!newplugins)
+				return;
+			plugins=newplugins;
+			max_plugins=newmax;
+		}
+		num_plugins++;
+	}
+	plugins[i].pindex=pindex;
+	plugins[i].base=lm->l_addr;
+}
+
+void DLLINTERNAL modmap_plugin_unloaded(int pindex) {
+	int i;
+
+	modmap_dirty=1;
+	for(i=0; i < num_plugins; i++) {
+		if(plugins[i].pindex == pindex) {
+			plugins[i]=plugins[--num_plugins];
+			return;
+		}
+	}
+}
+
+const char * DLLINTERNAL modmap_fname(const void *memptr) {
+	const modmap_module_t *mod;
+
+	if(!(mod=modmap_find(memptr)))
+		return(NULL);
+	return(mod->fname);
+}
+
+int DLLINTERNAL modmap_plugin(const void *memptr) {
+	const modmap_module_t *mod;
+
+	if(!(mod=modmap_find(memptr)))
+		return(0);
+	return(mod->plugin);
+}
@@ -73,4 +73,19 @@ DLHANDLE DLLINTERNAL get_module_handle_of_memptr(void * memptr);
 	void * DLLINTERNAL get_dlsym_pointer(void);
 #endif
 
+// Address ranges of loaded modules, for IS_VALID_PTR, DLFNAME and
+// find_memloc (osdep_modmap_linux.cpp).  Plugins are reported when opened
+// and closed, so pointers can be attributed to them.
+#ifdef linux
+	void DLLINTERNAL modmap_plugin_loaded(int pindex, DLHANDLE handle);
+	void DLLINTERNAL modmap_plugin_unloaded(int pindex);
+	// path of module containing memptr, or NULL
+	const char * DLLINTERNAL modmap_fname(const void *memptr);
+	// index of plugin containing memptr, or 0
+	int DLLINTERNAL modmap_plugin(const void *memptr);
+#else
+	inline void DLLINTERNAL modmap_plugin_loaded(int, DLHANDLE) {}
+	inline void DLLINTERNAL modmap_plugin_unloaded(int) {}
+#endif /* linux */
+
 #endif /* OSDEP_P_H */
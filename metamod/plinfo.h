@@ -62,6 +62,8 @@ typedef enum {
 	PNL_PLG_FORCED,			// forced by plugin function call
 //only used internally for 'meta reload'
 	PNL_RELOAD,			// forced unload by reload()
+//only used internally for 'meta hotreload'
+	PNL_HOT_RELOAD,			// state handed to new instance by hot_reload()
 } PL_UNLOAD_REASON;
 
 // Information plugin provides about itself.
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// realloc, free
+#include <string.h>			// memset, etc
+#ifdef linux
+#include <sys/time.h>		// gettimeofday; win32 in osdep.h
+#endif
+
+#include <extdll.h>			// always
+
+#include "startup_timeline.h"	// me
+#include "mplugin.h"		// MPlugin
+#include "mlist.h"			// WIDTH_MAX_PLUGINS
+#include "log_meta.h"		// META_CONS, etc
+#include "support_meta.h"	// STRNCPY
+#include "osdep.h"			// win32 gettimeofday
+
+typedef struct startup_phase_s {
+	const char *name;
+	double start;				// msec from start of metamod_startup
+	double msec;
+} startup_phase_t;
+
+typedef struct startup_row_s {
+	int index;					// plugin index
+	char desc[64];
+	double start[SS_MAX];		// msec from start of metamod_startup
+	double msec[SS_MAX];		// -1 if step not done
+	int worker;					// read-ahead thread, or -1
+} startup_row_t;
+
+static int startup_active = 0;
+static struct timeval startup_tv;
+static double startup_mark = 0.0;
+
+static startup_phase_t phases[STARTUP_MAX_PHASES];
+static int num_phases = 0;
+
+static startup_row_t *rows = NULL;
+static int num_rows = 0;
+static int size_rows = 0;
+
+
+static inline double DLLINTERNAL startup_msec(const struct timeval *tv) {
+	return((tv->tv_sec - startup_tv.tv_sec) * 1000.0 
+			+ (tv->tv_usec - startup_tv.tv_usec) / 1000.0);
+}
+
+static startup_row_t * DLLINTERNAL startup_row(MPlugin *plug) {
+	startup_row_t *row;
+	int i, newsize;
+
+	for(i=0; i < num_rows; i++) {
+		if(rows[i].index == plug->index)
+			return(&rows[i]);
+	}
+	if(num_rows == size_rows) {
+		newsize = size_rows ? size_rows * 2 : 32;
+		row = (startup_row_t *)realloc(rows, newsize * sizeof(startup_row_t));
+		if(!row)
+			return(NULL);
+		rows = row;
+		size_rows = newsize;
+	}
+	row = &rows[num_rows++];
+	memset(row, 0, sizeof(*row));
+	row->index = plug->index;
+	for(i=0; i < SS_MAX; i++)
+		row->msec[i] = -1.0;
+	row->worker = -1;
+	return(row);
+}
+
+void DLLINTERNAL startup_timeline_begin(void) {
+	gettimeofday(&startup_tv, NULL);
+	startup_mark = 0.0;
+	num_phases = 0;
+	num_rows = 0;
+	startup_active = 1;
+}
+
+void DLLINTERNAL startup_timeline_end(void) {
+	startup_active = 0;
+}
+
+void DLLINTERNAL startup_phase(const char *name) {
+	struct timeval tv;
+	double now;
+
+	if(!startup_active || num_phases == STARTUP_MAX_PHASES)
+		return;
+	gettimeofday(&tv, NULL);
+	now = startup_msec(&tv);
+	phases[num_phases].name = name;
+	phases[num_phases].start = startup_mark;
+	phases[num_phases].msec = now - startup_mark;
+	num_phases++;
+	startup_mark = now;
+}
+
+void DLLINTERNAL startup_plugin_step(MPlugin *plug, STARTUP_STEP step, 
+		const struct timeval *start, const struct timeval *end, int worker)
+{
+	startup_row_t *row;
+
+	if(!startup_active || !(row=startup_row(plug)))
+		return;
+	// desc changes from "<file>" to plugin's name on query
+	STRNCPY(row->desc, plug->desc, sizeof(row->desc));
+	row->start[step] = startup_msec(start);
+	row->msec[step] = startup_msec(end) - row->start[step];
+	if(step == SS_READ)
+		row->worker = worker;
+}
+
+static void DLLINTERNAL show_step(char *buf, int len, const startup_row_t *row, STARTUP_STEP step) {
+	if(row->msec[step] < 0)
+		safevoid_snprintf(buf, len, "%8s %7s", "-", "-");
+	else
+		safevoid_snprintf(buf, len, "%8.1f %7.1f", row->start[step], row->msec[step]);
+}
+
+// "meta startup" console command.
+void DLLINTERNAL cmd_meta_startup(void) {
+	char s_read[32], s_query[32], s_attach[32];
+	double total = 0.0;
+	int i;
+
+	if(!num_phases) {
+		META_CONS("No startup timeline recorded");
+		return;
+	}
+	META_CONS("Startup phases (msec from metamod start):");
+	META_CONS(" %-12s %8s %8s", "phase", "at", "took");
+	for(i=0; i < num_phases; i++) {
+		META_CONS(" %-12s %8.1f %8.1f", phases[i].name, phases[i].start, 
+				phases[i].msec);
+		total += phases[i].msec;
+	}
+	META_CONS(" %-12s %8s %8.1f", "total", "", total);
+
+	if(!num_rows)
+		return;
+	META_CONS("Plugins (msec; read is ahead, on thread #):");
+	META_CONS(" %*s %-20s %2s %8s %7s %8s %7s %8s %7s", WIDTH_MAX_PLUGINS+2, "", 
+			"description", "#", "read", "took", "query", "took", 
+			"attach", "took");
+	for(i=0; i < num_rows; i++) {
+		show_step(s_read, sizeof(s_read), &rows[i], SS_READ);
+		show_step(s_query, sizeof(s_query), &rows[i], SS_QUERY);
+		show_step(s_attach, sizeof(s_attach), &rows[i], SS_ATTACH);
+		if(rows[i].worker >= 0)
+			META_CONS(" [%*d] %-20.20s %2d %s %s %s", WIDTH_MAX_PLUGINS, 
+					rows[i].index, rows[i].desc, rows[i].worker, s_read, 
+					s_query, s_attach);
+		else
+			META_CONS(" [%*d] %-20.20s %2s %s %s %s", WIDTH_MAX_PLUGINS, 
+					rows[i].index, rows[i].desc, "-", s_read, s_query, 
+					s_attach);
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef STARTUP_TIMELINE_H
+#define STARTUP_TIMELINE_H
+
+#include "comp_dep.h"
+
+class MPlugin;
+struct timeval;
+
+// Timeline of metamod startup, for "meta startup".
+//  metamod_startup() and MPluginList::load() mark the end of each phase
+//  (config, gamedll, plugins.ini, plugins), and each plugin's read-ahead,
+//  query and attach are recorded as they happen.  Times are kept from the
+//  start of metamod_startup(); nothing is recorded after startup.
+
+// Steps of loading one plugin.
+typedef enum {
+	SS_READ = 0,		// file read ahead, on a worker thread
+	SS_QUERY,			// dlopen and Meta_Query
+	SS_ATTACH,			// Meta_Attach
+	SS_MAX,
+} STARTUP_STEP;
+
+// max number of phases recorded
+#define STARTUP_MAX_PHASES 16
+
+// start recording; first thing in metamod_startup()
+void DLLINTERNAL startup_timeline_begin(void);
+
+// stop recording; end of metamod_startup()
+void DLLINTERNAL startup_timeline_end(void);
+
+// end a phase, begun where the previous one ended; name must be constant
+void DLLINTERNAL startup_phase(const char *name);
+
+// record a step of loading plugin; main thread
+void DLLINTERNAL startup_plugin_step(MPlugin *plug, STARTUP_STEP step, 
+		const struct timeval *start, const struct timeval *end, int worker);
+
+void DLLINTERNAL cmd_meta_startup(void);
+
+#endif /* STARTUP_TIMELINE_H */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// calloc, free
+#include <string.h>			// strcmp, strlen, etc
+
+#include <extdll.h>			// always
+
+#include "string_cache.h"	// me
+#include "api_hook.h"		// api_hook_internal_ref, get_api_subscriber_count
+#include "api_record.h"		// api_record_active
+#include "metamod.h"		// Config, gpGlobals
+#include "log_meta.h"		// META_CONS, META_DEBUG, etc
+#include "osdep.h"			// likely, unlikely
+
+// initial table size, power of 2; doubled at half full
+#define STRING_CACHE_INITIAL 1024
+
+typedef struct string_entry_s {
+	unsigned int hash;
+	int str;						// string_t; 0 if slot is empty
+} string_entry_t;
+
+// Entity functions that start a map, see string_cache_map_start().
+static const unsigned int string_cache_map_funcs[] = {
+	offsetof(DLL_FUNCTIONS, pfnKeyValue),
+	offsetof(DLL_FUNCTIONS, pfnSpawn),
+	offsetof(DLL_FUNCTIONS, pfnRestore),
+};
+
+int string_cache_map_pending = 0;
+
+static int cache_enabled = 0;
+static int cache_live = 0;			// current map's heap in use
+static string_entry_t *table = NULL;
+static unsigned int table_size = 0;
+static unsigned int table_used = 0;
+
+static unsigned long long stat_hits = 0;
+static unsigned long long stat_misses = 0;
+static unsigned long long stat_uncached = 0;
+static unsigned long long stat_bytes_saved = 0;
+
+
+static inline unsigned int DLLINTERNAL string_hash(const char *str) {
+	unsigned int h = 2166136261U;
+
+	while(*str) {
+		h ^= (unsigned char)*str++;
+		h *= 16777619U;
+	}
+	return(h);
+}
+
+static mBOOL DLLINTERNAL string_table_grow(void) {
+	string_entry_t *newtable;
+	unsigned int newsize, i, j;
+
+	newsize = table_size ? table_size * 2 : STRING_CACHE_INITIAL;
+	newtable=(string_entry_t *)calloc(newsize, sizeof(string_entry_t));
+	if(!newtable)
+		return(mFALSE);
+	for(i=0; i < table_size; i++) {
+		if(!table[i].str)
+			continue;
+		for(j=table[i].hash & (newsize - 1); newtable[j].str; j=(j + 1) & (newsize - 1))
+			;
+		newtable[j]=table[i];
+	}
+	free(table);
+	table=newtable;
+	table_size=newsize;
+	return(mTRUE);
+}
+
+void DLLINTERNAL string_cache_init(void) {
+	unsigned int i;
+
+	if(!Config->string_cache || cache_enabled)
+		return;
+	cache_enabled=1;
+	// see gamedll's calls too
+	api_hook_internal_ref(e_api_engine, offsetof(enginefuncs_t, pfnAllocString), 1);
+	// and the start of the first map
+	for(i=0; i < sizeof(string_cache_map_funcs) / sizeof(string_cache_map_funcs[0]); i++)
+		api_hook_internal_ref(e_api_dllapi, string_cache_map_funcs[i], 1);
+	string_cache_map_pending=1;
+}
+
+int DLLINTERNAL string_cache_alloc(const char *szValue) {
+	unsigned int hash, i;
+	int str;
+
+	if(unlikely(!cache_live || !szValue))
+		return((*g_engfuncs.pfnAllocString)(szValue));
+
+	hash=string_hash(szValue);
+	if(likely(table_size)) {
+		for(i=hash & (table_size - 1); table[i].str; i=(i + 1) & (table_size - 1)) {
+			if(table[i].hash == hash && !strcmp(STRING(table[i].str), szValue)) {
+				stat_hits++;
+				stat_bytes_saved += strlen(szValue) + 1;
+				return(table[i].str);
+			}
+		}
+	}
+
+	stat_misses++;
+	str=(*g_engfuncs.pfnAllocString)(szValue);
+	if(!str || strcmp(STRING(str), szValue)) {
+		stat_uncached++;
+		return(str);
+	}
+	if((table_used + 1) * 2 > table_size && !string_table_grow())
+		return(str);
+	for(i=hash & (table_size - 1); table[i].str; i=(i + 1) & (table_size - 1))
+		;
+	table[i].hash=hash;
+	table[i].str=str;
+	table_used++;
+	return(str);
+}
+
+int DLLINTERNAL string_cache_bypass(void) {
+	return(cache_enabled && !api_record_active 
+			&& !get_api_subscriber_count(e_api_engine, offsetof(enginefuncs_t, pfnAllocString)));
+}
+
+// Called before the dispatch, so that strings the gamedll allocates for
+// the map's first entity are already cached.
+void DLLINTERNAL string_cache_map_start(void) {
+	if(table)
+		memset(table, 0, table_size * sizeof(string_entry_t));
+	table_used=0;
+	string_cache_map_pending=0;
+	cache_live=1;
+}
+
+void DLLINTERNAL string_cache_level_change(void) {
+	if(!cache_enabled)
+		return;
+	cache_live=0;
+	string_cache_map_pending=1;
+}
+
+// "meta strings" console command.
+void DLLINTERNAL cmd_meta_strings(void) {
+	if(!cache_enabled) {
+		META_CONS("AllocString cache disabled");
+		return;
+	}
+	if(!cache_live)
+		META_CONS("AllocString cache: waiting for map to start");
+	else
+		META_CONS("AllocString cache: %u strings on this map", table_used);
+	META_CONS("%llu hits, %llu misses (%llu not cacheable), %llu bytes saved", 
+			stat_hits, stat_misses, stat_uncached, stat_bytes_saved);
+}
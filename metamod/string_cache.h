@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef STRING_CACHE_H
+#define STRING_CACHE_H
+
+#include "comp_dep.h"
+
+// Cache for AllocString.
+//  Engine's AllocString copies the string to the map's string heap on
+//  every call, even for strings it already has; plugins and gamedlls
+//  allocating the same classnames, models and targetnames over and over
+//  grow the heap for as long as the map runs.  With "string_cache"
+//  enabled, calls from plugins and gamedll are answered from a hash
+//  table of strings allocated on the current map, and only strings not
+//  seen before go to engine.  The table is keyed by the engine's copies,
+//  so a hit is checked with a string compare against the heap itself.
+//  Strings that engine stores changed (it converts "\n" escapes) aren't
+//  cached.  Engine frees the heap when the next map starts loading, so
+//  only strings allocated while a map's entities are in use are cached:
+//  the table is flushed and filled from the first KeyValue, Spawn or
+//  Restore dispatched after startup or a level change, and left alone
+//  from ServerDeactivate on.  Strings from Meta_Attach, GameDLLInit and
+//  between maps go to engine uncached.
+//
+//  Gamedll calls are answered from cache only while no plugin hooks
+//  AllocString and calls aren't being recorded; otherwise they're hooked
+//  as usual.
+
+// enable cache, at startup
+void DLLINTERNAL string_cache_init(void);
+
+// AllocString through cache; plugins' pfnAllocString
+int DLLINTERNAL string_cache_alloc(const char *szValue);
+
+// whether gamedll's AllocString calls can bypass hooks for cache
+int DLLINTERNAL string_cache_bypass(void);
+
+// nonzero while cache is enabled and waiting for the next map to start
+extern int string_cache_map_pending DLLHIDDEN;
+
+// flush and start caching; first entity dispatch of a map
+void DLLINTERNAL string_cache_map_start(void);
+
+// stop caching until next map, on level change
+void DLLINTERNAL string_cache_level_change(void);
+
+void DLLINTERNAL cmd_meta_strings(void);
+
+#endif /* STRING_CACHE_H */
@@ -0,0 +1,567 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stdlib.h>			// malloc, free, atoi, etc
+#include <string.h>			// strstr, strncmp, etc
+
+#include <extdll.h>			// always
+
+#include "thread_logparse.h"	// me
+#include "api_hook.h"		// api_hook_internal_ref
+#include "log_meta.h"		// META_CONS, MAX_LOGMSG_LEN, etc
+#include "support_meta.h"	// STRNCPY
+#include "osdep.h"			// strcasecmp, etc
+
+#define LOGEV_MAX_SEGS (2 * LOGEV_MAX_FIELDS + 1)
+
+typedef enum {
+	LS_LITERAL = 0,
+	LS_STR,
+	LS_INT,
+	LS_FLOAT,
+} logparse_seg_type_t;
+
+typedef struct logparse_seg_s {
+	logparse_seg_type_t type;
+	const char *lit;				// literal, nul terminated
+	int len;
+	int field;						// field index
+} logparse_seg_t;
+
+typedef struct logparse_pattern_s {
+	int id;
+	plid_t plid;
+	META_LOG_EVENT_FN fn;			// NULL once unregistered
+	void *data;
+	char pattern[LOGEV_MAX_PATTERN];
+	char lits[LOGEV_MAX_PATTERN + LOGEV_MAX_SEGS];	// literals, unescaped
+	int nsegs;
+	int nfields;
+	logparse_seg_t segs[LOGEV_MAX_SEGS];
+	int keyword;					// segment used as keyword, -1 if none
+	unsigned long matches;
+	// set by logparse_build()
+	int next_same_kw;				// next pattern with same keyword
+	unsigned int seen;				// line generation when last marked
+} logparse_pattern_t;
+
+int logparse_active = 0;
+
+static logparse_pattern_t **patterns = NULL;
+static int num_patterns = 0;
+static int max_patterns = 0;
+static int next_id = 1;
+static int logparse_dirty = 0;
+static int logparse_dispatching = 0;
+
+// Automaton.  Characters are mapped to classes first; those not in any
+// keyword share class 0.  'ac_next' is the full transition table (failure
+// links resolved), ac_next[state * ac_nclass + class].
+static unsigned char ac_class[256];
+static int ac_nclass = 0;
+static int ac_nstates = 0;
+static unsigned short *ac_next = NULL;
+static short *ac_kw = NULL;				// keyword ending at state, or -1
+static unsigned short *ac_dict = NULL;	// next state on suffix chain with keyword, 0 if none
+static int *kw_first = NULL;			// first pattern with keyword
+static int ac_nkw = 0;
+static int *always = NULL;				// patterns without keyword
+static int num_always = 0;
+static int *candidates = NULL;			// patterns to match in full, per line
+
+// stats
+static unsigned long lines_scanned = 0;
+static unsigned long patterns_tried = 0;
+static unsigned long events_sent = 0;
+static unsigned int line_generation = 0;
+
+
+// Parse pattern into segments.
+static mBOOL DLLINTERNAL logparse_compile(logparse_pattern_t *pat) {
+	logparse_seg_t *seg;
+	const char *p;
+	char *lp, *lit;
+	int best;
+
+	pat->nsegs=0;
+	pat->nfields=0;
+	lp=lit=pat->lits;
+	for(p=pat->pattern; ; p++) {
+		if(*p && (*p != '%' || p[1] == '%')) {
+			*lp++ = *p;
+			if(*p == '%')
+				p++;
+			continue;
+		}
+		// end of literal
+		if(lp != lit) {
+			*lp++ = '\0';
+			seg=&pat->segs[pat->nsegs++];
+			seg->type=LS_LITERAL;
+			seg->lit=lit;
+			seg->len=lp - lit - 1;
+			lit=lp;
+		}
+		if(!*p)
+			break;
+
+		// field
+		if(pat->nfields >= LOGEV_MAX_FIELDS)
+			RETURN_ERRNO(mFALSE, ME_MAXREACHED);
+		if(pat->nsegs && pat->segs[pat->nsegs - 1].type != LS_LITERAL)
+			RETURN_ERRNO(mFALSE, ME_FORMAT);
+		seg=&pat->segs[pat->nsegs++];
+		switch(*++p) {
+			case 's': seg->type=LS_STR; break;
+			case 'd': seg->type=LS_INT; break;
+			case 'f': seg->type=LS_FLOAT; break;
+			default: RETURN_ERRNO(mFALSE, ME_FORMAT);
+		}
+		seg->lit=NULL;
+		seg->len=0;
+		seg->field=pat->nfields++;
+	}
+	if(!pat->nsegs)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+
+	// longest literal is the keyword, as it's most selective
+	pat->keyword=-1;
+	for(best=0, seg=pat->segs; seg < &pat->segs[pat->nsegs]; seg++) {
+		if(seg->type == LS_LITERAL && seg->len > best) {
+			best=seg->len;
+			pat->keyword=seg - pat->segs;
+		}
+	}
+	return(mTRUE);
+}
+
+static void DLLINTERNAL logparse_free_automaton(void) {
+	free(ac_next);
+	free(ac_kw);
+	free(ac_dict);
+	free(kw_first);
+	free(always);
+	free(candidates);
+	ac_next=NULL;
+	ac_kw=NULL;
+	ac_dict=NULL;
+	kw_first=NULL;
+	always=NULL;
+	candidates=NULL;
+	ac_nstates=0;
+	ac_nkw=0;
+	num_always=0;
+}
+
+// Drop unregistered patterns and build automaton for the rest.
+static void DLLINTERNAL logparse_build(void) {
+	logparse_pattern_t *pat;
+	const logparse_seg_t *kseg;
+	unsigned short *queue, *fail;
+	int i, j, c, s, t, f, max_states, qhead, qtail, kw;
+
+	logparse_dirty=0;
+	logparse_free_automaton();
+
+	for(i=0, j=0; i < num_patterns; i++) {
+		if(patterns[i]->fn)
+			patterns[j++]=patterns[i];
+		else
+			free(patterns[i]);
+	}
+	num_patterns=j;
+	if(!num_patterns)
+		return;
+
+	// character classes and state bound
+	memset(ac_class, 0, sizeof(ac_class));
+	ac_nclass=1;
+	max_states=1;
+	for(i=0; i < num_patterns; i++) {
+		pat=patterns[i];
+		if(pat->keyword < 0)
+			continue;
+		kseg=&pat->segs[pat->keyword];
+		for(j=0; j < kseg->len; j++) {
+			c=(unsigned char)kseg->lit[j];
+			if(!ac_class[c])
+				ac_class[c]=ac_nclass++;
+		}
+		max_states+=kseg->len;
+	}
+	if(max_states > 0xffff) {
+		META_WARNING("Log event patterns too long; %d automaton states", max_states);
+		max_states=0xffff;
+	}
+
+	ac_next=(unsigned short *)calloc(max_states * ac_nclass, sizeof(unsigned short));
+	ac_kw=(short *)malloc(max_states * sizeof(short));
+	ac_dict=(unsigned short *)calloc(max_states, sizeof(unsigned short));
+	kw_first=(int *)malloc(num_patterns * sizeof(int));
+	always=(int *)malloc(num_patterns * sizeof(int));
+	candidates=(int *)malloc(num_patterns * sizeof(int));
+	queue=(unsigned short *)malloc(max_states * sizeof(unsigned short));
+	if(!ac_next || !ac_kw || !ac_dict || !kw_first || !always || !candidates || !queue) {
+		META_WARNING("Out of memory building log event automaton; log events disabled");
+		logparse_free_automaton();
+		free(queue);
+		return;
+	}
+	for(s=0; s < max_states; s++)
+		ac_kw[s]=-1;
+
+	// trie; 0 in ac_next means no child yet (root can't be a child)
+	ac_nstates=1;
+	for(i=0; i < num_patterns; i++) {
+		pat=patterns[i];
+		pat->next_same_kw=-1;
+		if(pat->keyword < 0) {
+			always[num_always++]=i;
+			continue;
+		}
+		kseg=&pat->segs[pat->keyword];
+		for(s=0, j=0; j < kseg->len; j++) {
+			c=ac_class[(unsigned char)kseg->lit[j]];
+			t=ac_next[s * ac_nclass + c];
+			if(!t) {
+				if(ac_nstates >= max_states)
+					break;
+				t=ac_nstates++;
+				ac_next[s * ac_nclass + c]=t;
+			}
+			s=t;
+		}
+		if(j < kseg->len)
+			continue;
+		// patterns with same keyword share its state; keep them in order
+		kw=ac_kw[s];
+		if(kw < 0) {
+			kw=ac_kw[s]=ac_nkw++;
+			kw_first[kw]=i;
+		}
+		else {
+			for(j=kw_first[kw]; patterns[j]->next_same_kw >= 0; j=patterns[j]->next_same_kw)
+				;
+			patterns[j]->next_same_kw=i;
+		}
+	}
+
+	// failure links, breadth first; resolve missing transitions through
+	// them, and chain states whose suffixes end keywords
+	fail=(unsigned short *)calloc(ac_nstates, sizeof(unsigned short));
+	if(!fail) {
+		META_WARNING("Out of memory building log event automaton; log events disabled");
+		logparse_free_automaton();
+		free(queue);
+		return;
+	}
+	qhead=qtail=0;
+	for(c=0; c < ac_nclass; c++) {
+		t=ac_next[c];
+		if(t)
+			queue[qtail++]=t;
+	}
+	while(qhead < qtail) {
+		s=queue[qhead++];
+		for(c=0; c < ac_nclass; c++) {
+			t=ac_next[s * ac_nclass + c];
+			if(!t) {
+				ac_next[s * ac_nclass + c]=ac_next[fail[s] * ac_nclass + c];
+				continue;
+			}
+			f=ac_next[fail[s] * ac_nclass + c];
+			fail[t]=f;
+			ac_dict[t]=(ac_kw[f] >= 0) ? f : ac_dict[f];
+			queue[qtail++]=t;
+		}
+	}
+	free(fail);
+	free(queue);
+}
+
+// Check field text against its type.
+static int DLLINTERNAL logparse_field_ok(logparse_seg_type_t type, const char *start, const char *end) {
+	const char *p = start;
+	int digits = 0;
+
+	if(type == LS_STR)
+		return(1);
+	if(p < end && (*p == '-' || *p == '+'))
+		p++;
+	for(; p < end && *p >= '0' && *p <= '9'; p++)
+		digits++;
+	if(type == LS_FLOAT && p < end && *p == '.') {
+		for(p++; p < end && *p >= '0' && *p <= '9'; p++)
+			digits++;
+	}
+	return(digits && p == end);
+}
+
+// Match segments from 'i' on at 'pos'; fields as short as possible,
+// backtracking to later occurrences of the literal after them.
+static int DLLINTERNAL logparse_match(const logparse_pattern_t *pat, int i, const char *pos, 
+		const char **fstart, const char **fend)
+{
+	const logparse_seg_t *seg, *next;
+	const char *p;
+
+	if(i == pat->nsegs)
+		return(1);
+	seg=&pat->segs[i];
+
+	if(seg->type == LS_LITERAL) {
+		if(i > 0)
+			return(!strncmp(pos, seg->lit, seg->len) 
+					&& logparse_match(pat, i + 1, pos + seg->len, fstart, fend));
+		// pattern starts with literal; try every occurrence
+		for(p=pos; (p=strstr(p, seg->lit)); p++) {
+			if(logparse_match(pat, 1, p + seg->len, fstart, fend))
+				return(1);
+		}
+		return(0);
+	}
+
+	// last field takes rest of line
+	if(i == pat->nsegs - 1) {
+		p=pos + strlen(pos);
+		if(!logparse_field_ok(seg->type, pos, p))
+			return(0);
+		fstart[seg->field]=pos;
+		fend[seg->field]=p;
+		return(1);
+	}
+
+	next=&pat->segs[i + 1];
+	for(p=pos; (p=strstr(p, next->lit)); p++) {
+		if(logparse_field_ok(seg->type, pos, p) 
+				&& logparse_match(pat, i + 2, p + next->len, fstart, fend))
+		{
+			fstart[seg->field]=pos;
+			fend[seg->field]=p;
+			return(1);
+		}
+	}
+	return(0);
+}
+
+// Match pattern in full and pass event to plugin.
+static void DLLINTERNAL logparse_try(logparse_pattern_t *pat, const char *line) {
+	const char *fstart[LOGEV_MAX_FIELDS], *fend[LOGEV_MAX_FIELDS];
+	char fields[MAX_LOGMSG_LEN + LOGEV_MAX_FIELDS];
+	meta_log_event_t event;
+	char *fp;
+	int i, len;
+
+	patterns_tried++;
+	if(!pat->fn || !logparse_match(pat, 0, line, fstart, fend))
+		return;
+
+	event.id=pat->id;
+	event.line=line;
+	event.nfields=pat->nfields;
+	for(fp=fields, i=0; i < pat->nfields; i++) {
+		len=fend[i] - fstart[i];
+		memcpy(fp, fstart[i], len);
+		fp[len]='\0';
+		event.field[i].str=fp;
+		event.field[i].ival=atoi(fp);
+		event.field[i].fval=(float)atof(fp);
+		fp+=len + 1;
+	}
+
+	pat->matches++;
+	events_sent++;
+	pat->fn(&event, pat->data);
+}
+
+static int DLLINTERNAL logparse_cmp_index(const void *a, const void *b) {
+	return(*(const int *)a - *(const int *)b);
+}
+
+void DLLINTERNAL logparse_handle(const char *text) {
+	char line[MAX_LOGMSG_LEN];
+	const unsigned char *p;
+	int *cand;
+	int i, n, s, o, len;
+
+	// events of lines logged by event callbacks aren't dispatched
+	if(!logparse_active || logparse_dispatching)
+		return;
+	if(logparse_dirty)
+		logparse_build();
+	if(!num_patterns || !candidates)
+		return;
+
+	STRNCPY(line, text, sizeof(line));
+	for(len=strlen(line); len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'); len--)
+		line[len - 1]='\0';
+
+	lines_scanned++;
+	line_generation++;
+
+	// one pass over line; collect patterns whose keyword occurs
+	cand=candidates;
+	n=0;
+	if(ac_nstates) {
+		for(s=0, p=(const unsigned char *)line; *p; p++) {
+			s=ac_next[s * ac_nclass + ac_class[*p]];
+			for(o=(ac_kw[s] >= 0) ? s : ac_dict[s]; o; o=ac_dict[o]) {
+				for(i=kw_first[ac_kw[o]]; i >= 0; i=patterns[i]->next_same_kw) {
+					if(patterns[i]->seen != line_generation) {
+						patterns[i]->seen=line_generation;
+						cand[n++]=i;
+					}
+				}
+			}
+		}
+	}
+	for(i=0; i < num_always; i++)
+		cand[n++]=always[i];
+	if(!n)
+		return;
+
+	// dispatch in registration order
+	if(n > 1)
+		qsort(cand, n, sizeof(cand[0]), logparse_cmp_index);
+	logparse_dispatching=1;
+	for(i=0; i < n; i++)
+		logparse_try(patterns[cand[i]], line);
+	logparse_dispatching=0;
+}
+
+static void DLLINTERNAL logparse_set_active(int active) {
+	if(active == logparse_active)
+		return;
+	logparse_active=active;
+	// need to see gamedll's AlertMessage calls
+	api_hook_internal_ref(e_api_engine, offsetof(enginefuncs_t, pfnAlertMessage), active ? 1 : -1);
+}
+
+int DLLINTERNAL logparse_register(plid_t plid, const char *pattern, META_LOG_EVENT_FN fn, void *data) {
+	logparse_pattern_t *pat, **newlist;
+	int newmax;
+
+	if(!pattern || !fn)
+		RETURN_ERRNO(0, ME_ARGUMENT);
+	if(strlen(pattern) >= LOGEV_MAX_PATTERN)
+		RETURN_ERRNO(0, ME_ARGUMENT);
+
+	pat=(logparse_pattern_t *)calloc(1, sizeof(logparse_pattern_t));
+	if(!pat)
+		RETURN_ERRNO(0, ME_NOMEM);
+	STRNCPY(pat->pattern, pattern, sizeof(pat->pattern));
+	if(!logparse_compile(pat)) {
+		META_WARNING("Plugin '%s': bad log event pattern '%s'", plid->name, pattern);
+		free(pat);
+		// meta_errno set in logparse_compile
+		return(0);
+	}
+	pat->plid=plid;
+	pat->fn=fn;
+	pat->data=data;
+
+	if(num_patterns >= max_patterns) {
+		newmax = max_patterns ? max_patterns * 2 : 16;
+		newlist=(logparse_pattern_t **)realloc(patterns, newmax * sizeof(*patterns));
+		if(!newlist) {
+			free(pat);
+			RETURN_ERRNO(0, ME_NOMEM);
+		}
+		patterns=newlist;
+		max_patterns=newmax;
+	}
+	pat->id=next_id++;
+	pat->next_same_kw=-1;
+	patterns[num_patterns++]=pat;
+	logparse_dirty=1;
+	logparse_set_active(1);
+
+	META_DEBUG(3, ("Plugin '%s' registered log event %d: %s", plid->name, pat->id, pattern));
+	return(pat->id);
+}
+
+// Mark pattern unregistered; it's freed on next build, as it might be in
+// use by a dispatch in progress.
+static void DLLINTERNAL logparse_remove(logparse_pattern_t *pat) {
+	int i;
+
+	pat->fn=NULL;
+	logparse_dirty=1;
+	for(i=0; i < num_patterns; i++) {
+		if(patterns[i]->fn)
+			return;
+	}
+	logparse_set_active(0);
+}
+
+mBOOL DLLINTERNAL logparse_unregister(plid_t plid, int id) {
+	int i;
+
+	for(i=0; i < num_patterns; i++) {
+		if(patterns[i]->id == id && patterns[i]->plid == plid && patterns[i]->fn) {
+			logparse_remove(patterns[i]);
+			return(mTRUE);
+		}
+	}
+	RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+}
+
+void DLLINTERNAL logparse_plugin_unloaded(plid_t plid) {
+	int i;
+
+	for(i=0; i < num_patterns; i++) {
+		if(patterns[i]->plid == plid && patterns[i]->fn)
+			logparse_remove(patterns[i]);
+	}
+}
+
+// "meta logevents" console command.
+void DLLINTERNAL cmd_meta_logevents(void) {
+	logparse_pattern_t *pat;
+	int i, n;
+
+	if(logparse_dirty)
+		logparse_build();
+
+	META_CONS("Log event patterns:");
+	META_CONS("  %4s %-16s %10s  %s", "id", "plugin", "matches", "pattern");
+	for(i=0, n=0; i < num_patterns; i++) {
+		pat=patterns[i];
+		if(!pat->fn)
+			continue;
+		META_CONS("  %4d %-16.16s %10lu  %s", pat->id, pat->plid->name, pat->matches, pat->pattern);
+		n++;
+	}
+	META_CONS("%d patterns; automaton: %d keywords, %d states, %d char classes, %d without keyword",
+			n, ac_nkw, ac_nstates, ac_nclass, num_always);
+	META_CONS("%lu lines scanned, %lu full pattern matches tried, %lu events", 
+			lines_scanned, patterns_tried, events_sent);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef THREAD_LOGPARSE_H
+#define THREAD_LOGPARSE_H
+
+#include "plinfo.h"			// plid_t
+#include "mhook.h"			// META_LOG_EVENT_FN, etc
+#include "types_meta.h"		// mBOOL
+#include "comp_dep.h"
+
+// Log event bus.
+//  Plugins register patterns for log lines with REG_LOG_EVENT.  Metamod
+//  sees the gamedll's log lines (AlertMessage with at_logged) once, and
+//  runs them through one Aho-Corasick automaton built from a keyword of
+//  every pattern.  Only patterns whose keyword occurs in the line are
+//  matched in full, and matching ones are passed to their plugin's
+//  callback with captured fields.  Cost per line doesn't grow with the
+//  number of plugins listening.
+//
+// Pattern syntax: text to find in line, with fields
+//  %s  any text (also empty)
+//  %d  integer
+//  %f  decimal number
+//  %%  '%'
+// Fields are matched as short as possible, except last field of pattern
+// that takes rest of line.  Two fields can't be next to each other.  A
+// pattern matches anywhere in line, except that a field at start of
+// pattern starts at start of line.  Example:
+//  "%s<%d><%s><%s>" triggered "%s"
+
+// max length of pattern
+#define LOGEV_MAX_PATTERN 256
+
+// nonzero while there are patterns registered
+extern int logparse_active DLLHIDDEN;
+
+// register pattern; returns event id, or 0 with meta_errno set
+int DLLINTERNAL logparse_register(plid_t plid, const char *pattern, META_LOG_EVENT_FN fn, void *data);
+
+// unregister pattern by id
+mBOOL DLLINTERNAL logparse_unregister(plid_t plid, int id);
+
+// unregister plugin's patterns, on unload
+void DLLINTERNAL logparse_plugin_unloaded(plid_t plid);
+
+// match log line and dispatch events; main thread
+void DLLINTERNAL logparse_handle(const char *line);
+
+void DLLINTERNAL cmd_meta_logevents(void);
+
+#endif /* THREAD_LOGPARSE_H */
@@ -0,0 +1,564 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// malloc, free, etc
+#include <string.h>			// strcmp, memset, etc
+
+#include <extdll.h>			// always
+
+#include "usermsg.h"		// me
+#include "api_hook.h"		// api_hook_dispatch, api_hook_internal_ref
+#include "engine_api.h"		// FN_WRITEBYTE, engine_info, etc
+#include "metamod.h"		// RegMsgs
+#include "mreg.h"			// MRegMsg
+#include "mlist.h"			// Plugins
+#include "mplugin.h"		// MPlugin
+#include "log_meta.h"		// META_CONS, META_DEBUG, etc
+#include "support_meta.h"	// STRNCPY
+#include "osdep.h"			// unlikely
+
+// space for string arguments of one message
+#define USERMSG_MAX_STRINGS 4096
+
+typedef struct usermsg_sub_s {
+	int id;
+	plid_t plid;
+	META_USERMSG_FN fn;				// NULL once unregistered
+	void *data;
+	char name[64];					// "" if subscribed by msgid
+	int msgid;						// 0 for all messages, -1 if not resolved
+	unsigned long calls;
+	unsigned long blocks;
+} usermsg_sub_t;
+
+int usermsg_active = 0;
+int usermsg_capturing = 0;
+
+static usermsg_sub_t **subs = NULL;
+static int num_subs = 0;
+static int max_subs = 0;
+static int next_id = 1;
+static int subs_dirty = 0;
+static int usermsg_dispatching = 0;
+
+// msg_types with subscribers
+static unsigned char usermsg_wanted[256];
+
+// message being held back
+static meta_usermsg_t cur;
+static float cur_origin[3];
+static meta_msgarg_t cur_args[USERMSG_MAX_ARGS];
+static char cur_strings[USERMSG_MAX_STRINGS];
+static int cur_strings_len;
+
+// stats
+static unsigned long msgs_captured = 0;
+static unsigned long msgs_blocked = 0;
+static unsigned long msgs_overflowed = 0;
+
+// Message filter names not registered by gamedll yet.
+typedef struct usermsg_pending_s {
+	plid_t plid;
+	int post;
+	char name[64];
+} usermsg_pending_t;
+
+static usermsg_pending_t *pending = NULL;
+static int num_pending = 0;
+static int max_pending = 0;
+
+// plugin hook tables with message filter
+static int num_filtered = 0;
+
+#define USERMSG_DISPATCH(FN_TYPE, pfnName, pfn_args) \
+	api_hook_dispatch(api_hook_caller<FN_TYPE> pfn_args, &engine_info.pfnName, e_api_engine, offsetof(enginefuncs_t, pfnName), 0)
+
+
+static inline mBOOL DLLINTERNAL usermsg_sub_matches(const usermsg_sub_t *sub, int msg_type) {
+	if(!sub->fn)
+		return(mFALSE);
+	if(sub->msgid == 0)
+		return(mTRUE);
+	return(sub->msgid == msg_type ? mTRUE : mFALSE);
+}
+
+static void DLLINTERNAL usermsg_update_wanted(void) {
+	usermsg_sub_t *sub;
+	int i;
+
+	memset(usermsg_wanted, 0, sizeof(usermsg_wanted));
+	for(i=0; i < num_subs; i++) {
+		sub=subs[i];
+		if(!sub->fn)
+			continue;
+		if(sub->msgid == 0) {
+			memset(usermsg_wanted, 1, sizeof(usermsg_wanted));
+			return;
+		}
+		if(sub->msgid > 0)
+			usermsg_wanted[sub->msgid & 0xff]=1;
+	}
+}
+
+// Send held back message on to the normal dispatch; all but MessageEnd.
+static void DLLINTERNAL usermsg_send(void) {
+	meta_msgarg_t *arg;
+	int i;
+
+	usermsg_capturing=0;
+	api_hook_msg_type=cur.msg_type;
+	USERMSG_DISPATCH(FN_MESSAGEBEGIN, pfnMessageBegin, (cur.msg_dest, cur.msg_type, cur.origin, cur.ed));
+	for(i=0; i < cur.nargs; i++) {
+		arg=&cur_args[i];
+		switch(arg->type) {
+			case MSGARG_BYTE:
+				USERMSG_DISPATCH(FN_WRITEBYTE, pfnWriteByte, (arg->ival));
+				break;
+			case MSGARG_CHAR:
+				USERMSG_DISPATCH(FN_WRITECHAR, pfnWriteChar, (arg->ival));
+				break;
+			case MSGARG_SHORT:
+				USERMSG_DISPATCH(FN_WRITESHORT, pfnWriteShort, (arg->ival));
+				break;
+			case MSGARG_LONG:
+				USERMSG_DISPATCH(FN_WRITELONG, pfnWriteLong, (arg->ival));
+				break;
+			case MSGARG_ANGLE:
+				USERMSG_DISPATCH(FN_WRITEANGLE, pfnWriteAngle, (arg->fval));
+				break;
+			case MSGARG_COORD:
+				USERMSG_DISPATCH(FN_WRITECOORD, pfnWriteCoord, (arg->fval));
+				break;
+			case MSGARG_STRING:
+				USERMSG_DISPATCH(FN_WRITESTRING, pfnWriteString, (arg->str ? arg->str : ""));
+				break;
+			case MSGARG_ENTITY:
+				USERMSG_DISPATCH(FN_WRITEENTITY, pfnWriteEntity, (arg->ival));
+				break;
+		}
+	}
+}
+
+// Free unregistered subscriptions, once no callback is running.
+static void DLLINTERNAL usermsg_compact(void) {
+	int i, n;
+
+	if(!subs_dirty || usermsg_dispatching)
+		return;
+	for(i=0, n=0; i < num_subs; i++) {
+		if(subs[i]->fn)
+			subs[n++]=subs[i];
+		else
+			free(subs[i]);
+	}
+	num_subs=n;
+	subs_dirty=0;
+}
+
+static void DLLINTERNAL usermsg_set_active(int active) {
+	int i;
+
+	if(active == usermsg_active)
+		return;
+	// message held back when the last subscription went away; send it
+	// before Write* calls start to bypass us
+	if(!active && usermsg_capturing && !usermsg_dispatching)
+		usermsg_send();
+	usermsg_active=active;
+	// need to see every part of messages
+	for(i=0; i < NUM_API_MSG_FUNCS; i++)
+		api_hook_internal_ref(e_api_engine, api_msg_funcs[i], active ? 1 : -1);
+}
+
+int DLLINTERNAL usermsg_register(plid_t plid, const char *msgname, int msgid, META_USERMSG_FN fn, void *data) {
+	usermsg_sub_t *sub, **newlist;
+	MRegMsg *msg;
+	int newmax;
+
+	if(!fn)
+		RETURN_ERRNO(0, ME_ARGUMENT);
+	if(msgname && (!msgname[0] || strlen(msgname) >= sizeof(sub->name)))
+		RETURN_ERRNO(0, ME_ARGUMENT);
+	if(!msgname && (msgid < 0 || msgid > 255))
+		RETURN_ERRNO(0, ME_ARGUMENT);
+
+	if(num_subs >= max_subs) {
+		newmax = max_subs ? max_subs * 2 : 16;
+		newlist=(usermsg_sub_t **)realloc(subs, newmax * sizeof(*subs));
+		if(!newlist)
+			RETURN_ERRNO(0, ME_NOMEM);
+		subs=newlist;
+		max_subs=newmax;
+	}
+	sub=(usermsg_sub_t *)calloc(1, sizeof(usermsg_sub_t));
+	if(!sub)
+		RETURN_ERRNO(0, ME_NOMEM);
+	if(msgname) {
+		STRNCPY(sub->name, msgname, sizeof(sub->name));
+		msg=RegMsgs->find(msgname);
+		sub->msgid = msg ? msg->msgid : -1;
+	}
+	else
+		sub->msgid=msgid;
+	sub->id=next_id++;
+	sub->plid=plid;
+	sub->fn=fn;
+	sub->data=data;
+	subs[num_subs++]=sub;
+
+	usermsg_update_wanted();
+	usermsg_set_active(1);
+
+	META_DEBUG(3, ("Plugin '%s' subscribed to user message %s (%d); id %d", plid->name, 
+			msgname ? msgname : "*", sub->msgid, sub->id));
+	return(sub->id);
+}
+
+static void DLLINTERNAL usermsg_remove(usermsg_sub_t *sub) {
+	int i;
+
+	sub->fn=NULL;
+	subs_dirty=1;
+	usermsg_update_wanted();
+	for(i=0; i < num_subs; i++) {
+		if(subs[i]->fn)
+			break;
+	}
+	if(i == num_subs)
+		usermsg_set_active(0);
+}
+
+mBOOL DLLINTERNAL usermsg_unregister(plid_t plid, int id) {
+	int i;
+
+	for(i=0; i < num_subs; i++) {
+		if(subs[i]->id == id && subs[i]->plid == plid && subs[i]->fn) {
+			usermsg_remove(subs[i]);
+			usermsg_compact();
+			return(mTRUE);
+		}
+	}
+	RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+}
+
+void DLLINTERNAL usermsg_plugin_unloaded(plid_t plid) {
+	int i;
+
+	for(i=0; i < num_subs; i++) {
+		if(subs[i]->plid == plid && subs[i]->fn)
+			usermsg_remove(subs[i]);
+	}
+	usermsg_compact();
+	usermsg_filter_clear(plid, 0);
+	usermsg_filter_clear(plid, 1);
+}
+
+static inline void DLLINTERNAL usermsg_filter_set(MPlugin *plug, int post, int msgid) {
+	plug->msg_filter[post][msgid >> 5] |= 1U << (msgid & 31);
+}
+
+mBOOL DLLINTERNAL usermsg_filter_add(plid_t plid, int post, const char *msgname, int msgid) {
+	MPlugin *plug;
+	MRegMsg *msg;
+	usermsg_pending_t *newlist;
+	int newmax;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+	post = post ? 1 : 0;
+	if(msgname) {
+		if(!msgname[0] || strlen(msgname) >= sizeof(pending->name))
+			RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+		msg=RegMsgs->find(msgname);
+		msgid = msg ? msg->msgid : -1;
+	}
+	else if(msgid < 0 || msgid > 255)
+		RETURN_ERRNO(mFALSE, ME_ARGUMENT);
+
+	// remember name until gamedll registers it
+	if(msgid < 0) {
+		if(num_pending >= max_pending) {
+			newmax = max_pending ? max_pending * 2 : 16;
+			newlist=(usermsg_pending_t *)realloc(pending, newmax * sizeof(*pending));
+			if(!newlist)
+				RETURN_ERRNO(mFALSE, ME_NOMEM);
+			pending=newlist;
+			max_pending=newmax;
+		}
+		pending[num_pending].plid=plid;
+		pending[num_pending].post=post;
+		STRNCPY(pending[num_pending].name, msgname, sizeof(pending[num_pending].name));
+		num_pending++;
+	}
+
+	if(!plug->msg_filtered[post]) {
+		memset(plug->msg_filter[post], 0, sizeof(plug->msg_filter[post]));
+		if(msgid >= 0)
+			usermsg_filter_set(plug, post, msgid);
+		plug->msg_filtered[post]=mTRUE;
+		// msg_type of each message is taken from MessageBegin
+		if(num_filtered++ == 0)
+			api_hook_internal_ref(e_api_engine, offsetof(enginefuncs_t, pfnMessageBegin), 1);
+		rebuild_api_hook_subscribers();
+	}
+	else if(msgid >= 0)
+		usermsg_filter_set(plug, post, msgid);
+
+	META_DEBUG(3, ("Plugin '%s' added %s message filter %s (%d)", plid->name, post ? "post" : "pre", 
+			msgname ? msgname : "-", msgid));
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL usermsg_filter_clear(plid_t plid, int post) {
+	MPlugin *plug;
+	int i, n;
+
+	plug=Plugins->find(plid);
+	if(!plug)
+		RETURN_ERRNO(mFALSE, ME_NOTFOUND);
+	post = post ? 1 : 0;
+	for(i=0, n=0; i < num_pending; i++) {
+		if(pending[i].plid != plid || pending[i].post != post)
+			pending[n++]=pending[i];
+	}
+	num_pending=n;
+	if(!plug->msg_filtered[post])
+		return(mTRUE);
+
+	plug->msg_filtered[post]=mFALSE;
+	if(--num_filtered == 0)
+		api_hook_internal_ref(e_api_engine, offsetof(enginefuncs_t, pfnMessageBegin), -1);
+	rebuild_api_hook_subscribers();
+	return(mTRUE);
+}
+
+void DLLINTERNAL usermsg_msg_registered(const char *msgname, int msgid) {
+	MPlugin *plug;
+	int i, n, changed;
+
+	for(i=0, n=0; i < num_pending; i++) {
+		if(strcmp(pending[i].name, msgname)) {
+			pending[n++]=pending[i];
+			continue;
+		}
+		plug=Plugins->find(pending[i].plid);
+		if(plug && plug->msg_filtered[pending[i].post])
+			usermsg_filter_set(plug, pending[i].post, msgid);
+	}
+	num_pending=n;
+
+	for(i=0, changed=0; i < num_subs; i++) {
+		if(subs[i]->msgid == -1 && subs[i]->fn && !strcmp(subs[i]->name, msgname)) {
+			subs[i]->msgid=msgid;
+			changed=1;
+		}
+	}
+	if(changed)
+		usermsg_update_wanted();
+}
+
+mBOOL DLLINTERNAL usermsg_begin(int msg_dest, int msg_type, const float *pOrigin, edict_t *ed) {
+	MRegMsg *msg;
+
+	// gamedll didn't end previous message; let the engine deal with it
+	if(unlikely(usermsg_capturing))
+		usermsg_send();
+	// Message sent from a subscriber callback, such as a blocked message
+	// sent again in changed form; capturing it would overwrite the message
+	// being dispatched, so it goes through uncaptured.
+	if(unlikely(usermsg_dispatching))
+		return(mFALSE);
+	if(msg_type < 0 || msg_type > 255 || !usermsg_wanted[msg_type])
+		return(mFALSE);
+
+	memset(&cur, 0, sizeof(cur));
+	cur.msg_dest=msg_dest;
+	cur.msg_type=msg_type;
+	cur.size=-1;
+	msg=RegMsgs->find(msg_type);
+	if(msg) {
+		cur.name=msg->name;
+		cur.size=msg->size;
+	}
+	if(pOrigin) {
+		cur_origin[0]=pOrigin[0];
+		cur_origin[1]=pOrigin[1];
+		cur_origin[2]=pOrigin[2];
+		cur.origin=cur_origin;
+	}
+	cur.ed=ed;
+	cur.args=cur_args;
+	cur_strings_len=0;
+	usermsg_capturing=1;
+	return(mTRUE);
+}
+
+// Message too long to hold back; send what we have, and let rest of it
+// go through normal dispatch.
+static mBOOL DLLINTERNAL usermsg_overflow(void) {
+	msgs_overflowed++;
+	META_DEBUG(3, ("User message %d too long to capture; sending without callbacks", cur.msg_type));
+	usermsg_send();
+	return(mFALSE);
+}
+
+mBOOL DLLINTERNAL usermsg_write_int(meta_msgarg_type_t type, int value) {
+	meta_msgarg_t *arg;
+
+	if(unlikely(cur.nargs >= USERMSG_MAX_ARGS))
+		return(usermsg_overflow());
+	arg=&cur_args[cur.nargs++];
+	arg->type=type;
+	arg->ival=value;
+	arg->fval=(float)value;
+	arg->str="";
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL usermsg_write_float(meta_msgarg_type_t type, float value) {
+	meta_msgarg_t *arg;
+
+	if(unlikely(cur.nargs >= USERMSG_MAX_ARGS))
+		return(usermsg_overflow());
+	arg=&cur_args[cur.nargs++];
+	arg->type=type;
+	arg->ival=(int)value;
+	arg->fval=value;
+	arg->str="";
+	return(mTRUE);
+}
+
+mBOOL DLLINTERNAL usermsg_write_string(const char *str) {
+	meta_msgarg_t *arg;
+	int len;
+
+	// NULL goes on to engine as it is
+	if(unlikely(!str))
+		return(usermsg_overflow());
+	len=strlen(str) + 1;
+	if(unlikely(cur.nargs >= USERMSG_MAX_ARGS || len > USERMSG_MAX_STRINGS - cur_strings_len))
+		return(usermsg_overflow());
+	arg=&cur_args[cur.nargs++];
+	arg->type=MSGARG_STRING;
+	memcpy(&cur_strings[cur_strings_len], str, len);
+	arg->str=&cur_strings[cur_strings_len];
+	arg->ival=atoi(arg->str);
+	arg->fval=(float)atof(arg->str);
+	cur_strings_len+=len;
+	return(mTRUE);
+}
+
+// Pass the held back message to subscribers, and send it on unless
+// blocked.
+void DLLINTERNAL usermsg_end(void) {
+	usermsg_sub_t *sub;
+	int i, n, blocked;
+
+	usermsg_capturing=0;
+	msgs_captured++;
+
+	usermsg_dispatching++;
+	n=num_subs;
+	for(i=0; i < n; i++) {
+		sub=subs[i];
+		if(!usermsg_sub_matches(sub, cur.msg_type))
+			continue;
+		cur.id=sub->id;
+		cur.pos=0;
+		blocked=cur.block;
+		sub->fn(&cur, sub->data);
+		sub->calls++;
+		if(cur.block && !blocked)
+			sub->blocks++;
+	}
+	usermsg_dispatching--;
+
+	if(cur.block) {
+		msgs_blocked++;
+		META_DEBUG(5, ("Blocked user message %s (%d)", cur.name ? cur.name : "-", cur.msg_type));
+	}
+	else {
+		usermsg_send();
+		USERMSG_DISPATCH(FN_MESSAGEEND, pfnMessageEnd, (VOID_ARG));
+	}
+	usermsg_compact();
+}
+
+// "meta usermsgs" console command.
+void DLLINTERNAL cmd_meta_usermsgs(void) {
+	usermsg_sub_t *sub;
+	MPlugin *plug;
+	char msg[256];
+	int i, n, post, t, len;
+
+	META_CONS("User message subscriptions:");
+	META_CONS("  %4s %-16s %-24s %10s %10s", "id", "plugin", "message", "calls", "blocked");
+	for(i=0, n=0; i < num_subs; i++) {
+		sub=subs[i];
+		if(!sub->fn)
+			continue;
+		if(sub->name[0] && sub->msgid == -1)
+			safe_snprintf(msg, sizeof(msg), "%s (unregistered)", sub->name);
+		else if(sub->name[0])
+			safe_snprintf(msg, sizeof(msg), "%s (%d)", sub->name, sub->msgid);
+		else if(sub->msgid)
+			safe_snprintf(msg, sizeof(msg), "#%d", sub->msgid);
+		else
+			STRNCPY(msg, "*", sizeof(msg));
+		META_CONS("  %4d %-16.16s %-24.24s %10lu %10lu", sub->id, sub->plid->name, msg, sub->calls, sub->blocks);
+		n++;
+	}
+	META_CONS("%d subscriptions; %lu messages captured, %lu blocked, %lu too long to capture",
+			n, msgs_captured, msgs_blocked, msgs_overflowed);
+
+	if(!num_filtered)
+		return;
+	META_CONS("Message filters:");
+	META_CONS("  %-16s %-4s %s", "plugin", "hook", "msg_types");
+	for(i=0; i < Plugins->endlist; i++) {
+		plug=Plugins->plist[i];
+		for(post=0; post < 2; post++) {
+			if(plug->status < PL_RUNNING || !plug->msg_filtered[post])
+				continue;
+			len=0;
+			msg[0]='\0';
+			for(t=0; t < 256 && len < (int)sizeof(msg) - 8; t++) {
+				if(!((plug->msg_filter[post][t >> 5] >> (t & 31)) & 1))
+					continue;
+				safevoid_snprintf(msg + len, sizeof(msg) - len, "%s%d", len ? "," : "", t);
+				len+=strlen(msg + len);
+			}
+			META_CONS("  %-16.16s %-4s %s", plug->info ? plug->info->name : plug->file, post ? "post" : "pre", msg);
+		}
+	}
+}
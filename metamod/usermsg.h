@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef USERMSG_H
+#define USERMSG_H
+
+#include "plinfo.h"			// plid_t
+#include "mhook.h"			// META_USERMSG_FN, etc
+#include "types_meta.h"		// mBOOL
+#include "comp_dep.h"
+
+// User message capture.
+//  Plugins that want to look at messages the gamedll sends (DeathMsg,
+//  TeamInfo, etc) register a callback with REG_USERMSG_HOOK, by message
+//  name, instead of hooking MessageBegin, every Write* and MessageEnd.
+//  When gamedll begins a message somebody has subscribed to, metamod
+//  holds back the MessageBegin and Write* calls, collecting the arguments
+//  into a typed buffer.  At MessageEnd the subscribers' callbacks get the
+//  whole message with a read cursor, and can change argument values or
+//  block the message.  Unless blocked, the message is then sent on with
+//  the normal hook dispatch, so that plugins hooking the Write* functions
+//  see it as before, only at MessageEnd.  Messages nobody subscribed to
+//  are dispatched as they come.
+
+// nonzero while there are subscriptions
+extern int usermsg_active DLLHIDDEN;
+
+// nonzero while a message is being held back
+extern int usermsg_capturing DLLHIDDEN;
+
+// Subscribe to message by name, or by msgid if 'msgname' is NULL (for
+// engine's svc_* messages); msgid 0 and NULL name subscribes to every
+// message.  Names the gamedll hasn't registered yet are resolved when
+// it does.  Returns subscription id, or 0 with meta_errno set.
+int DLLINTERNAL usermsg_register(plid_t plid, const char *msgname, int msgid, META_USERMSG_FN fn, void *data);
+
+// unsubscribe by id
+mBOOL DLLINTERNAL usermsg_unregister(plid_t plid, int id);
+
+// unsubscribe plugin's messages, on unload
+void DLLINTERNAL usermsg_plugin_unloaded(plid_t plid);
+
+// Message filter of plugin's MessageBegin, Write* and MessageEnd hooks
+// (pre or post table).  Once plugin has added a message (by name, or by
+// msgid if 'msgname' is NULL), its message hooks only get calls of the
+// messages added.  Clearing filter gives it every message again.
+mBOOL DLLINTERNAL usermsg_filter_add(plid_t plid, int post, const char *msgname, int msgid);
+mBOOL DLLINTERNAL usermsg_filter_clear(plid_t plid, int post);
+
+// gamedll registered a message; resolve subscriptions and filters by name
+void DLLINTERNAL usermsg_msg_registered(const char *msgname, int msgid);
+
+// From engine hooks.  usermsg_begin() returns mTRUE when the message is
+// held back; the Write* and MessageEnd calls of it then go to
+// usermsg_write*() and usermsg_end() instead of the normal dispatch.
+mBOOL DLLINTERNAL usermsg_begin(int msg_dest, int msg_type, const float *pOrigin, edict_t *ed);
+mBOOL DLLINTERNAL usermsg_write_int(meta_msgarg_type_t type, int value);
+mBOOL DLLINTERNAL usermsg_write_float(meta_msgarg_type_t type, float value);
+mBOOL DLLINTERNAL usermsg_write_string(const char *str);
+void DLLINTERNAL usermsg_end(void);
+
+void DLLINTERNAL cmd_meta_usermsgs(void);
+
+#endif /* USERMSG_H */
@@ -0,0 +1,1683 @@
+/*
+ * Copyright (c) 2004-2006 Jussi Kivilinna
+ *
+ *    This file is part of "Metamod All-Mod-Support"-patch for Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// mmreplay - replay a metamod call recording without the engine.
+//
+// Loads metamod (which loads gamedll and plugins as usual) with a stand-in
+// engine, feeds it the dllapi/newapi calls from a file written by
+// "meta record start", and answers the engine calls that gamedll makes
+// from the recorded return values.  Prints frame time statistics, so that
+// metamod, plugin or gamedll builds can be compared on the same real
+// match on a dev box.
+//
+// Run from the hlds directory:
+//   mmreplay [-v] [-g <gamedir>] [-m <metamod.so>] [-o <frames.txt>] <recording>
+//
+// What is replayed and what isn't:
+//  - Engine calls made by gamedll get the recorded return values and
+//    output arguments (trace results, vectors etc).  Calls that engine
+//    made to gamedll while in such a call (Touch from SetOrigin etc) are
+//    replayed from inside it.
+//  - Engine calls that plugins make directly aren't in the recording;
+//    they, and any other call the recording doesn't match, are answered
+//    by the stand-in itself: edicts, private data, strings and cvars are
+//    kept for real, everything else returns zero.
+//  - Engine's own physics and networking don't run; entity state only
+//    changes by what gamedll and plugins do.
+//  - Player movement (PM_Move) and save/restore aren't replayed.
+
+#include <stdio.h>			// printf, etc
+#include <stdlib.h>			// malloc, etc
+#include <stdarg.h>			// va_list
+#include <string.h>			// memcpy, etc
+#include <math.h>			// sin, cos
+#include <time.h>			// clock_gettime
+#include <fcntl.h>			// open
+#include <unistd.h>			// close, getopt
+#include <dlfcn.h>			// dlopen, etc
+#include <sys/mman.h>		// mmap
+#include <sys/stat.h>		// fstat
+
+#include <extdll.h>			// always
+#include <entity_state.h>	// entity_state_t, clientdata_t
+#include <usercmd.h>		// usercmd_t
+#include <weaponinfo.h>		// weapon_data_t
+#include <netadr.h>			// netadr_t
+#include <custom.h>			// customization_t
+#include <pm_defs.h>		// playermove_t
+
+#include "api_record.h"		// record file format
+
+#define MAX_STRING_POOL (16 * 1024 * 1024)
+#define MAX_ARENA (8 * 1024 * 1024)
+
+// function index ranges in recording, as in metamod's api_func_base
+#define NUM_ENGINE_FUNCS (sizeof(enginefuncs_t) / sizeof(void*))
+#define NUM_DLLAPI_FUNCS (sizeof(DLL_FUNCTIONS) / sizeof(void*))
+#define NUM_NEWAPI_FUNCS (sizeof(NEW_DLL_FUNCTIONS) / sizeof(void*))
+#define DLLAPI_BASE NUM_ENGINE_FUNCS
+#define NEWAPI_BASE (NUM_ENGINE_FUNCS + NUM_DLLAPI_FUNCS)
+#define NUM_FUNCS (NEWAPI_BASE + NUM_NEWAPI_FUNCS)
+
+#define ENGINE_FUNC(name) (offsetof(enginefuncs_t, name) / sizeof(void*))
+#define DLLAPI_FUNC(name) (DLLAPI_BASE + offsetof(DLL_FUNCTIONS, name) / sizeof(void*))
+#define NEWAPI_FUNC(name) (NEWAPI_BASE + offsetof(NEW_DLL_FUNCTIONS, name) / sizeof(void*))
+
+static int verbose = 0;
+static const char *gamedir = NULL;
+
+static globalvars_t globals;
+static edict_t *edicts = NULL;
+static int max_entities = 0;
+static unsigned char *edict_stale = NULL;	// left over from previous map
+
+static char *string_pool = NULL;
+static unsigned int string_pool_used = 0;
+
+static void *metamod_handle = NULL;
+static DLL_FUNCTIONS dllapi_table;
+static NEW_DLL_FUNCTIONS newapi_table;
+
+// recording, mapped
+static const unsigned char *rec_pos = NULL;
+static const unsigned char *rec_end = NULL;
+static int replaying = 0;
+
+static struct {
+	unsigned long calls;				// dllapi/newapi calls replayed
+	unsigned long skipped_calls;		// calls we don't replay (PM_Move, etc)
+	unsigned long engine_matched;		// engine calls answered from recording
+	unsigned long engine_unmatched;		// engine calls answered by stand-in
+	unsigned long records_skipped;		// recorded calls nobody made in replay
+} stats;
+
+
+//
+// Scratch memory for arguments of one top level call.
+//
+static unsigned char *arena = NULL;
+static unsigned int arena_used = 0;
+static unsigned char arena_overflow[65536];
+
+static void *arena_alloc(unsigned int size) {
+	void *ptr;
+
+	size = (size + 15) & ~15;
+	if(arena_used + size > MAX_ARENA) {
+		static int warned = 0;
+		if(!warned++)
+			fprintf(stderr, "mmreplay: argument scratch space exhausted\n");
+		memset(arena_overflow, 0, sizeof(arena_overflow));
+		return(arena_overflow);
+	}
+	ptr = arena + arena_used;
+	arena_used += size;
+	memset(ptr, 0, size);
+	return(ptr);
+}
+
+// Size of scratch buffer for pointer arguments that aren't recorded
+// (gamedll output structs, etc).
+template<typename T> struct scratch_size { enum { size = sizeof(T) }; };
+template<> struct scratch_size<void> { enum { size = 4096 }; };
+template<> struct scratch_size<weapon_data_t> { enum { size = 64 * sizeof(weapon_data_t) }; };
+
+// Engine returns strings that gamedll may hold onto for a while; keep
+// the last few.
+static char *string_ring_copy(const char *str) {
+	static char ring[16][4096];
+	static int next = 0;
+	char *buf;
+
+	if(!str)
+		return(NULL);
+	buf = ring[next++ & 15];
+	strncpy(buf, str, sizeof(ring[0]) - 1);
+	buf[sizeof(ring[0]) - 1] = '\0';
+	return(buf);
+}
+
+
+//
+// Edicts and strings.
+//
+static edict_t *edict_of(int index) {
+	if(index < 0 || index >= max_entities)
+		return(NULL);
+	return(&edicts[index]);
+}
+
+static int alloc_string(const char *str) {
+	unsigned int len;
+	int offset;
+
+	if(!str)
+		return(0);
+	len = strlen(str) + 1;
+	if(string_pool_used + len > MAX_STRING_POOL) {
+		fprintf(stderr, "mmreplay: string pool exhausted\n");
+		exit(1);
+	}
+	offset = string_pool_used;
+	memcpy(string_pool + offset, str, len);
+	string_pool_used += len;
+	return(offset);
+}
+
+static void free_private_data(edict_t *pEdict) {
+	if(pEdict->pvPrivateData) {
+		free(pEdict->pvPrivateData);
+		pEdict->pvPrivateData = NULL;
+	}
+}
+
+// Clear edict for new entity, as engine's ED_Alloc does.
+static void init_edict(edict_t *pEdict) {
+	int index = pEdict - edicts;
+
+	free_private_data(pEdict);
+	memset(&pEdict->v, 0, sizeof(pEdict->v));
+	pEdict->free = 0;
+	pEdict->serialnumber++;
+	pEdict->v.pContainingEntity = pEdict;
+	edict_stale[index] = 0;
+}
+
+static edict_t *alloc_edict(void) {
+	int i;
+
+	for(i = globals.maxClients + 1; i < max_entities; i++)
+		if(edicts[i].free)
+			break;
+	if(i >= max_entities) {
+		fprintf(stderr, "mmreplay: out of edicts\n");
+		exit(1);
+	}
+	init_edict(&edicts[i]);
+	return(&edicts[i]);
+}
+
+// Create entity of given class by calling its linkent function, which
+// metamod finds in itself or in gamedll.
+static void spawn_entity_class(edict_t *pEdict, const char *classname) {
+	typedef void (*ENTITY_FN)(entvars_t *);
+	ENTITY_FN pfnEntity;
+
+	pEdict->v.classname = alloc_string(classname);
+	pfnEntity = (ENTITY_FN)dlsym(metamod_handle, classname);
+	if(pfnEntity)
+		(*pfnEntity)(&pEdict->v);
+	else if(verbose)
+		printf("mmreplay: no entity function for '%s'\n", classname);
+}
+
+// Map entities are created by engine before their first KeyValue, without
+// going through metamod; do the same when we see an edict that doesn't
+// have an entity yet.
+static void ensure_entity(edict_t *pEdict, const char *classname) {
+	int index;
+
+	if(!pEdict || !classname || !*classname)
+		return;
+	index = pEdict - edicts;
+	if(!pEdict->free && pEdict->pvPrivateData && !edict_stale[index])
+		return;
+	if(index > 0 && index <= globals.maxClients)
+		return;
+	init_edict(pEdict);
+	spawn_entity_class(pEdict, classname);
+}
+
+
+//
+// Reading recorded records.
+//
+static const api_record_header_t *rec_peek(void) {
+	api_record_header_t *hdr;
+
+	if(rec_end - rec_pos < (int)sizeof(api_record_header_t))
+		return(NULL);
+	hdr = (api_record_header_t *)rec_pos;
+	if((unsigned int)(rec_end - rec_pos) - sizeof(api_record_header_t) < hdr->size)
+		return(NULL);
+	return(hdr);
+}
+
+static void rec_advance(const api_record_header_t *hdr) {
+	rec_pos = (const unsigned char *)hdr + sizeof(*hdr) + hdr->size;
+}
+
+// Deserializes arguments and return values; mirror of metamod's
+// api_record_writer.
+class replay_reader {
+public:
+	inline replay_reader(void): pos(NULL), end(NULL) {};
+	inline replay_reader(const api_record_header_t *hdr): pos((const unsigned char *)(hdr + 1)), end(pos + hdr->size) {};
+
+	void get(void *data, unsigned int len) {
+		if(len > (unsigned int)(end - pos)) {
+			memset(data, 0, len);
+			pos = end;
+			return;
+		}
+		memcpy(data, pos, len);
+		pos += len;
+	};
+	int get_int(void) { int value; get(&value, sizeof(value)); return(value); };
+	float get_float(void) { float value; get(&value, sizeof(value)); return(value); };
+	int get_present(void) { unsigned char present; get(&present, sizeof(present)); return(present); };
+	edict_t *get_edict(void) { return(edict_of(get_int())); };
+	const char *get_string(void) {
+		const char *str;
+		int len = get_int();
+		if(len < 0 || len + 1 > end - pos)
+			return(NULL);
+		str = (const char *)pos;
+		pos += len + 1;
+		return(str);
+	};
+	char *get_string_copy(void) {
+		const char *str = get_string();
+		char *copy;
+		unsigned int len;
+		if(!str)
+			return(NULL);
+		// room for gamedll to write into, as in ClientConnect's reject
+		// reason
+		len = strlen(str) + 1;
+		copy = (char *)arena_alloc(len < 256 ? 256 : len);
+		memcpy(copy, str, len);
+		return(copy);
+	};
+	float *get_vector(void) {
+		float *vec;
+		if(!get_present())
+			return(NULL);
+		vec = (float *)arena_alloc(3 * sizeof(float));
+		get(vec, 3 * sizeof(float));
+		return(vec);
+	};
+
+	// arguments
+	template<typename T> void arg(T &value) { get(&value, sizeof(value)); };
+	template<typename T> void arg(T *&ptr) { ptr = (T *)arena_alloc(scratch_size<T>::size); };
+	void arg(edict_t *&pEdict) { pEdict = get_edict(); };
+	void arg(const edict_t *&pEdict) { pEdict = get_edict(); };
+	void arg(entvars_t *&pev) { edict_t *pEdict = get_edict(); pev = pEdict ? &pEdict->v : NULL; };
+	void arg(char *&str) { str = get_string_copy(); };
+	void arg(const char *&str) { str = get_string(); };
+	void arg(const float *&vec) { vec = get_vector(); };
+	void arg(int *&ptr) {
+		ptr = NULL;
+		if(get_present()) {
+			ptr = (int *)arena_alloc(sizeof(int));
+			*ptr = get_int();
+		}
+	};
+	void arg(KeyValueData *&pkvd) {
+		const char *classname = get_string();
+		pkvd = NULL;
+		if(!classname)
+			return;
+		pkvd = (KeyValueData *)arena_alloc(sizeof(KeyValueData));
+		pkvd->szClassName = (char *)classname;
+		pkvd->szKeyName = (char *)get_string();
+		pkvd->szValue = (char *)get_string();
+		pkvd->fHandled = get_int();
+	};
+	void arg(const usercmd_t *&cmd) {
+		usercmd_t *copy = NULL;
+		if(get_present()) {
+			copy = (usercmd_t *)arena_alloc(sizeof(usercmd_t));
+			get(copy, sizeof(usercmd_t));
+		}
+		cmd = copy;
+	};
+
+	// output arguments
+	template<typename T> void out(T) {};
+	void out(float *vec) {
+		float tmp[3];
+		if(!get_present())
+			return;
+		get(tmp, sizeof(tmp));
+		if(vec)
+			memcpy(vec, tmp, sizeof(tmp));
+	};
+	void out(int *ptr) {
+		int tmp;
+		if(!get_present())
+			return;
+		tmp = get_int();
+		if(ptr)
+			*ptr = tmp;
+	};
+	void out(TraceResult *ptr) {
+		TraceResult tmp;
+		if(!get_present())
+			return;
+		get(&tmp, sizeof(tmp));
+		tmp.pHit = get_edict();
+		if(ptr)
+			*ptr = tmp;
+	};
+
+	// return values
+	template<typename T> void ret(T &value) { get(&value, sizeof(value)); };
+	template<typename T> void ret(T *&ptr) { ptr = NULL; };
+	void ret(edict_t *&pEdict) { pEdict = get_edict(); };
+	void ret(char *&str) { str = string_ring_copy(get_string()); };
+	void ret(const char *&str) { str = get_string(); };
+private:
+	const unsigned char *pos;
+	const unsigned char *end;
+};
+
+static void replay_call(const api_record_header_t *hdr);
+
+// Skip recorded call with everything nested in it.
+static void skip_call(const api_record_header_t *hdr) {
+	unsigned int func = hdr->func;
+	unsigned int depth = hdr->depth;
+
+	rec_advance(hdr);
+	stats.records_skipped++;
+	while((hdr = rec_peek())) {
+		rec_advance(hdr);
+		if(hdr->kind != REC_CALL && hdr->func == func && hdr->depth == depth)
+			return;
+	}
+}
+
+// Finish replayed call: find its return record, skipping anything
+// recorded in it that replay didn't call.
+static const api_record_header_t *finish_call(unsigned int func, unsigned int depth) {
+	const api_record_header_t *hdr;
+
+	while((hdr = rec_peek())) {
+		if(hdr->kind == REC_CALL) {
+			skip_call(hdr);
+			continue;
+		}
+		rec_advance(hdr);
+		if(hdr->func == func && hdr->depth == depth)
+			return(hdr);
+		stats.records_skipped++;
+	}
+	return(NULL);
+}
+
+// Engine call made in replay; matches it against the recording.  If the
+// next recorded call is this function, calls that engine made to gamedll
+// during it are replayed, and 'matched' is set with 'reader' positioned
+// at the recorded return value.
+class engine_call {
+public:
+	engine_call(unsigned int func);
+	int matched;
+	replay_reader reader;
+};
+
+engine_call::engine_call(unsigned int func): matched(0) {
+	const api_record_header_t *hdr;
+	unsigned int depth;
+
+	if(!replaying || !(hdr = rec_peek()) || hdr->kind != REC_CALL || hdr->func != func) {
+		stats.engine_unmatched++;
+		return;
+	}
+	depth = hdr->depth;
+	rec_advance(hdr);
+
+	while((hdr = rec_peek())) {
+		if(hdr->kind == REC_CALL) {
+			if(hdr->func < NUM_ENGINE_FUNCS)
+				skip_call(hdr);
+			else
+				replay_call(hdr);
+			continue;
+		}
+		rec_advance(hdr);
+		if(hdr->func == func && hdr->depth == depth) {
+			if(hdr->kind == REC_RETURN) {
+				reader = replay_reader(hdr);
+				matched = 1;
+			}
+			stats.engine_matched++;
+			return;
+		}
+		stats.records_skipped++;
+	}
+}
+
+// Return value holder; void version does nothing.
+template<typename R> class replay_ret {
+public:
+	inline replay_ret(void): value() {};
+	inline void read(replay_reader &reader) { reader.ret(value); };
+	inline R get(void) const { return(value); };
+private:
+	R value;
+};
+
+template<> class replay_ret<void> {
+public:
+	inline void read(replay_reader &) {};
+	inline void get(void) const {};
+};
+
+
+//
+// Stand-in engine function for each engine function type: answers from
+// the recording, and leaves output arguments as they were recorded.
+//
+template<typename fn_t, unsigned int FUNC> class engine_stub;
+
+template<typename R, unsigned int FUNC>
+class engine_stub<R (*)(void), FUNC> {
+public:
+	static R call(void) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, unsigned int FUNC>
+class engine_stub<R (*)(A1), FUNC> {
+public:
+	static R call(A1 a1) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2), FUNC> {
+public:
+	static R call(A1 a1, A2 a2) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5, A6), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5); c.reader.out(a6);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5, A6, A7), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5); c.reader.out(a6); c.reader.out(a7);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5, A6, A7, A8), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5); c.reader.out(a6); c.reader.out(a7); c.reader.out(a8);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5); c.reader.out(a6); c.reader.out(a7); c.reader.out(a8); c.reader.out(a9);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9, typename A10, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9, A10 a10) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5); c.reader.out(a6); c.reader.out(a7); c.reader.out(a8); c.reader.out(a9); c.reader.out(a10);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9, typename A10, typename A11, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9, A10 a10, A11 a11) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5); c.reader.out(a6); c.reader.out(a7); c.reader.out(a8); c.reader.out(a9); c.reader.out(a10); c.reader.out(a11);
+		}
+		return(ret.get());
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, typename A8, typename A9, typename A10, typename A11, typename A12, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11, A12), FUNC> {
+public:
+	static R call(A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6, A7 a7, A8 a8, A9 a9, A10 a10, A11 a11, A12 a12) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched) {
+			ret.read(c.reader);
+			c.reader.out(a1); c.reader.out(a2); c.reader.out(a3); c.reader.out(a4); c.reader.out(a5); c.reader.out(a6); c.reader.out(a7); c.reader.out(a8); c.reader.out(a9); c.reader.out(a10); c.reader.out(a11); c.reader.out(a12);
+		}
+		return(ret.get());
+	};
+};
+
+// printf-style functions
+template<typename R, typename A1, typename A2, unsigned int FUNC>
+class engine_stub<R (*)(A1, A2, ...), FUNC> {
+public:
+	static R call(A1, A2, ...) {
+		engine_call c(FUNC);
+		replay_ret<R> ret;
+		if(c.matched)
+			ret.read(c.reader);
+		return(ret.get());
+	};
+};
+
+#define ENGINE_STUB(name) standin->name = &engine_stub<__typeof__(standin->name), ENGINE_FUNC(name)>::call
+
+static void fill_engine_stubs(enginefuncs_t *standin) {
+	memset(standin, 0, sizeof(*standin));
+	ENGINE_STUB(pfnPrecacheModel);
+	ENGINE_STUB(pfnPrecacheSound);
+	ENGINE_STUB(pfnSetModel);
+	ENGINE_STUB(pfnModelIndex);
+	ENGINE_STUB(pfnModelFrames);
+	ENGINE_STUB(pfnSetSize);
+	ENGINE_STUB(pfnChangeLevel);
+	ENGINE_STUB(pfnGetSpawnParms);
+	ENGINE_STUB(pfnSaveSpawnParms);
+	ENGINE_STUB(pfnVecToYaw);
+	ENGINE_STUB(pfnVecToAngles);
+	ENGINE_STUB(pfnMoveToOrigin);
+	ENGINE_STUB(pfnChangeYaw);
+	ENGINE_STUB(pfnChangePitch);
+	ENGINE_STUB(pfnFindEntityByString);
+	ENGINE_STUB(pfnGetEntityIllum);
+	ENGINE_STUB(pfnFindEntityInSphere);
+	ENGINE_STUB(pfnFindClientInPVS);
+	ENGINE_STUB(pfnEntitiesInPVS);
+	ENGINE_STUB(pfnMakeVectors);
+	ENGINE_STUB(pfnAngleVectors);
+	ENGINE_STUB(pfnCreateEntity);
+	ENGINE_STUB(pfnRemoveEntity);
+	ENGINE_STUB(pfnCreateNamedEntity);
+	ENGINE_STUB(pfnMakeStatic);
+	ENGINE_STUB(pfnEntIsOnFloor);
+	ENGINE_STUB(pfnDropToFloor);
+	ENGINE_STUB(pfnWalkMove);
+	ENGINE_STUB(pfnSetOrigin);
+	ENGINE_STUB(pfnEmitSound);
+	ENGINE_STUB(pfnEmitAmbientSound);
+	ENGINE_STUB(pfnTraceLine);
+	ENGINE_STUB(pfnTraceToss);
+	ENGINE_STUB(pfnTraceMonsterHull);
+	ENGINE_STUB(pfnTraceHull);
+	ENGINE_STUB(pfnTraceModel);
+	ENGINE_STUB(pfnTraceTexture);
+	ENGINE_STUB(pfnTraceSphere);
+	ENGINE_STUB(pfnGetAimVector);
+	ENGINE_STUB(pfnServerCommand);
+	ENGINE_STUB(pfnServerExecute);
+	ENGINE_STUB(pfnClientCommand);
+	ENGINE_STUB(pfnParticleEffect);
+	ENGINE_STUB(pfnLightStyle);
+	ENGINE_STUB(pfnDecalIndex);
+	ENGINE_STUB(pfnPointContents);
+	ENGINE_STUB(pfnMessageBegin);
+	ENGINE_STUB(pfnMessageEnd);
+	ENGINE_STUB(pfnWriteByte);
+	ENGINE_STUB(pfnWriteChar);
+	ENGINE_STUB(pfnWriteShort);
+	ENGINE_STUB(pfnWriteLong);
+	ENGINE_STUB(pfnWriteAngle);
+	ENGINE_STUB(pfnWriteCoord);
+	ENGINE_STUB(pfnWriteString);
+	ENGINE_STUB(pfnWriteEntity);
+	ENGINE_STUB(pfnCVarRegister);
+	ENGINE_STUB(pfnCVarGetFloat);
+	ENGINE_STUB(pfnCVarGetString);
+	ENGINE_STUB(pfnCVarSetFloat);
+	ENGINE_STUB(pfnCVarSetString);
+	ENGINE_STUB(pfnAlertMessage);
+	ENGINE_STUB(pfnEngineFprintf);
+	ENGINE_STUB(pfnPvAllocEntPrivateData);
+	ENGINE_STUB(pfnPvEntPrivateData);
+	ENGINE_STUB(pfnFreeEntPrivateData);
+	ENGINE_STUB(pfnSzFromIndex);
+	ENGINE_STUB(pfnAllocString);
+	ENGINE_STUB(pfnGetVarsOfEnt);
+	ENGINE_STUB(pfnPEntityOfEntOffset);
+	ENGINE_STUB(pfnEntOffsetOfPEntity);
+	ENGINE_STUB(pfnIndexOfEdict);
+	ENGINE_STUB(pfnPEntityOfEntIndex);
+	ENGINE_STUB(pfnFindEntityByVars);
+	ENGINE_STUB(pfnGetModelPtr);
+	ENGINE_STUB(pfnRegUserMsg);
+	ENGINE_STUB(pfnAnimationAutomove);
+	ENGINE_STUB(pfnGetBonePosition);
+	ENGINE_STUB(pfnFunctionFromName);
+	ENGINE_STUB(pfnNameForFunction);
+	ENGINE_STUB(pfnClientPrintf);
+	ENGINE_STUB(pfnServerPrint);
+	ENGINE_STUB(pfnCmd_Args);
+	ENGINE_STUB(pfnCmd_Argv);
+	ENGINE_STUB(pfnCmd_Argc);
+	ENGINE_STUB(pfnGetAttachment);
+	ENGINE_STUB(pfnCRC32_Init);
+	ENGINE_STUB(pfnCRC32_ProcessBuffer);
+	ENGINE_STUB(pfnCRC32_ProcessByte);
+	ENGINE_STUB(pfnCRC32_Final);
+	ENGINE_STUB(pfnRandomLong);
+	ENGINE_STUB(pfnRandomFloat);
+	ENGINE_STUB(pfnSetView);
+	ENGINE_STUB(pfnTime);
+	ENGINE_STUB(pfnCrosshairAngle);
+	ENGINE_STUB(pfnLoadFileForMe);
+	ENGINE_STUB(pfnFreeFile);
+	ENGINE_STUB(pfnEndSection);
+	ENGINE_STUB(pfnCompareFileTime);
+	ENGINE_STUB(pfnGetGameDir);
+	ENGINE_STUB(pfnCvar_RegisterVariable);
+	ENGINE_STUB(pfnFadeClientVolume);
+	ENGINE_STUB(pfnSetClientMaxspeed);
+	ENGINE_STUB(pfnCreateFakeClient);
+	ENGINE_STUB(pfnRunPlayerMove);
+	ENGINE_STUB(pfnNumberOfEntities);
+	ENGINE_STUB(pfnGetInfoKeyBuffer);
+	ENGINE_STUB(pfnInfoKeyValue);
+	ENGINE_STUB(pfnSetKeyValue);
+	ENGINE_STUB(pfnSetClientKeyValue);
+	ENGINE_STUB(pfnIsMapValid);
+	ENGINE_STUB(pfnStaticDecal);
+	ENGINE_STUB(pfnPrecacheGeneric);
+	ENGINE_STUB(pfnGetPlayerUserId);
+	ENGINE_STUB(pfnBuildSoundMsg);
+	ENGINE_STUB(pfnIsDedicatedServer);
+	ENGINE_STUB(pfnCVarGetPointer);
+	ENGINE_STUB(pfnGetPlayerWONId);
+	ENGINE_STUB(pfnInfo_RemoveKey);
+	ENGINE_STUB(pfnGetPhysicsKeyValue);
+	ENGINE_STUB(pfnSetPhysicsKeyValue);
+	ENGINE_STUB(pfnGetPhysicsInfoString);
+	ENGINE_STUB(pfnPrecacheEvent);
+	ENGINE_STUB(pfnPlaybackEvent);
+	ENGINE_STUB(pfnSetFatPVS);
+	ENGINE_STUB(pfnSetFatPAS);
+	ENGINE_STUB(pfnCheckVisibility);
+	ENGINE_STUB(pfnDeltaSetField);
+	ENGINE_STUB(pfnDeltaUnsetField);
+	ENGINE_STUB(pfnDeltaAddEncoder);
+	ENGINE_STUB(pfnGetCurrentPlayer);
+	ENGINE_STUB(pfnCanSkipPlayer);
+	ENGINE_STUB(pfnDeltaFindField);
+	ENGINE_STUB(pfnDeltaSetFieldByIndex);
+	ENGINE_STUB(pfnDeltaUnsetFieldByIndex);
+	ENGINE_STUB(pfnSetGroupMask);
+	ENGINE_STUB(pfnCreateInstancedBaseline);
+	ENGINE_STUB(pfnCvar_DirectSet);
+	ENGINE_STUB(pfnForceUnmodified);
+	ENGINE_STUB(pfnGetPlayerStats);
+	ENGINE_STUB(pfnAddServerCommand);
+	ENGINE_STUB(pfnVoice_GetClientListening);
+	ENGINE_STUB(pfnVoice_SetClientListening);
+	ENGINE_STUB(pfnGetPlayerAuthId);
+	ENGINE_STUB(pfnSequenceGet);
+	ENGINE_STUB(pfnSequencePickSentence);
+	ENGINE_STUB(pfnGetFileSize);
+	ENGINE_STUB(pfnGetApproxWavePlayLen);
+	ENGINE_STUB(pfnIsCareerMatch);
+	ENGINE_STUB(pfnGetLocalizedStringLength);
+	ENGINE_STUB(pfnRegisterTutorMessageShown);
+	ENGINE_STUB(pfnGetTimesTutorMessageShown);
+	ENGINE_STUB(pfnProcessTutorMessageDecayBuffer);
+	ENGINE_STUB(pfnConstructTutorMessageDecayBuffer);
+	ENGINE_STUB(pfnResetTutorMessageDecayData);
+	ENGINE_STUB(pfnQueryClientCvarValue);
+	ENGINE_STUB(pfnQueryClientCvarValue2);
+	ENGINE_STUB(pfnEngCheckParm);
+}
+
+
+//
+// Player for each dllapi/newapi function type: reads arguments from the
+// recording and calls function from metamod's table.
+//
+typedef void (*api_player_t)(replay_reader &reader, const void *table);
+
+template<typename fn_t, unsigned int OFFSET> class api_player;
+
+template<typename R, unsigned int OFFSET>
+class api_player<R (*)(void), OFFSET> {
+public:
+	static void play(replay_reader &, const void *table) {
+		typedef R (*fn_t)(void);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		if(pfn)
+			(*pfn)();
+	};
+};
+
+template<typename R, typename A1, unsigned int OFFSET>
+class api_player<R (*)(A1), OFFSET> {
+public:
+	static void play(replay_reader &reader, const void *table) {
+		typedef R (*fn_t)(A1);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		A1 a1;
+		reader.arg(a1);
+		if(pfn)
+			(*pfn)(a1);
+	};
+};
+
+template<typename R, typename A1, typename A2, unsigned int OFFSET>
+class api_player<R (*)(A1, A2), OFFSET> {
+public:
+	static void play(replay_reader &reader, const void *table) {
+		typedef R (*fn_t)(A1, A2);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		A1 a1; A2 a2;
+		reader.arg(a1); reader.arg(a2);
+		if(pfn)
+			(*pfn)(a1, a2);
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, unsigned int OFFSET>
+class api_player<R (*)(A1, A2, A3), OFFSET> {
+public:
+	static void play(replay_reader &reader, const void *table) {
+		typedef R (*fn_t)(A1, A2, A3);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		A1 a1; A2 a2; A3 a3;
+		reader.arg(a1); reader.arg(a2); reader.arg(a3);
+		if(pfn)
+			(*pfn)(a1, a2, a3);
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, unsigned int OFFSET>
+class api_player<R (*)(A1, A2, A3, A4), OFFSET> {
+public:
+	static void play(replay_reader &reader, const void *table) {
+		typedef R (*fn_t)(A1, A2, A3, A4);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		A1 a1; A2 a2; A3 a3; A4 a4;
+		reader.arg(a1); reader.arg(a2); reader.arg(a3); reader.arg(a4);
+		if(pfn)
+			(*pfn)(a1, a2, a3, a4);
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, unsigned int OFFSET>
+class api_player<R (*)(A1, A2, A3, A4, A5), OFFSET> {
+public:
+	static void play(replay_reader &reader, const void *table) {
+		typedef R (*fn_t)(A1, A2, A3, A4, A5);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		A1 a1; A2 a2; A3 a3; A4 a4; A5 a5;
+		reader.arg(a1); reader.arg(a2); reader.arg(a3); reader.arg(a4); reader.arg(a5);
+		if(pfn)
+			(*pfn)(a1, a2, a3, a4, a5);
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, unsigned int OFFSET>
+class api_player<R (*)(A1, A2, A3, A4, A5, A6), OFFSET> {
+public:
+	static void play(replay_reader &reader, const void *table) {
+		typedef R (*fn_t)(A1, A2, A3, A4, A5, A6);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6;
+		reader.arg(a1); reader.arg(a2); reader.arg(a3); reader.arg(a4); reader.arg(a5); reader.arg(a6);
+		if(pfn)
+			(*pfn)(a1, a2, a3, a4, a5, a6);
+	};
+};
+
+template<typename R, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6, typename A7, unsigned int OFFSET>
+class api_player<R (*)(A1, A2, A3, A4, A5, A6, A7), OFFSET> {
+public:
+	static void play(replay_reader &reader, const void *table) {
+		typedef R (*fn_t)(A1, A2, A3, A4, A5, A6, A7);
+		fn_t pfn = *(const fn_t *)((const char *)table + OFFSET);
+		A1 a1; A2 a2; A3 a3; A4 a4; A5 a5; A6 a6; A7 a7;
+		reader.arg(a1); reader.arg(a2); reader.arg(a3); reader.arg(a4); reader.arg(a5); reader.arg(a6); reader.arg(a7);
+		if(pfn)
+			(*pfn)(a1, a2, a3, a4, a5, a6, a7);
+	};
+};
+
+#define DLLAPI_PLAYER(name) &api_player<__typeof__(dllapi_table.name), offsetof(DLL_FUNCTIONS, name)>::play
+#define NEWAPI_PLAYER(name) &api_player<__typeof__(newapi_table.name), offsetof(NEW_DLL_FUNCTIONS, name)>::play
+
+static const api_player_t dllapi_players[NUM_DLLAPI_FUNCS] = {
+	DLLAPI_PLAYER(pfnGameInit),
+	DLLAPI_PLAYER(pfnSpawn),
+	DLLAPI_PLAYER(pfnThink),
+	DLLAPI_PLAYER(pfnUse),
+	DLLAPI_PLAYER(pfnTouch),
+	DLLAPI_PLAYER(pfnBlocked),
+	DLLAPI_PLAYER(pfnKeyValue),
+	DLLAPI_PLAYER(pfnSave),
+	DLLAPI_PLAYER(pfnRestore),
+	DLLAPI_PLAYER(pfnSetAbsBox),
+	DLLAPI_PLAYER(pfnSaveWriteFields),
+	DLLAPI_PLAYER(pfnSaveReadFields),
+	DLLAPI_PLAYER(pfnSaveGlobalState),
+	DLLAPI_PLAYER(pfnRestoreGlobalState),
+	DLLAPI_PLAYER(pfnResetGlobalState),
+	DLLAPI_PLAYER(pfnClientConnect),
+	DLLAPI_PLAYER(pfnClientDisconnect),
+	DLLAPI_PLAYER(pfnClientKill),
+	DLLAPI_PLAYER(pfnClientPutInServer),
+	DLLAPI_PLAYER(pfnClientCommand),
+	DLLAPI_PLAYER(pfnClientUserInfoChanged),
+	DLLAPI_PLAYER(pfnServerActivate),
+	DLLAPI_PLAYER(pfnServerDeactivate),
+	DLLAPI_PLAYER(pfnPlayerPreThink),
+	DLLAPI_PLAYER(pfnPlayerPostThink),
+	DLLAPI_PLAYER(pfnStartFrame),
+	DLLAPI_PLAYER(pfnParmsNewLevel),
+	DLLAPI_PLAYER(pfnParmsChangeLevel),
+	DLLAPI_PLAYER(pfnGetGameDescription),
+	DLLAPI_PLAYER(pfnPlayerCustomization),
+	DLLAPI_PLAYER(pfnSpectatorConnect),
+	DLLAPI_PLAYER(pfnSpectatorDisconnect),
+	DLLAPI_PLAYER(pfnSpectatorThink),
+	DLLAPI_PLAYER(pfnSys_Error),
+	DLLAPI_PLAYER(pfnPM_Move),
+	DLLAPI_PLAYER(pfnPM_Init),
+	DLLAPI_PLAYER(pfnPM_FindTextureType),
+	DLLAPI_PLAYER(pfnSetupVisibility),
+	DLLAPI_PLAYER(pfnUpdateClientData),
+	DLLAPI_PLAYER(pfnAddToFullPack),
+	DLLAPI_PLAYER(pfnCreateBaseline),
+	DLLAPI_PLAYER(pfnRegisterEncoders),
+	DLLAPI_PLAYER(pfnGetWeaponData),
+	DLLAPI_PLAYER(pfnCmdStart),
+	DLLAPI_PLAYER(pfnCmdEnd),
+	DLLAPI_PLAYER(pfnConnectionlessPacket),
+	DLLAPI_PLAYER(pfnGetHullBounds),
+	DLLAPI_PLAYER(pfnCreateInstancedBaselines),
+	DLLAPI_PLAYER(pfnInconsistentFile),
+	DLLAPI_PLAYER(pfnAllowLagCompensation),
+};
+
+static const api_player_t newapi_players[NUM_NEWAPI_FUNCS] = {
+	NEWAPI_PLAYER(pfnOnFreeEntPrivateData),
+	NEWAPI_PLAYER(pfnGameShutdown),
+	NEWAPI_PLAYER(pfnShouldCollide),
+	NEWAPI_PLAYER(pfnCvarValue),
+	NEWAPI_PLAYER(pfnCvarValue2),
+};
+
+//
+// Stand-in engine functions that keep real state.  Each first syncs with
+// the recording, so that calls engine made to gamedll during the
+// original call are replayed.
+//
+static cvar_t *cvar_list = NULL;
+
+static cvar_t *find_cvar(const char *name) {
+	cvar_t *pCvar;
+
+	for(pCvar = cvar_list; pCvar; pCvar = pCvar->next)
+		if(!strcmp(pCvar->name, name))
+			return(pCvar);
+	return(NULL);
+}
+
+static void set_cvar(cvar_t *pCvar, const char *value) {
+	pCvar->string = strdup(value);
+	pCvar->value = atof(value);
+}
+
+static void n_SetModel(edict_t *e, const char *m) {
+	engine_call c(ENGINE_FUNC(pfnSetModel));
+	if(e)
+		e->v.model = alloc_string(m);
+}
+
+static void n_SetSize(edict_t *e, const float *rgflMin, const float *rgflMax) {
+	engine_call c(ENGINE_FUNC(pfnSetSize));
+	if(e && rgflMin && rgflMax) {
+		e->v.mins = Vector(rgflMin[0], rgflMin[1], rgflMin[2]);
+		e->v.maxs = Vector(rgflMax[0], rgflMax[1], rgflMax[2]);
+		e->v.size = e->v.maxs - e->v.mins;
+	}
+}
+
+static void n_SetOrigin(edict_t *e, const float *rgflOrigin) {
+	engine_call c(ENGINE_FUNC(pfnSetOrigin));
+	if(e && rgflOrigin) {
+		e->v.origin = Vector(rgflOrigin[0], rgflOrigin[1], rgflOrigin[2]);
+		e->v.absmin = e->v.origin + e->v.mins;
+		e->v.absmax = e->v.origin + e->v.maxs;
+	}
+}
+
+// Use the same edict as original server, so that recorded indexes stay
+// right.
+static edict_t *n_CreateEntity(void) {
+	engine_call c(ENGINE_FUNC(pfnCreateEntity));
+	edict_t *pEdict = NULL;
+
+	if(c.matched)
+		c.reader.ret(pEdict);
+	if(pEdict)
+		init_edict(pEdict);
+	else
+		pEdict = alloc_edict();
+	return(pEdict);
+}
+
+static edict_t *n_CreateNamedEntity(int className) {
+	engine_call c(ENGINE_FUNC(pfnCreateNamedEntity));
+	edict_t *pEdict = NULL;
+
+	if(c.matched)
+		c.reader.ret(pEdict);
+	if(pEdict)
+		init_edict(pEdict);
+	else
+		pEdict = alloc_edict();
+	spawn_entity_class(pEdict, string_pool + className);
+	return(pEdict);
+}
+
+static void n_RemoveEntity(edict_t *e) {
+	engine_call c(ENGINE_FUNC(pfnRemoveEntity));
+	if(!e)
+		return;
+	free_private_data(e);
+	memset(&e->v, 0, sizeof(e->v));
+	e->v.pContainingEntity = e;
+	e->free = 1;
+}
+
+// angle indexes, as in engine's mathlib
+#define PITCH 0
+#define YAW 1
+#define ROLL 2
+
+static void n_AngleVectors(const float *rgflVector, float *forward, float *right, float *up) {
+	engine_call c(ENGINE_FUNC(pfnAngleVectors));
+	float angle, sr, sp, sy, cr, cp, cy;
+
+	angle = rgflVector[YAW] * (M_PI * 2 / 360);
+	sy = sin(angle);
+	cy = cos(angle);
+	angle = rgflVector[PITCH] * (M_PI * 2 / 360);
+	sp = sin(angle);
+	cp = cos(angle);
+	angle = rgflVector[ROLL] * (M_PI * 2 / 360);
+	sr = sin(angle);
+	cr = cos(angle);
+
+	if(forward) {
+		forward[0] = cp * cy;
+		forward[1] = cp * sy;
+		forward[2] = -sp;
+	}
+	if(right) {
+		right[0] = -1 * sr * sp * cy + -1 * cr * -sy;
+		right[1] = -1 * sr * sp * sy + -1 * cr * cy;
+		right[2] = -1 * sr * cp;
+	}
+	if(up) {
+		up[0] = cr * sp * cy + -sr * -sy;
+		up[1] = cr * sp * sy + -sr * cy;
+		up[2] = cr * cp;
+	}
+}
+
+static void n_MakeVectors(const float *rgflVector) {
+	n_AngleVectors(rgflVector, globals.v_forward, globals.v_right, globals.v_up);
+}
+
+static void *n_PvAllocEntPrivateData(edict_t *pEdict, int32 cb) {
+	engine_call c(ENGINE_FUNC(pfnPvAllocEntPrivateData));
+	if(!pEdict)
+		return(NULL);
+	free_private_data(pEdict);
+	pEdict->pvPrivateData = calloc(1, cb);
+	return(pEdict->pvPrivateData);
+}
+
+static void *n_PvEntPrivateData(edict_t *pEdict) {
+	engine_call c(ENGINE_FUNC(pfnPvEntPrivateData));
+	return(pEdict ? pEdict->pvPrivateData : NULL);
+}
+
+static void n_FreeEntPrivateData(edict_t *pEdict) {
+	engine_call c(ENGINE_FUNC(pfnFreeEntPrivateData));
+	if(pEdict)
+		free_private_data(pEdict);
+}
+
+static const char *n_SzFromIndex(int iString) {
+	engine_call c(ENGINE_FUNC(pfnSzFromIndex));
+	return(string_pool + iString);
+}
+
+static int n_AllocString(const char *szValue) {
+	engine_call c(ENGINE_FUNC(pfnAllocString));
+	return(alloc_string(szValue));
+}
+
+static struct entvars_s *n_GetVarsOfEnt(edict_t *pEdict) {
+	engine_call c(ENGINE_FUNC(pfnGetVarsOfEnt));
+	return(pEdict ? &pEdict->v : NULL);
+}
+
+static edict_t *n_PEntityOfEntOffset(int iEntOffset) {
+	engine_call c(ENGINE_FUNC(pfnPEntityOfEntOffset));
+	return((edict_t *)((char *)edicts + iEntOffset));
+}
+
+static int n_EntOffsetOfPEntity(const edict_t *pEdict) {
+	engine_call c(ENGINE_FUNC(pfnEntOffsetOfPEntity));
+	return((const char *)pEdict - (const char *)edicts);
+}
+
+static int n_IndexOfEdict(const edict_t *pEdict) {
+	engine_call c(ENGINE_FUNC(pfnIndexOfEdict));
+	return(pEdict ? pEdict - edicts : 0);
+}
+
+static edict_t *n_PEntityOfEntIndex(int iEntIndex) {
+	engine_call c(ENGINE_FUNC(pfnPEntityOfEntIndex));
+	edict_t *pEdict = edict_of(iEntIndex);
+
+	// engine gives free edicts and empty non-player edicts as NULL
+	if(!pEdict || pEdict->free || (iEntIndex > globals.maxClients && !pEdict->pvPrivateData))
+		return(NULL);
+	return(pEdict);
+}
+
+static edict_t *n_FindEntityByVars(struct entvars_s *pvars) {
+	engine_call c(ENGINE_FUNC(pfnFindEntityByVars));
+	return(pvars ? pvars->pContainingEntity : NULL);
+}
+
+static int n_NumberOfEntities(void) {
+	engine_call c(ENGINE_FUNC(pfnNumberOfEntities));
+	int i, n;
+
+	for(i = 0, n = 0; i < max_entities; i++)
+		if(!edicts[i].free)
+			n++;
+	return(n);
+}
+
+static void n_CVarRegister(cvar_t *pCvar) {
+	engine_call c(ENGINE_FUNC(pfnCVarRegister));
+	if(!pCvar || find_cvar(pCvar->name))
+		return;
+	set_cvar(pCvar, pCvar->string);
+	pCvar->next = cvar_list;
+	cvar_list = pCvar;
+}
+
+static void n_Cvar_RegisterVariable(cvar_t *variable) {
+	engine_call c(ENGINE_FUNC(pfnCvar_RegisterVariable));
+	if(!variable || find_cvar(variable->name))
+		return;
+	set_cvar(variable, variable->string);
+	variable->next = cvar_list;
+	cvar_list = variable;
+}
+
+static cvar_t *n_CVarGetPointer(const char *szVarName) {
+	engine_call c(ENGINE_FUNC(pfnCVarGetPointer));
+	return(find_cvar(szVarName));
+}
+
+// Values set in server.cfg etc aren't known here; prefer recorded ones.
+static float n_CVarGetFloat(const char *szVarName) {
+	engine_call c(ENGINE_FUNC(pfnCVarGetFloat));
+	cvar_t *pCvar;
+	float value = 0;
+
+	if(c.matched)
+		c.reader.ret(value);
+	else if((pCvar = find_cvar(szVarName)))
+		value = pCvar->value;
+	return(value);
+}
+
+static const char *n_CVarGetString(const char *szVarName) {
+	engine_call c(ENGINE_FUNC(pfnCVarGetString));
+	cvar_t *pCvar;
+	const char *value = "";
+
+	if(c.matched)
+		c.reader.ret(value);
+	else if((pCvar = find_cvar(szVarName)))
+		value = pCvar->string;
+	return(value ? value : "");
+}
+
+static void n_CVarSetFloat(const char *szVarName, float flValue) {
+	engine_call c(ENGINE_FUNC(pfnCVarSetFloat));
+	cvar_t *pCvar = find_cvar(szVarName);
+	char buf[64];
+
+	if(pCvar) {
+		snprintf(buf, sizeof(buf), "%g", flValue);
+		set_cvar(pCvar, buf);
+	}
+}
+
+static void n_CVarSetString(const char *szVarName, const char *szValue) {
+	engine_call c(ENGINE_FUNC(pfnCVarSetString));
+	cvar_t *pCvar = find_cvar(szVarName);
+
+	if(pCvar && szValue)
+		set_cvar(pCvar, szValue);
+}
+
+static void n_Cvar_DirectSet(struct cvar_s *var, char *value) {
+	engine_call c(ENGINE_FUNC(pfnCvar_DirectSet));
+	if(var && value)
+		set_cvar(var, value);
+}
+
+static void n_GetGameDir(char *szGetGameDir) {
+	engine_call c(ENGINE_FUNC(pfnGetGameDir));
+	strcpy(szGetGameDir, gamedir);
+}
+
+static int n_IsDedicatedServer(void) {
+	engine_call c(ENGINE_FUNC(pfnIsDedicatedServer));
+	return(1);
+}
+
+static void n_ServerPrint(const char *szMsg) {
+	engine_call c(ENGINE_FUNC(pfnServerPrint));
+	if(verbose)
+		fputs(szMsg, stdout);
+}
+
+static void n_AlertMessage(ALERT_TYPE atype, char *szFmt, ...) {
+	engine_call c(ENGINE_FUNC(pfnAlertMessage));
+	va_list ap;
+
+	if(!verbose)
+		return;
+	va_start(ap, szFmt);
+	vprintf(szFmt, ap);
+	va_end(ap);
+}
+
+static byte *n_LoadFileForMe(char *filename, int *pLength) {
+	engine_call c(ENGINE_FUNC(pfnLoadFileForMe));
+	char path[1024];
+	FILE *fp;
+	long len;
+	byte *buf;
+
+	snprintf(path, sizeof(path), "%s/%s", gamedir, filename);
+	if(!(fp = fopen(path, "rb")))
+		return(NULL);
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	buf = (byte *)malloc(len + 1);
+	if(fread(buf, 1, len, fp) != (size_t)len) {
+		fclose(fp);
+		free(buf);
+		return(NULL);
+	}
+	buf[len] = '\0';
+	fclose(fp);
+	if(pLength)
+		*pLength = len;
+	return(buf);
+}
+
+static void n_FreeFile(void *buffer) {
+	engine_call c(ENGINE_FUNC(pfnFreeFile));
+	free(buffer);
+}
+
+static char *n_GetInfoKeyBuffer(edict_t *e) {
+	engine_call c(ENGINE_FUNC(pfnGetInfoKeyBuffer));
+	static char empty[1] = "";
+	char *buf = NULL;
+
+	if(c.matched)
+		c.reader.ret(buf);
+	return(buf ? buf : empty);
+}
+
+static char *n_InfoKeyValue(char *infobuffer, char *key) {
+	engine_call c(ENGINE_FUNC(pfnInfoKeyValue));
+	static char empty[1] = "";
+	char *value = NULL;
+
+	if(c.matched)
+		c.reader.ret(value);
+	return(value ? value : empty);
+}
+
+static float n_Time(void) {
+	engine_call c(ENGINE_FUNC(pfnTime));
+	float value = globals.time;
+
+	if(c.matched)
+		c.reader.ret(value);
+	return(value);
+}
+
+static void fill_engine_natives(enginefuncs_t *standin) {
+	standin->pfnSetModel = n_SetModel;
+	standin->pfnSetSize = n_SetSize;
+	standin->pfnSetOrigin = n_SetOrigin;
+	standin->pfnCreateEntity = n_CreateEntity;
+	standin->pfnCreateNamedEntity = n_CreateNamedEntity;
+	standin->pfnRemoveEntity = n_RemoveEntity;
+	standin->pfnMakeVectors = n_MakeVectors;
+	standin->pfnAngleVectors = n_AngleVectors;
+	standin->pfnPvAllocEntPrivateData = n_PvAllocEntPrivateData;
+	standin->pfnPvEntPrivateData = n_PvEntPrivateData;
+	standin->pfnFreeEntPrivateData = n_FreeEntPrivateData;
+	standin->pfnSzFromIndex = n_SzFromIndex;
+	standin->pfnAllocString = n_AllocString;
+	standin->pfnGetVarsOfEnt = n_GetVarsOfEnt;
+	standin->pfnPEntityOfEntOffset = n_PEntityOfEntOffset;
+	standin->pfnEntOffsetOfPEntity = n_EntOffsetOfPEntity;
+	standin->pfnIndexOfEdict = n_IndexOfEdict;
+	standin->pfnPEntityOfEntIndex = n_PEntityOfEntIndex;
+	standin->pfnFindEntityByVars = n_FindEntityByVars;
+	standin->pfnNumberOfEntities = n_NumberOfEntities;
+	standin->pfnCVarRegister = n_CVarRegister;
+	standin->pfnCvar_RegisterVariable = n_Cvar_RegisterVariable;
+	standin->pfnCVarGetPointer = n_CVarGetPointer;
+	standin->pfnCVarGetFloat = n_CVarGetFloat;
+	standin->pfnCVarGetString = n_CVarGetString;
+	standin->pfnCVarSetFloat = n_CVarSetFloat;
+	standin->pfnCVarSetString = n_CVarSetString;
+	standin->pfnCvar_DirectSet = n_Cvar_DirectSet;
+	standin->pfnGetGameDir = n_GetGameDir;
+	standin->pfnIsDedicatedServer = n_IsDedicatedServer;
+	standin->pfnServerPrint = n_ServerPrint;
+	standin->pfnAlertMessage = n_AlertMessage;
+	standin->pfnLoadFileForMe = n_LoadFileForMe;
+	standin->pfnFreeFile = n_FreeFile;
+	standin->pfnGetInfoKeyBuffer = n_GetInfoKeyBuffer;
+	standin->pfnInfoKeyValue = n_InfoKeyValue;
+	standin->pfnTime = n_Time;
+}
+
+
+//
+// Replaying gamedll calls.
+//
+
+// Calls that need engine state we don't have.
+static int is_skipped_call(unsigned int func) {
+	return(func == DLLAPI_FUNC(pfnPM_Move)
+			|| func == DLLAPI_FUNC(pfnPM_Init)
+			|| func == DLLAPI_FUNC(pfnSave)
+			|| func == DLLAPI_FUNC(pfnRestore)
+			|| func == DLLAPI_FUNC(pfnSaveWriteFields)
+			|| func == DLLAPI_FUNC(pfnSaveReadFields)
+			|| func == DLLAPI_FUNC(pfnSaveGlobalState)
+			|| func == DLLAPI_FUNC(pfnRestoreGlobalState)
+			|| func == DLLAPI_FUNC(pfnPlayerCustomization));
+}
+
+// Replay recorded dllapi/newapi call, and everything engine did in it.
+static void replay_call(const api_record_header_t *hdr) {
+	unsigned int func = hdr->func;
+	unsigned int depth = hdr->depth;
+	replay_reader reader(hdr);
+	replay_reader peek;
+	edict_t *pEdict = NULL;
+	KeyValueData *pkvd;
+	int i;
+
+	globals.time = reader.get_float();
+	globals.frametime = reader.get_float();
+	rec_advance(hdr);
+
+	if(is_skipped_call(func) || func < DLLAPI_BASE || func >= NUM_FUNCS) {
+		stats.skipped_calls++;
+		finish_call(func, depth);
+		return;
+	}
+
+	// entities engine would have created before the call
+	peek = reader;
+	if(func == DLLAPI_FUNC(pfnKeyValue)) {
+		peek.arg(pEdict);
+		peek.arg(pkvd);
+		if(pkvd)
+			ensure_entity(pEdict, pkvd->szClassName);
+	}
+	else if(func == DLLAPI_FUNC(pfnSpawn)) {
+		peek.arg(pEdict);
+		if(pEdict && pEdict->v.classname)
+			ensure_entity(pEdict, string_pool + pEdict->v.classname);
+	}
+	else if(func == NEWAPI_FUNC(pfnOnFreeEntPrivateData))
+		peek.arg(pEdict);
+
+	if(func < NEWAPI_BASE)
+		(*dllapi_players[func - DLLAPI_BASE])(reader, &dllapi_table);
+	else
+		(*newapi_players[func - NEWAPI_BASE])(reader, &newapi_table);
+	stats.calls++;
+
+	// what engine does after the call
+	if(func == NEWAPI_FUNC(pfnOnFreeEntPrivateData) && pEdict)
+		free_private_data(pEdict);
+	else if(func == DLLAPI_FUNC(pfnServerDeactivate)) {
+		for(i = 0; i < max_entities; i++)
+			edict_stale[i] = 1;
+	}
+
+	finish_call(func, depth);
+}
+
+static double now_usec(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0);
+}
+
+static int compare_double(const void *a, const void *b) {
+	double da = *(const double *)a, db = *(const double *)b;
+
+	return((da > db) - (da < db));
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-v] [-g <gamedir>] [-m <metamod.so>] [-o <frames.txt>] <recording>\n", prog);
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	typedef void (*GIVE_ENGINE_FUNCTIONS_FN)(enginefuncs_t *, globalvars_t *);
+	typedef int (*APIFUNCTION2)(DLL_FUNCTIONS *, int *);
+	typedef int (*NEW_DLL_FUNCTIONS_FN)(NEW_DLL_FUNCTIONS *, int *);
+	static enginefuncs_t standin;
+	const char *metamod_path = NULL, *frames_path = NULL;
+	const api_record_file_header_t *fhdr;
+	const api_record_header_t *hdr;
+	GIVE_ENGINE_FUNCTIONS_FN pfn_give_engfuncs;
+	APIFUNCTION2 pfn_getapi;
+	NEW_DLL_FUNCTIONS_FN pfn_getnewapi;
+	char path[1024];
+	struct stat st;
+	void *map;
+	int fd, opt, version, i;
+	double *frames = NULL, frame_start = 0, start, total;
+	unsigned int num_frames = 0, max_frames = 0;
+	FILE *fp;
+
+	while((opt = getopt(argc, argv, "vg:m:o:")) != -1) {
+		switch(opt) {
+			case 'v': verbose = 1; break;
+			case 'g': gamedir = optarg; break;
+			case 'm': metamod_path = optarg; break;
+			case 'o': frames_path = optarg; break;
+			default: usage(argv[0]);
+		}
+	}
+	if(optind != argc - 1)
+		usage(argv[0]);
+
+	// map recording
+	if((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		return(1);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) {
+		perror("mmap");
+		return(1);
+	}
+	fhdr = (const api_record_file_header_t *)map;
+	if(st.st_size < (off_t)sizeof(*fhdr) || strcmp(fhdr->magic, REC_MAGIC) || fhdr->version != REC_VERSION) {
+		fprintf(stderr, "%s: not a metamod call recording (version %d)\n", argv[optind], REC_VERSION);
+		return(1);
+	}
+	if(fhdr->ptr_size != sizeof(void*) || fhdr->num_funcs[0] != NUM_ENGINE_FUNCS
+			|| fhdr->num_funcs[1] != NUM_DLLAPI_FUNCS || fhdr->num_funcs[2] != NUM_NEWAPI_FUNCS) {
+		fprintf(stderr, "%s: recorded with different api tables or architecture\n", argv[optind]);
+		return(1);
+	}
+	rec_pos = (const unsigned char *)map + fhdr->header_size;
+	rec_end = (const unsigned char *)map + st.st_size;
+	if(!gamedir)
+		gamedir = fhdr->gamedir;
+	if(!metamod_path) {
+		snprintf(path, sizeof(path), "%s/addons/metamod/dlls/metamod.so", gamedir);
+		metamod_path = path;
+	}
+
+	// engine state
+	max_entities = fhdr->max_entities;
+	edicts = (edict_t *)calloc(max_entities, sizeof(edict_t));
+	edict_stale = (unsigned char *)calloc(max_entities, 1);
+	string_pool = (char *)calloc(1, MAX_STRING_POOL);
+	arena = (unsigned char *)malloc(MAX_ARENA);
+	if(!edicts || !edict_stale || !string_pool || !arena) {
+		fprintf(stderr, "mmreplay: out of memory\n");
+		return(1);
+	}
+	string_pool_used = 1;	// 0 is ""
+	for(i = 0; i < max_entities; i++) {
+		edicts[i].v.pContainingEntity = &edicts[i];
+		edicts[i].free = (i > fhdr->max_clients);
+	}
+	memset(&globals, 0, sizeof(globals));
+	globals.maxClients = fhdr->max_clients;
+	globals.maxEntities = max_entities;
+	globals.pStringBase = string_pool;
+
+	fill_engine_stubs(&standin);
+	fill_engine_natives(&standin);
+
+	// load metamod, which loads gamedll and plugins
+	if(!(metamod_handle = dlopen(metamod_path, RTLD_NOW))) {
+		fprintf(stderr, "mmreplay: %s\n", dlerror());
+		return(1);
+	}
+	pfn_give_engfuncs = (GIVE_ENGINE_FUNCTIONS_FN)dlsym(metamod_handle, "GiveFnptrsToDll");
+	pfn_getapi = (APIFUNCTION2)dlsym(metamod_handle, "GetEntityAPI2");
+	pfn_getnewapi = (NEW_DLL_FUNCTIONS_FN)dlsym(metamod_handle, "GetNewDLLFunctions");
+	if(!pfn_give_engfuncs || !pfn_getapi) {
+		fprintf(stderr, "mmreplay: %s doesn't look like metamod\n", metamod_path);
+		return(1);
+	}
+	(*pfn_give_engfuncs)(&standin, &globals);
+	version = INTERFACE_VERSION;
+	if(!(*pfn_getapi)(&dllapi_table, &version)) {
+		fprintf(stderr, "mmreplay: GetEntityAPI2 failed\n");
+		return(1);
+	}
+	version = NEW_DLL_FUNCTIONS_VERSION;
+	if(pfn_getnewapi)
+		(*pfn_getnewapi)(&newapi_table, &version);
+	if(dllapi_table.pfnGameInit)
+		(*dllapi_table.pfnGameInit)();
+
+	// replay
+	printf("Replaying %s (%s, %d clients)\n", argv[optind], gamedir, globals.maxClients);
+	replaying = 1;
+	start = now_usec();
+	while((hdr = rec_peek())) {
+		if(hdr->kind != REC_CALL) {
+			rec_advance(hdr);
+			stats.records_skipped++;
+			continue;
+		}
+		if(hdr->func < NUM_ENGINE_FUNCS) {
+			skip_call(hdr);
+			continue;
+		}
+		if(hdr->func == DLLAPI_FUNC(pfnStartFrame)) {
+			double t = now_usec();
+			if(frame_start) {
+				if(num_frames == max_frames) {
+					max_frames = max_frames ? max_frames * 2 : 4096;
+					frames = (double *)realloc(frames, max_frames * sizeof(double));
+				}
+				frames[num_frames++] = t - frame_start;
+			}
+			frame_start = t;
+		}
+		replay_call(hdr);
+		arena_used = 0;
+	}
+	total = now_usec() - start;
+	replaying = 0;
+
+	// report
+	printf("%lu calls replayed, %lu not replayable, %lu recorded calls not made\n",
+			stats.calls, stats.skipped_calls, stats.records_skipped);
+	printf("%lu engine calls answered from recording, %lu by stand-in\n",
+			stats.engine_matched, stats.engine_unmatched);
+	printf("%.3f ms total\n", total / 1000);
+	if(num_frames) {
+		if(frames_path && (fp = fopen(frames_path, "w"))) {
+			for(i = 0; i < (int)num_frames; i++)
+				fprintf(fp, "%.3f\n", frames[i]);
+			fclose(fp);
+		}
+		qsort(frames, num_frames, sizeof(double), compare_double);
+		for(i = 0, total = 0; i < (int)num_frames; i++)
+			total += frames[i];
+		printf("%u frames: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n", num_frames,
+				total / num_frames, frames[num_frames / 2], frames[(num_frames * 99) / 100], frames[num_frames - 1]);
+	}
+	return(0);
+}
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Convert a metamod hook trace dump (metatrace.bin, written by "meta trace
+# dump", on Sys_Error or on crash) to Chrome/Perfetto trace event JSON.
+# Load the result in chrome://tracing or https://ui.perfetto.dev.
+#
+# Usage: metatrace2json.py metatrace.bin [out.json]
+#
+# Every recorded call becomes a complete ("X") event.  Calls made from
+# inside another call (ie. engine functions called by the gamedll while
+# handling a dllapi call) nest under it by time.
+#
+
+import json
+import struct
+import sys
+
+HEADER = struct.Struct("<8s6Idq64s")
+RECORD = struct.Struct("<QQHHBBbB")
+FLAG_POST = 0x01
+MRES_NAMES = ["UNSET", "IGNORED", "HANDLED", "OVERRIDE", "SUPERCEDE"]
+
+
+def read_strings(data, pos, count):
+	strings = []
+	for _ in range(count):
+		end = data.index(b"\0", pos)
+		strings.append(data[pos:end].decode("latin-1"))
+		pos = end + 1
+	return strings, pos
+
+
+def convert(data):
+	(magic, version, header_size, record_size, num_records, num_funcs,
+	 num_plugins, ticks_per_usec, dump_tsc, reason) = HEADER.unpack_from(data, 0)
+	if magic.rstrip(b"\0") != b"MMTRACE":
+		raise ValueError("not a metamod trace dump")
+	if version != 2:
+		raise ValueError("unsupported trace dump version %d" % version)
+	if ticks_per_usec <= 0:
+		ticks_per_usec = 1000.0
+
+	funcs, pos = read_strings(data, header_size, num_funcs)
+	plugins, pos = read_strings(data, pos, num_plugins)
+	gamedll = plugins[0] or "gamedll"
+
+	records = []
+	for i in range(num_records):
+		records.append(RECORD.unpack_from(data, pos + i * record_size))
+	base = min([r[0] for r in records]) if records else dump_tsc
+
+	events = [{
+		"name": "process_name", "ph": "M", "pid": 1,
+		"args": {"name": "hlds (%s)" % gamedll},
+	}]
+	for start, end, func, plugin, flags, depth, mres, _ in records:
+		name = funcs[func] if func < len(funcs) else "#%d" % func
+		api, _, short = name.partition(".")
+		if flags & FLAG_POST:
+			short += "_Post"
+		if plugin == 0:
+			who = "engine" if api == "engine" else gamedll
+		else:
+			who = plugins[plugin] if plugin < len(plugins) and plugins[plugin] else "plugin %d" % plugin
+		args = {"plugin": who, "api": api, "depth": depth}
+		if mres >= 0:
+			args["mres"] = MRES_NAMES[mres] if mres < len(MRES_NAMES) else mres
+		events.append({
+			"name": "%s:%s" % (who, short),
+			"cat": api,
+			"ph": "X",
+			"pid": 1,
+			"tid": 1,
+			"ts": (start - base) / ticks_per_usec,
+			"dur": max(end - start, 0) / ticks_per_usec,
+			"args": args,
+		})
+
+	# Chrome wants enclosing spans first when start times are equal.
+	events[1:] = sorted(events[1:], key=lambda e: (e["ts"], -e["dur"]))
+	return {
+		"traceEvents": events,
+		"displayTimeUnit": "ns",
+		"otherData": {"reason": reason.rstrip(b"\0").decode("latin-1")},
+	}
+
+
+def main(argv):
+	if len(argv) < 2:
+		sys.stderr.write("usage: %s metatrace.bin [out.json]\n" % argv[0])
+		return 1
+	with open(argv[1], "rb") as f:
+		trace = convert(f.read())
+	if len(argv) > 2:
+		with open(argv[2], "w") as f:
+			json.dump(trace, f)
+	else:
+		json.dump(trace, sys.stdout)
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
@@ -0,0 +1,119 @@
+// vi: set ts=4 sw=4 :
+// vim: set tw=75 :
+
+// api_hook.h - api_caller names used in api_info.cpp
+
+/*
+ * Copyright (c) 2001-2006 Will Day <willday@hpgx.net>
+ *
+ *    This file is part of Metamod.
+ *
+ *    Metamod is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    Metamod is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Metamod; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef API_HOOK_H
+#define API_HOOK_H
+
+#include "api_info.h"		// api_caller_func_t
+
+// The dllapi/engine info tables in api_info.cpp are shared in layout with
+// metamod's, which keeps an argument format per function in the
+// api_caller field.  The plugin never calls through it, so the names only
+// need to exist; they are null here, as metamod's own api_hook.h used to
+// declare them for non-metamod builds.  Kept local so the plugin doesn't
+// include metamod internals.
+#define API_CALLER_STUB(ret_type, args_code) \
+	static const api_caller_func_t api_caller_##ret_type##_args_##args_code DLLHIDDEN = (api_caller_func_t)0
+
+API_CALLER_STUB(char, p);
+API_CALLER_STUB(float, 2f);
+API_CALLER_STUB(float, p);
+API_CALLER_STUB(float, void);
+API_CALLER_STUB(int, 2i);
+API_CALLER_STUB(int, 2p);
+API_CALLER_STUB(int, 2pi);
+API_CALLER_STUB(int, 3i);
+API_CALLER_STUB(int, 3p);
+API_CALLER_STUB(int, 3pi2p);
+API_CALLER_STUB(int, 4p);
+API_CALLER_STUB(int, i);
+API_CALLER_STUB(int, i2p);
+API_CALLER_STUB(int, ip);
+API_CALLER_STUB(int, p);
+API_CALLER_STUB(int, p2fi);
+API_CALLER_STUB(int, pi);
+API_CALLER_STUB(int, pi2p2ip);
+API_CALLER_STUB(int, void);
+API_CALLER_STUB(ptr, 2p);
+API_CALLER_STUB(ptr, 2pf);
+API_CALLER_STUB(ptr, 3p);
+API_CALLER_STUB(ptr, i);
+API_CALLER_STUB(ptr, p);
+API_CALLER_STUB(ptr, pi);
+API_CALLER_STUB(ptr, pip);
+API_CALLER_STUB(ptr, ui);
+API_CALLER_STUB(ptr, void);
+API_CALLER_STUB(uint, p);
+API_CALLER_STUB(ulong, ul);
+API_CALLER_STUB(ushort, ip);
+API_CALLER_STUB(void, 2i);
+API_CALLER_STUB(void, 2i2p);
+API_CALLER_STUB(void, 2i2pi2p);
+API_CALLER_STUB(void, 2p);
+API_CALLER_STUB(void, 2p2f);
+API_CALLER_STUB(void, 2p2i2p);
+API_CALLER_STUB(void, 2p3fus2uc);
+API_CALLER_STUB(void, 2pV);
+API_CALLER_STUB(void, 2pfi);
+API_CALLER_STUB(void, 2pi);
+API_CALLER_STUB(void, 2pi2p);
+API_CALLER_STUB(void, 2pif2p);
+API_CALLER_STUB(void, 2pui);
+API_CALLER_STUB(void, 3p);
+API_CALLER_STUB(void, 3p2f2i);
+API_CALLER_STUB(void, 4p);
+API_CALLER_STUB(void, 4pi);
+API_CALLER_STUB(void, f);
+API_CALLER_STUB(void, i);
+API_CALLER_STUB(void, i3p);
+API_CALLER_STUB(void, ip);
+API_CALLER_STUB(void, ipV);
+API_CALLER_STUB(void, ipusf2p2f4i);
+API_CALLER_STUB(void, p);
+API_CALLER_STUB(void, p2f);
+API_CALLER_STUB(void, p2i);
+API_CALLER_STUB(void, p3i);
+API_CALLER_STUB(void, p4i);
+API_CALLER_STUB(void, pf);
+API_CALLER_STUB(void, pfp);
+API_CALLER_STUB(void, pi);
+API_CALLER_STUB(void, pi2p);
+API_CALLER_STUB(void, pip);
+API_CALLER_STUB(void, pip2f2i);
+API_CALLER_STUB(void, pip2f4i2p);
+API_CALLER_STUB(void, puc);
+API_CALLER_STUB(void, void);
+
+#endif /* API_HOOK_H */